@@ -109,6 +109,14 @@ function(oblo_init_build_configurations)
         list(APPEND _oblo_cxx_compile_definitions "$<$<CONFIG:Debug>:OBLO_DEBUG>")
     endif()
 
+    if(OBLO_TRACK_ALLOCATIONS)
+        list(APPEND _oblo_cxx_compile_definitions "OBLO_TRACK_ALLOCATIONS")
+    endif()
+
+    if(OBLO_TRACE_RECORDER)
+        list(APPEND _oblo_cxx_compile_definitions "OBLO_TRACE_RECORDER")
+    endif()
+
     set_property(GLOBAL PROPERTY oblo_cxx_compile_options "${_oblo_cxx_compile_options}")
     set_property(GLOBAL PROPERTY oblo_cxx_compile_definitions "${_oblo_cxx_compile_definitions}")
     set_property(GLOBAL PROPERTY oblo_cxx_link_options "${_oblo_cxx_link_options}")
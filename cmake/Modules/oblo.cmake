@@ -17,9 +17,12 @@ option(OBLO_ENABLE_ASSERT "Enables internal asserts" OFF)
 option(OBLO_ENABLE_HOTRELOADING "Enables hot-reloading of dynamic libraries" OFF)
 option(OBLO_DISABLE_COMPILER_OPTIMIZATIONS "Disables compiler optimizations" OFF)
 option(OBLO_DEBUG "Activates code useful for debugging" OFF)
+option(OBLO_TRACK_ALLOCATIONS "Instruments the global allocators to track allocations per tag" OFF)
+option(OBLO_TRACE_RECORDER "Enables the built-in trace recorder for profile scopes, when Tracy is not in use" ON)
 option(OBLO_GENERATE_CSHARP "Enables C# projects" OFF)
 option(OBLO_WITH_DOTNET "Enables .NET modules" ON)
 option(OBLO_CONAN_FORCE_INSTALL "Always runs conan install, regardless of conanfile being modified" OFF)
+option(OBLO_BUILD_BENCHMARKS "Builds the micro-benchmarks suite" OFF)
 set(OBLO_EXTRA_MODULE_DIRS "" CACHE STRING "A list of directories for extra modules to include in the project")
 
 define_property(GLOBAL PROPERTY oblo_cxx_compile_options BRIEF_DOCS "C++ compile options for oblo targets")
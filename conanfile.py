@@ -52,6 +52,9 @@ class ObloConanRecipe(ConanFile):
         # This is only needed for unit tests
         self.requires("eigen/3.4.0")
 
+        # This is only needed for the micro-benchmarks (OBLO_BUILD_BENCHMARKS)
+        self.requires("benchmark/1.8.3")
+
         if self.options.with_tracy:
             self.requires("tracy/0.13.1")
 
@@ -0,0 +1,255 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/core/deque.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/flat_dense_map.hpp>
+#include <oblo/core/handle.hpp>
+#include <oblo/core/handle_flat_pool_map.hpp>
+#include <oblo/core/random_generator.hpp>
+
+namespace oblo
+{
+    namespace
+    {
+        void dynamic_array_push_back(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            for (auto _ : state)
+            {
+                dynamic_array<u32> array;
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    array.push_back(i);
+                }
+
+                benchmark::DoNotOptimize(array.data());
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void dynamic_array_push_back_reserved(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            for (auto _ : state)
+            {
+                dynamic_array<u32> array;
+                array.reserve(n);
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    array.push_back(i);
+                }
+
+                benchmark::DoNotOptimize(array.data());
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void dynamic_array_iterate(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            dynamic_array<u32> array;
+            array.resize(n, 1u);
+
+            for (auto _ : state)
+            {
+                u32 sum{};
+
+                for (const u32 v : array)
+                {
+                    sum += v;
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void deque_push_back_pop_front(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            deque<u32> queue;
+
+            for (auto _ : state)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    queue.push_back(i);
+                }
+
+                while (!queue.empty())
+                {
+                    benchmark::DoNotOptimize(queue.front());
+                    queue.pop_front();
+                }
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void deque_random_access(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            deque<u32> queue;
+            queue.assign(usize{n}, 1u);
+
+            random_generator rng;
+            rng.seed(42);
+
+            dynamic_array<u32> indices;
+            indices.reserve(n);
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                indices.push_back(rng.generate() % n);
+            }
+
+            for (auto _ : state)
+            {
+                u32 sum{};
+
+                for (const u32 i : indices)
+                {
+                    sum += queue[i];
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void flat_dense_map_emplace_erase(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            for (auto _ : state)
+            {
+                flat_dense_map<u32, u64> map;
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    map.emplace(i * 3, u64{i});
+                }
+
+                for (u32 i = 0; i < n; i += 2)
+                {
+                    map.erase(i * 3);
+                }
+
+                benchmark::DoNotOptimize(map.size());
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void flat_dense_map_find(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            flat_dense_map<u32, u64> map;
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                map.emplace(i * 3, u64{i});
+            }
+
+            for (auto _ : state)
+            {
+                u64 sum{};
+
+                for (u32 i = 0; i < n * 3; ++i)
+                {
+                    if (const auto* const v = map.try_find(i))
+                    {
+                        sum += *v;
+                    }
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * n * 3);
+        }
+
+        struct benchmark_entity;
+
+        void handle_flat_pool_map_emplace_erase(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            dynamic_array<h32<benchmark_entity>> handles;
+            handles.reserve(n);
+
+            for (auto _ : state)
+            {
+                h32_flat_pool_dense_map<benchmark_entity, u64> map;
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    handles.push_back(map.emplace(u64{i}).second);
+                }
+
+                for (const auto h : handles)
+                {
+                    map.erase(h);
+                }
+
+                handles.clear();
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void handle_flat_pool_map_find(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            dynamic_array<h32<benchmark_entity>> handles;
+            handles.reserve(n);
+
+            h32_flat_pool_dense_map<benchmark_entity, u64> map;
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                handles.push_back(map.emplace(u64{i}).second);
+            }
+
+            for (auto _ : state)
+            {
+                u64 sum{};
+
+                for (const auto h : handles)
+                {
+                    sum += *map.try_find(h);
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+    }
+
+    BENCHMARK(dynamic_array_push_back)->Range(1 << 6, 1 << 16);
+    BENCHMARK(dynamic_array_push_back_reserved)->Range(1 << 6, 1 << 16);
+    BENCHMARK(dynamic_array_iterate)->Range(1 << 10, 1 << 20);
+
+    BENCHMARK(deque_push_back_pop_front)->Range(1 << 6, 1 << 16);
+    BENCHMARK(deque_random_access)->Range(1 << 10, 1 << 20);
+
+    BENCHMARK(flat_dense_map_emplace_erase)->Range(1 << 6, 1 << 16);
+    BENCHMARK(flat_dense_map_find)->Range(1 << 6, 1 << 16);
+
+    BENCHMARK(handle_flat_pool_map_emplace_erase)->Range(1 << 6, 1 << 16);
+    BENCHMARK(handle_flat_pool_map_find)->Range(1 << 6, 1 << 16);
+}
@@ -0,0 +1,668 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/acceleration/bvh.hpp>
+#include <oblo/acceleration/quantized_bvh.hpp>
+#include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/mat4.hpp>
+#include <oblo/math/quaternion.hpp>
+#include <oblo/math/random.hpp>
+#include <oblo/math/triangle.hpp>
+#include <oblo/math/vec3.hpp>
+#include <oblo/raytracer/camera.hpp>
+#include <oblo/raytracer/material.hpp>
+#include <oblo/raytracer/raytracer.hpp>
+#include <oblo/thread/job_manager.hpp>
+
+#include <tinygltf/implementation.hpp>
+
+#include <cstring>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+// Unfortunately tiny_gltf includes Windows.h
+#ifdef GetObject
+    #undef GetObject
+#endif
+
+namespace oblo
+{
+    namespace
+    {
+        enum class sample_model : u8
+        {
+            duck,
+            damaged_helmet,
+            flight_helmet,
+            sponza,
+            enum_max,
+        };
+
+        constexpr const char* SampleModelPaths[] = {
+            OBLO_GLTF_SAMPLE_MODELS "/Models/Duck/glTF-Binary/Duck.glb",
+            OBLO_GLTF_SAMPLE_MODELS "/Models/DamagedHelmet/glTF-Binary/DamagedHelmet.glb",
+            OBLO_GLTF_SAMPLE_MODELS "/Models/FlightHelmet/glTF/FlightHelmet.gltf",
+            OBLO_GLTF_SAMPLE_MODELS "/Models/Sponza/glTF/Sponza.gltf",
+        };
+
+        static_assert(std::size(SampleModelPaths) == u32(sample_model::enum_max));
+
+        // Rays are traced on a fixed grid, so that the numbers don't depend on the resolution of the benchmark machine
+        constexpr u32 RaysGridSize{256};
+
+        mat4 make_node_transform(const tinygltf::Node& node)
+        {
+            mat4 m = mat4::identity();
+
+            if (node.matrix.size() == 16)
+            {
+                for (u32 column = 0; column < 4; ++column)
+                {
+                    for (u32 row = 0; row < 4; ++row)
+                    {
+                        m.at(row, column) = f32(node.matrix[column * 4 + row]);
+                    }
+                }
+
+                return m;
+            }
+
+            vec3 t{0.f, 0.f, 0.f};
+            quaternion r = quaternion::identity();
+            vec3 s{1.f, 1.f, 1.f};
+
+            if (node.translation.size() == 3)
+            {
+                t = {f32(node.translation[0]), f32(node.translation[1]), f32(node.translation[2])};
+            }
+
+            if (node.rotation.size() == 4)
+            {
+                r = {f32(node.rotation[0]), f32(node.rotation[1]), f32(node.rotation[2]), f32(node.rotation[3])};
+            }
+
+            if (node.scale.size() == 3)
+            {
+                s = {f32(node.scale[0]), f32(node.scale[1]), f32(node.scale[2])};
+            }
+
+            const vec3 x = r * vec3{s.x, 0.f, 0.f};
+            const vec3 y = r * vec3{0.f, s.y, 0.f};
+            const vec3 z = r * vec3{0.f, 0.f, s.z};
+
+            m.columns[0] = {x.x, x.y, x.z, 0.f};
+            m.columns[1] = {y.x, y.y, y.z, 0.f};
+            m.columns[2] = {z.x, z.y, z.z, 0.f};
+            m.columns[3] = {t.x, t.y, t.z, 1.f};
+
+            return m;
+        }
+
+        vec3 read_position(const tinygltf::Model& model, const tinygltf::Accessor& accessor, u32 index)
+        {
+            const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+            const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+            const usize stride = bufferView.byteStride == 0 ? sizeof(vec3) : bufferView.byteStride;
+            const usize offset = bufferView.byteOffset + accessor.byteOffset + stride * index;
+
+            vec3 position;
+            std::memcpy(&position, buffer.data.data() + offset, sizeof(vec3));
+
+            return position;
+        }
+
+        u32 read_index(const tinygltf::Model& model, const tinygltf::Accessor& accessor, u32 index)
+        {
+            const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+            const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+            const unsigned char* const data = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+
+            switch (accessor.componentType)
+            {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                return data[index];
+
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                u16 value;
+                std::memcpy(&value, data + index * sizeof(u16), sizeof(u16));
+                return value;
+            }
+
+            default: {
+                u32 value;
+                std::memcpy(&value, data + index * sizeof(u32), sizeof(u32));
+                return value;
+            }
+            }
+        }
+
+        void append_mesh_triangles(
+            const tinygltf::Model& model, const tinygltf::Mesh& mesh, const mat4& transform, std::vector<triangle>& out)
+        {
+            for (const tinygltf::Primitive& primitive : mesh.primitives)
+            {
+                const auto it = primitive.attributes.find("POSITION");
+
+                if (primitive.mode != TINYGLTF_MODE_TRIANGLES || it == primitive.attributes.end())
+                {
+                    continue;
+                }
+
+                const tinygltf::Accessor& positions = model.accessors[it->second];
+
+                if (positions.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || positions.type != TINYGLTF_TYPE_VEC3)
+                {
+                    continue;
+                }
+
+                const tinygltf::Accessor* const indices =
+                    primitive.indices >= 0 ? &model.accessors[primitive.indices] : nullptr;
+
+                const u32 verticesCount = u32(indices ? indices->count : positions.count);
+
+                for (u32 i = 0; i + 2 < verticesCount; i += 3)
+                {
+                    triangle& t = out.emplace_back();
+
+                    for (u32 v = 0; v < 3; ++v)
+                    {
+                        const u32 vertex = indices ? read_index(model, *indices, i + v) : i + v;
+                        const vec3 p = read_position(model, positions, vertex);
+                        const vec4 world = transform * vec4{p.x, p.y, p.z, 1.f};
+
+                        t.v[v] = {world.x, world.y, world.z};
+                    }
+                }
+            }
+        }
+
+        void append_node_triangles(
+            const tinygltf::Model& model, i32 nodeIndex, const mat4& parentTransform, std::vector<triangle>& out)
+        {
+            const tinygltf::Node& node = model.nodes[nodeIndex];
+            const mat4 transform = parentTransform * make_node_transform(node);
+
+            if (node.mesh >= 0)
+            {
+                append_mesh_triangles(model, model.meshes[node.mesh], transform, out);
+            }
+
+            for (const i32 child : node.children)
+            {
+                append_node_triangles(model, child, transform, out);
+            }
+        }
+
+        /// @brief Loads the triangles of the default scene of a glTF file, flattened in world space.
+        bool load_triangles(const char* path, std::vector<triangle>& out)
+        {
+            tinygltf::TinyGLTF loader;
+
+            // Only the geometry is needed, skip decoding the images
+            loader.SetImageLoader([](tinygltf::Image*,
+                                      int,
+                                      std::string*,
+                                      std::string*,
+                                      int,
+                                      int,
+                                      const unsigned char*,
+                                      int,
+                                      void*) { return true; },
+                nullptr);
+
+            tinygltf::Model model;
+            std::string errors;
+            std::string warnings;
+
+            const bool isBinary = std::string_view{path}.ends_with(".glb");
+
+            const bool success = isBinary ? loader.LoadBinaryFromFile(&model, &errors, &warnings, path)
+                                          : loader.LoadASCIIFromFile(&model, &errors, &warnings, path);
+
+            if (!success || model.scenes.empty())
+            {
+                return false;
+            }
+
+            const auto& scene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+
+            for (const i32 node : scene.nodes)
+            {
+                append_node_triangles(model, node, mat4::identity(), out);
+            }
+
+            return !out.empty();
+        }
+
+        /// @brief Loads each model once, the first time a benchmark needs it.
+        /// @return The triangles of the model, or nullptr if the model could not be loaded, e.g. because the sample
+        /// assets are not checked out.
+        const std::vector<triangle>* get_triangles(sample_model model)
+        {
+            static std::optional<std::vector<triangle>> s_models[u32(sample_model::enum_max)];
+
+            auto& triangles = s_models[u32(model)];
+
+            if (!triangles)
+            {
+                triangles.emplace();
+
+                if (!load_triangles(SampleModelPaths[u32(model)], *triangles))
+                {
+                    triangles->clear();
+                }
+            }
+
+            return triangles->empty() ? nullptr : &*triangles;
+        }
+
+        const std::vector<triangle>* get_triangles_or_skip(benchmark::State& state, sample_model model)
+        {
+            const auto* const triangles = get_triangles(model);
+
+            if (!triangles)
+            {
+                state.SkipWithError("Failed to load the sample model, are the glTF sample assets checked out?");
+            }
+
+            return triangles;
+        }
+
+        /// @brief A scene with a single instance of a sample model, and the hits of primary rays cast on a grid from a
+        /// camera framing the whole model, which are the starting points of secondary rays.
+        struct sample_scene
+        {
+            raytracer rt;
+            std::vector<ray> primaryRays;
+            std::vector<vec3> hitPositions;
+            std::vector<vec3> hitNormals;
+            vec3 lightPosition;
+        };
+
+        bool init_scene(sample_scene& scene, const std::vector<triangle>& triangles)
+        {
+            triangle_container container;
+            container.add(triangles);
+
+            const u32 mesh = scene.rt.add_mesh(std::move(container));
+            const u32 material = scene.rt.add_material({.albedo = {.5f, .5f, .5f}, .emissive = {}});
+
+            scene.rt.add_instance({.mesh = mesh, .material = material});
+            scene.rt.rebuild_tlas();
+
+            const triangle_container& meshTriangles = scene.rt.get_meshes()[mesh];
+            const aabb bounds = meshTriangles.primitives_bounds(0, meshTriangles.size());
+            const vec3 center = (bounds.min + bounds.max) * .5f;
+            const f32 radius = length(bounds.max - bounds.min) * .5f;
+
+            camera cam{};
+            camera_set_look_at(cam, center + vec3{.5f, .5f, -2.f} * radius, center, vec3{0.f, 1.f, 0.f});
+            camera_set_horizontal_fov(cam, 60_deg);
+            camera_set_vertical_fov(cam, 60_deg);
+
+            scene.lightPosition = center + vec3{0.f, 2.f * radius, 0.f};
+
+            scene.primaryRays.reserve(RaysGridSize * RaysGridSize);
+
+            for (u32 y = 0; y < RaysGridSize; ++y)
+            {
+                for (u32 x = 0; x < RaysGridSize; ++x)
+                {
+                    const vec2 uv{
+                        2.f * (x + .5f) / RaysGridSize - 1.f,
+                        2.f * (y + .5f) / RaysGridSize - 1.f,
+                    };
+
+                    scene.primaryRays.push_back(ray_cast(cam, uv));
+                }
+            }
+
+            const auto normals = meshTriangles.get_normals();
+
+            for (const ray& r : scene.primaryRays)
+            {
+                if (raytracer_result result; scene.rt.intersect(r, result))
+                {
+                    const vec3 normal = normals[result.triangle];
+
+                    scene.hitPositions.push_back(r.origin + r.direction * result.distance);
+                    scene.hitNormals.push_back(dot(normal, r.direction) > 0.f ? -normal : normal);
+                }
+            }
+
+            return !scene.hitPositions.empty();
+        }
+
+        void set_scene_counters(benchmark::State& state, const sample_scene& scene, usize rays)
+        {
+            state.counters["rays_per_second"] = benchmark::Counter(f64(state.iterations() * rays),
+                benchmark::Counter::kIsRate);
+            state.counters["primary_hit_ratio"] = f64(scene.hitPositions.size()) / scene.primaryRays.size();
+        }
+
+        void set_memory_counters(benchmark::State& state, const bvh& bvh, const triangle_container& triangles)
+        {
+            state.counters["triangles"] = triangles.size();
+            state.counters["nodes"] = bvh.get_nodes_count();
+            state.counters["sah_cost"] = bvh.compute_sah_cost();
+            state.counters["bvh_bytes"] =
+                benchmark::Counter(f64(bvh.get_memory_footprint()), {}, benchmark::Counter::kIs1024);
+            state.counters["triangles_bytes"] =
+                benchmark::Counter(f64(triangles.get_memory_footprint()), {}, benchmark::Counter::kIs1024);
+        }
+
+        void cpurt_bvh_build(benchmark::State& state, sample_model model)
+        {
+            const auto* const triangles = get_triangles_or_skip(state, model);
+
+            if (!triangles)
+            {
+                return;
+            }
+
+            triangle_container source;
+            source.add(*triangles);
+
+            triangle_container container;
+            bvh bvh;
+
+            for (auto _ : state)
+            {
+                // The build reorders the primitives, so each iteration starts over from the original order
+                state.PauseTiming();
+                container = source;
+                state.ResumeTiming();
+
+                bvh.build(container);
+                benchmark::DoNotOptimize(bvh);
+            }
+
+            set_memory_counters(state, bvh, container);
+        }
+
+        void cpurt_bvh_build_parallel(benchmark::State& state, sample_model model)
+        {
+            const auto* const triangles = get_triangles_or_skip(state, model);
+
+            if (!triangles)
+            {
+                return;
+            }
+
+            job_manager jm;
+
+            if (!jm.init())
+            {
+                state.SkipWithError("Failed to initialize the job manager");
+                return;
+            }
+
+            triangle_container source;
+            source.add(*triangles);
+
+            triangle_container container;
+            bvh bvh;
+
+            for (auto _ : state)
+            {
+                state.PauseTiming();
+                container = source;
+                state.ResumeTiming();
+
+                bvh.build_parallel(container);
+                benchmark::DoNotOptimize(bvh);
+            }
+
+            set_memory_counters(state, bvh, container);
+
+            jm.shutdown();
+        }
+
+        void cpurt_primary_rays(benchmark::State& state, sample_model model)
+        {
+            const auto* const triangles = get_triangles_or_skip(state, model);
+
+            if (!triangles)
+            {
+                return;
+            }
+
+            sample_scene scene;
+
+            if (!init_scene(scene, *triangles))
+            {
+                state.SkipWithError("The camera doesn't see the model");
+                return;
+            }
+
+            for (auto _ : state)
+            {
+                for (const ray& r : scene.primaryRays)
+                {
+                    raytracer_result result;
+                    benchmark::DoNotOptimize(scene.rt.intersect(r, result));
+                }
+            }
+
+            set_scene_counters(state, scene, scene.primaryRays.size());
+        }
+
+        void cpurt_diffuse_rays(benchmark::State& state, sample_model model)
+        {
+            const auto* const triangles = get_triangles_or_skip(state, model);
+
+            if (!triangles)
+            {
+                return;
+            }
+
+            sample_scene scene;
+
+            if (!init_scene(scene, *triangles))
+            {
+                state.SkipWithError("The camera doesn't see the model");
+                return;
+            }
+
+            // The first bounce off the primary hits, which is incoherent and dominates the cost of path tracing
+            std::mt19937 rng{42};
+
+            std::vector<ray> rays;
+            rays.reserve(scene.hitPositions.size());
+
+            for (usize i = 0; i < scene.hitPositions.size(); ++i)
+            {
+                const vec3 direction = hemisphere_uniform_sample(rng, scene.hitNormals[i]);
+                rays.push_back({scene.hitPositions[i] + direction * .001f, direction});
+            }
+
+            for (auto _ : state)
+            {
+                for (const ray& r : rays)
+                {
+                    raytracer_result result;
+                    benchmark::DoNotOptimize(scene.rt.intersect(r, result));
+                }
+            }
+
+            set_scene_counters(state, scene, rays.size());
+        }
+
+        void cpurt_occlusion_rays(benchmark::State& state, sample_model model)
+        {
+            const auto* const triangles = get_triangles_or_skip(state, model);
+
+            if (!triangles)
+            {
+                return;
+            }
+
+            sample_scene scene;
+
+            if (!init_scene(scene, *triangles))
+            {
+                state.SkipWithError("The camera doesn't see the model");
+                return;
+            }
+
+            // Shadow rays from the primary hits towards a point light above the model
+            std::vector<ray> rays;
+            std::vector<f32> maxDistances;
+
+            rays.reserve(scene.hitPositions.size());
+            maxDistances.reserve(scene.hitPositions.size());
+
+            for (usize i = 0; i < scene.hitPositions.size(); ++i)
+            {
+                const vec3 toLight = scene.lightPosition - scene.hitPositions[i];
+                const f32 distance = length(toLight);
+                const vec3 direction = toLight / distance;
+
+                rays.push_back({scene.hitPositions[i] + direction * .001f, direction});
+                maxDistances.push_back(distance);
+            }
+
+            u32 occludedCount{};
+
+            for (auto _ : state)
+            {
+                occludedCount = 0;
+
+                for (usize i = 0; i < rays.size(); ++i)
+                {
+                    occludedCount += u32{scene.rt.occluded(rays[i], maxDistances[i])};
+                }
+
+                benchmark::DoNotOptimize(occludedCount);
+            }
+
+            set_scene_counters(state, scene, rays.size());
+            state.counters["occluded_ratio"] = f64(occludedCount) / rays.size();
+        }
+
+        /// @brief Traces the primary rays of the scene directly against a BLAS, to compare node formats without the
+        /// overhead of the TLAS and the instance transforms.
+        template <typename F>
+        void trace_blas_primary_rays(benchmark::State& state, sample_model model, F&& makeBlas)
+        {
+            const auto* const triangles = get_triangles_or_skip(state, model);
+
+            if (!triangles)
+            {
+                return;
+            }
+
+            sample_scene scene;
+
+            if (!init_scene(scene, *triangles))
+            {
+                state.SkipWithError("The camera doesn't see the model");
+                return;
+            }
+
+            triangle_container container;
+            container.add(*triangles);
+
+            bvh binaryBvh;
+            binaryBvh.build(container);
+
+            const auto blas = makeBlas(std::move(binaryBvh));
+
+            for (auto _ : state)
+            {
+                for (const ray& r : scene.primaryRays)
+                {
+                    f32 hitDistance{};
+
+                    blas.traverse(r,
+                        [&r, &container, &hitDistance](u32 offset, u16 numPrimitives, f32& distance)
+                        {
+                            if (triangle_container::hit_result result;
+                                container.intersect(r, offset, numPrimitives, distance, result))
+                            {
+                                hitDistance = distance;
+                            }
+                        });
+
+                    benchmark::DoNotOptimize(hitDistance);
+                }
+            }
+
+            set_scene_counters(state, scene, scene.primaryRays.size());
+            state.counters["nodes"] = blas.get_nodes_count();
+            state.counters["bvh_bytes"] =
+                benchmark::Counter(f64(blas.get_memory_footprint()), {}, benchmark::Counter::kIs1024);
+        }
+
+        void cpurt_blas_primary_rays(benchmark::State& state, sample_model model)
+        {
+            trace_blas_primary_rays(state, model, [](bvh&& source) { return std::move(source); });
+        }
+
+        void cpurt_quantized_blas_primary_rays(benchmark::State& state, sample_model model)
+        {
+            trace_blas_primary_rays(state,
+                model,
+                [](bvh&& source)
+                {
+                    quantized_bvh quantizedBvh;
+                    quantizedBvh.build(source);
+                    return quantizedBvh;
+                });
+        }
+    }
+
+    BENCHMARK_CAPTURE(cpurt_bvh_build, duck, sample_model::duck)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_bvh_build, damaged_helmet, sample_model::damaged_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_bvh_build, flight_helmet, sample_model::flight_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_bvh_build, sponza, sample_model::sponza)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(cpurt_bvh_build_parallel, duck, sample_model::duck)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(cpurt_bvh_build_parallel, damaged_helmet, sample_model::damaged_helmet)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(cpurt_bvh_build_parallel, flight_helmet, sample_model::flight_helmet)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(cpurt_bvh_build_parallel, sponza, sample_model::sponza)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+    BENCHMARK_CAPTURE(cpurt_primary_rays, duck, sample_model::duck)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_primary_rays, damaged_helmet, sample_model::damaged_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_primary_rays, flight_helmet, sample_model::flight_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_primary_rays, sponza, sample_model::sponza)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(cpurt_diffuse_rays, duck, sample_model::duck)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_diffuse_rays, damaged_helmet, sample_model::damaged_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_diffuse_rays, flight_helmet, sample_model::flight_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_diffuse_rays, sponza, sample_model::sponza)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(cpurt_occlusion_rays, duck, sample_model::duck)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_occlusion_rays, damaged_helmet, sample_model::damaged_helmet)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_occlusion_rays, flight_helmet, sample_model::flight_helmet)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_occlusion_rays, sponza, sample_model::sponza)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(cpurt_blas_primary_rays, duck, sample_model::duck)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_blas_primary_rays, damaged_helmet, sample_model::damaged_helmet)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_blas_primary_rays, flight_helmet, sample_model::flight_helmet)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_blas_primary_rays, sponza, sample_model::sponza)->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(cpurt_quantized_blas_primary_rays, duck, sample_model::duck)->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_quantized_blas_primary_rays, damaged_helmet, sample_model::damaged_helmet)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_quantized_blas_primary_rays, flight_helmet, sample_model::flight_helmet)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(cpurt_quantized_blas_primary_rays, sponza, sample_model::sponza)
+        ->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,118 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/hash.hpp>
+#include <oblo/core/utility.hpp>
+#include <oblo/core/uuid.hpp>
+
+namespace oblo
+{
+    namespace
+    {
+        dynamic_array<byte> make_bytes(usize size)
+        {
+            dynamic_array<byte> bytes;
+            bytes.resize(size);
+
+            for (usize i = 0; i < size; ++i)
+            {
+                bytes[i] = byte(i * 31 + 7);
+            }
+
+            return bytes;
+        }
+
+        void hash_xxh64_bytes(benchmark::State& state)
+        {
+            const auto bytes = make_bytes(usize(state.range(0)));
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(hash_xxh64(bytes.data(), bytes.size()));
+            }
+
+            state.SetBytesProcessed(state.iterations() * state.range(0));
+        }
+
+        void hash_xxh3_bytes(benchmark::State& state)
+        {
+            const auto bytes = make_bytes(usize(state.range(0)));
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(hash_xxh3(bytes.data(), bytes.size()));
+            }
+
+            state.SetBytesProcessed(state.iterations() * state.range(0));
+        }
+
+        void hasher_streaming(benchmark::State& state)
+        {
+            const auto bytes = make_bytes(usize(state.range(0)));
+            constexpr usize chunkSize{256};
+
+            for (auto _ : state)
+            {
+                hasher h;
+
+                for (usize offset = 0; offset < bytes.size(); offset += chunkSize)
+                {
+                    h.update(bytes.data() + offset, min(chunkSize, bytes.size() - offset));
+                }
+
+                benchmark::DoNotOptimize(h.digest());
+            }
+
+            state.SetBytesProcessed(state.iterations() * state.range(0));
+        }
+
+        void hash_integers(benchmark::State& state)
+        {
+            u64 sum{};
+
+            for (auto _ : state)
+            {
+                for (u64 i = 0; i < 1024; ++i)
+                {
+                    sum += hash<u64>{}(i);
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * 1024);
+        }
+
+        void hash_uuids(benchmark::State& state)
+        {
+            uuid ids[64];
+
+            for (u8 i = 0; i < 64; ++i)
+            {
+                ids[i].data[0] = i;
+                ids[i].data[15] = u8(i * 7);
+            }
+
+            for (auto _ : state)
+            {
+                usize sum{};
+
+                for (const auto& id : ids)
+                {
+                    sum += hash<uuid>{}(id);
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * 64);
+        }
+    }
+
+    BENCHMARK(hash_xxh64_bytes)->RangeMultiplier(4)->Range(8, 1 << 20);
+    BENCHMARK(hash_xxh3_bytes)->RangeMultiplier(4)->Range(8, 1 << 20);
+    BENCHMARK(hasher_streaming)->RangeMultiplier(4)->Range(1 << 10, 1 << 20);
+
+    BENCHMARK(hash_integers);
+    BENCHMARK(hash_uuids);
+}
@@ -0,0 +1,157 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/mat4.hpp>
+#include <oblo/math/quaternion.hpp>
+#include <oblo/math/ray.hpp>
+#include <oblo/math/ray_intersection.hpp>
+#include <oblo/math/triangle.hpp>
+#include <oblo/math/vec3.hpp>
+
+#include <random>
+
+namespace oblo
+{
+    namespace
+    {
+        constexpr u32 ElementsCount{1024};
+
+        dynamic_array<vec3> make_points(u32 count, u32 seed)
+        {
+            std::mt19937 rng{seed};
+            std::uniform_real_distribution<f32> dist{-1.f, 1.f};
+
+            dynamic_array<vec3> points;
+            points.reserve(count);
+
+            for (u32 i = 0; i < count; ++i)
+            {
+                points.push_back({dist(rng), dist(rng), dist(rng)});
+            }
+
+            return points;
+        }
+
+        void math_mat4_multiply(benchmark::State& state)
+        {
+            const auto points = make_points(8, 1);
+
+            mat4 m = mat4::identity();
+
+            for (u32 i = 0; i < 4; ++i)
+            {
+                m.columns[i] = {points[2 * i].x, points[2 * i].y, points[2 * i].z, points[2 * i + 1].x};
+            }
+
+            mat4 r = mat4::identity();
+
+            for (auto _ : state)
+            {
+                r = r * m;
+                benchmark::DoNotOptimize(r);
+            }
+        }
+
+        void math_mat4_inverse(benchmark::State& state)
+        {
+            const mat4 m = {
+                .columns =
+                    {
+                        {2.f, 0.f, 0.f, 0.f},
+                        {0.f, 3.f, 1.f, 0.f},
+                        {0.f, 1.f, 4.f, 0.f},
+                        {1.f, 2.f, 3.f, 1.f},
+                    },
+            };
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(inverse(m));
+            }
+        }
+
+        void math_quaternion_transform(benchmark::State& state)
+        {
+            const auto points = make_points(ElementsCount, 2);
+            const auto q = quaternion::from_axis_angle(normalize(vec3{1.f, 2.f, 3.f}), radians{.5f});
+
+            for (auto _ : state)
+            {
+                vec3 sum{};
+
+                for (const auto& p : points)
+                {
+                    sum = sum + transform(q, p);
+                }
+
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * ElementsCount);
+        }
+
+        void math_ray_triangle(benchmark::State& state)
+        {
+            const auto points = make_points(ElementsCount * 3, 3);
+
+            const ray r{
+                .origin = {0.f, 0.f, -5.f},
+                .direction = normalize(vec3{.1f, .05f, 1.f}),
+            };
+
+            for (auto _ : state)
+            {
+                u32 hits{};
+
+                for (u32 i = 0; i < ElementsCount; ++i)
+                {
+                    const triangle t{{points[3 * i], points[3 * i + 1], points[3 * i + 2]}};
+
+                    f32 distance;
+                    hits += u32{intersect(r, t, distance)};
+                }
+
+                benchmark::DoNotOptimize(hits);
+            }
+
+            state.SetItemsProcessed(state.iterations() * ElementsCount);
+        }
+
+        void math_ray_aabb(benchmark::State& state)
+        {
+            const auto points = make_points(ElementsCount * 2, 4);
+
+            const ray r{
+                .origin = {0.f, 0.f, -5.f},
+                .direction = normalize(vec3{.1f, .05f, 1.f}),
+            };
+
+            for (auto _ : state)
+            {
+                u32 hits{};
+
+                for (u32 i = 0; i < ElementsCount; ++i)
+                {
+                    const aabb box{
+                        .min = min(points[2 * i], points[2 * i + 1]),
+                        .max = max(points[2 * i], points[2 * i + 1]),
+                    };
+
+                    f32 t0, t1;
+                    hits += u32{intersect(r, box, 100.f, t0, t1)};
+                }
+
+                benchmark::DoNotOptimize(hits);
+            }
+
+            state.SetItemsProcessed(state.iterations() * ElementsCount);
+        }
+    }
+
+    BENCHMARK(math_mat4_multiply);
+    BENCHMARK(math_mat4_inverse);
+    BENCHMARK(math_quaternion_transform);
+    BENCHMARK(math_ray_triangle);
+    BENCHMARK(math_ray_aabb);
+}
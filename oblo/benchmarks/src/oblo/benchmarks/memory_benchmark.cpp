@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/core/frame_allocator.hpp>
+#include <oblo/core/string/hashed_string_view.hpp>
+#include <oblo/core/string/string_interner.hpp>
+#include <oblo/core/suballocation/buffer_table.hpp>
+
+namespace oblo
+{
+    namespace
+    {
+        void frame_allocator_allocate(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            frame_allocator allocator;
+            allocator.init(1u << 30);
+
+            for (auto _ : state)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    benchmark::DoNotOptimize(allocator.allocate(16 + (i % 8) * 32, 16));
+                }
+
+                allocator.restore_all();
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void frame_allocator_scoped_restore(benchmark::State& state)
+        {
+            frame_allocator allocator;
+            allocator.init(1u << 30);
+
+            for (auto _ : state)
+            {
+                const auto restore = allocator.make_scoped_restore();
+                benchmark::DoNotOptimize(allocator.allocate(256, 16));
+            }
+        }
+
+        struct position
+        {
+            f32 x, y, z;
+        };
+
+        struct tex_coord
+        {
+            f32 u, v;
+        };
+
+        void buffer_table_init_find(benchmark::State& state)
+        {
+            string_interner interner;
+            interner.init(4);
+
+            const auto posName = interner.get_or_add("position"_hsv).rebind<buffer_table_name>();
+            const auto nrmName = interner.get_or_add("normal"_hsv).rebind<buffer_table_name>();
+            const auto uvName = interner.get_or_add("tex_coord"_hsv).rebind<buffer_table_name>();
+
+            const buffer_table::column_description columns[] = {
+                {.name = posName, .elementSize = sizeof(position)},
+                {.name = nrmName, .elementSize = sizeof(position)},
+                {.name = uvName, .elementSize = sizeof(tex_coord)},
+            };
+
+            for (auto _ : state)
+            {
+                buffer_table table;
+                benchmark::DoNotOptimize(table.init(0, 1u << 20, columns, 1024, 16));
+
+                benchmark::DoNotOptimize(table.find(posName));
+                benchmark::DoNotOptimize(table.find(nrmName));
+                benchmark::DoNotOptimize(table.find(uvName));
+            }
+        }
+    }
+
+    BENCHMARK(frame_allocator_allocate)->Range(1 << 6, 1 << 16);
+    BENCHMARK(frame_allocator_scoped_restore);
+
+    BENCHMARK(buffer_table_init_find);
+}
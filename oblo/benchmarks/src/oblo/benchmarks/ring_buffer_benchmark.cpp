@@ -0,0 +1,201 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/core/thread/mpmc_ring_buffer.hpp>
+#include <oblo/core/thread/spin_wait.hpp>
+#include <oblo/core/thread/spsc_ring_buffer.hpp>
+#include <oblo/core/types.hpp>
+
+#include <moodycamel/concurrentqueue.h>
+
+#include <array>
+#include <thread>
+
+namespace oblo
+{
+    namespace
+    {
+        constexpr usize QueueCapacity{4096};
+        constexpr usize BatchSize{32};
+        constexpr u64 ThreadedItems{1u << 16};
+
+        // Thin adapters so the same benchmark body can drive every queue
+
+        template <typename Queue>
+        struct queue_adapter;
+
+        template <>
+        struct queue_adapter<spsc_ring_buffer<u64>>
+        {
+            spsc_ring_buffer<u64> queue{QueueCapacity};
+
+            bool try_push(u64 v)
+            {
+                return queue.try_push(v);
+            }
+
+            bool try_pop(u64& v)
+            {
+                return queue.try_pop(v);
+            }
+
+            usize try_push_batch(std::span<const u64> values)
+            {
+                return queue.try_push_batch(values);
+            }
+
+            usize try_pop_batch(std::span<u64> out)
+            {
+                return queue.try_pop_batch(out);
+            }
+        };
+
+        template <>
+        struct queue_adapter<mpmc_ring_buffer<u64>>
+        {
+            mpmc_ring_buffer<u64> queue{QueueCapacity};
+
+            bool try_push(u64 v)
+            {
+                return queue.try_push(v);
+            }
+
+            bool try_pop(u64& v)
+            {
+                return queue.try_pop(v);
+            }
+
+            usize try_push_batch(std::span<const u64> values)
+            {
+                return queue.try_push_batch(values);
+            }
+
+            usize try_pop_batch(std::span<u64> out)
+            {
+                return queue.try_pop_batch(out);
+            }
+        };
+
+        template <>
+        struct queue_adapter<moodycamel::ConcurrentQueue<u64>>
+        {
+            moodycamel::ConcurrentQueue<u64> queue;
+
+            bool try_push(u64 v)
+            {
+                return queue.enqueue(v);
+            }
+
+            bool try_pop(u64& v)
+            {
+                return queue.try_dequeue(v);
+            }
+
+            usize try_push_batch(std::span<const u64> values)
+            {
+                return queue.enqueue_bulk(values.data(), values.size()) ? values.size() : 0;
+            }
+
+            usize try_pop_batch(std::span<u64> out)
+            {
+                return queue.try_dequeue_bulk(out.data(), out.size());
+            }
+        };
+
+        template <typename Queue>
+        void queue_push_pop(benchmark::State& state)
+        {
+            queue_adapter<Queue> q;
+            u64 v{};
+
+            for (auto _ : state)
+            {
+                q.try_push(v);
+                q.try_pop(v);
+                ++v;
+            }
+
+            benchmark::DoNotOptimize(v);
+            state.SetItemsProcessed(state.iterations());
+        }
+
+        template <typename Queue>
+        void queue_push_pop_batch(benchmark::State& state)
+        {
+            queue_adapter<Queue> q;
+
+            std::array<u64, BatchSize> in{};
+            std::array<u64, BatchSize> out{};
+
+            for (auto _ : state)
+            {
+                q.try_push_batch(in);
+                benchmark::DoNotOptimize(q.try_pop_batch(out));
+            }
+
+            state.SetItemsProcessed(state.iterations() * BatchSize);
+        }
+
+        template <typename Queue>
+        void queue_producer_consumer(benchmark::State& state)
+        {
+            for (auto _ : state)
+            {
+                queue_adapter<Queue> q;
+
+                std::thread producer{[&q]
+                    {
+                        spin_wait wait;
+
+                        for (u64 i = 0; i < ThreadedItems;)
+                        {
+                            if (q.try_push(i))
+                            {
+                                ++i;
+                                wait.reset();
+                            }
+                            else
+                            {
+                                wait.wait();
+                            }
+                        }
+                    }};
+
+                u64 sum{};
+                spin_wait wait;
+
+                for (u64 received = 0; received < ThreadedItems;)
+                {
+                    u64 v;
+
+                    if (q.try_pop(v))
+                    {
+                        sum += v;
+                        ++received;
+                        wait.reset();
+                    }
+                    else
+                    {
+                        wait.wait();
+                    }
+                }
+
+                producer.join();
+                benchmark::DoNotOptimize(sum);
+            }
+
+            state.SetItemsProcessed(state.iterations() * ThreadedItems);
+        }
+    }
+
+    BENCHMARK(queue_push_pop<spsc_ring_buffer<u64>>);
+    BENCHMARK(queue_push_pop<mpmc_ring_buffer<u64>>);
+    BENCHMARK(queue_push_pop<moodycamel::ConcurrentQueue<u64>>);
+
+    BENCHMARK(queue_push_pop_batch<spsc_ring_buffer<u64>>);
+    BENCHMARK(queue_push_pop_batch<mpmc_ring_buffer<u64>>);
+    BENCHMARK(queue_push_pop_batch<moodycamel::ConcurrentQueue<u64>>);
+
+    BENCHMARK(queue_producer_consumer<spsc_ring_buffer<u64>>)->UseRealTime();
+    BENCHMARK(queue_producer_consumer<mpmc_ring_buffer<u64>>)->UseRealTime();
+    BENCHMARK(queue_producer_consumer<moodycamel::ConcurrentQueue<u64>>)->UseRealTime();
+}
@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/string/string.hpp>
+#include <oblo/core/string/string_builder.hpp>
+#include <oblo/core/string/string_interner.hpp>
+
+namespace oblo
+{
+    namespace
+    {
+        dynamic_array<string> make_strings(u32 count)
+        {
+            dynamic_array<string> strings;
+            strings.reserve(count);
+
+            string_builder builder;
+
+            for (u32 i = 0; i < count; ++i)
+            {
+                builder.clear().format("benchmark_string_{}", i);
+                strings.emplace_back(builder.as<string_view>());
+            }
+
+            return strings;
+        }
+
+        void string_builder_append(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            string_builder builder;
+
+            for (auto _ : state)
+            {
+                builder.clear();
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    builder.append("some/path").append_path_separator().append("file.ext");
+                }
+
+                benchmark::DoNotOptimize(builder.data());
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void string_builder_format(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+
+            string_builder builder;
+
+            for (auto _ : state)
+            {
+                builder.clear();
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    builder.format("{}: {} {}\n", i, 4.2f, "text");
+                }
+
+                benchmark::DoNotOptimize(builder.data());
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void string_interner_get_or_add(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+            const auto strings = make_strings(n);
+
+            for (auto _ : state)
+            {
+                string_interner interner;
+                interner.init(n);
+
+                for (const auto& str : strings)
+                {
+                    benchmark::DoNotOptimize(interner.get_or_add(str));
+                }
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void string_interner_get(benchmark::State& state)
+        {
+            const auto n = u32(state.range(0));
+            const auto strings = make_strings(n);
+
+            string_interner interner;
+            interner.init(n);
+
+            for (const auto& str : strings)
+            {
+                interner.get_or_add(str);
+            }
+
+            for (auto _ : state)
+            {
+                for (const auto& str : strings)
+                {
+                    benchmark::DoNotOptimize(interner.get(str));
+                }
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+
+        void string_interner_get_or_add_concurrent(benchmark::State& state)
+        {
+            constexpr u32 n{1u << 12};
+
+            static string_interner g_interner;
+            static dynamic_array<string> g_strings;
+
+            if (state.thread_index() == 0)
+            {
+                g_strings = make_strings(n);
+                g_interner.init(n);
+            }
+
+            for (auto _ : state)
+            {
+                for (const auto& str : g_strings)
+                {
+                    benchmark::DoNotOptimize(g_interner.get_or_add(str));
+                }
+            }
+
+            state.SetItemsProcessed(state.iterations() * n);
+        }
+    }
+
+    BENCHMARK(string_builder_append)->Range(1 << 4, 1 << 12);
+    BENCHMARK(string_builder_format)->Range(1 << 4, 1 << 12);
+
+    BENCHMARK(string_interner_get_or_add)->Range(1 << 6, 1 << 16);
+    BENCHMARK(string_interner_get)->Range(1 << 6, 1 << 16);
+    BENCHMARK(string_interner_get_or_add_concurrent)->ThreadRange(1, 8);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <oblo/core/allocator.hpp>
+#include <oblo/core/time/time.hpp>
+#include <oblo/core/types.hpp>
+
+#include <cstdio>
+
+namespace oblo
+{
+    enum class allocation_tag : u8
+    {
+        general,
+        ecs,
+        jobs,
+        resources,
+        importers,
+        strings,
+        enum_max,
+    };
+
+    inline constexpr u32 allocation_tags_count{u32(allocation_tag::enum_max)};
+
+    /// @brief Number of size classes in the allocation histogram.
+    /// Bucket i counts allocations with size in [2^i, 2^(i+1)), the last bucket also counts all bigger allocations.
+    inline constexpr u32 allocation_size_buckets{24};
+
+    struct allocation_tag_stats
+    {
+        u64 liveBytes;
+        u64 peakBytes;
+        u64 totalBytes;
+        u64 allocations;
+        u64 deallocations;
+        u64 sizeHistogram[allocation_size_buckets];
+    };
+
+    struct allocation_snapshot
+    {
+        time timestamp;
+        allocation_tag_stats tags[allocation_tags_count];
+    };
+
+    struct allocation_rate
+    {
+        f64 allocationsPerSecond;
+        f64 bytesPerSecond;
+    };
+
+    /// @brief Decorator that accounts all allocations to the given tag before forwarding them.
+    /// @remarks A small header is stored in front of each allocation, so sizes and alignments passed to deallocate do
+    /// not need to match the ones used in allocate (e.g. when deleting through a pointer to base).
+    class tracking_allocator final : public allocator
+    {
+    public:
+        constexpr tracking_allocator() = default;
+        constexpr tracking_allocator(allocator* inner, allocation_tag tag) : m_inner{inner}, m_tag{tag} {}
+
+        tracking_allocator(const tracking_allocator&) = delete;
+        tracking_allocator& operator=(const tracking_allocator&) = delete;
+
+        byte* allocate(usize size, usize alignment) noexcept override;
+        void deallocate(byte* ptr, usize size, usize alignment) noexcept override;
+
+        allocator* get_inner_allocator() const noexcept
+        {
+            return m_inner;
+        }
+
+        allocation_tag get_tag() const noexcept
+        {
+            return m_tag;
+        }
+
+    private:
+        allocator* m_inner{};
+        allocation_tag m_tag{};
+    };
+
+    /// @brief Returns whether the global allocators are instrumented, i.e. the build uses OBLO_TRACK_ALLOCATIONS.
+    bool is_allocation_tracking_enabled() noexcept;
+
+    const char* get_allocation_tag_name(allocation_tag tag) noexcept;
+
+    /// @brief Captures the current counters of all tags.
+    /// @remarks Counters are updated atomically one by one, the snapshot is not a consistent cut across all of them.
+    allocation_snapshot get_allocation_snapshot() noexcept;
+
+    /// @brief Computes the allocation rate of a tag between two snapshots.
+    allocation_rate compute_allocation_rate(
+        const allocation_snapshot& from, const allocation_snapshot& to, allocation_tag tag) noexcept;
+
+    /// @brief Prints the live allocations of each tag.
+    /// @return True if any tag still has live allocations.
+    bool report_allocation_leaks(std::FILE* file);
+
+    /// @brief Registers a report of the live allocations to be printed on stderr when the process exits.
+    void enable_allocation_leak_report_on_exit();
+}
@@ -4,6 +4,8 @@
 
 namespace oblo
 {
+    enum class allocation_tag : u8;
+
     class allocator
     {
     public:
@@ -15,6 +17,11 @@ namespace oblo
     allocator* get_global_allocator() noexcept;
     allocator* get_global_aligned_allocator() noexcept;
 
+    /// @brief Returns the global allocator for the given tag.
+    /// @remarks Unless allocations are tracked (i.e. OBLO_TRACK_ALLOCATIONS) this is the same as get_global_allocator.
+    allocator* get_global_allocator(allocation_tag tag) noexcept;
+    allocator* get_global_aligned_allocator(allocation_tag tag) noexcept;
+
     template <usize Alignment>
     allocator* select_global_allocator()
     {
@@ -27,4 +34,17 @@ namespace oblo
             return get_global_aligned_allocator();
         }
     }
+
+    template <usize Alignment>
+    allocator* select_global_allocator(allocation_tag tag)
+    {
+        if constexpr (Alignment <= alignof(std::max_align_t))
+        {
+            return get_global_allocator(tag);
+        }
+        else
+        {
+            return get_global_aligned_allocator(tag);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <oblo/core/expected.hpp>
+#include <oblo/core/handle.hpp>
+#include <oblo/core/platform/file.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/core/unique_ptr.hpp>
+
+#include <span>
+
+namespace oblo::filesystem
+{
+    struct async_io_request;
+
+    using async_io_handle = h64<async_io_request>;
+
+    enum class async_io_operation : u8
+    {
+        read,
+        write,
+        enum_max,
+    };
+
+    enum class async_io_status : u8
+    {
+        completed,
+        failed,
+        cancelled,
+        enum_max,
+    };
+
+    struct async_io_result
+    {
+        async_io_handle handle;
+        async_io_status status;
+
+        /// @brief The number of bytes read or written, it might be less than requested, e.g. when reading past the end
+        /// of the file.
+        u32 bytesTransferred;
+    };
+
+    /// @brief Invoked when a request completes, fails or is cancelled.
+    /// @remarks Callbacks are invoked on the I/O threads, or on the thread calling cancel. They should be short, e.g.
+    /// pushing a job to process the data, to avoid delaying other completions.
+    using async_io_callback = void (*)(const async_io_result& result, void* userdata);
+
+    struct async_io_request
+    {
+        /// @brief The file has to stay open until the request completes.
+        const platform::file* file;
+        async_io_operation operation;
+
+        /// @brief The offset in the file where to read from or write to.
+        u64 offset;
+
+        /// @brief The destination of a read, or the source of a write. It has to stay alive until the request
+        /// completes.
+        byte* buffer;
+        u32 size;
+
+        async_io_callback callback;
+        void* userdata;
+    };
+
+    struct async_file_io_initializer
+    {
+        /// @brief Maximum number of requests in flight, additional requests are queued.
+        u32 queueDepth{128};
+
+        /// @brief Number of threads used when io_uring is not available.
+        u32 fallbackThreadsCount{2};
+
+        /// @brief Forces the use of the thread pool, even when io_uring is available.
+        bool forceFallback{false};
+    };
+
+    /// @brief Asynchronous file I/O service, allowing workers to avoid blocking on disk reads and writes.
+    /// @remarks Uses io_uring on Linux when available, otherwise a small pool of threads that performs blocking
+    /// positional reads and writes. All functions except init and shutdown are thread-safe.
+    class async_file_io
+    {
+    public:
+        async_file_io();
+        async_file_io(const async_file_io&) = delete;
+        async_file_io(async_file_io&&) noexcept = delete;
+
+        async_file_io& operator=(const async_file_io&) = delete;
+        async_file_io& operator=(async_file_io&&) noexcept = delete;
+
+        ~async_file_io();
+
+        expected<> init(const async_file_io_initializer& initializer);
+
+        /// @brief Cancels queued requests and waits for the ones in flight to complete.
+        void shutdown();
+
+        /// @brief Returns true if requests are executed through io_uring, false if the thread pool is in use.
+        bool is_using_io_uring() const;
+
+        async_io_handle submit(const async_io_request& request);
+
+        /// @brief Submits multiple requests at once, amortizing the cost of submission.
+        /// @param requests The requests to submit.
+        /// @param outHandles Optional, if not empty it has to be at least as big as the requests span.
+        void submit(std::span<const async_io_request> requests, std::span<async_io_handle> outHandles = {});
+
+        /// @brief Tries to cancel the request.
+        /// @remarks Requests that were not started yet are guaranteed to be cancelled, while requests in flight might
+        /// still complete. In either case the callback is invoked exactly once.
+        /// @return True if the request was still queued or in flight, false if it already completed.
+        bool cancel(async_io_handle handle);
+
+        /// @brief Blocks until all submitted requests have completed.
+        void wait_idle();
+
+    private:
+        struct impl;
+        unique_ptr<impl> m_impl;
+    };
+}
@@ -4,6 +4,7 @@
 #include <oblo/core/flags.hpp>
 #include <oblo/core/invoke/function_ref.hpp>
 #include <oblo/core/string/cstring_view.hpp>
+#include <oblo/core/time/time.hpp>
 #include <oblo/core/unique_ptr.hpp>
 
 #include <span>
@@ -25,6 +26,20 @@ namespace oblo::filesystem
     {
         string_view path;
         bool isRecursive = false;
+
+        /// @brief When enabled, notifications are checked against an index of the directory and reported as at most
+        /// one event per file, once the file was left untouched for the debounce time.
+        bool coalesceEvents = false;
+
+        /// @brief How long a file has to be left untouched before reporting its changes, only used when coalescing.
+        time debounceTime{};
+
+        /// @brief When coalescing, skips modified events for files whose content did not change.
+        bool hashContents = false;
+
+        /// @brief When coalescing, the index is loaded from this file on init and saved on shutdown. Changes that
+        /// happened while not watching are reported on the first call to process.
+        string_view indexPath;
     };
 
     class directory_watcher
@@ -47,8 +62,14 @@ namespace oblo::filesystem
         expected<> init(const directory_watcher_initializer& initializer);
         void shutdown();
 
+        /// @brief Dispatches the changes since the last call.
+        /// @remarks An error might be returned after the events were dispatched, e.g. when some of the directories
+        /// could not be watched, in which case changes in them might be missed.
         expected<> process(callback_fn callback) const;
 
+        /// @brief Writes the index to the path specified on init, only available when coalescing events.
+        expected<> save_index() const;
+
         cstring_view get_directory() const;
 
     private:
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <oblo/core/expected.hpp>
+#include <oblo/core/flags.hpp>
+#include <oblo/core/string/cstring_view.hpp>
+#include <oblo/core/types.hpp>
+
+#include <span>
+
+namespace oblo::filesystem
+{
+    /// @brief Hints on how a mapped file is going to be accessed, which can be used by the OS to optimize paging.
+    enum class mapped_file_hint : u8
+    {
+        /// @brief Pages are accessed sequentially, the OS can read ahead aggressively and drop pages behind.
+        sequential,
+        /// @brief Pages are accessed randomly, read-ahead should be disabled.
+        random,
+        /// @brief The whole file is going to be accessed soon, the OS should start reading it in the background.
+        will_need,
+        /// @brief Requests transparent huge pages for the mapping, to reduce TLB pressure on big files.
+        /// @remarks Only supported on Linux, and only when the kernel supports huge pages for read-only file mappings.
+        huge_pages,
+        enum_max,
+    };
+
+    /// @brief A read-only memory mapping of a whole file.
+    /// @remarks Allows parsing files in place, without copying them into an allocation first. The mapping stays valid
+    /// even if the file is deleted, but modifying the file while mapped is not allowed.
+    class mapped_file
+    {
+    public:
+        mapped_file() = default;
+        mapped_file(const mapped_file&) = delete;
+        mapped_file(mapped_file&&) noexcept;
+
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file& operator=(mapped_file&&) noexcept;
+
+        ~mapped_file();
+
+        /// @brief Maps the whole file for reading.
+        /// @remarks Mapping an empty file succeeds, resulting in an empty span.
+        expected<> open(cstring_view path, flags<mapped_file_hint> hints = {});
+        void close();
+
+        bool is_open() const;
+
+        /// @brief Applies the hints to the whole mapping.
+        /// @remarks Some hints might only be effective if passed on open, e.g. sequential and random on Windows.
+        void advise(flags<mapped_file_hint> hints) const;
+
+        /// @brief Asks the OS to start paging in the given range in the background, without blocking.
+        /// @param offset The offset in bytes of the range, it does not need to be aligned to the page size.
+        /// @param size The size in bytes of the range, it's clamped to the size of the file.
+        void prefetch(usize offset, usize size) const;
+
+        std::span<const byte> get_bytes() const;
+
+        const byte* data() const;
+        usize size() const;
+
+    private:
+        const byte* m_data{};
+        usize m_size{};
+        bool m_isOpen{};
+    };
+}
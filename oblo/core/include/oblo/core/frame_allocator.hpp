@@ -5,6 +5,34 @@
 
 namespace oblo
 {
+    enum class frame_allocator_pages : u8
+    {
+        /// @brief Regular pages, the default.
+        regular,
+        /// @brief The range is aligned and hinted to the OS to be backed by transparent huge pages, where supported.
+        transparent_huge,
+        /// @brief The whole range is reserved from the system huge page pool upfront, falling back to transparent
+        /// huge pages if the pool cannot satisfy the request.
+        /// @remarks The chunk size has to be a multiple of the huge page size.
+        huge,
+    };
+
+    struct frame_allocator_initializer
+    {
+        usize maxSize;
+        usize chunkSize = 4u << 20;
+        usize startingChunks = 0;
+
+        frame_allocator_pages pages = frame_allocator_pages::regular;
+
+        /// @brief Touches committed memory right away, to avoid paying for page faults on first use.
+        bool prefault = false;
+
+        /// @brief When not 0, end_frame decommits the chunks above the highest high-water mark of the last
+        /// shrinkFrames frames. The starting chunks are never decommitted.
+        u32 shrinkFrames = 0;
+    };
+
     class frame_allocator final : public allocator
     {
     public:
@@ -18,6 +46,7 @@ namespace oblo
         ~frame_allocator();
 
         bool init(usize maxSize, usize chunkSize = 4u << 20, usize startingChunks = 0);
+        bool init(const frame_allocator_initializer& initializer);
         void shutdown();
 
         byte* allocate(usize size, usize alignment) noexcept;
@@ -28,19 +57,48 @@ namespace oblo
         void restore(void* point);
         void restore_all();
 
+        /// @brief Tracks the peak usage of the frame that just ended and applies the shrink policy, if enabled.
+        /// @remarks Meant to be called once per frame, after restoring the allocator.
+        void end_frame();
+
         usize get_committed_memory_size() const;
 
+        /// @brief Returns the number of bytes currently allocated, including alignment padding.
+        usize get_allocated_memory_size() const;
+
+        /// @brief Returns the highest number of bytes allocated since the last call to reset_high_water_mark.
+        usize get_high_water_mark() const;
+
+        /// @brief Resets the high-water mark to the currently allocated size.
+        void reset_high_water_mark();
+
         void* get_first_unallocated_byte() const;
 
         scoped_restore make_scoped_restore();
 
         bool contains(const void* ptr) const;
 
+        /// @brief Returns the kind of pages backing the allocator, which might differ from the requested one when the
+        /// system does not support it.
+        frame_allocator_pages get_pages() const;
+
+    private:
+        void decommit_above(usize size);
+
     private:
         u8* m_virtualMemory{nullptr};
         u8* m_end{nullptr};
         u8* m_commitEnd{nullptr};
+        u8* m_highWaterMark{nullptr};
+        u8* m_framePeak{nullptr};
+        u8* m_shrinkPeak{nullptr};
+        usize m_reservedSize{0};
         usize m_chunkSize{0};
+        usize m_minCommittedSize{0};
+        u32 m_shrinkFrames{0};
+        u32 m_shrinkFramesCount{0};
+        frame_allocator_pages m_pages{frame_allocator_pages::regular};
+        bool m_prefault{false};
     };
 
     class frame_allocator::scoped_restore
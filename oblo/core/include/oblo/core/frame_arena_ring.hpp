@@ -0,0 +1,54 @@
+#pragma once
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/frame_allocator.hpp>
+#include <oblo/core/types.hpp>
+
+namespace oblo
+{
+    /// @brief A ring of frame allocators, one per frame in flight.
+    /// Each frame allocates from its own arena, which is only reset once the frame that last used it is retired, e.g.
+    /// after the GPU is done consuming the data.
+    class frame_arena_ring
+    {
+    public:
+        frame_arena_ring();
+        frame_arena_ring(const frame_arena_ring&) = delete;
+        frame_arena_ring(frame_arena_ring&&) noexcept;
+        frame_arena_ring& operator=(const frame_arena_ring&) = delete;
+        frame_arena_ring& operator=(frame_arena_ring&&) noexcept;
+        ~frame_arena_ring();
+
+        bool init(u32 buffersCount, usize maxSize, usize chunkSize = 4u << 20);
+        bool init(u32 buffersCount, const frame_allocator_initializer& initializer);
+        void shutdown();
+
+        /// @brief Selects and resets the arena for the given frame.
+        /// @remarks Frame indices are expected to be monotonically increasing.
+        /// @return False if the arena is still in use by a frame that was not retired yet.
+        [[nodiscard]] bool begin_frame(u64 frameIndex);
+
+        /// @brief Marks all frames up to the given index (included) as retired, allowing their arenas to be reused.
+        void retire_frames(u64 lastRetiredFrame);
+
+        /// @brief Checks whether the arena that would be used for the given frame can be reset.
+        bool can_begin_frame(u64 frameIndex) const;
+
+        frame_allocator& get_current();
+        const frame_allocator& get_current() const;
+
+        u32 get_buffers_count() const;
+
+        /// @brief Returns the highest high-water mark across all arenas.
+        usize get_high_water_mark() const;
+
+    private:
+        static constexpr u64 NoFrame{~u64{}};
+
+    private:
+        dynamic_array<frame_allocator> m_arenas;
+        dynamic_array<u64> m_arenaFrames;
+        u64 m_retiredFramesEnd{0};
+        u32 m_current{0};
+    };
+}
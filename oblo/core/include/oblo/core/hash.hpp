@@ -5,6 +5,8 @@
 #include <oblo/core/platform/compiler.hpp>
 #include <oblo/core/types.hpp>
 
+#include <type_traits>
+
 #if UINTPTR_MAX == 0xFFFFFFFFFFFFFFFFu
     #include <xxhashct/xxh64.hpp>
     #define OBLO_XXHASHZ xxh64
@@ -27,6 +29,29 @@ namespace oblo
         return seed;
     }
 
+    /// @brief Bijective finalizer for 64-bit integers (splitmix64), much cheaper than running a full hash on a few
+    /// bytes while still spreading every input bit over the whole result.
+    constexpr u64 hash_integer(u64 x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    /// @brief Bijective finalizer for 32-bit integers (lowbias32).
+    constexpr u32 hash_integer(u32 x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
     template <template <typename> typename Hash, typename T, typename... Others>
     constexpr auto hash_all(const T& first, const Others&... args)
     {
@@ -41,6 +66,43 @@ namespace oblo
 
     usize hash_xxhz(const void* p, u64 size, usize seed = 0);
 
+    /// @brief Hashes the input with XXH3, which is considerably faster than xxh64 on both short and long inputs.
+    /// @remarks The result is not the same as hash_xxhz, so it should not be mixed with hashed strings.
+    u64 hash_xxh3(const void* p, u64 size, u64 seed = 0);
+
+    /// @brief Streaming version of hash_xxh3, for hashing data that is not contiguous in memory.
+    /// @remarks Feeding the same bytes in any number of updates produces the same result as hash_xxh3.
+    class hasher
+    {
+    public:
+        hasher() noexcept;
+        explicit hasher(u64 seed) noexcept;
+        hasher(const hasher&) noexcept;
+
+        hasher& operator=(const hasher&) noexcept;
+
+        ~hasher();
+
+        void reset(u64 seed = 0) noexcept;
+
+        hasher& update(const void* p, u64 size) noexcept;
+
+        template <typename T>
+            requires std::has_unique_object_representations_v<T>
+        hasher& update(const T& value) noexcept
+        {
+            return update(&value, sizeof(T));
+        }
+
+        u64 digest() const noexcept;
+
+    private:
+        static constexpr usize StateSize{576};
+
+    private:
+        alignas(64) byte m_state[StateSize];
+    };
+
     OBLO_FORCEINLINE constexpr usize hash_xxhz_compile_time(const char* p, u64 size, usize seed = 0)
     {
         return OBLO_XXHASHZ{}.hash(p, size, seed);
@@ -55,9 +117,27 @@ namespace oblo
         requires std::is_integral_v<T> || std::is_enum_v<T>
     struct hash<T>
     {
-        hash_type operator()(const T& v) const noexcept
+        constexpr hash_type operator()(const T& v) const noexcept
         {
-            return hash_xxhz(&v, sizeof(T));
+            u64 bits;
+
+            if constexpr (std::is_enum_v<T>)
+            {
+                bits = u64(std::underlying_type_t<T>(v));
+            }
+            else
+            {
+                bits = u64(v);
+            }
+
+            if constexpr (sizeof(hash_type) == sizeof(u64))
+            {
+                return hash_type(hash_integer(bits));
+            }
+            else
+            {
+                return hash_type(hash_integer(u32(bits ^ (bits >> 32))));
+            }
         }
     };
 
@@ -15,6 +15,10 @@ namespace oblo
         }
 
     public:
+        memory_pool() = default;
+
+        explicit memory_pool(std::pmr::memory_resource* upstream) : std::pmr::unsynchronized_pool_resource{upstream} {}
+
         template <typename T>
         T* create_array_uninitialized(usize count)
         {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <oblo/core/expected.hpp>
+#include <oblo/core/string/cstring_view.hpp>
 
 namespace oblo::platform
 {
@@ -16,6 +17,15 @@ namespace oblo::platform
             unspecified
         };
 
+        enum class open_mode : u8
+        {
+            /// @brief Opens an existing file for reading.
+            read,
+            /// @brief Opens a file for writing, creating it or truncating it if it exists.
+            write,
+            enum_max,
+        };
+
 #ifdef _WIN32
         using native_handle = void*;
 #else
@@ -32,9 +42,21 @@ namespace oblo::platform
         file& operator=(const file&) = delete;
         file& operator=(file&&) noexcept;
 
+        expected<> open(cstring_view path, open_mode mode);
+
         expected<u32, error> read(void* dst, u32 size) const noexcept;
         expected<u32, error> write(const void* src, u32 size) const noexcept;
 
+        /// @brief Reads at the given offset, without affecting the file pointer.
+        /// @remarks Can be called concurrently on the same file.
+        expected<u32, error> read_at(void* dst, u32 size, u64 offset) const noexcept;
+
+        /// @brief Writes at the given offset, without affecting the file pointer.
+        /// @remarks Can be called concurrently on the same file.
+        expected<u32, error> write_at(const void* src, u32 size, u64 offset) const noexcept;
+
+        expected<u64> get_size() const noexcept;
+
         bool is_open() const noexcept;
 
         void close() noexcept;
@@ -3,13 +3,21 @@
 #include <oblo/core/forward.hpp>
 #include <oblo/core/handle.hpp>
 
+#include <span>
+
 namespace oblo
 {
+    class allocator;
     class string;
 
+    /// @brief Maps strings to stable handles, storing a single copy of each string.
+    /// @remarks All functions can be called concurrently, with the exception of init and shutdown. Insertions are
+    /// sharded by hash to reduce contention, while str, h_str and c_str are wait-free.
     class string_interner
     {
     public:
+        /// @brief Strings up to this length are packed together in shared chunks, longer strings are given their own
+        /// allocation.
         static constexpr u32 MaxStringLength{255};
 
     public:
@@ -20,11 +28,22 @@ namespace oblo
         string_interner& operator=(string_interner&&) noexcept;
         ~string_interner();
 
-        void init(u32 estimatedStringsCount);
+        /// @brief Initializes the interner.
+        /// @param estimatedStringsCount Used to reserve space for the lookup tables.
+        /// @param allocator The allocator used for the string storage, which is only released on shutdown, hence it
+        /// can be an arena. The global allocator is used when nullptr.
+        void init(u32 estimatedStringsCount, allocator* allocator = nullptr);
         void shutdown();
 
         h32<string> get_or_add(string_view str);
         h32<string> get_or_add(hashed_string_view str);
+
+        /// @brief Interns multiple strings, acquiring each shard only once.
+        /// @param strings The strings to intern.
+        /// @param outHandles The resulting handles, has to be at least as big as the input.
+        void get_or_add(std::span<const string_view> strings, std::span<h32<string>> outHandles);
+        void get_or_add(std::span<const hashed_string_view> strings, std::span<h32<string>> outHandles);
+
         h32<string> get(string_view str) const;
         h32<string> get(hashed_string_view str) const;
 
@@ -32,8 +51,11 @@ namespace oblo
         hashed_string_view h_str(h32<string> handle) const;
         const char* c_str(h32<string> handle) const;
 
+        /// @brief Returns the number of interned strings, which doesn't include the reserved invalid handle.
+        u32 size() const;
+
     private:
         struct impl;
         impl* m_impl{nullptr};
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <oblo/core/allocator.hpp>
+#include <oblo/core/debug.hpp>
+#include <oblo/core/thread/spin_wait.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/math/power_of_two.hpp>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+
+namespace oblo
+{
+    /// @brief Bounded lock-free queue for multiple producers and multiple consumers.
+    /// @remarks Each slot carries a sequence number which tells producers and consumers whether it's free or full for
+    /// the current lap around the buffer, so that the only contended state is the pair of enqueue and dequeue
+    /// positions, which live on separate cache lines. The storage is allocated on init, push and pop never allocate.
+    /// The capacity is rounded up to a power of two.
+    template <typename T>
+    class mpmc_ring_buffer
+    {
+    public:
+        static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_destructible_v<T>);
+
+    public:
+        mpmc_ring_buffer() = default;
+        mpmc_ring_buffer(const mpmc_ring_buffer&) = delete;
+        mpmc_ring_buffer(mpmc_ring_buffer&&) noexcept = delete;
+
+        explicit mpmc_ring_buffer(usize capacity, allocator* allocator = select_global_allocator<alignof(cell)>())
+        {
+            init(capacity, allocator);
+        }
+
+        mpmc_ring_buffer& operator=(const mpmc_ring_buffer&) = delete;
+        mpmc_ring_buffer& operator=(mpmc_ring_buffer&&) noexcept = delete;
+
+        ~mpmc_ring_buffer()
+        {
+            shutdown();
+        }
+
+        /// @brief Allocates the storage, it's not thread-safe.
+        void init(usize capacity, allocator* allocator = select_global_allocator<alignof(cell)>())
+        {
+            shutdown();
+
+            OBLO_ASSERT(capacity > 0);
+            capacity = round_up_power_of_two(capacity);
+
+            m_allocator = allocator;
+            m_cells = reinterpret_cast<cell*>(allocator->allocate(capacity * sizeof(cell), alignof(cell)));
+            m_mask = capacity - 1;
+
+            for (usize i = 0; i < capacity; ++i)
+            {
+                new (m_cells + i) cell{};
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /// @brief Destroys the elements left in the queue and frees the storage, it's not thread-safe.
+        void shutdown()
+        {
+            if (!m_cells)
+            {
+                return;
+            }
+
+            const usize end = m_enqueuePos.load(std::memory_order_relaxed);
+
+            for (usize i = m_dequeuePos.load(std::memory_order_relaxed); i != end; ++i)
+            {
+                cell& c = m_cells[i & m_mask];
+
+                if (c.sequence.load(std::memory_order_relaxed) == i + 1)
+                {
+                    std::destroy_at(c.get());
+                }
+            }
+
+            std::destroy_n(m_cells, m_mask + 1);
+            m_allocator->deallocate(reinterpret_cast<byte*>(m_cells), (m_mask + 1) * sizeof(cell), alignof(cell));
+
+            m_cells = nullptr;
+            m_mask = 0;
+            m_enqueuePos.store(0, std::memory_order_relaxed);
+            m_dequeuePos.store(0, std::memory_order_relaxed);
+        }
+
+        usize capacity() const noexcept
+        {
+            return m_cells ? m_mask + 1 : 0;
+        }
+
+        /// @brief Approximate number of elements in the queue, since other threads might be pushing or popping.
+        usize size() const noexcept
+        {
+            const usize dequeuePos = m_dequeuePos.load(std::memory_order_acquire);
+            const usize enqueuePos = m_enqueuePos.load(std::memory_order_acquire);
+            return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+        }
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /// @brief Tries to push an element, fails if the queue is full.
+        template <typename... Args>
+        bool try_emplace(Args&&... args)
+        {
+            usize pos = m_enqueuePos.load(std::memory_order_relaxed);
+            cell* c;
+
+            while (true)
+            {
+                c = m_cells + (pos & m_mask);
+
+                const usize sequence = c->sequence.load(std::memory_order_acquire);
+                const isize diff = isize(sequence - pos);
+
+                if (diff == 0)
+                {
+                    if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // The slot was not consumed yet since the last lap
+                    return false;
+                }
+                else
+                {
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (c->get()) T(std::forward<Args>(args)...);
+            c->sequence.store(pos + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool try_push(const T& value)
+        {
+            return try_emplace(value);
+        }
+
+        bool try_push(T&& value)
+        {
+            return try_emplace(std::move(value));
+        }
+
+        /// @brief Pushes an element, spinning until there is enough space in the queue.
+        template <typename U>
+        void push(U&& value)
+        {
+            for (spin_wait sw; !try_emplace(std::forward<U>(value));)
+            {
+                sw.wait();
+            }
+        }
+
+        /// @brief Reserves a contiguous range of free slots with a single atomic operation and pushes as many elements
+        /// as possible in it.
+        /// @return The number of elements that were pushed, which might be less than the input size if the queue
+        /// fills up.
+        usize try_push_batch(std::span<const T> values)
+        {
+            if (values.empty())
+            {
+                return 0;
+            }
+
+            usize pos = m_enqueuePos.load(std::memory_order_relaxed);
+            usize count;
+
+            while (true)
+            {
+                count = 0;
+
+                while (count < values.size() &&
+                    m_cells[(pos + count) & m_mask].sequence.load(std::memory_order_acquire) == pos + count)
+                {
+                    ++count;
+                }
+
+                if (count == 0)
+                {
+                    const usize sequence = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+
+                    if (isize(sequence - pos) < 0)
+                    {
+                        return 0;
+                    }
+
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+                else if (m_enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            for (usize i = 0; i < count; ++i)
+            {
+                cell& c = m_cells[(pos + i) & m_mask];
+                new (c.get()) T(values[i]);
+                c.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+
+            return count;
+        }
+
+        /// @brief Pushes all the elements, spinning whenever the queue is full.
+        void push_batch(std::span<const T> values)
+        {
+            for (spin_wait sw; !values.empty();)
+            {
+                const usize count = try_push_batch(values);
+
+                if (count == 0)
+                {
+                    sw.wait();
+                }
+                else
+                {
+                    values = values.subspan(count);
+                    sw.reset();
+                }
+            }
+        }
+
+        /// @brief Tries to pop an element, fails if the queue is empty.
+        bool try_pop(T& out)
+        {
+            usize pos = m_dequeuePos.load(std::memory_order_relaxed);
+            cell* c;
+
+            while (true)
+            {
+                c = m_cells + (pos & m_mask);
+
+                const usize sequence = c->sequence.load(std::memory_order_acquire);
+                const isize diff = isize(sequence - (pos + 1));
+
+                if (diff == 0)
+                {
+                    if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // The slot was not filled yet for this lap
+                    return false;
+                }
+                else
+                {
+                    pos = m_dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            T* const element = c->get();
+            out = std::move(*element);
+            std::destroy_at(element);
+
+            c->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /// @brief Pops an element, spinning until one is available.
+        T pop()
+        {
+            T out;
+
+            for (spin_wait sw; !try_pop(out);)
+            {
+                sw.wait();
+            }
+
+            return out;
+        }
+
+        /// @brief Reserves a contiguous range of full slots with a single atomic operation and pops them.
+        /// @return The number of elements written to the output.
+        usize try_pop_batch(std::span<T> out)
+        {
+            if (out.empty())
+            {
+                return 0;
+            }
+
+            usize pos = m_dequeuePos.load(std::memory_order_relaxed);
+            usize count;
+
+            while (true)
+            {
+                count = 0;
+
+                while (count < out.size() &&
+                    m_cells[(pos + count) & m_mask].sequence.load(std::memory_order_acquire) == pos + count + 1)
+                {
+                    ++count;
+                }
+
+                if (count == 0)
+                {
+                    const usize sequence = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+
+                    if (isize(sequence - (pos + 1)) < 0)
+                    {
+                        return 0;
+                    }
+
+                    pos = m_dequeuePos.load(std::memory_order_relaxed);
+                }
+                else if (m_dequeuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            for (usize i = 0; i < count; ++i)
+            {
+                cell& c = m_cells[(pos + i) & m_mask];
+
+                T* const element = c.get();
+                out[i] = std::move(*element);
+                std::destroy_at(element);
+
+                c.sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+            }
+
+            return count;
+        }
+
+    private:
+        struct cell
+        {
+            std::atomic<usize> sequence;
+            alignas(T) byte storage[sizeof(T)];
+
+            T* get() noexcept
+            {
+                return std::launder(reinterpret_cast<T*>(storage));
+            }
+        };
+
+    private:
+        alignas(std::hardware_destructive_interference_size) std::atomic<usize> m_enqueuePos{};
+        alignas(std::hardware_destructive_interference_size) std::atomic<usize> m_dequeuePos{};
+        alignas(std::hardware_destructive_interference_size) cell* m_cells{};
+        usize m_mask{};
+        allocator* m_allocator{};
+    };
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <oblo/core/types.hpp>
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+#endif
+
+namespace oblo
+{
+    /// @brief Exponential backoff for busy waiting, it spins on the CPU for a while before yielding the thread.
+    class spin_wait
+    {
+    public:
+        void wait() noexcept
+        {
+            if (m_count < MaxSpinCount)
+            {
+                for (u32 i = 0; i < (1u << m_count); ++i)
+                {
+#if defined(__x86_64__) || defined(_M_X64)
+                    _mm_pause();
+#endif
+                }
+
+                ++m_count;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        void reset() noexcept
+        {
+            m_count = 0;
+        }
+
+    private:
+        static constexpr u32 MaxSpinCount{7};
+
+    private:
+        u32 m_count{};
+    };
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <oblo/core/allocator.hpp>
+#include <oblo/core/debug.hpp>
+#include <oblo/core/thread/spin_wait.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/math/power_of_two.hpp>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+
+namespace oblo
+{
+    /// @brief Bounded lock-free queue for a single producer and a single consumer.
+    /// @remarks The storage is allocated on init, push and pop never allocate. The capacity is rounded up to a power
+    /// of two. The producer and the consumer indices live on separate cache lines, and each side keeps a cached copy of
+    /// the other side's index to avoid touching the shared cache line unless the queue looks full or empty.
+    template <typename T>
+    class spsc_ring_buffer
+    {
+    public:
+        static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_destructible_v<T>);
+
+    public:
+        spsc_ring_buffer() = default;
+        spsc_ring_buffer(const spsc_ring_buffer&) = delete;
+        spsc_ring_buffer(spsc_ring_buffer&&) noexcept = delete;
+
+        explicit spsc_ring_buffer(usize capacity, allocator* allocator = select_global_allocator<alignof(T)>())
+        {
+            init(capacity, allocator);
+        }
+
+        spsc_ring_buffer& operator=(const spsc_ring_buffer&) = delete;
+        spsc_ring_buffer& operator=(spsc_ring_buffer&&) noexcept = delete;
+
+        ~spsc_ring_buffer()
+        {
+            shutdown();
+        }
+
+        /// @brief Allocates the storage, it's not thread-safe.
+        void init(usize capacity, allocator* allocator = select_global_allocator<alignof(T)>())
+        {
+            shutdown();
+
+            OBLO_ASSERT(capacity > 0);
+            capacity = round_up_power_of_two(capacity);
+
+            m_allocator = allocator;
+            m_buffer = reinterpret_cast<T*>(allocator->allocate(capacity * sizeof(T), alignof(T)));
+            m_mask = capacity - 1;
+        }
+
+        /// @brief Destroys the elements left in the queue and frees the storage, it's not thread-safe.
+        void shutdown()
+        {
+            if (!m_buffer)
+            {
+                return;
+            }
+
+            const usize tail = m_producer.tail.load(std::memory_order_relaxed);
+
+            for (usize i = m_consumer.head.load(std::memory_order_relaxed); i != tail; ++i)
+            {
+                std::destroy_at(m_buffer + (i & m_mask));
+            }
+
+            m_allocator->deallocate(reinterpret_cast<byte*>(m_buffer), (m_mask + 1) * sizeof(T), alignof(T));
+
+            m_buffer = nullptr;
+            m_mask = 0;
+            m_producer.reset();
+            m_consumer.reset();
+        }
+
+        usize capacity() const noexcept
+        {
+            return m_buffer ? m_mask + 1 : 0;
+        }
+
+        /// @brief Approximate number of elements in the queue, it's only exact when called by either side.
+        usize size() const noexcept
+        {
+            return m_producer.tail.load(std::memory_order_acquire) - m_consumer.head.load(std::memory_order_acquire);
+        }
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /// @brief Tries to push an element, fails if the queue is full. Only to be called by the producer.
+        template <typename... Args>
+        bool try_emplace(Args&&... args)
+        {
+            const usize tail = m_producer.tail.load(std::memory_order_relaxed);
+
+            if (tail - m_producer.cachedHead > m_mask)
+            {
+                m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+
+                if (tail - m_producer.cachedHead > m_mask)
+                {
+                    return false;
+                }
+            }
+
+            new (m_buffer + (tail & m_mask)) T(std::forward<Args>(args)...);
+            m_producer.tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool try_push(const T& value)
+        {
+            return try_emplace(value);
+        }
+
+        bool try_push(T&& value)
+        {
+            return try_emplace(std::move(value));
+        }
+
+        /// @brief Pushes an element, spinning until there is enough space in the queue. Only to be called by the
+        /// producer.
+        template <typename U>
+        void push(U&& value)
+        {
+            for (spin_wait sw; !try_emplace(std::forward<U>(value));)
+            {
+                sw.wait();
+            }
+        }
+
+        /// @brief Pushes as many elements as possible, publishing them all at once.
+        /// @return The number of elements that were pushed, which might be less than the input size if the queue
+        /// fills up.
+        usize try_push_batch(std::span<const T> values)
+        {
+            const usize tail = m_producer.tail.load(std::memory_order_relaxed);
+            usize available = m_mask + 1 - (tail - m_producer.cachedHead);
+
+            if (available < values.size())
+            {
+                m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+                available = m_mask + 1 - (tail - m_producer.cachedHead);
+            }
+
+            const usize count = values.size() < available ? values.size() : available;
+
+            for (usize i = 0; i < count; ++i)
+            {
+                new (m_buffer + ((tail + i) & m_mask)) T(values[i]);
+            }
+
+            m_producer.tail.store(tail + count, std::memory_order_release);
+
+            return count;
+        }
+
+        /// @brief Pushes all the elements, spinning whenever the queue is full.
+        void push_batch(std::span<const T> values)
+        {
+            for (spin_wait sw; !values.empty();)
+            {
+                const usize count = try_push_batch(values);
+
+                if (count == 0)
+                {
+                    sw.wait();
+                }
+                else
+                {
+                    values = values.subspan(count);
+                    sw.reset();
+                }
+            }
+        }
+
+        /// @brief Tries to pop an element, fails if the queue is empty. Only to be called by the consumer.
+        bool try_pop(T& out)
+        {
+            const usize head = m_consumer.head.load(std::memory_order_relaxed);
+
+            if (head == m_consumer.cachedTail)
+            {
+                m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+
+                if (head == m_consumer.cachedTail)
+                {
+                    return false;
+                }
+            }
+
+            T* const element = m_buffer + (head & m_mask);
+            out = std::move(*element);
+            std::destroy_at(element);
+
+            m_consumer.head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /// @brief Pops an element, spinning until one is available. Only to be called by the consumer.
+        T pop()
+        {
+            T out;
+
+            for (spin_wait sw; !try_pop(out);)
+            {
+                sw.wait();
+            }
+
+            return out;
+        }
+
+        /// @brief Pops up to out.size() elements, releasing the slots all at once.
+        /// @return The number of elements written to the output.
+        usize try_pop_batch(std::span<T> out)
+        {
+            const usize head = m_consumer.head.load(std::memory_order_relaxed);
+            usize available = m_consumer.cachedTail - head;
+
+            if (available < out.size())
+            {
+                m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+                available = m_consumer.cachedTail - head;
+            }
+
+            const usize count = out.size() < available ? out.size() : available;
+
+            for (usize i = 0; i < count; ++i)
+            {
+                T* const element = m_buffer + ((head + i) & m_mask);
+                out[i] = std::move(*element);
+                std::destroy_at(element);
+            }
+
+            m_consumer.head.store(head + count, std::memory_order_release);
+
+            return count;
+        }
+
+    private:
+        struct alignas(std::hardware_destructive_interference_size) producer_state
+        {
+            std::atomic<usize> tail;
+            usize cachedHead;
+
+            void reset()
+            {
+                tail.store(0, std::memory_order_relaxed);
+                cachedHead = 0;
+            }
+        };
+
+        struct alignas(std::hardware_destructive_interference_size) consumer_state
+        {
+            std::atomic<usize> head;
+            usize cachedTail;
+
+            void reset()
+            {
+                head.store(0, std::memory_order_relaxed);
+                cachedTail = 0;
+            }
+        };
+
+    private:
+        producer_state m_producer{};
+        consumer_state m_consumer{};
+        T* m_buffer{};
+        usize m_mask{};
+        allocator* m_allocator{};
+    };
+}
@@ -54,7 +54,8 @@ namespace oblo
     template <>
     struct hash<type_id>
     {
-        auto operator()(const type_id& typeId) const noexcept
+        /// @remarks The name hash is computed at compile time, so hashing a type_id is just a load.
+        constexpr hash_type operator()(const type_id& typeId) const noexcept
         {
             return typeId.name.hash();
         }
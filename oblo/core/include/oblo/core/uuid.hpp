@@ -236,16 +236,18 @@ namespace oblo
     template <>
     struct hash<oblo::uuid>
     {
-        constexpr auto operator()(const oblo::uuid& uuid) const noexcept
+        constexpr hash_type operator()(const oblo::uuid& uuid) const noexcept
         {
             struct u128
             {
-                char data[16];
+                u64 low;
+                u64 high;
             };
 
-            const auto chars = std::bit_cast<u128>(uuid);
+            // Most bits of a uuid are random already, folding the halves and mixing is enough
+            const auto halves = std::bit_cast<u128>(uuid);
 
-            return hash_xxhz_compile_time(chars.data, sizeof(uuid));
+            return hash_type(hash_integer(halves.low ^ hash_integer(halves.high)));
         }
     };
 }
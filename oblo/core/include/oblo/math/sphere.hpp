@@ -0,0 +1,26 @@
+#pragma once
+
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/vec3.hpp>
+
+namespace oblo
+{
+    struct sphere
+    {
+        vec3 center;
+        f32 radius;
+    };
+
+    constexpr bool overlap(const sphere& s, const aabb& box)
+    {
+        const vec3 closest = min(max(s.center, box.min), box.max);
+        return length2(closest - s.center) <= s.radius * s.radius;
+    }
+
+    // Returns true iff the box is entirely inside the sphere
+    constexpr bool contains(const sphere& s, const aabb& box)
+    {
+        const vec3 farthest = max(s.center - box.min, box.max - s.center);
+        return length2(farthest) <= s.radius * s.radius;
+    }
+}
@@ -1,13 +1,11 @@
 #pragma once
 
-#ifdef TRACY_ENABLE
+#if defined(TRACY_ENABLE) || defined(OBLO_TRACE_RECORDER)
 
     #include <oblo/core/string/string_view.hpp>
 
     #include <source_location>
 
-    #include <tracy/Tracy.hpp>
-
 namespace oblo::trace
 {
     consteval const char* make_scope_name(const char* name)
@@ -21,6 +19,12 @@ namespace oblo::trace
     }
 }
 
+#endif
+
+#ifdef TRACY_ENABLE
+
+    #include <tracy/Tracy.hpp>
+
     #define OBLO_PROFILE_FRAME_BEGIN()
     #define OBLO_PROFILE_FRAME_END() FrameMark
     #define OBLO_PROFILE_SCOPE(...) ZoneScopedN(oblo::trace::make_scope_name(__VA_ARGS__))
@@ -38,6 +42,34 @@ namespace oblo::trace
             ZoneTextV(Name, _trace_tag.data(), _trace_tag.size());                                                     \
         }
 
+#elif defined(OBLO_TRACE_RECORDER)
+
+    #include <oblo/core/preprocessor.hpp>
+    #include <oblo/trace/trace_recorder.hpp>
+
+    #define OBLO_PROFILE_FRAME_BEGIN()
+    #define OBLO_PROFILE_FRAME_END() oblo::trace::mark_frame()
+    #define OBLO_PROFILE_SCOPE(...)                                                                                    \
+        const oblo::trace::scope OBLO_CAT_EVAL(_trace_scope_, __LINE__)                                                \
+        {                                                                                                              \
+            oblo::trace::make_scope_name(__VA_ARGS__)                                                                  \
+        }
+    #define OBLO_PROFILE_SCOPE_NAMED(Name, ...)                                                                        \
+        const oblo::trace::scope Name                                                                                  \
+        {                                                                                                              \
+            oblo::trace::make_scope_name(__VA_ARGS__)                                                                  \
+        }
+
+    #define OBLO_PROFILE_TAG(Text)                                                                                     \
+        {                                                                                                              \
+            oblo::trace::tag(oblo::string_view{Text});                                                                 \
+        }
+
+    #define OBLO_PROFILE_TAG_NAMED(Name, Text)                                                                         \
+        {                                                                                                              \
+            Name.tag(oblo::string_view{Text});                                                                         \
+        }
+
 #else
 
     #define OBLO_PROFILE_FRAME_BEGIN()
@@ -47,4 +79,4 @@ namespace oblo::trace
     #define OBLO_PROFILE_TAG(Text)
     #define OBLO_PROFILE_TAG_NAMED(Name, Text)
 
-#endif
\ No newline at end of file
+#endif
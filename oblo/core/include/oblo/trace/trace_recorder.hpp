@@ -0,0 +1,102 @@
+#pragma once
+
+#include <oblo/core/expected.hpp>
+#include <oblo/core/string/cstring_view.hpp>
+#include <oblo/core/string/string_view.hpp>
+#include <oblo/core/types.hpp>
+
+#include <atomic>
+
+namespace oblo
+{
+    class string_builder;
+}
+
+namespace oblo::trace
+{
+    namespace detail
+    {
+        extern std::atomic<bool> g_recordingEnabled;
+
+        void record_begin(const char* name) noexcept;
+        void record_end() noexcept;
+        void record_tag(string_view text) noexcept;
+    }
+
+    // Built-in trace recorder, used by the OBLO_PROFILE_* macros when Tracy is not enabled.
+    // Each thread records events in its own fixed-size ring buffer, overwriting the oldest events when full, so a
+    // capture always contains the most recent part of the trace. The buffers of threads that exited are reused by new
+    // threads, which continue the same track in the trace.
+
+    /// @brief Enables or disables the recording, which is disabled by default.
+    void set_recording_enabled(bool enabled);
+
+    inline bool is_recording_enabled() noexcept
+    {
+        return detail::g_recordingEnabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Sets the number of events each thread can hold before overwriting the oldest ones.
+    /// @remarks Only affects threads that did not record any event yet. The value is rounded up to a power of two.
+    void set_events_per_thread(u32 count);
+
+    /// @brief Sets the name of the current thread, as shown in the trace.
+    void set_thread_name(string_view name);
+
+    /// @brief Discards all recorded events.
+    void clear_recording();
+
+    /// @brief Records a frame marker.
+    void mark_frame() noexcept;
+
+    /// @brief Appends the recorded events in the Chrome trace event JSON format, which can be opened in Perfetto.
+    /// @remarks Recording can continue while exporting, but events that are overwritten in the meanwhile are dropped.
+    void write_chrome_trace(string_builder& out);
+
+    /// @brief Writes the recorded events to a file in the Chrome trace event JSON format.
+    expected<> write_chrome_trace(cstring_view path);
+
+    /// @brief Records a scope, used by OBLO_PROFILE_SCOPE.
+    class scope
+    {
+    public:
+        explicit scope(const char* name) noexcept : m_active{is_recording_enabled()}
+        {
+            if (m_active)
+            {
+                detail::record_begin(name);
+            }
+        }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+        ~scope()
+        {
+            // We close the scope even if recording was disabled in the meanwhile, to keep events balanced
+            if (m_active)
+            {
+                detail::record_end();
+            }
+        }
+
+        void tag(string_view text) const noexcept
+        {
+            if (m_active)
+            {
+                detail::record_tag(text);
+            }
+        }
+
+    private:
+        bool m_active;
+    };
+
+    inline void tag(string_view text) noexcept
+    {
+        if (is_recording_enabled())
+        {
+            detail::record_tag(text);
+        }
+    }
+}
@@ -0,0 +1,231 @@
+#include <oblo/core/allocation_tracking.hpp>
+
+#include <oblo/core/array_size.hpp>
+#include <oblo/core/debug.hpp>
+#include <oblo/core/print.hpp>
+#include <oblo/core/time/clock.hpp>
+#include <oblo/core/utility.hpp>
+#include <oblo/math/power_of_two.hpp>
+
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+
+namespace oblo
+{
+    namespace
+    {
+        struct alignas(64) tag_counters
+        {
+            std::atomic<u64> liveBytes;
+            std::atomic<u64> peakBytes;
+            std::atomic<u64> totalBytes;
+            std::atomic<u64> allocations;
+            std::atomic<u64> deallocations;
+            std::atomic<u64> sizeHistogram[allocation_size_buckets];
+        };
+
+        struct allocation_header
+        {
+            u64 size;
+            u32 offset;
+            u16 alignment;
+            allocation_tag tag;
+        };
+
+        static_assert(sizeof(allocation_header) == 16);
+
+        constinit tag_counters g_counters[allocation_tags_count]{};
+
+        constexpr const char* g_tagNames[] = {
+            "general",
+            "ecs",
+            "jobs",
+            "resources",
+            "importers",
+            "strings",
+        };
+
+        static_assert(array_size(g_tagNames) == allocation_tags_count);
+
+        u32 get_size_bucket(usize size)
+        {
+            const u32 log2 = size == 0 ? 0 : u32(std::bit_width(size) - 1);
+            return min(log2, allocation_size_buckets - 1);
+        }
+
+        void record_allocation(allocation_tag tag, usize size)
+        {
+            auto& c = g_counters[u32(tag)];
+
+            const u64 live = c.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+            c.totalBytes.fetch_add(size, std::memory_order_relaxed);
+            c.allocations.fetch_add(1, std::memory_order_relaxed);
+            c.sizeHistogram[get_size_bucket(size)].fetch_add(1, std::memory_order_relaxed);
+
+            u64 peak = c.peakBytes.load(std::memory_order_relaxed);
+
+            while (live > peak && !c.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void record_deallocation(allocation_tag tag, usize size)
+        {
+            auto& c = g_counters[u32(tag)];
+
+            c.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+            c.deallocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void report_leaks_on_exit()
+        {
+            report_allocation_leaks(stderr);
+        }
+    }
+
+    byte* tracking_allocator::allocate(usize size, usize alignment) noexcept
+    {
+        OBLO_ASSERT(m_inner);
+        OBLO_ASSERT(is_power_of_two(alignment));
+
+        const usize headerAlignment = max(alignment, alignof(allocation_header));
+        const usize offset = align_power_of_two(sizeof(allocation_header), headerAlignment);
+
+        byte* const base = m_inner->allocate(size + offset, headerAlignment);
+
+        if (!base)
+        {
+            return nullptr;
+        }
+
+        byte* const ptr = base + offset;
+
+        new (ptr - sizeof(allocation_header)) allocation_header{
+            .size = size,
+            .offset = u32(offset),
+            .alignment = u16(headerAlignment),
+            .tag = m_tag,
+        };
+
+        record_allocation(m_tag, size);
+
+        return ptr;
+    }
+
+    void tracking_allocator::deallocate(byte* ptr, usize, usize) noexcept
+    {
+        if (!ptr)
+        {
+            return;
+        }
+
+        const auto* const header = reinterpret_cast<const allocation_header*>(ptr - sizeof(allocation_header));
+        OBLO_ASSERT(header->tag == m_tag);
+
+        const usize size = header->size;
+        const usize offset = header->offset;
+        const usize alignment = header->alignment;
+
+        record_deallocation(m_tag, size);
+
+        m_inner->deallocate(ptr - offset, size + offset, alignment);
+    }
+
+    bool is_allocation_tracking_enabled() noexcept
+    {
+#ifdef OBLO_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    const char* get_allocation_tag_name(allocation_tag tag) noexcept
+    {
+        return tag < allocation_tag::enum_max ? g_tagNames[u32(tag)] : "unknown";
+    }
+
+    allocation_snapshot get_allocation_snapshot() noexcept
+    {
+        allocation_snapshot snapshot{
+            .timestamp = clock::now(),
+        };
+
+        for (u32 i = 0; i < allocation_tags_count; ++i)
+        {
+            const auto& c = g_counters[i];
+            auto& s = snapshot.tags[i];
+
+            s.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+            s.peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+            s.totalBytes = c.totalBytes.load(std::memory_order_relaxed);
+            s.allocations = c.allocations.load(std::memory_order_relaxed);
+            s.deallocations = c.deallocations.load(std::memory_order_relaxed);
+
+            for (u32 j = 0; j < allocation_size_buckets; ++j)
+            {
+                s.sizeHistogram[j] = c.sizeHistogram[j].load(std::memory_order_relaxed);
+            }
+        }
+
+        return snapshot;
+    }
+
+    allocation_rate compute_allocation_rate(
+        const allocation_snapshot& from, const allocation_snapshot& to, allocation_tag tag) noexcept
+    {
+        const f64 seconds = f64(to_f32_seconds(to.timestamp - from.timestamp));
+
+        if (seconds <= 0.0)
+        {
+            return {};
+        }
+
+        const auto& a = from.tags[u32(tag)];
+        const auto& b = to.tags[u32(tag)];
+
+        return {
+            .allocationsPerSecond = f64(b.allocations - a.allocations) / seconds,
+            .bytesPerSecond = f64(b.totalBytes - a.totalBytes) / seconds,
+        };
+    }
+
+    bool report_allocation_leaks(std::FILE* file)
+    {
+        const auto snapshot = get_allocation_snapshot();
+
+        bool anyLeak = false;
+
+        for (u32 i = 0; i < allocation_tags_count; ++i)
+        {
+            const auto& s = snapshot.tags[i];
+
+            if (s.allocations == s.deallocations && s.liveBytes == 0)
+            {
+                continue;
+            }
+
+            if (!anyLeak)
+            {
+                print_line(file, "[Allocation Tracking] Live allocations detected");
+                anyLeak = true;
+            }
+
+            print_line(file,
+                "  {}: {} bytes in {} allocations (peak: {} bytes)",
+                get_allocation_tag_name(allocation_tag(i)),
+                s.liveBytes,
+                s.allocations - s.deallocations,
+                s.peakBytes);
+        }
+
+        return anyLeak;
+    }
+
+    void enable_allocation_leak_report_on_exit()
+    {
+        static const bool registered = std::atexit(report_leaks_on_exit) == 0;
+        (void) registered;
+    }
+}
@@ -1,5 +1,6 @@
 #include <oblo/core/allocator.hpp>
 
+#include <oblo/core/allocation_tracking.hpp>
 #include <oblo/core/debug.hpp>
 
 #include <cstdlib>
@@ -36,17 +37,64 @@ namespace oblo
             }
         };
 
-        global_allocator g_allocator;
-        global_aligned_allocator g_alignedAllocator;
+        constinit global_allocator g_allocator;
+        constinit global_aligned_allocator g_alignedAllocator;
+
+#ifdef OBLO_TRACK_ALLOCATIONS
+        template <usize... Tags>
+        consteval auto make_tracking_allocators(allocator* inner, std::index_sequence<Tags...>)
+        {
+            struct tracking_allocators
+            {
+                tracking_allocator allocators[sizeof...(Tags)];
+            };
+
+            return tracking_allocators{{tracking_allocator{inner, allocation_tag(Tags)}...}};
+        }
+
+        constinit auto g_trackingAllocators =
+            make_tracking_allocators(&g_allocator, std::make_index_sequence<allocation_tags_count>{});
+
+        constinit auto g_trackingAlignedAllocators =
+            make_tracking_allocators(&g_alignedAllocator, std::make_index_sequence<allocation_tags_count>{});
+#endif
     }
 
     allocator* get_global_allocator() noexcept
     {
+#ifdef OBLO_TRACK_ALLOCATIONS
+        return &g_trackingAllocators.allocators[u32(allocation_tag::general)];
+#else
         return &g_allocator;
+#endif
     }
 
     allocator* get_global_aligned_allocator() noexcept
     {
+#ifdef OBLO_TRACK_ALLOCATIONS
+        return &g_trackingAlignedAllocators.allocators[u32(allocation_tag::general)];
+#else
+        return &g_alignedAllocator;
+#endif
+    }
+
+    allocator* get_global_allocator([[maybe_unused]] allocation_tag tag) noexcept
+    {
+#ifdef OBLO_TRACK_ALLOCATIONS
+        OBLO_ASSERT(tag < allocation_tag::enum_max);
+        return &g_trackingAllocators.allocators[u32(tag)];
+#else
+        return &g_allocator;
+#endif
+    }
+
+    allocator* get_global_aligned_allocator([[maybe_unused]] allocation_tag tag) noexcept
+    {
+#ifdef OBLO_TRACK_ALLOCATIONS
+        OBLO_ASSERT(tag < allocation_tag::enum_max);
+        return &g_trackingAlignedAllocators.allocators[u32(tag)];
+#else
         return &g_alignedAllocator;
+#endif
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,619 @@
+#include <oblo/core/filesystem/async_file_io.hpp>
+
+#include <oblo/core/debug.hpp>
+#include <oblo/core/deque.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/filesystem/io_uring_queue.hpp>
+#include <oblo/core/utility.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+    #include <cerrno>
+#endif
+
+namespace oblo::filesystem
+{
+    namespace
+    {
+        enum class slot_state : u8
+        {
+            free,
+            queued,
+            in_flight,
+            // Cancelled while queued, the slot is released when it's dequeued
+            cancelled,
+        };
+
+        struct request_slot
+        {
+            async_io_request request;
+            u32 generation;
+            slot_state state;
+        };
+
+        struct pending_callback
+        {
+            async_io_callback callback;
+            void* userdata;
+            async_io_result result;
+        };
+
+        // User data reserved for internal operations in io_uring, slots use their handle value which is never 0
+        constexpr u64 WakeUpUserData{0};
+        constexpr u64 CancelUserData{~u64{}};
+
+        void invoke_callbacks(std::span<const pending_callback> callbacks)
+        {
+            for (const auto& c : callbacks)
+            {
+                if (c.callback)
+                {
+                    c.callback(c.result, c.userdata);
+                }
+            }
+        }
+    }
+
+    struct async_file_io::impl
+    {
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable idle;
+
+        dynamic_array<request_slot> slots;
+        dynamic_array<u32> freeSlots;
+        deque<u32> queued;
+
+        // Requests that have not invoked the callback yet
+        u32 activeCount{};
+        u32 inFlightCount{};
+        u32 queueDepth{};
+        bool stop{};
+
+        dynamic_array<std::thread> threads;
+
+#ifdef __linux__
+        io_uring_queue ring;
+
+        // Cleared by the completion thread if the ring breaks, it has to be accessed with the lock held
+        bool useRing{};
+#endif
+
+        static async_io_handle make_handle(u32 slotIndex, u32 generation)
+        {
+            return {(u64{generation} << 32) | (slotIndex + 1)};
+        }
+
+        request_slot* find_slot(async_io_handle h)
+        {
+            const u32 slotIndex = u32(h.value) - 1;
+            const u32 generation = u32(h.value >> 32);
+
+            if (!h || slotIndex >= slots.size())
+            {
+                return nullptr;
+            }
+
+            auto& slot = slots[slotIndex];
+            return slot.generation == generation && slot.state != slot_state::free ? &slot : nullptr;
+        }
+
+        u32 get_slot_index(const request_slot& slot) const
+        {
+            return u32(&slot - slots.data());
+        }
+
+        async_io_handle get_handle(const request_slot& slot) const
+        {
+            return make_handle(get_slot_index(slot), slot.generation);
+        }
+
+        async_io_handle enqueue_locked(const async_io_request& request)
+        {
+            OBLO_ASSERT(!stop);
+            OBLO_ASSERT(request.file && request.file->is_open());
+
+            u32 slotIndex;
+
+            if (freeSlots.empty())
+            {
+                slotIndex = slots.size32();
+                slots.push_back({.generation = 0});
+            }
+            else
+            {
+                slotIndex = freeSlots.back();
+                freeSlots.pop_back();
+            }
+
+            auto& slot = slots[slotIndex];
+            slot.request = request;
+            slot.state = slot_state::queued;
+
+            queued.push_back(slotIndex);
+            ++activeCount;
+
+            return make_handle(slotIndex, slot.generation);
+        }
+
+        void release_slot_locked(request_slot& slot)
+        {
+            slot.state = slot_state::free;
+            ++slot.generation;
+            freeSlots.push_back(get_slot_index(slot));
+        }
+
+        pending_callback complete_locked(request_slot& slot, async_io_status status, u32 bytesTransferred)
+        {
+            const pending_callback c{
+                .callback = slot.request.callback,
+                .userdata = slot.request.userdata,
+                .result =
+                    {
+                        .handle = get_handle(slot),
+                        .status = status,
+                        .bytesTransferred = bytesTransferred,
+                    },
+            };
+
+            release_slot_locked(slot);
+
+            return c;
+        }
+
+        // Pops the next request that was not cancelled, releasing the cancelled ones on the way
+        request_slot* pop_queued_locked()
+        {
+            while (!queued.empty())
+            {
+                auto& slot = slots[queued.front()];
+                queued.pop_front();
+
+                if (slot.state == slot_state::cancelled)
+                {
+                    release_slot_locked(slot);
+                    continue;
+                }
+
+                OBLO_ASSERT(slot.state == slot_state::queued);
+                return &slot;
+            }
+
+            return nullptr;
+        }
+
+        void on_callbacks_invoked(u32 count)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+
+            std::unique_lock lock{mutex};
+
+            OBLO_ASSERT(activeCount >= count);
+            activeCount -= count;
+
+            if (activeCount == 0)
+            {
+                idle.notify_all();
+            }
+        }
+
+        void worker_thread()
+        {
+            while (true)
+            {
+                request_slot* slot;
+
+                {
+                    std::unique_lock lock{mutex};
+                    workAvailable.wait(lock, [this] { return stop || !queued.empty(); });
+
+                    slot = pop_queued_locked();
+
+                    if (!slot)
+                    {
+                        if (stop)
+                        {
+                            return;
+                        }
+
+                        continue;
+                    }
+
+                    slot->state = slot_state::in_flight;
+                }
+
+                // The slot is not going to be touched by other threads until we release it
+                const async_io_request& r = slot->request;
+
+                const auto result = r.operation == async_io_operation::read
+                    ? r.file->read_at(r.buffer, r.size, r.offset)
+                    : r.file->write_at(r.buffer, r.size, r.offset);
+
+                auto status = async_io_status::completed;
+                u32 bytesTransferred{};
+
+                if (result)
+                {
+                    bytesTransferred = *result;
+                }
+                else if (result.error() != platform::file::error::eof)
+                {
+                    status = async_io_status::failed;
+                }
+
+                pending_callback c;
+
+                {
+                    std::unique_lock lock{mutex};
+                    c = complete_locked(*slot, status, bytesTransferred);
+                }
+
+                invoke_callbacks({&c, 1});
+                on_callbacks_invoked(1);
+            }
+        }
+
+#ifdef __linux__
+        // Moves queued requests to the ring, as long as there is space, and submits them
+        void flush_queued_locked(dynamic_array<pending_callback>& failed)
+        {
+            bool anyPrepared = false;
+
+            while (inFlightCount < queueDepth)
+            {
+                auto* const slot = pop_queued_locked();
+
+                if (!slot)
+                {
+                    break;
+                }
+
+                const async_io_request& r = slot->request;
+                const u64 userData = get_handle(*slot).value;
+
+                const bool prepared = r.operation == async_io_operation::read
+                    ? ring.prepare_read(r.file->get_native_handle(), r.buffer, r.size, r.offset, userData)
+                    : ring.prepare_write(r.file->get_native_handle(), r.buffer, r.size, r.offset, userData);
+
+                if (!prepared)
+                {
+                    // Should not happen since the ring is as big as the queue depth, but we can just try again later
+                    queued.push_front(get_slot_index(*slot));
+                    break;
+                }
+
+                slot->state = slot_state::in_flight;
+                ++inFlightCount;
+                anyPrepared = true;
+            }
+
+            if (anyPrepared && !ring.submit())
+            {
+                // We don't know which entries were consumed, but this should only happen if the ring itself is broken
+                OBLO_ASSERT(false, "Failed to submit to io_uring");
+                fail_in_flight_locked(failed);
+            }
+        }
+
+        void fail_in_flight_locked(dynamic_array<pending_callback>& failed)
+        {
+            for (auto& slot : slots)
+            {
+                if (slot.state == slot_state::in_flight)
+                {
+                    failed.push_back(complete_locked(slot, async_io_status::failed, 0));
+                    --inFlightCount;
+                }
+            }
+        }
+
+        // Called by the completion thread when the ring can't be waited on anymore, the requests in flight are failed
+        // and the thread carries on executing the queued ones as a worker
+        void fall_back_to_worker()
+        {
+            OBLO_ASSERT(false, "Failed to wait for io_uring completions");
+
+            dynamic_array<pending_callback> failed;
+
+            {
+                std::unique_lock lock{mutex};
+                useRing = false;
+                fail_in_flight_locked(failed);
+            }
+
+            invoke_callbacks(failed);
+            on_callbacks_invoked(failed.size32());
+
+            worker_thread();
+        }
+
+        void completion_thread()
+        {
+            struct completion
+            {
+                u64 userData;
+                i32 result;
+            };
+
+            dynamic_array<completion> completions;
+            dynamic_array<pending_callback> callbacks;
+
+            while (true)
+            {
+                bool wakeUp = false;
+
+                // Only this thread consumes completions, so we can do it without holding the lock
+                const bool succeeded = ring.wait_completions(
+                    [&](u64 userData, i32 result)
+                    {
+                        if (userData == WakeUpUserData)
+                        {
+                            wakeUp = true;
+                        }
+                        else if (userData != CancelUserData)
+                        {
+                            completions.push_back({userData, result});
+                        }
+                    });
+
+                if (!succeeded)
+                {
+                    fall_back_to_worker();
+                    return;
+                }
+
+                {
+                    std::unique_lock lock{mutex};
+
+                    for (const auto [userData, result] : completions)
+                    {
+                        auto* const slot = find_slot({userData});
+                        OBLO_ASSERT(slot && slot->state == slot_state::in_flight);
+
+                        auto status = async_io_status::completed;
+
+                        if (result == -ECANCELED)
+                        {
+                            status = async_io_status::cancelled;
+                        }
+                        else if (result < 0)
+                        {
+                            status = async_io_status::failed;
+                        }
+
+                        callbacks.push_back(complete_locked(*slot, status, result < 0 ? 0u : u32(result)));
+                        --inFlightCount;
+                    }
+
+                    // Completions made space in the ring, we can submit more requests
+                    flush_queued_locked(callbacks);
+
+                    if (wakeUp && stop && inFlightCount == 0)
+                    {
+                        OBLO_ASSERT(callbacks.empty());
+                        return;
+                    }
+                }
+
+                invoke_callbacks(callbacks);
+                on_callbacks_invoked(callbacks.size32());
+
+                completions.clear();
+                callbacks.clear();
+            }
+        }
+#endif
+    };
+
+    async_file_io::async_file_io() = default;
+
+    async_file_io::~async_file_io()
+    {
+        shutdown();
+    }
+
+    expected<> async_file_io::init(const async_file_io_initializer& initializer)
+    {
+        shutdown();
+
+        m_impl = allocate_unique<impl>();
+        m_impl->queueDepth = max(initializer.queueDepth, 1u);
+
+#ifdef __linux__
+        if (!initializer.forceFallback && m_impl->ring.init(m_impl->queueDepth))
+        {
+            m_impl->useRing = true;
+            m_impl->threads.emplace_back([impl = m_impl.get()] { impl->completion_thread(); });
+            return no_error;
+        }
+#endif
+
+        const u32 threadsCount = max(initializer.fallbackThreadsCount, 1u);
+
+        for (u32 i = 0; i < threadsCount; ++i)
+        {
+            m_impl->threads.emplace_back([impl = m_impl.get()] { impl->worker_thread(); });
+        }
+
+        return no_error;
+    }
+
+    void async_file_io::shutdown()
+    {
+        if (!m_impl)
+        {
+            return;
+        }
+
+        dynamic_array<pending_callback> cancelled;
+
+        {
+            std::unique_lock lock{m_impl->mutex};
+            m_impl->stop = true;
+
+            while (auto* const slot = m_impl->pop_queued_locked())
+            {
+                cancelled.push_back(m_impl->complete_locked(*slot, async_io_status::cancelled, 0));
+            }
+        }
+
+        invoke_callbacks(cancelled);
+        m_impl->on_callbacks_invoked(cancelled.size32());
+
+        wait_idle();
+
+#ifdef __linux__
+        {
+            std::unique_lock lock{m_impl->mutex};
+
+            if (m_impl->useRing)
+            {
+                m_impl->ring.prepare_nop(WakeUpUserData);
+                m_impl->ring.submit();
+            }
+        }
+#endif
+
+        // Also wakes up the completion thread, in case it fell back to executing requests itself
+        m_impl->workAvailable.notify_all();
+
+        for (auto& t : m_impl->threads)
+        {
+            t.join();
+        }
+
+        m_impl.reset();
+    }
+
+    bool async_file_io::is_using_io_uring() const
+    {
+#ifdef __linux__
+        if (!m_impl)
+        {
+            return false;
+        }
+
+        std::unique_lock lock{m_impl->mutex};
+        return m_impl->useRing;
+#else
+        return false;
+#endif
+    }
+
+    async_io_handle async_file_io::submit(const async_io_request& request)
+    {
+        async_io_handle h;
+        submit({&request, 1}, {&h, 1});
+        return h;
+    }
+
+    void async_file_io::submit(std::span<const async_io_request> requests, std::span<async_io_handle> outHandles)
+    {
+        OBLO_ASSERT(outHandles.empty() || outHandles.size() >= requests.size());
+
+        [[maybe_unused]] dynamic_array<pending_callback> failed;
+        [[maybe_unused]] bool useRing{};
+
+        {
+            std::unique_lock lock{m_impl->mutex};
+
+            for (usize i = 0; i < requests.size(); ++i)
+            {
+                const auto h = m_impl->enqueue_locked(requests[i]);
+
+                if (!outHandles.empty())
+                {
+                    outHandles[i] = h;
+                }
+            }
+
+#ifdef __linux__
+            useRing = m_impl->useRing;
+
+            if (useRing)
+            {
+                m_impl->flush_queued_locked(failed);
+            }
+#endif
+        }
+
+#ifdef __linux__
+        if (useRing)
+        {
+            invoke_callbacks(failed);
+            m_impl->on_callbacks_invoked(failed.size32());
+            return;
+        }
+#endif
+
+        if (requests.size() == 1)
+        {
+            m_impl->workAvailable.notify_one();
+        }
+        else
+        {
+            m_impl->workAvailable.notify_all();
+        }
+    }
+
+    bool async_file_io::cancel(async_io_handle handle)
+    {
+        pending_callback c;
+
+        {
+            std::unique_lock lock{m_impl->mutex};
+
+            auto* const slot = m_impl->find_slot(handle);
+
+            if (!slot || slot->state == slot_state::cancelled)
+            {
+                return false;
+            }
+
+            if (slot->state == slot_state::in_flight)
+            {
+#ifdef __linux__
+                if (m_impl->useRing && m_impl->ring.prepare_cancel(handle.value, CancelUserData))
+                {
+                    m_impl->ring.submit();
+                }
+#endif
+
+                // The callback will be invoked by the I/O thread, with the cancelled status if it succeeded
+                return true;
+            }
+
+            OBLO_ASSERT(slot->state == slot_state::queued);
+
+            c = {
+                .callback = slot->request.callback,
+                .userdata = slot->request.userdata,
+                .result =
+                    {
+                        .handle = handle,
+                        .status = async_io_status::cancelled,
+                    },
+            };
+
+            // Keep the slot reserved until it's dequeued
+            slot->state = slot_state::cancelled;
+        }
+
+        invoke_callbacks({&c, 1});
+        m_impl->on_callbacks_invoked(1);
+
+        return true;
+    }
+
+    void async_file_io::wait_idle()
+    {
+        std::unique_lock lock{m_impl->mutex};
+        m_impl->idle.wait(lock, [this] { return m_impl->activeCount == 0; });
+    }
+}
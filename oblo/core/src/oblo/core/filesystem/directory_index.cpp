@@ -0,0 +1,504 @@
+#include <oblo/core/filesystem/directory_index.hpp>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/filesystem/file.hpp>
+#include <oblo/core/filesystem/mapped_file.hpp>
+#include <oblo/core/hash.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+namespace oblo::filesystem
+{
+    namespace
+    {
+        constexpr u32 IndexMagic{0x5844494F};
+        constexpr u32 IndexVersion{2};
+
+        // Used for changes detected by scans, which don't need to be debounced
+        constexpr time NoDebounce{std::numeric_limits<i64>::min() / 2};
+
+        struct index_header
+        {
+            u32 magic;
+            u32 version;
+            u64 entriesCount;
+        };
+
+        struct index_entry
+        {
+            i64 lastWriteTime;
+            u64 size;
+            u64 contentHash;
+            u32 pathLength;
+            u8 isDirectory;
+        };
+
+        std::filesystem::path make_native_path(string_view path)
+        {
+            return std::filesystem::path{std::u8string_view{path.u8data(), path.size()}};
+        }
+
+        bool is_in_subtree(string_view path, string_view directory)
+        {
+            return path.size() > directory.size() && path.starts_with(directory) &&
+                (path[directory.size()] == '/' || path[directory.size()] == '\\');
+        }
+
+        template <typename T>
+        void write_pod(dynamic_array<byte>& out, const T& value)
+        {
+            const auto* const bytes = reinterpret_cast<const byte*>(&value);
+            out.append(bytes, bytes + sizeof(T));
+        }
+
+        template <typename T>
+        bool read_pod(std::span<const byte>& in, T& value)
+        {
+            if (in.size() < sizeof(T))
+            {
+                return false;
+            }
+
+            std::memcpy(&value, in.data(), sizeof(T));
+            in = in.subspan(sizeof(T));
+            return true;
+        }
+    }
+
+    void directory_index::init(cstring_view root, const config& cfg)
+    {
+        m_root = root;
+        m_config = cfg;
+        m_files.clear();
+        m_pending.clear();
+    }
+
+    expected<> directory_index::load(cstring_view indexPath)
+    {
+        mapped_file file;
+
+        if (!file.open(indexPath, mapped_file_hint::sequential))
+        {
+            return "Failed to read directory index"_err;
+        }
+
+        std::span<const byte> in = file.get_bytes();
+
+        index_header header;
+
+        if (!read_pod(in, header) || header.magic != IndexMagic || header.version != IndexVersion)
+        {
+            return "Invalid directory index"_err;
+        }
+
+        files_map files;
+        files.reserve(header.entriesCount);
+
+        for (u64 i = 0; i < header.entriesCount; ++i)
+        {
+            index_entry entry;
+
+            if (!read_pod(in, entry) || in.size() < entry.pathLength)
+            {
+                return "Invalid directory index"_err;
+            }
+
+            // Paths are stored relative to the root, so the index survives moving the whole directory
+            m_pathBuffer = m_root;
+            m_pathBuffer.append_path_separator().append(string_view{reinterpret_cast<const char*>(in.data()),
+                entry.pathLength});
+
+            in = in.subspan(entry.pathLength);
+
+            files.emplace(m_pathBuffer.as<string>(),
+                file_state{
+                    .lastWriteTime = entry.lastWriteTime,
+                    .size = entry.size,
+                    .contentHash = entry.contentHash,
+                    .isDirectory = entry.isDirectory != 0,
+                });
+        }
+
+        m_files = std::move(files);
+
+        return no_error;
+    }
+
+    expected<> directory_index::save(cstring_view indexPath) const
+    {
+        dynamic_array<byte> out;
+        out.reserve(sizeof(index_header) + m_files.size() * (sizeof(index_entry) + 32));
+
+        write_pod(out,
+            index_header{
+                .magic = IndexMagic,
+                .version = IndexVersion,
+                .entriesCount = m_files.size(),
+            });
+
+        const usize rootLength = m_root.size() + 1;
+
+        for (const auto& [path, state] : m_files)
+        {
+            OBLO_ASSERT(path.size() > rootLength);
+            const string_view relativePath = string_view{path}.substr(rootLength);
+
+            write_pod(out,
+                index_entry{
+                    .lastWriteTime = state.lastWriteTime,
+                    .size = state.size,
+                    .contentHash = state.contentHash,
+                    .pathLength = u32(relativePath.size()),
+                    .isDirectory = u8{state.isDirectory},
+                });
+
+            const auto* const pathBytes = reinterpret_cast<const byte*>(relativePath.data());
+            out.append(pathBytes, pathBytes + relativePath.size());
+        }
+
+        return write_file(indexPath, out, write_mode::binary);
+    }
+
+    void directory_index::scan(bool silent)
+    {
+        if (silent)
+        {
+            m_files.clear();
+        }
+
+        // Start by assuming everything was removed, the walk will clear the entries that are still there
+        if (!silent)
+        {
+            for (const auto& [path, state] : m_files)
+            {
+                m_pending.try_emplace(path, pending_change{.lastEvent = NoDebounce});
+            }
+        }
+
+        string_builder path = m_root;
+        scan_directory(path, silent);
+    }
+
+    void directory_index::scan_directory(string_builder& path, bool silent)
+    {
+        std::error_code ec;
+        std::filesystem::directory_iterator it{make_native_path(path.as<string_view>()), ec};
+
+        if (ec)
+        {
+            return;
+        }
+
+        const usize parentLength = path.size();
+
+        for (const auto& entry : it)
+        {
+            const auto fileName = entry.path().filename().u8string();
+
+            path.resize(parentLength);
+            path.append_path_separator().append(fileName.c_str(), fileName.c_str() + fileName.size());
+
+            const bool isDirectory = entry.is_directory(ec);
+
+            const file_state current{
+                .lastWriteTime = isDirectory ? 0 : entry.last_write_time(ec).time_since_epoch().count(),
+                .size = isDirectory ? 0 : u64(entry.file_size(ec)),
+                .isDirectory = isDirectory,
+            };
+
+            if (silent)
+            {
+                m_files.emplace(path.as<string>(), current);
+            }
+            else
+            {
+                const auto fileIt = m_files.find(path.as<string_view>());
+
+                if (fileIt != m_files.end() && fileIt->second.lastWriteTime == current.lastWriteTime &&
+                    fileIt->second.size == current.size && fileIt->second.isDirectory == current.isDirectory)
+                {
+                    // Unchanged, remove the entry we added assuming it was removed
+                    if (const auto pendingIt = m_pending.find(path.as<string_view>());
+                        pendingIt != m_pending.end() && pendingIt->second.lastEvent == NoDebounce)
+                    {
+                        m_pending.erase(pendingIt);
+                    }
+                }
+                else
+                {
+                    m_pending.insert_or_assign(path.as<string>(), pending_change{.lastEvent = NoDebounce});
+                }
+            }
+
+            if (isDirectory && m_config.isRecursive)
+            {
+                scan_directory(path, silent);
+            }
+        }
+
+        path.resize(parentLength);
+    }
+
+    bool directory_index::query_state(cstring_view path, file_state& out) const
+    {
+        const auto nativePath = make_native_path(path);
+
+        std::error_code ec;
+        const auto status = std::filesystem::status(nativePath, ec);
+
+        if (ec || !std::filesystem::exists(status))
+        {
+            return false;
+        }
+
+        const bool isDirectory = std::filesystem::is_directory(status);
+
+        out = {
+            .isDirectory = isDirectory,
+        };
+
+        if (!isDirectory)
+        {
+            out.lastWriteTime = std::filesystem::last_write_time(nativePath, ec).time_since_epoch().count();
+            out.size = u64(std::filesystem::file_size(nativePath, ec));
+        }
+
+        return true;
+    }
+
+    u64 directory_index::hash_contents(cstring_view path) const
+    {
+        mapped_file file;
+
+        if (!file.open(path, mapped_file_hint::sequential))
+        {
+            return 0;
+        }
+
+        // Zero is reserved for unknown hashes
+        return max(hash_xxh3(file.data(), file.size()), u64{1});
+    }
+
+    void directory_index::rename_subtree(string_view from, string_view to)
+    {
+        dynamic_array<std::pair<string, file_state>> moved;
+
+        for (auto it = m_files.begin(); it != m_files.end();)
+        {
+            if (is_in_subtree(it->first, from))
+            {
+                m_pathBuffer = to;
+                m_pathBuffer.append(string_view{it->first}.substr(from.size()));
+
+                moved.emplace_back(m_pathBuffer.as<string>(), it->second);
+                it = m_files.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        for (auto& [path, state] : moved)
+        {
+            m_files.insert_or_assign(std::move(path), state);
+        }
+    }
+
+    void directory_index::erase_subtree(string_view directory, directory_watcher::callback_fn callback)
+    {
+        for (auto it = m_files.begin(); it != m_files.end();)
+        {
+            if (is_in_subtree(it->first, directory))
+            {
+                // Subscribers might have an entry for each file, so every one of them is reported
+                callback({
+                    .path = it->first,
+                    .eventKind = directory_watcher_event_kind::removed,
+                });
+
+                it = m_files.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void directory_index::push(const directory_watcher_event& e, time now)
+    {
+        const auto [it, inserted] = m_pending.try_emplace(e.path.as<string>());
+        it->second.lastEvent = now;
+
+        if (e.eventKind == directory_watcher_event_kind::renamed)
+        {
+            it->second.previousName = e.previousName.as<string>();
+
+            // The old name might need to be reported as removed, e.g. if the new name was not part of the tree
+            m_pending.try_emplace(e.previousName.as<string>()).first->second.lastEvent = now;
+        }
+    }
+
+    void directory_index::flush(time now, directory_watcher::callback_fn callback)
+    {
+        // Processing new directories might add more changes, we keep going until nothing is left
+        while (true)
+        {
+            m_ready.clear();
+
+            for (const auto& [path, change] : m_pending)
+            {
+                if (now - change.lastEvent >= m_config.debounceTime)
+                {
+                    m_ready.push_back(path);
+                }
+            }
+
+            if (m_ready.empty())
+            {
+                return;
+            }
+
+            // Process renames first, so that we can report them instead of a removal and an addition
+            const auto isRename = [this](const string& path) { return !m_pending.at(path).previousName.empty(); };
+            std::stable_partition(m_ready.begin(), m_ready.end(), isRename);
+
+            for (const auto& path : m_ready)
+            {
+                const auto it = m_pending.find(path);
+
+                // A rename might have consumed the entry already
+                if (it == m_pending.end())
+                {
+                    continue;
+                }
+
+                const pending_change change = std::move(it->second);
+                m_pending.erase(it);
+
+                flush_one(path, change, callback);
+            }
+        }
+    }
+
+    void directory_index::flush_one(
+        const string& path, const pending_change& change, directory_watcher::callback_fn callback)
+    {
+        file_state current;
+        const bool exists = query_state(path, current);
+
+        const auto it = m_files.find(path);
+
+        if (exists && it == m_files.end())
+        {
+            if (!change.previousName.empty())
+            {
+                const auto previousIt = m_files.find(change.previousName);
+                file_state previousState;
+
+                if (previousIt != m_files.end() && !query_state(change.previousName, previousState))
+                {
+                    current.contentHash = previousIt->second.contentHash;
+
+                    m_files.erase(previousIt);
+                    m_files.emplace(path, current);
+
+                    if (current.isDirectory)
+                    {
+                        rename_subtree(change.previousName, path);
+                    }
+
+                    m_pending.erase(change.previousName);
+
+                    callback({
+                        .path = path,
+                        .eventKind = directory_watcher_event_kind::renamed,
+                        .previousName = change.previousName,
+                    });
+
+                    return;
+                }
+            }
+
+            if (m_config.hashContents && !current.isDirectory)
+            {
+                current.contentHash = hash_contents(path);
+            }
+
+            m_files.emplace(path, current);
+
+            callback({
+                .path = path,
+                .eventKind = directory_watcher_event_kind::added,
+            });
+
+            // Files might have been created before we started watching the new directory
+            if (current.isDirectory && m_config.isRecursive)
+            {
+                m_pathBuffer = path;
+                scan_directory(m_pathBuffer, false);
+            }
+        }
+        else if (!exists && it != m_files.end())
+        {
+            const bool isDirectory = it->second.isDirectory;
+            m_files.erase(it);
+
+            if (isDirectory)
+            {
+                erase_subtree(path, callback);
+            }
+
+            callback({
+                .path = path,
+                .eventKind = directory_watcher_event_kind::removed,
+            });
+        }
+        else if (exists)
+        {
+            auto& previous = it->second;
+
+            if (current.isDirectory != previous.isDirectory)
+            {
+                // Replaced a file with a directory or vice versa, we report it as modified
+                previous = current;
+            }
+            else if (current.isDirectory ||
+                (current.lastWriteTime == previous.lastWriteTime && current.size == previous.size))
+            {
+                // Nothing changed, e.g. the event was about the content of a directory
+                return;
+            }
+            else if (m_config.hashContents)
+            {
+                current.contentHash = hash_contents(path);
+
+                const bool sameContent = previous.contentHash != 0 && previous.contentHash == current.contentHash;
+                previous = current;
+
+                if (sameContent)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                previous = current;
+            }
+
+            callback({
+                .path = path,
+                .eventKind = directory_watcher_event_kind::modified,
+            });
+        }
+    }
+
+    usize directory_index::get_files_count() const
+    {
+        return m_files.size();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/expected.hpp>
+#include <oblo/core/filesystem/directory_watcher.hpp>
+#include <oblo/core/string/string.hpp>
+#include <oblo/core/string/string_builder.hpp>
+#include <oblo/core/string/transparent_string_hash.hpp>
+#include <oblo/core/time/time.hpp>
+
+#include <unordered_map>
+
+namespace oblo::filesystem
+{
+    /// @brief Keeps track of the state of the files in a directory, used by the directory watcher to coalesce
+    /// notifications into one event per file, and to detect changes across runs.
+    class directory_index
+    {
+    public:
+        struct config
+        {
+            bool isRecursive;
+            bool hashContents;
+            time debounceTime;
+        };
+
+    public:
+        void init(cstring_view root, const config& cfg);
+
+        expected<> load(cstring_view indexPath);
+        expected<> save(cstring_view indexPath) const;
+
+        /// @brief Walks the whole tree, comparing it against the index.
+        /// @param silent If true the index is updated without reporting any event, otherwise differences are reported
+        /// on the next flush.
+        void scan(bool silent);
+
+        /// @brief Records a notification, the event will be reported on flush once the debounce time expired.
+        void push(const directory_watcher_event& e, time now);
+
+        /// @brief Reports the changes for all the files that were not touched for at least the debounce time.
+        void flush(time now, directory_watcher::callback_fn callback);
+
+        usize get_files_count() const;
+
+    private:
+        struct file_state
+        {
+            i64 lastWriteTime;
+            u64 size;
+            u64 contentHash;
+            bool isDirectory;
+        };
+
+        struct pending_change
+        {
+            time lastEvent;
+            string previousName;
+        };
+
+        using files_map = std::unordered_map<string, file_state, transparent_string_hash, std::equal_to<>>;
+        using pending_map = std::unordered_map<string, pending_change, transparent_string_hash, std::equal_to<>>;
+
+    private:
+        void scan_directory(string_builder& path, bool silent);
+        bool query_state(cstring_view path, file_state& out) const;
+        u64 hash_contents(cstring_view path) const;
+
+        void rename_subtree(string_view from, string_view to);
+        void erase_subtree(string_view directory, directory_watcher::callback_fn callback);
+
+        void flush_one(const string& path, const pending_change& change, directory_watcher::callback_fn callback);
+
+    private:
+        string_builder m_root;
+        config m_config{};
+        files_map m_files;
+        pending_map m_pending;
+        dynamic_array<string> m_ready;
+        string_builder m_pathBuffer;
+    };
+}
@@ -1,10 +1,12 @@
 ﻿#ifdef __linux__
 
     #include <oblo/core/array_size.hpp>
+    #include <oblo/core/filesystem/directory_index.hpp>
     #include <oblo/core/filesystem/directory_watcher.hpp>
     #include <oblo/core/filesystem/filesystem.hpp>
     #include <oblo/core/string/hashed_string_view.hpp>
     #include <oblo/core/string/string_builder.hpp>
+    #include <oblo/core/time/clock.hpp>
     #include <oblo/core/unordered_map.hpp>
 
     #include <sys/inotify.h>
@@ -20,13 +22,20 @@ namespace oblo::filesystem
     {
         int inotifyFd{-1};
         bool isRecursive{};
+        bool coalesce{};
+
+        /// @brief The directories that could not be watched since the last process call.
+        u32 failedWatchesCount{};
 
         string_builder path;
+        string indexPath;
 
         unordered_map<hashed_string_view, int> pathToWd;
         unordered_map<int, string_builder> wdToPath;
 
-        alignas(void*) u8 buffer[4096];
+        directory_index index;
+
+        alignas(inotify_event) u8 buffer[64 << 10];
 
         expected<> build_full_path(string_builder& out, int wd, cstring_view path)
         {
@@ -51,32 +60,119 @@ namespace oblo::filesystem
 
             if (isRecursive)
             {
-                string_builder buf;
+                add_subdirectory_watches(directoryPath);
+            }
+
+            return no_error;
+        }
 
-                const auto r = filesystem::walk(directoryPath,
-                    [this, &buf](const filesystem::walk_entry& e)
+        /// @brief Watches the subdirectories recursively, skipping the ones that can't be watched, e.g. because they
+        /// were removed in the meantime or because the inotify watch limit was reached. Failures are counted, and
+        /// reported by the next process call.
+        void add_subdirectory_watches(cstring_view directoryPath)
+        {
+            string_builder buf;
+
+            const auto r = filesystem::walk(directoryPath,
+                [this, &buf](const filesystem::walk_entry& e)
+                {
+                    if (e.is_directory())
                     {
-                        if (e.is_directory())
+                        e.append_full_path(buf.clear());
+
+                        if (add_watch_impl(buf))
                         {
-                            e.append_full_path(buf.clear());
-                            add_watch_impl(buf);
+                            add_subdirectory_watches(buf);
                         }
+                        else
+                        {
+                            ++failedWatchesCount;
+                        }
+                    }
 
-                        return walk_result::walk;
-                    });
+                    return walk_result::walk;
+                });
 
-                return r;
+            if (!r)
+            {
+                ++failedWatchesCount;
             }
+        }
 
-            return no_error;
+        void remove_watch_subtree(string_view directoryPath)
+        {
+            OBLO_ASSERT(isRecursive);
+
+            // The directory is usually gone at this point, so we look for the watches rather than walking the tree
+            for (auto it = wdToPath.begin(); it != wdToPath.end();)
+            {
+                if (is_same_or_subdirectory(it->second.as<string_view>(), directoryPath))
+                {
+                    inotify_rm_watch(inotifyFd, it->first);
+                    pathToWd.erase(it->second.as<hashed_string_view>());
+                    it = wdToPath.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        void rename_watch_subtree(string_view from, string_view to)
+        {
+            OBLO_ASSERT(isRecursive);
+
+            string_builder buf;
+
+            for (auto& [wd, watchPath] : wdToPath)
+            {
+                if (is_same_or_subdirectory(watchPath.as<string_view>(), from))
+                {
+                    pathToWd.erase(watchPath.as<hashed_string_view>());
+
+                    buf = to;
+                    buf.append(watchPath.as<string_view>().substr(from.size()));
+                    watchPath = buf;
+
+                    pathToWd[watchPath.as<hashed_string_view>()] = wd;
+                }
+            }
         }
 
-        expected<> remove_watch_subtree(cstring_view directoryPath)
+        /// @brief Brings the watches up to date after an overflow, which might have dropped the events about
+        /// directories being created, moved or removed. Existing watches are kept, only the directories that are not
+        /// watched yet are added.
+        void update_watches()
         {
             OBLO_ASSERT(isRecursive);
 
-            remove_watch_from_full_path(directoryPath.as<hashed_string_view>());
+            // The IN_IGNORED events of directories removed or moved away might have been dropped as well
+            for (auto it = wdToPath.begin(); it != wdToPath.end();)
+            {
+                if (!filesystem::is_directory(it->second.as<string_view>()).value_or(false))
+                {
+                    inotify_rm_watch(inotifyFd, it->first);
+                    pathToWd.erase(it->second.as<hashed_string_view>());
+                    it = wdToPath.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            if (!pathToWd.contains(path.as<hashed_string_view>()) && !add_watch_impl(path))
+            {
+                ++failedWatchesCount;
+                return;
+            }
 
+            add_missing_subdirectory_watches(path);
+        }
+
+        void add_missing_subdirectory_watches(cstring_view directoryPath)
+        {
             string_builder buf;
 
             const auto r = filesystem::walk(directoryPath,
@@ -86,13 +182,24 @@ namespace oblo::filesystem
                     {
                         e.append_full_path(buf.clear());
 
-                        remove_watch_from_full_path(buf.as<hashed_string_view>());
+                        // Moved directories keep their watch descriptor, which add_watch_impl maps to the new path
+                        if (pathToWd.contains(buf.as<hashed_string_view>()) || add_watch_impl(buf))
+                        {
+                            add_missing_subdirectory_watches(buf);
+                        }
+                        else
+                        {
+                            ++failedWatchesCount;
+                        }
                     }
 
                     return walk_result::walk;
                 });
 
-            return r;
+            if (!r)
+            {
+                ++failedWatchesCount;
+            }
         }
 
         void remove_watch_from_wd(int wd)
@@ -119,10 +226,15 @@ namespace oblo::filesystem
         }
 
     private:
+        static bool is_same_or_subdirectory(string_view p, string_view directory)
+        {
+            return p.starts_with(directory) && (p.size() == directory.size() || p[directory.size()] == '/');
+        }
+
         bool add_watch_impl(const cstring_view& directoryPath)
         {
-            static constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_MOVE_SELF |
-                IN_MOVED_FROM | IN_MOVED_TO | IN_IGNORED;
+            static constexpr uint32_t mask =
+                IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO | IN_IGNORED;
 
             const int wd = inotify_add_watch(inotifyFd, directoryPath.c_str(), mask);
 
@@ -147,7 +259,10 @@ namespace oblo::filesystem
     directory_watcher::directory_watcher() = default;
     directory_watcher::directory_watcher(directory_watcher&&) noexcept = default;
     directory_watcher& directory_watcher::operator=(directory_watcher&&) noexcept = default;
-    directory_watcher::~directory_watcher() = default;
+    directory_watcher::~directory_watcher()
+    {
+        shutdown();
+    }
 
     expected<> directory_watcher::init(const directory_watcher_initializer& initializer)
     {
@@ -177,15 +292,39 @@ namespace oblo::filesystem
         if (!r)
         {
             shutdown();
+            return r;
+        }
+
+        if (initializer.coalesceEvents)
+        {
+            m_impl->coalesce = true;
+            m_impl->indexPath = initializer.indexPath;
+
+            m_impl->index.init(m_impl->path,
+                {
+                    .isRecursive = initializer.isRecursive,
+                    .hashContents = initializer.hashContents,
+                    .debounceTime = initializer.debounceTime,
+                });
+
+            // Without a previous index we have nothing to compare against, we just take the current state
+            const bool hasIndex = !m_impl->indexPath.empty() && m_impl->index.load(m_impl->indexPath);
+            m_impl->index.scan(!hasIndex);
         }
 
-        return r;
+        return no_error;
     }
 
     void directory_watcher::shutdown()
     {
         if (m_impl)
         {
+            if (m_impl->coalesce && !m_impl->indexPath.empty())
+            {
+                // Best effort, if it fails the next run will start from a full scan
+                [[maybe_unused]] const auto saved = save_index();
+            }
+
             for (const auto& [fd, path] : m_impl->wdToPath)
             {
                 inotify_rm_watch(m_impl->inotifyFd, fd);
@@ -207,16 +346,13 @@ namespace oblo::filesystem
             return "Failed to watch directory"_err;
         }
 
-        const ssize_t bytesRead = read(m_impl->inotifyFd, m_impl->buffer, sizeof(m_impl->buffer));
+        const time now = clock::now();
 
-        if (bytesRead <= 0)
-        {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
-            {
-                return no_error;
-            }
-            return "Operation failed"_err;
-        }
+        // When coalescing we feed the index instead, which will report events on flush
+        const auto pushToIndex = [impl = m_impl.get(), now](const directory_watcher_event& e)
+        { impl->index.push(e, now); };
+
+        const callback_fn dispatch = m_impl->coalesce ? callback_fn{pushToIndex} : callback;
 
         string_builder fullPath;
 
@@ -230,7 +366,7 @@ namespace oblo::filesystem
 
         pending_rename_info pendingRename;
 
-        const auto try_flush_pending_moved_from = [&pendingRename, &callback, impl = m_impl.get()]
+        const auto try_flush_pending_moved_from = [&pendingRename, &dispatch, impl = m_impl.get()]
         {
             if (pendingRename.cookie == 0)
             {
@@ -242,137 +378,173 @@ namespace oblo::filesystem
                 .eventKind = directory_watcher_event_kind::removed,
             };
 
-            callback(e);
+            dispatch(e);
 
             const bool isWatchSubdir = pendingRename.isDir && impl->isRecursive;
 
             if (isWatchSubdir)
             {
-                impl->remove_watch_subtree(pendingRename.oldName).assert_value();
+                impl->remove_watch_subtree(pendingRename.oldName.as<string_view>());
             }
+
+            pendingRename.cookie = 0;
         };
 
-        for (ssize_t offset = 0; offset < bytesRead;)
-        {
-            auto* const evt = reinterpret_cast<const inotify_event*>(m_impl->buffer + offset);
+        bool hasOverflown{};
 
-            directory_watcher_event_kind kind{};
-            bool sendEvent{true};
+        while (true)
+        {
+            const ssize_t bytesRead = read(m_impl->inotifyFd, m_impl->buffer, sizeof(m_impl->buffer));
 
-            if (evt->mask & IN_CREATE)
+            if (bytesRead <= 0)
             {
-                kind = directory_watcher_event_kind::added;
-
-                if (m_impl->isRecursive && evt->mask & IN_ISDIR)
+                if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
                 {
-                    if (m_impl->build_full_path(fullPath, evt->wd, evt->name))
-                    {
-                        m_impl->add_watch(fullPath.as<cstring_view>()).assert_value();
-                    }
+                    break;
                 }
+
+                return "Operation failed"_err;
             }
-            else if (evt->mask & IN_DELETE)
+
+            for (ssize_t offset = 0; offset < bytesRead;)
             {
-                kind = directory_watcher_event_kind::removed;
+                auto* const evt = reinterpret_cast<const inotify_event*>(m_impl->buffer + offset);
+                offset += sizeof(inotify_event) + evt->len;
 
-                if (m_impl->build_full_path(fullPath, evt->wd, evt->name))
+                if (evt->mask & IN_Q_OVERFLOW)
+                {
+                    hasOverflown = true;
+                    continue;
+                }
+
+                if (evt->mask & IN_IGNORED)
                 {
                     m_impl->remove_watch_from_wd(evt->wd);
+                    continue;
                 }
-            }
-            else if (evt->mask & (IN_MODIFY | IN_CLOSE_WRITE))
-            {
-                kind = directory_watcher_event_kind::modified;
-            }
-            else if (evt->mask & IN_MOVE_SELF)
-            {
-                if (m_impl->isRecursive && evt->mask & IN_ISDIR)
+
+                if (evt->len == 0 || !m_impl->build_full_path(fullPath, evt->wd, evt->name))
                 {
-                    if (m_impl->build_full_path(fullPath, evt->wd, ""))
+                    continue;
+                }
+
+                const bool isWatchSubdir = m_impl->isRecursive && (evt->mask & IN_ISDIR) != 0;
+
+                directory_watcher_event e{
+                    .path = fullPath,
+                };
+
+                if (evt->mask & IN_CREATE)
+                {
+                    e.eventKind = directory_watcher_event_kind::added;
+
+                    if (isWatchSubdir)
                     {
-                        m_impl->remove_watch_from_wd(evt->wd);
+                        if (!m_impl->add_watch(fullPath.as<cstring_view>()))
+                        {
+                            ++m_impl->failedWatchesCount;
+                        }
                     }
                 }
-            }
-            else if (evt->mask & IN_MOVED_FROM)
-            {
-                OBLO_ASSERT(evt->cookie != 0);
-
-                if (evt->cookie != 0 && evt->len > 0) [[likely]]
+                else if (evt->mask & IN_DELETE)
+                {
+                    e.eventKind = directory_watcher_event_kind::removed;
+                }
+                else if (evt->mask & (IN_MODIFY | IN_CLOSE_WRITE))
+                {
+                    e.eventKind = directory_watcher_event_kind::modified;
+                }
+                else if (evt->mask & IN_MOVED_FROM)
                 {
+                    OBLO_ASSERT(evt->cookie != 0);
+
                     try_flush_pending_moved_from();
 
                     pendingRename.cookie = evt->cookie;
-                    pendingRename.oldName = evt->name;
+                    pendingRename.oldName = fullPath;
                     pendingRename.isDir = (evt->mask & IN_ISDIR) != 0;
-                }
 
-                sendEvent = false;
-            }
-            else if (evt->mask & IN_MOVED_TO)
-            {
-                const bool isWatchSubdir = m_impl->isRecursive && evt->mask & IN_ISDIR;
-
-                if (pendingRename.cookie == evt->cookie)
-                {
-                    kind = directory_watcher_event_kind::renamed;
+                    continue;
                 }
-                else
+                else if (evt->mask & IN_MOVED_TO)
                 {
-                    kind = directory_watcher_event_kind::added;
+                    if (pendingRename.cookie != 0 && pendingRename.cookie == evt->cookie)
+                    {
+                        e.eventKind = directory_watcher_event_kind::renamed;
+                        e.previousName = pendingRename.oldName;
+
+                        if (isWatchSubdir)
+                        {
+                            m_impl->rename_watch_subtree(pendingRename.oldName.as<string_view>(),
+                                fullPath.as<string_view>());
+                        }
+
+                        dispatch(e);
+
+                        pendingRename.cookie = 0;
+                        continue;
+                    }
+
+                    e.eventKind = directory_watcher_event_kind::added;
 
                     if (isWatchSubdir)
                     {
-                        fullPath = m_impl->path;
-                        fullPath.append_path_separator().append(evt->name);
-
-                        m_impl->add_watch(fullPath).assert_value();
+                        if (!m_impl->add_watch(fullPath.as<cstring_view>()))
+                        {
+                            ++m_impl->failedWatchesCount;
+                        }
                     }
                 }
+                else
+                {
+                    continue;
+                }
+
+                dispatch(e);
             }
-            else if (evt->mask & IN_IGNORED)
-            {
-                m_impl->remove_watch_from_wd(evt->wd);
-                sendEvent = false;
-            }
-            else
+        }
+
+        try_flush_pending_moved_from();
+
+        if (hasOverflown)
+        {
+            // Some events were dropped, new directories might not be watched either
+            if (m_impl->isRecursive)
             {
-                sendEvent = false;
+                m_impl->update_watches();
             }
 
-            if (sendEvent && evt->len > 0)
+            if (!m_impl->coalesce)
             {
-                fullPath = m_impl->path;
-                fullPath.append_path_separator().append(evt->name);
+                return "Directory watcher event queue overflow, some changes might have been lost"_err;
+            }
 
-                directory_watcher_event e{
-                    .path = fullPath,
-                    .eventKind = kind,
-                };
+            // The index is compared against the tree to report the changes we missed
+            m_impl->index.scan(false);
+        }
 
-                switch (kind)
-                {
-                case directory_watcher_event_kind::renamed: {
-                    e.previousName = pendingRename.oldName;
-                    break;
-                }
+        if (m_impl->coalesce)
+        {
+            m_impl->index.flush(now, callback);
+        }
 
-                default:
-                    break;
-                }
+        if (m_impl->failedWatchesCount > 0)
+        {
+            m_impl->failedWatchesCount = 0;
+            return "Some directories could not be watched, changes in them might be missed"_err;
+        }
 
-                if (sendEvent)
-                {
-                    callback(e);
-                }
-            }
+        return no_error;
+    }
 
-            offset += sizeof(inotify_event) + evt->len;
+    expected<> directory_watcher::save_index() const
+    {
+        if (!m_impl || !m_impl->coalesce || m_impl->indexPath.empty())
+        {
+            return "Directory watcher has no index to save"_err;
         }
 
-        try_flush_pending_moved_from();
-
-        return no_error;
+        return m_impl->index.save(m_impl->indexPath);
     }
 
     cstring_view directory_watcher::get_directory() const
@@ -1,9 +1,11 @@
 #ifdef _WIN32
 
     #include <oblo/core/array_size.hpp>
+    #include <oblo/core/filesystem/directory_index.hpp>
     #include <oblo/core/filesystem/directory_watcher.hpp>
     #include <oblo/core/filesystem/filesystem.hpp>
     #include <oblo/core/string/string_builder.hpp>
+    #include <oblo/core/time/clock.hpp>
 
     #include <filesystem>
 
@@ -98,6 +100,7 @@ namespace oblo::filesystem
         }
 
         bool isRecursive;
+        bool coalesce{};
 
         HANDLE hDirectory{INVALID_HANDLE_VALUE};
         HANDLE hEvent{INVALID_HANDLE_VALUE};
@@ -110,7 +113,11 @@ namespace oblo::filesystem
 
         bool isExpectingRenameNewName{};
 
-        alignas(void*) u8 buffer[1024];
+        string indexPath;
+        directory_index index;
+
+        // ReadDirectoryChangesW fails with buffers larger than 64KB on network drives
+        alignas(DWORD) u8 buffer[64 << 10];
     };
 
     directory_watcher::directory_watcher() = default;
@@ -119,7 +126,10 @@ namespace oblo::filesystem
 
     directory_watcher& directory_watcher::operator=(directory_watcher&&) noexcept = default;
 
-    directory_watcher::~directory_watcher() = default;
+    directory_watcher::~directory_watcher()
+    {
+        shutdown();
+    }
 
     expected<> directory_watcher::init(const directory_watcher_initializer& initializer)
     {
@@ -180,11 +190,34 @@ namespace oblo::filesystem
             return "Failed to start monitoring directory for changes"_err;
         }
 
+        if (initializer.coalesceEvents)
+        {
+            m_impl->coalesce = true;
+            m_impl->indexPath = initializer.indexPath;
+
+            m_impl->index.init(m_impl->path,
+                {
+                    .isRecursive = initializer.isRecursive,
+                    .hashContents = initializer.hashContents,
+                    .debounceTime = initializer.debounceTime,
+                });
+
+            // Without a previous index we have nothing to compare against, we just take the current state
+            const bool hasIndex = !m_impl->indexPath.empty() && m_impl->index.load(m_impl->indexPath);
+            m_impl->index.scan(!hasIndex);
+        }
+
         return no_error;
     }
 
     void directory_watcher::shutdown()
     {
+        if (m_impl && m_impl->coalesce && !m_impl->indexPath.empty())
+        {
+            // Best effort, if it fails the next run will start from a full scan
+            [[maybe_unused]] const auto saved = save_index();
+        }
+
         m_impl.reset();
     }
 
@@ -195,7 +228,16 @@ namespace oblo::filesystem
             return "Directory watcher not initialized"_err;
         }
 
+        const time now = clock::now();
+
+        // When coalescing we feed the index instead, which will report events on flush
+        const auto pushToIndex = [impl = m_impl.get(), now](const directory_watcher_event& e)
+        { impl->index.push(e, now); };
+
+        const callback_fn dispatch = m_impl->coalesce ? callback_fn{pushToIndex} : callback;
+
         modification_tracker lastModification{};
+        bool hasOverflown{};
 
         string_builder builder;
         string_builder auxBuilder;
@@ -216,6 +258,11 @@ namespace oblo::filesystem
                 {
                     return "Failed to retrieve directory change notifications"_err;
                 }
+                else if (bytes == 0)
+                {
+                    // The buffer overflowed and the notifications were dropped
+                    hasOverflown = true;
+                }
                 else
                 {
                     DWORD offset = 0;
@@ -280,7 +327,7 @@ namespace oblo::filesystem
                             bool sendEvent = true;
 
                             // Try to reduce the spam of modified events a little bit
-                            if (eventKind == directory_watcher_event_kind::modified)
+                            if (eventKind == directory_watcher_event_kind::modified && !m_impl->coalesce)
                             {
                                 m_impl->nativePathBuffer = m_impl->nativePath;
                                 m_impl->nativePathBuffer.append(std::wstring_view{fileNameBegin, fileNameEnd});
@@ -306,7 +353,7 @@ namespace oblo::filesystem
 
                             if (sendEvent)
                             {
-                                callback(evt);
+                                dispatch(evt);
                             }
                         }
 
@@ -334,9 +381,34 @@ namespace oblo::filesystem
             }
         }
 
+        if (hasOverflown)
+        {
+            if (!m_impl->coalesce)
+            {
+                return "Directory watcher event queue overflow, some changes might have been lost"_err;
+            }
+
+            m_impl->index.scan(false);
+        }
+
+        if (m_impl->coalesce)
+        {
+            m_impl->index.flush(now, callback);
+        }
+
         return no_error;
     }
 
+    expected<> directory_watcher::save_index() const
+    {
+        if (!m_impl || !m_impl->coalesce || m_impl->indexPath.empty())
+        {
+            return "Directory watcher has no index to save"_err;
+        }
+
+        return m_impl->index.save(m_impl->indexPath);
+    }
+
     cstring_view directory_watcher::get_directory() const
     {
         if (!m_impl)
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifdef __linux__
+
+    #include <oblo/core/expected.hpp>
+    #include <oblo/core/invoke/function_ref.hpp>
+    #include <oblo/core/types.hpp>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace oblo::filesystem
+{
+    /// @brief Minimal wrapper around the io_uring syscalls, to avoid depending on liburing.
+    /// @remarks Preparing and submitting have to be externally synchronized, while completions can only be waited on
+    /// by a single thread.
+    class io_uring_queue
+    {
+    public:
+        io_uring_queue() = default;
+        io_uring_queue(const io_uring_queue&) = delete;
+        io_uring_queue& operator=(const io_uring_queue&) = delete;
+        ~io_uring_queue();
+
+        /// @brief Creates the ring, it might fail when io_uring is not supported or disabled on the system.
+        expected<> init(u32 entries);
+        void shutdown();
+
+        bool prepare_read(int fd, void* dst, u32 size, u64 offset, u64 userData);
+        bool prepare_write(int fd, const void* src, u32 size, u64 offset, u64 userData);
+        bool prepare_cancel(u64 targetUserData, u64 userData);
+        bool prepare_nop(u64 userData);
+
+        /// @brief Submits all prepared entries to the kernel.
+        /// @remarks When the kernel can't accept them yet, e.g. because the completion queue is full, the entries stay
+        /// in the ring and they are submitted by the next wait_completions.
+        /// @return False if the ring is broken.
+        bool submit();
+
+        /// @brief Blocks until at least one completion is available, then invokes the callback for each of them.
+        /// @remarks The result is either the number of bytes transferred or a negated errno.
+        /// @return False if the ring is broken, in which case no callback is invoked.
+        bool wait_completions(function_ref<void(u64 userData, i32 result)> callback);
+
+    private:
+        io_uring_sqe* get_sqe();
+
+        /// @brief The number of entries published to the kernel that it didn't consume yet.
+        u32 get_unsubmitted_count() const;
+
+    private:
+        int m_fd{-1};
+
+        u32* m_sqHead{};
+        u32* m_sqTail{};
+        u32 m_sqMask{};
+        u32 m_sqEntries{};
+        u32* m_sqArray{};
+        io_uring_sqe* m_sqes{};
+        u32 m_sqPending{};
+
+        u32* m_cqHead{};
+        u32* m_cqTail{};
+        u32 m_cqMask{};
+        io_uring_cqe* m_cqes{};
+
+        void* m_sqRing{};
+        usize m_sqRingSize{};
+        void* m_cqRing{};
+        usize m_cqRingSize{};
+        usize m_sqesSize{};
+    };
+}
+
+#endif
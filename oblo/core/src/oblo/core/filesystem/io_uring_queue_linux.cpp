@@ -0,0 +1,344 @@
+#ifdef __linux__
+
+    #include <oblo/core/filesystem/io_uring_queue.hpp>
+
+    #include <algorithm>
+    #include <atomic>
+    #include <cerrno>
+    #include <cstring>
+
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+namespace oblo::filesystem
+{
+    namespace
+    {
+        int sys_io_uring_setup(u32 entries, io_uring_params* p)
+        {
+            return int(syscall(__NR_io_uring_setup, entries, p));
+        }
+
+        int sys_io_uring_enter(int fd, u32 toSubmit, u32 minComplete, u32 flags)
+        {
+            return int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+        }
+
+        u32* ring_offset(void* ring, u32 offset)
+        {
+            return reinterpret_cast<u32*>(static_cast<u8*>(ring) + offset);
+        }
+
+        u32 load_acquire(u32* ptr)
+        {
+            return std::atomic_ref<u32>{*ptr}.load(std::memory_order_acquire);
+        }
+
+        void store_release(u32* ptr, u32 value)
+        {
+            std::atomic_ref<u32>{*ptr}.store(value, std::memory_order_release);
+        }
+    }
+
+    io_uring_queue::~io_uring_queue()
+    {
+        shutdown();
+    }
+
+    expected<> io_uring_queue::init(u32 entries)
+    {
+        shutdown();
+
+        io_uring_params p{};
+
+        // Cancellations produce additional completions, we make the completion queue big enough to never overflow
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;
+
+        const int fd = sys_io_uring_setup(entries, &p);
+
+        if (fd < 0)
+        {
+            return "Failed to create io_uring"_err;
+        }
+
+        m_fd = fd;
+
+        m_sqRingSize = p.sq_off.array + p.sq_entries * sizeof(u32);
+        m_cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+        const bool singleMap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+        if (singleMap)
+        {
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+
+        constexpr int protection = PROT_READ | PROT_WRITE;
+        constexpr int mapFlags = MAP_SHARED | MAP_POPULATE;
+
+        m_sqRing = mmap(nullptr, m_sqRingSize, protection, mapFlags, fd, IORING_OFF_SQ_RING);
+
+        if (m_sqRing == MAP_FAILED)
+        {
+            m_sqRing = nullptr;
+            shutdown();
+            return "Failed to map io_uring"_err;
+        }
+
+        if (singleMap)
+        {
+            m_cqRing = m_sqRing;
+        }
+        else
+        {
+            m_cqRing = mmap(nullptr, m_cqRingSize, protection, mapFlags, fd, IORING_OFF_CQ_RING);
+
+            if (m_cqRing == MAP_FAILED)
+            {
+                m_cqRing = nullptr;
+                shutdown();
+                return "Failed to map io_uring"_err;
+            }
+        }
+
+        m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+
+        void* const sqes = mmap(nullptr, m_sqesSize, protection, mapFlags, fd, IORING_OFF_SQES);
+
+        if (sqes == MAP_FAILED)
+        {
+            shutdown();
+            return "Failed to map io_uring"_err;
+        }
+
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        m_sqHead = ring_offset(m_sqRing, p.sq_off.head);
+        m_sqTail = ring_offset(m_sqRing, p.sq_off.tail);
+        m_sqMask = *ring_offset(m_sqRing, p.sq_off.ring_mask);
+        m_sqEntries = *ring_offset(m_sqRing, p.sq_off.ring_entries);
+        m_sqArray = ring_offset(m_sqRing, p.sq_off.array);
+
+        m_cqHead = ring_offset(m_cqRing, p.cq_off.head);
+        m_cqTail = ring_offset(m_cqRing, p.cq_off.tail);
+        m_cqMask = *ring_offset(m_cqRing, p.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(static_cast<u8*>(m_cqRing) + p.cq_off.cqes);
+
+        return no_error;
+    }
+
+    void io_uring_queue::shutdown()
+    {
+        if (m_sqes)
+        {
+            munmap(m_sqes, m_sqesSize);
+        }
+
+        if (m_cqRing && m_cqRing != m_sqRing)
+        {
+            munmap(m_cqRing, m_cqRingSize);
+        }
+
+        if (m_sqRing)
+        {
+            munmap(m_sqRing, m_sqRingSize);
+        }
+
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+
+        m_fd = -1;
+
+        m_sqHead = m_sqTail = m_sqArray = nullptr;
+        m_sqMask = m_sqEntries = m_sqPending = 0;
+        m_sqes = nullptr;
+
+        m_cqHead = m_cqTail = nullptr;
+        m_cqMask = 0;
+        m_cqes = nullptr;
+
+        m_sqRing = m_cqRing = nullptr;
+        m_sqRingSize = m_cqRingSize = m_sqesSize = 0;
+    }
+
+    io_uring_sqe* io_uring_queue::get_sqe()
+    {
+        const u32 head = load_acquire(m_sqHead);
+        const u32 tail = *m_sqTail + m_sqPending;
+
+        if (tail - head >= m_sqEntries)
+        {
+            return nullptr;
+        }
+
+        const u32 index = tail & m_sqMask;
+        io_uring_sqe* const sqe = m_sqes + index;
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+        m_sqArray[index] = index;
+        ++m_sqPending;
+
+        return sqe;
+    }
+
+    bool io_uring_queue::prepare_read(int fd, void* dst, u32 size, u64 offset, u64 userData)
+    {
+        io_uring_sqe* const sqe = get_sqe();
+
+        if (!sqe)
+        {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<u64>(dst);
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = userData;
+
+        return true;
+    }
+
+    bool io_uring_queue::prepare_write(int fd, const void* src, u32 size, u64 offset, u64 userData)
+    {
+        io_uring_sqe* const sqe = get_sqe();
+
+        if (!sqe)
+        {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<u64>(src);
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = userData;
+
+        return true;
+    }
+
+    bool io_uring_queue::prepare_cancel(u64 targetUserData, u64 userData)
+    {
+        io_uring_sqe* const sqe = get_sqe();
+
+        if (!sqe)
+        {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = targetUserData;
+        sqe->user_data = userData;
+
+        return true;
+    }
+
+    bool io_uring_queue::prepare_nop(u64 userData)
+    {
+        io_uring_sqe* const sqe = get_sqe();
+
+        if (!sqe)
+        {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_NOP;
+        sqe->fd = -1;
+        sqe->user_data = userData;
+
+        return true;
+    }
+
+    u32 io_uring_queue::get_unsubmitted_count() const
+    {
+        // The kernel advances the head as it consumes the entries published by the tail
+        return load_acquire(m_sqTail) - load_acquire(m_sqHead);
+    }
+
+    bool io_uring_queue::submit()
+    {
+        if (m_sqPending == 0)
+        {
+            return true;
+        }
+
+        // Publish the entries to the kernel, the release makes sure the content of the entries is visible
+        store_release(m_sqTail, *m_sqTail + m_sqPending);
+
+        m_sqPending = 0;
+
+        while (true)
+        {
+            const u32 toSubmit = get_unsubmitted_count();
+
+            if (toSubmit == 0)
+            {
+                return true;
+            }
+
+            const int r = sys_io_uring_enter(m_fd, toSubmit, 0, 0);
+
+            if (r < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                // The completion queue is full (EBUSY), or the kernel is short on resources (EAGAIN). Retrying here
+                // can't make progress, since completions are only reaped by the thread waiting on them, which might be
+                // the one submitting. The entries stay in the ring, and wait_completions submits them.
+                if (errno == EBUSY || errno == EAGAIN)
+                {
+                    return true;
+                }
+
+                return false;
+            }
+
+            // The entries might have been submitted concurrently by wait_completions, otherwise the ring is broken
+            if (r == 0)
+            {
+                return get_unsubmitted_count() == 0;
+            }
+        }
+    }
+
+    bool io_uring_queue::wait_completions(function_ref<void(u64 userData, i32 result)> callback)
+    {
+        u32 head = *m_cqHead;
+
+        while (head == load_acquire(m_cqTail))
+        {
+            // Also submits the entries that submit couldn't, now that completions have been reaped
+            const int r = sys_io_uring_enter(m_fd, get_unsubmitted_count(), 1, IORING_ENTER_GETEVENTS);
+
+            if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                return false;
+            }
+        }
+
+        const u32 tail = load_acquire(m_cqTail);
+
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+            callback(cqe.user_data, cqe.res);
+        }
+
+        store_release(m_cqHead, head);
+
+        return true;
+    }
+}
+
+#endif
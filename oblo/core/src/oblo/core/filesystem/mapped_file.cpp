@@ -0,0 +1,50 @@
+#include <oblo/core/filesystem/mapped_file.hpp>
+
+#include <utility>
+
+namespace oblo::filesystem
+{
+    mapped_file::mapped_file(mapped_file&& other) noexcept :
+        m_data{std::exchange(other.m_data, nullptr)}, m_size{std::exchange(other.m_size, 0)},
+        m_isOpen{std::exchange(other.m_isOpen, false)}
+    {
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_isOpen = std::exchange(other.m_isOpen, false);
+        }
+
+        return *this;
+    }
+
+    mapped_file::~mapped_file()
+    {
+        close();
+    }
+
+    bool mapped_file::is_open() const
+    {
+        return m_isOpen;
+    }
+
+    std::span<const byte> mapped_file::get_bytes() const
+    {
+        return {m_data, m_size};
+    }
+
+    const byte* mapped_file::data() const
+    {
+        return m_data;
+    }
+
+    usize mapped_file::size() const
+    {
+        return m_size;
+    }
+}
@@ -0,0 +1,139 @@
+#ifdef __linux__
+
+    #include <oblo/core/filesystem/mapped_file.hpp>
+
+    #include <algorithm>
+
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+namespace oblo::filesystem
+{
+    namespace
+    {
+        usize get_page_size()
+        {
+            static const usize pageSize = usize(sysconf(_SC_PAGESIZE));
+            return pageSize;
+        }
+
+        void advise_range(const byte* data, usize size, flags<mapped_file_hint> hints)
+        {
+            if (size == 0)
+            {
+                return;
+            }
+
+            void* const ptr = const_cast<byte*>(data);
+
+            if (hints.contains(mapped_file_hint::sequential))
+            {
+                madvise(ptr, size, MADV_SEQUENTIAL);
+            }
+            else if (hints.contains(mapped_file_hint::random))
+            {
+                madvise(ptr, size, MADV_RANDOM);
+            }
+
+    #ifdef MADV_HUGEPAGE
+            if (hints.contains(mapped_file_hint::huge_pages))
+            {
+                // This is only a hint, it fails when the kernel doesn't support huge pages for file mappings
+                madvise(ptr, size, MADV_HUGEPAGE);
+            }
+    #endif
+
+            if (hints.contains(mapped_file_hint::will_need))
+            {
+                madvise(ptr, size, MADV_WILLNEED);
+            }
+        }
+    }
+
+    expected<> mapped_file::open(cstring_view path, flags<mapped_file_hint> hints)
+    {
+        close();
+
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+        {
+            return "Failed to open file"_err;
+        }
+
+        struct stat st;
+
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return "Failed to query file statistics"_err;
+        }
+
+        const usize size = usize(st.st_size);
+
+        if (size == 0)
+        {
+            ::close(fd);
+            m_isOpen = true;
+            return no_error;
+        }
+
+        // MAP_POPULATE would prefault everything synchronously, we rely on madvise instead to keep open non-blocking
+        void* const ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // The mapping keeps a reference to the file, we don't need the descriptor anymore
+        ::close(fd);
+
+        if (ptr == MAP_FAILED)
+        {
+            return "Failed to map file"_err;
+        }
+
+        m_data = static_cast<const byte*>(ptr);
+        m_size = size;
+        m_isOpen = true;
+
+        advise_range(m_data, m_size, hints);
+
+        return no_error;
+    }
+
+    void mapped_file::close()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<byte*>(m_data), m_size);
+        }
+
+        m_data = nullptr;
+        m_size = 0;
+        m_isOpen = false;
+    }
+
+    void mapped_file::advise(flags<mapped_file_hint> hints) const
+    {
+        advise_range(m_data, m_size, hints);
+    }
+
+    void mapped_file::prefetch(usize offset, usize size) const
+    {
+        if (offset >= m_size)
+        {
+            return;
+        }
+
+        // madvise requires the address to be aligned to the page size
+        const usize pageSize = get_page_size();
+        const usize alignedOffset = offset & ~(pageSize - 1);
+        const usize end = std::min(m_size, offset + size);
+
+        if (end > alignedOffset)
+        {
+            madvise(const_cast<byte*>(m_data) + alignedOffset, end - alignedOffset, MADV_WILLNEED);
+        }
+    }
+}
+
+#endif
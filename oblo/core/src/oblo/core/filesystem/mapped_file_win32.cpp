@@ -0,0 +1,144 @@
+#ifdef _WIN32
+
+    #include <oblo/core/filesystem/mapped_file.hpp>
+    #include <oblo/core/platform/platform_win32.hpp>
+
+    #include <algorithm>
+
+    #include <Windows.h>
+
+namespace oblo::filesystem
+{
+    namespace
+    {
+        void prefetch_range(const byte* data, usize size)
+        {
+            if (size == 0)
+            {
+                return;
+            }
+
+            WIN32_MEMORY_RANGE_ENTRY entry{
+                .VirtualAddress = const_cast<byte*>(data),
+                .NumberOfBytes = size,
+            };
+
+            // This is only a hint, the OS issues asynchronous reads for the range
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+        }
+    }
+
+    expected<> mapped_file::open(cstring_view path, flags<mapped_file_hint> hints)
+    {
+        close();
+
+        wchar_t wPath[win32::MaxPath];
+        win32::convert_path(path, wPath);
+
+        // Access pattern hints can only be specified when opening the file on Windows
+        DWORD fileFlags = FILE_ATTRIBUTE_NORMAL;
+
+        if (hints.contains(mapped_file_hint::sequential))
+        {
+            fileFlags |= FILE_FLAG_SEQUENTIAL_SCAN;
+        }
+        else if (hints.contains(mapped_file_hint::random))
+        {
+            fileFlags |= FILE_FLAG_RANDOM_ACCESS;
+        }
+
+        const HANDLE file = CreateFileW(wPath,
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            fileFlags,
+            nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return "Failed to open file"_err;
+        }
+
+        LARGE_INTEGER fileSize;
+
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            return "Failed to query file statistics"_err;
+        }
+
+        const usize size = usize(fileSize.QuadPart);
+
+        if (size == 0)
+        {
+            // Mapping empty files is not allowed
+            CloseHandle(file);
+            m_isOpen = true;
+            return no_error;
+        }
+
+        const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+
+        if (!mapping)
+        {
+            return "Failed to map file"_err;
+        }
+
+        void* const ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        // The view keeps a reference to the mapping object
+        CloseHandle(mapping);
+
+        if (!ptr)
+        {
+            return "Failed to map file"_err;
+        }
+
+        m_data = static_cast<const byte*>(ptr);
+        m_size = size;
+        m_isOpen = true;
+
+        if (hints.contains(mapped_file_hint::will_need))
+        {
+            prefetch_range(m_data, m_size);
+        }
+
+        return no_error;
+    }
+
+    void mapped_file::close()
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+
+        m_data = nullptr;
+        m_size = 0;
+        m_isOpen = false;
+    }
+
+    void mapped_file::advise(flags<mapped_file_hint> hints) const
+    {
+        // Huge pages are not supported for file mappings, sequential and random are only supported on open
+        if (hints.contains(mapped_file_hint::will_need))
+        {
+            prefetch_range(m_data, m_size);
+        }
+    }
+
+    void mapped_file::prefetch(usize offset, usize size) const
+    {
+        if (offset >= m_size)
+        {
+            return;
+        }
+
+        const usize end = std::min(m_size, offset + size);
+        prefetch_range(m_data + offset, end - offset);
+    }
+}
+
+#endif
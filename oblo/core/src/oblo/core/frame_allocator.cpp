@@ -12,10 +12,14 @@ namespace oblo
         // Could consider reading the actual page size through system calls
         constexpr auto PageSize{16u << 10};
 
-        void* virtual_memory_allocate(usize size);
-        void virtual_memory_free(void* ptr);
+        // The most common size for huge pages on x64 and arm64, it's also used to align transparent huge pages
+        constexpr auto HugePageSize{2u << 20};
+
+        void* virtual_memory_allocate(usize size, frame_allocator_pages& pages);
+        void virtual_memory_free(void* ptr, usize size);
         bool virtual_memory_commit(void* ptr, usize size);
         bool virtual_memory_decommit(void* ptr, usize size);
+        void virtual_memory_prefault(void* ptr, usize size);
     }
 
     frame_allocator::frame_allocator(frame_allocator&& other) noexcept
@@ -23,7 +27,16 @@ namespace oblo
         std::swap(m_virtualMemory, other.m_virtualMemory);
         std::swap(m_end, other.m_end);
         std::swap(m_commitEnd, other.m_commitEnd);
+        std::swap(m_highWaterMark, other.m_highWaterMark);
+        std::swap(m_framePeak, other.m_framePeak);
+        std::swap(m_shrinkPeak, other.m_shrinkPeak);
+        std::swap(m_reservedSize, other.m_reservedSize);
         std::swap(m_chunkSize, other.m_chunkSize);
+        std::swap(m_minCommittedSize, other.m_minCommittedSize);
+        std::swap(m_shrinkFrames, other.m_shrinkFrames);
+        std::swap(m_shrinkFramesCount, other.m_shrinkFramesCount);
+        std::swap(m_pages, other.m_pages);
+        std::swap(m_prefault, other.m_prefault);
     }
 
     frame_allocator::~frame_allocator()
@@ -32,29 +45,66 @@ namespace oblo
     }
 
     bool frame_allocator::init(usize maxSize, usize chunkSize, usize startingChunks)
+    {
+        return init({
+            .maxSize = maxSize,
+            .chunkSize = chunkSize,
+            .startingChunks = startingChunks,
+        });
+    }
+
+    bool frame_allocator::init(const frame_allocator_initializer& initializer)
     {
         if (m_virtualMemory)
         {
             return false;
         }
 
-        if (chunkSize % PageSize != 0)
+        const auto chunkSize = initializer.chunkSize;
+        const auto startingChunks = initializer.startingChunks;
+
+        if (chunkSize == 0 || chunkSize % PageSize != 0)
         {
             return false;
         }
 
-        if (maxSize < chunkSize * startingChunks)
+        if (initializer.maxSize < chunkSize * startingChunks)
         {
             return false;
         }
 
-        m_virtualMemory = static_cast<u8*>(virtual_memory_allocate(maxSize));
+        auto pages = initializer.pages;
+
+        if (pages == frame_allocator_pages::huge && chunkSize % HugePageSize != 0)
+        {
+            // Huge page mappings can only be committed in multiples of the huge page size
+            pages = frame_allocator_pages::transparent_huge;
+        }
+
+        const auto maxSize = pages == frame_allocator_pages::regular
+            ? initializer.maxSize
+            : round_up_multiple(initializer.maxSize, usize{HugePageSize});
+
+        m_virtualMemory = static_cast<u8*>(virtual_memory_allocate(maxSize, pages));
         m_end = m_virtualMemory;
+        m_highWaterMark = m_virtualMemory;
+        m_framePeak = m_virtualMemory;
+        m_shrinkPeak = m_virtualMemory;
+        m_reservedSize = m_virtualMemory ? maxSize : 0;
+        m_pages = pages;
+        m_prefault = initializer.prefault;
+        m_shrinkFrames = initializer.shrinkFrames;
+        m_shrinkFramesCount = 0;
 
         if (const auto initialCommit = chunkSize * startingChunks;
             m_virtualMemory && startingChunks > 0 && virtual_memory_commit(m_virtualMemory, initialCommit))
         {
             m_commitEnd = m_virtualMemory + initialCommit;
+
+            if (m_prefault)
+            {
+                virtual_memory_prefault(m_virtualMemory, initialCommit);
+            }
         }
         else
         {
@@ -62,6 +112,7 @@ namespace oblo
         }
 
         m_chunkSize = chunkSize;
+        m_minCommittedSize = get_committed_memory_size();
 
         return m_virtualMemory != nullptr;
     }
@@ -70,8 +121,15 @@ namespace oblo
     {
         if (m_virtualMemory)
         {
-            virtual_memory_free(m_virtualMemory);
+            virtual_memory_free(m_virtualMemory, m_reservedSize);
             m_virtualMemory = nullptr;
+            m_end = nullptr;
+            m_commitEnd = nullptr;
+            m_highWaterMark = nullptr;
+            m_framePeak = nullptr;
+            m_shrinkPeak = nullptr;
+            m_reservedSize = 0;
+            m_minCommittedSize = 0;
         }
     }
 
@@ -101,6 +159,11 @@ namespace oblo
 
             if (virtual_memory_commit(m_commitEnd, bytesToCommit))
             {
+                if (m_prefault)
+                {
+                    virtual_memory_prefault(m_commitEnd, bytesToCommit);
+                }
+
                 m_commitEnd += bytesToCommit;
             }
             else
@@ -110,17 +173,30 @@ namespace oblo
         }
 
         m_end = newEnd;
+        m_highWaterMark = max(m_highWaterMark, m_end);
+        m_framePeak = max(m_framePeak, m_end);
+
         return reinterpret_cast<byte*>(ptr);
     }
 
     void frame_allocator::free_unused()
+    {
+        decommit_above(usize(m_end - m_virtualMemory));
+    }
+
+    void frame_allocator::decommit_above(usize size)
     {
         const auto prevCommittedSize = get_committed_memory_size();
-        OBLO_ASSERT(prevCommittedSize % prevCommittedSize == 0);
+        OBLO_ASSERT(m_chunkSize == 0 || prevCommittedSize % m_chunkSize == 0);
+
+        if (prevCommittedSize == 0)
+        {
+            return;
+        }
+
         const auto prevChunksCount = prevCommittedSize / m_chunkSize;
 
-        const auto newBytesSize = usize(m_end - m_virtualMemory);
-        const auto newChunksCount = round_up_div(newBytesSize, m_chunkSize);
+        const auto newChunksCount = round_up_div(size, m_chunkSize);
         OBLO_ASSERT(newChunksCount <= prevChunksCount);
 
         if (newChunksCount < prevChunksCount)
@@ -145,11 +221,44 @@ namespace oblo
         m_end = m_virtualMemory;
     }
 
+    void frame_allocator::end_frame()
+    {
+        m_shrinkPeak = max(m_shrinkPeak, m_framePeak);
+        m_framePeak = m_end;
+
+        if (m_shrinkFrames == 0 || ++m_shrinkFramesCount < m_shrinkFrames)
+        {
+            return;
+        }
+
+        // Keep what was needed by the worst frame in the window, as well as anything that is still in use
+        const auto peak = max(m_shrinkPeak, m_end);
+        decommit_above(max(usize(peak - m_virtualMemory), m_minCommittedSize));
+
+        m_shrinkPeak = m_end;
+        m_shrinkFramesCount = 0;
+    }
+
     usize frame_allocator::get_committed_memory_size() const
     {
         return usize(m_commitEnd - m_virtualMemory);
     }
 
+    usize frame_allocator::get_allocated_memory_size() const
+    {
+        return usize(m_end - m_virtualMemory);
+    }
+
+    usize frame_allocator::get_high_water_mark() const
+    {
+        return usize(m_highWaterMark - m_virtualMemory);
+    }
+
+    void frame_allocator::reset_high_water_mark()
+    {
+        m_highWaterMark = m_end;
+    }
+
     void* frame_allocator::get_first_unallocated_byte() const
     {
         return m_end;
@@ -159,6 +268,11 @@ namespace oblo
     {
         return ptr >= m_virtualMemory && ptr < m_commitEnd;
     }
+
+    frame_allocator_pages frame_allocator::get_pages() const
+    {
+        return m_pages;
+    }
 }
 
 #ifdef _WIN32
@@ -169,12 +283,15 @@ namespace oblo
 {
     namespace
     {
-        void* virtual_memory_allocate(usize size)
+        void* virtual_memory_allocate(usize size, frame_allocator_pages& pages)
         {
+            // Large pages on Windows have to be committed on reservation and require SeLockMemoryPrivilege, which
+            // doesn't fit the incremental commit, so we stick to regular pages
+            pages = frame_allocator_pages::regular;
             return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
         }
 
-        void virtual_memory_free(void* ptr)
+        void virtual_memory_free(void* ptr, usize)
         {
             [[maybe_unused]] const auto success = VirtualFree(ptr, 0, MEM_RELEASE);
             OBLO_ASSERT(success);
@@ -189,12 +306,24 @@ namespace oblo
         {
             return VirtualFree(ptr, size, MEM_DECOMMIT) != FALSE;
         }
+
+        void virtual_memory_prefault(void* ptr, usize size)
+        {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+
+            auto* const begin = static_cast<volatile u8*>(ptr);
+
+            for (usize offset = 0; offset < size; offset += info.dwPageSize)
+            {
+                begin[offset] = 0;
+            }
+        }
     }
 }
 
 #elif defined(__linux__)
 
-    #include <cassert>
     #include <sys/mman.h>
     #include <unistd.h>
 
@@ -202,15 +331,75 @@ namespace oblo
 {
     namespace
     {
-        void* virtual_memory_allocate(usize size)
+        void* virtual_memory_reserve_aligned(usize size, usize alignment)
         {
+            const usize paddedSize = size + alignment;
+
+            void* const ptr = mmap(nullptr, paddedSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (ptr == MAP_FAILED)
+            {
+                return nullptr;
+            }
+
+            // Trim the excess on both sides, to be left with an aligned range
+            auto* const begin = static_cast<u8*>(ptr);
+            auto* const alignedBegin = begin + (alignment - std::bit_cast<uintptr>(begin) % alignment) % alignment;
+            auto* const end = begin + paddedSize;
+            auto* const alignedEnd = alignedBegin + size;
+
+            if (alignedBegin != begin)
+            {
+                munmap(begin, usize(alignedBegin - begin));
+            }
+
+            if (alignedEnd != end)
+            {
+                munmap(alignedEnd, usize(end - alignedEnd));
+            }
+
+            return alignedBegin;
+        }
+
+        void* virtual_memory_allocate(usize size, frame_allocator_pages& pages)
+        {
+            if (pages == frame_allocator_pages::huge)
+            {
+                // Without MAP_NORESERVE the pages are reserved from the pool upfront, so we fail here rather than
+                // with a SIGBUS on first touch when the pool runs out
+                void* const ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+                if (ptr != MAP_FAILED)
+                {
+                    return ptr;
+                }
+
+                pages = frame_allocator_pages::transparent_huge;
+            }
+
+            if (pages == frame_allocator_pages::transparent_huge)
+            {
+                if (void* const ptr = virtual_memory_reserve_aligned(size, HugePageSize))
+                {
+                    if (madvise(ptr, size, MADV_HUGEPAGE) != 0)
+                    {
+                        // Transparent huge pages are not available, the range is still usable with regular pages
+                        pages = frame_allocator_pages::regular;
+                    }
+
+                    return ptr;
+                }
+
+                pages = frame_allocator_pages::regular;
+            }
+
             void* const ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
             return ptr == MAP_FAILED ? nullptr : ptr;
         }
 
-        void virtual_memory_free(void* ptr)
+        void virtual_memory_free(void* ptr, usize size)
         {
-            const int success = munmap(ptr, 0);
+            [[maybe_unused]] const int success = munmap(ptr, size);
             OBLO_ASSERT(success == 0);
         }
 
@@ -222,9 +411,31 @@ namespace oblo
 
         bool virtual_memory_decommit(void* ptr, usize size)
         {
+            // Changing the protection alone would keep the physical pages around, so we release them first
+            madvise(ptr, size, MADV_DONTNEED);
+
             const int success = mprotect(ptr, size, PROT_NONE);
             return success == 0;
         }
+
+        void virtual_memory_prefault(void* ptr, usize size)
+        {
+    #ifdef MADV_POPULATE_WRITE
+            if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0)
+            {
+                return;
+            }
+    #endif
+
+            // Fallback for kernels older than 5.14
+            const auto pageSize = usize(sysconf(_SC_PAGESIZE));
+            auto* const begin = static_cast<volatile u8*>(ptr);
+
+            for (usize offset = 0; offset < size; offset += pageSize)
+            {
+                begin[offset] = 0;
+            }
+        }
     }
 }
 
@@ -0,0 +1,112 @@
+#include <oblo/core/frame_arena_ring.hpp>
+
+#include <oblo/core/debug.hpp>
+#include <oblo/core/utility.hpp>
+
+namespace oblo
+{
+    frame_arena_ring::frame_arena_ring() = default;
+
+    frame_arena_ring::frame_arena_ring(frame_arena_ring&&) noexcept = default;
+
+    frame_arena_ring& frame_arena_ring::operator=(frame_arena_ring&&) noexcept = default;
+
+    frame_arena_ring::~frame_arena_ring()
+    {
+        shutdown();
+    }
+
+    bool frame_arena_ring::init(u32 buffersCount, usize maxSize, usize chunkSize)
+    {
+        return init(buffersCount, {.maxSize = maxSize, .chunkSize = chunkSize});
+    }
+
+    bool frame_arena_ring::init(u32 buffersCount, const frame_allocator_initializer& initializer)
+    {
+        if (!m_arenas.empty() || buffersCount == 0)
+        {
+            return false;
+        }
+
+        m_arenas = dynamic_array<frame_allocator>{get_global_allocator(), buffersCount};
+        m_arenaFrames.assign(buffersCount, NoFrame);
+
+        for (auto& arena : m_arenas)
+        {
+            if (!arena.init(initializer))
+            {
+                shutdown();
+                return false;
+            }
+        }
+
+        m_retiredFramesEnd = 0;
+        m_current = 0;
+
+        return true;
+    }
+
+    void frame_arena_ring::shutdown()
+    {
+        m_arenas.clear();
+        m_arenaFrames.clear();
+    }
+
+    bool frame_arena_ring::begin_frame(u64 frameIndex)
+    {
+        if (!can_begin_frame(frameIndex))
+        {
+            return false;
+        }
+
+        const auto index = u32(frameIndex % m_arenas.size());
+        OBLO_ASSERT(m_arenaFrames[index] == NoFrame || m_arenaFrames[index] < frameIndex);
+
+        m_arenas[index].restore_all();
+        m_arenas[index].end_frame();
+        m_arenaFrames[index] = frameIndex;
+        m_current = index;
+
+        return true;
+    }
+
+    void frame_arena_ring::retire_frames(u64 lastRetiredFrame)
+    {
+        m_retiredFramesEnd = max(m_retiredFramesEnd, lastRetiredFrame + 1);
+    }
+
+    bool frame_arena_ring::can_begin_frame(u64 frameIndex) const
+    {
+        OBLO_ASSERT(!m_arenas.empty());
+
+        const auto lastFrame = m_arenaFrames[frameIndex % m_arenas.size()];
+        return lastFrame == NoFrame || lastFrame < m_retiredFramesEnd;
+    }
+
+    frame_allocator& frame_arena_ring::get_current()
+    {
+        return m_arenas[m_current];
+    }
+
+    const frame_allocator& frame_arena_ring::get_current() const
+    {
+        return m_arenas[m_current];
+    }
+
+    u32 frame_arena_ring::get_buffers_count() const
+    {
+        return m_arenas.size32();
+    }
+
+    usize frame_arena_ring::get_high_water_mark() const
+    {
+        usize highWaterMark{0};
+
+        for (const auto& arena : m_arenas)
+        {
+            highWaterMark = max(highWaterMark, arena.get_high_water_mark());
+        }
+
+        return highWaterMark;
+    }
+}
@@ -1,9 +1,25 @@
 #include <oblo/core/hash.hpp>
 
+#define XXH_STATIC_LINKING_ONLY
 #include <xxhash.h>
 
+#include <new>
+
 namespace oblo
 {
+    namespace
+    {
+        XXH3_state_t* get_state(byte* state)
+        {
+            return std::launder(reinterpret_cast<XXH3_state_t*>(state));
+        }
+
+        const XXH3_state_t* get_state(const byte* state)
+        {
+            return std::launder(reinterpret_cast<const XXH3_state_t*>(state));
+        }
+    }
+
     u32 hash_xxh32(const void* p, u64 size, u32 seed)
     {
         return XXH32(p, size, seed);
@@ -25,4 +41,50 @@ namespace oblo
             return usize{XXH32(p, size, u32(seed))};
         }
     }
-}
\ No newline at end of file
+
+    u64 hash_xxh3(const void* p, u64 size, u64 seed)
+    {
+        return XXH3_64bits_withSeed(p, size, seed);
+    }
+
+    hasher::hasher() noexcept : hasher{0} {}
+
+    hasher::hasher(u64 seed) noexcept
+    {
+        static_assert(sizeof(XXH3_state_t) == StateSize && alignof(XXH3_state_t) <= alignof(hasher));
+
+        new (m_state) XXH3_state_t;
+        XXH3_INITSTATE(get_state(m_state));
+        reset(seed);
+    }
+
+    hasher::hasher(const hasher& other) noexcept
+    {
+        new (m_state) XXH3_state_t;
+        XXH3_copyState(get_state(m_state), get_state(other.m_state));
+    }
+
+    hasher& hasher::operator=(const hasher& other) noexcept
+    {
+        XXH3_copyState(get_state(m_state), get_state(other.m_state));
+        return *this;
+    }
+
+    hasher::~hasher() = default;
+
+    void hasher::reset(u64 seed) noexcept
+    {
+        XXH3_64bits_reset_withSeed(get_state(m_state), seed);
+    }
+
+    hasher& hasher::update(const void* p, u64 size) noexcept
+    {
+        XXH3_64bits_update(get_state(m_state), p, size);
+        return *this;
+    }
+
+    u64 hasher::digest() const noexcept
+    {
+        return XXH3_64bits_digest(get_state(m_state));
+    }
+}
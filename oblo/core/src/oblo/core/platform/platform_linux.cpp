@@ -13,6 +13,7 @@
 
     #include <cerrno>
     #include <fcntl.h>
+    #include <sys/stat.h>
     #include <sys/types.h>
     #include <sys/wait.h>
     #include <unistd.h>
@@ -327,7 +328,7 @@ namespace oblo::platform
         return no_error;
     }
 
-    file::file() noexcept = default;
+    file::file() noexcept : m_handle{-1} {}
 
     file::file(file&& other) noexcept : m_handle(other.m_handle)
     {
@@ -379,6 +380,62 @@ namespace oblo::platform
         return static_cast<u32>(result);
     }
 
+    expected<> file::open(cstring_view path, open_mode mode)
+    {
+        close();
+
+        const int flags = mode == open_mode::read ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
+        m_handle = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+
+        if (m_handle < 0)
+        {
+            return "Failed to open file"_err;
+        }
+
+        return no_error;
+    }
+
+    expected<u32, file::error> file::read_at(void* dst, u32 size, u64 offset) const noexcept
+    {
+        const ssize_t result = ::pread(m_handle, dst, size, off_t(offset));
+
+        if (result < 0)
+        {
+            return translate_file_error();
+        }
+
+        if (result == 0)
+        {
+            return file::error::eof;
+        }
+
+        return static_cast<u32>(result);
+    }
+
+    expected<u32, file::error> file::write_at(const void* src, u32 size, u64 offset) const noexcept
+    {
+        const ssize_t result = ::pwrite(m_handle, src, size, off_t(offset));
+
+        if (result < 0)
+        {
+            return translate_file_error();
+        }
+
+        return static_cast<u32>(result);
+    }
+
+    expected<u64> file::get_size() const noexcept
+    {
+        struct stat st;
+
+        if (fstat(m_handle, &st) != 0)
+        {
+            return "Failed to query file statistics"_err;
+        }
+
+        return u64(st.st_size);
+    }
+
     bool file::is_open() const noexcept
     {
         return m_handle >= 0;
@@ -373,6 +373,82 @@ namespace oblo::platform
         return actuallyRead;
     }
 
+    expected<> file::open(cstring_view path, open_mode mode)
+    {
+        close();
+
+        wchar_t wPath[win32::MaxPath];
+        win32::convert_path(path, wPath);
+
+        const HANDLE h = mode == open_mode::read
+            ? CreateFileW(wPath,
+                  GENERIC_READ,
+                  FILE_SHARE_READ | FILE_SHARE_DELETE,
+                  nullptr,
+                  OPEN_EXISTING,
+                  FILE_ATTRIBUTE_NORMAL,
+                  nullptr)
+            : CreateFileW(wPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (h == INVALID_HANDLE_VALUE)
+        {
+            return "Failed to open file"_err;
+        }
+
+        m_handle = h;
+        return no_error;
+    }
+
+    expected<u32, file::error> file::read_at(void* dst, u32 size, u64 offset) const noexcept
+    {
+        // On synchronous handles the offset in the OVERLAPPED is used as file position
+        OVERLAPPED overlapped{};
+        overlapped.Offset = DWORD(offset);
+        overlapped.OffsetHigh = DWORD(offset >> 32);
+
+        DWORD actuallyRead{};
+
+        if (!ReadFile(m_handle, dst, size, &actuallyRead, &overlapped))
+        {
+            return translate_file_error();
+        }
+
+        if (actuallyRead == 0)
+        {
+            return file::error::eof;
+        }
+
+        return actuallyRead;
+    }
+
+    expected<u32, file::error> file::write_at(const void* src, u32 size, u64 offset) const noexcept
+    {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = DWORD(offset);
+        overlapped.OffsetHigh = DWORD(offset >> 32);
+
+        DWORD actuallyWritten{};
+
+        if (!WriteFile(m_handle, src, size, &actuallyWritten, &overlapped))
+        {
+            return translate_file_error();
+        }
+
+        return actuallyWritten;
+    }
+
+    expected<u64> file::get_size() const noexcept
+    {
+        LARGE_INTEGER size;
+
+        if (!GetFileSizeEx(m_handle, &size))
+        {
+            return "Failed to query file statistics"_err;
+        }
+
+        return u64(size.QuadPart);
+    }
+
     bool file::is_open() const noexcept
     {
         return m_handle != nullptr;
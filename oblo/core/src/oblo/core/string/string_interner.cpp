@@ -1,5 +1,6 @@
 #include <oblo/core/string/string_interner.hpp>
 
+#include <oblo/core/allocation_tracking.hpp>
 #include <oblo/core/debug.hpp>
 #include <oblo/core/dynamic_array.hpp>
 #include <oblo/core/hash.hpp>
@@ -9,6 +10,11 @@
 #include <oblo/core/string/transparent_string_hash.hpp>
 #include <oblo/core/unordered_map.hpp>
 
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <shared_mutex>
+
 namespace oblo
 {
     namespace
@@ -20,19 +26,246 @@ namespace oblo
             string_chunk* next;
         };
 
+        struct large_string_block
+        {
+            large_string_block* next;
+            usize size;
+        };
+
         struct string_storage
         {
             cstring_view view;
             hash_type hash;
         };
+
+        // Shard count has to be a power of two, we use the top bits of the hash to select it
+        constexpr u32 ShardsCountLog2{4};
+        constexpr u32 ShardsCount{1u << ShardsCountLog2};
+
+        // Strings are stored in pages of increasing size, the first one holds 2^FirstPageLog2 entries, every other page
+        // is twice as big as the previous one, which means pages never need to move and lookups are wait-free.
+        constexpr u32 FirstPageLog2{8};
+        constexpr u32 MaxPages{32 - FirstPageLog2};
+
+        struct page_location
+        {
+            u32 page;
+            u32 offset;
+        };
+
+        constexpr page_location get_page_location(u32 index)
+        {
+            const u64 biased = u64{index} + (1u << FirstPageLog2);
+            const u32 log2 = u32(std::bit_width(biased) - 1);
+
+            return {
+                .page = log2 - FirstPageLog2,
+                .offset = u32(biased - (u64{1} << log2)),
+            };
+        }
+
+        constexpr u32 get_page_size(u32 page)
+        {
+            return 1u << (page + FirstPageLog2);
+        }
+
+        static_assert(get_page_location(0).page == 0 && get_page_location(0).offset == 0);
+        static_assert(get_page_location(255).page == 0 && get_page_location(255).offset == 255);
+        static_assert(get_page_location(256).page == 1 && get_page_location(256).offset == 0);
+        static_assert(get_page_location(767).page == 1 && get_page_location(767).offset == 511);
+        static_assert(get_page_location(768).page == 2 && get_page_location(768).offset == 0);
+
+        u32 get_shard_index(hash_type hash)
+        {
+            return u32(hash >> (sizeof(hash_type) * 8 - ShardsCountLog2));
+        }
+
+        struct alignas(64) shard
+        {
+            mutable std::shared_mutex mutex;
+            std::unordered_map<hashed_string_view, u32, transparent_string_hash> sparse;
+            string_chunk* chunks{};
+            large_string_block* largeStrings{};
+            u16 firstFree{string_chunk::Size};
+        };
     }
 
     struct string_interner::impl
     {
-        std::unordered_map<hashed_string_view, u32, transparent_string_hash> sparse;
-        dynamic_array<string_storage> strings;
-        string_chunk* chunks;
-        u16 firstFree{string_chunk::Size};
+        allocator* allocator;
+        shard shards[ShardsCount];
+        std::atomic<string_storage*> pages[MaxPages];
+        std::atomic<u32> nextIndex;
+
+        string_storage& get_storage(u32 index) const
+        {
+            const auto [page, offset] = get_page_location(index);
+            string_storage* const storage = pages[page].load(std::memory_order_acquire);
+            OBLO_ASSERT(storage);
+            return storage[offset];
+        }
+
+        string_storage& acquire_storage(u32 index)
+        {
+            const auto [page, offset] = get_page_location(index);
+            string_storage* storage = pages[page].load(std::memory_order_acquire);
+
+            if (!storage)
+            {
+                const usize pageBytes = sizeof(string_storage) * get_page_size(page);
+
+                auto* const newStorage =
+                    reinterpret_cast<string_storage*>(allocator->allocate(pageBytes, alignof(string_storage)));
+
+                if (pages[page].compare_exchange_strong(storage,
+                        newStorage,
+                        std::memory_order_acq_rel,
+                        std::memory_order_acquire))
+                {
+                    storage = newStorage;
+                }
+                else
+                {
+                    // Some other thread allocated the page in the meanwhile, storage now holds its value
+                    allocator->deallocate(reinterpret_cast<byte*>(newStorage), pageBytes, alignof(string_storage));
+                }
+            }
+
+            return storage[offset];
+        }
+
+        char* allocate_string(shard& s, usize storageLength)
+        {
+            if (storageLength > MaxStringLength + 1)
+            {
+                auto* const block = new (allocator->allocate(sizeof(large_string_block) + storageLength,
+                    alignof(large_string_block))) large_string_block{
+                    .next = s.largeStrings,
+                    .size = storageLength,
+                };
+
+                s.largeStrings = block;
+
+                return reinterpret_cast<char*>(block + 1);
+            }
+
+            const auto oldFirstFree = s.firstFree;
+            const auto newFirstFree = oldFirstFree + storageLength;
+
+            if (newFirstFree > string_chunk::Size)
+            {
+                auto* const newChunk =
+                    new (allocator->allocate(sizeof(string_chunk), alignof(string_chunk))) string_chunk;
+
+                newChunk->next = s.chunks;
+                s.chunks = newChunk;
+                s.firstFree = u16(storageLength);
+
+                return newChunk->buf;
+            }
+
+            s.firstFree = u16(newFirstFree);
+            return s.chunks->buf + oldFirstFree;
+        }
+
+        // Expects the shard to be locked exclusively
+        u32 add_locked(shard& s, hashed_string_view str)
+        {
+            const auto it = s.sparse.find(str);
+
+            if (it != s.sparse.end())
+            {
+                return it->second;
+            }
+
+            const auto stringLength = str.size();
+            char* const newStringPtr = allocate_string(s, stringLength + 1);
+
+            std::memcpy(newStringPtr, str.data(), stringLength);
+            newStringPtr[stringLength] = '\0';
+
+            const hashed_string_view sv{string_view{newStringPtr, stringLength}, str.hash()};
+
+            const u32 stringIndex = nextIndex.fetch_add(1, std::memory_order_relaxed);
+            new (&acquire_storage(stringIndex)) string_storage{cstring_view{newStringPtr, stringLength}, sv.hash()};
+
+            s.sparse.emplace(sv, stringIndex);
+
+            return stringIndex;
+        }
+
+        u32 get_or_add(hashed_string_view str)
+        {
+            auto& s = shards[get_shard_index(str.hash())];
+
+            {
+                const std::shared_lock lock{s.mutex};
+                const auto it = s.sparse.find(str);
+
+                if (it != s.sparse.end())
+                {
+                    return it->second;
+                }
+            }
+
+            const std::unique_lock lock{s.mutex};
+            return add_locked(s, str);
+        }
+
+        template <typename T>
+        void get_or_add(std::span<const T> strings, std::span<h32<string>> outHandles)
+        {
+            OBLO_ASSERT(outHandles.size() >= strings.size());
+
+            dynamic_array<hashed_string_view> hashed;
+            hashed.reserve(strings.size());
+
+            // Counting sort by shard, so that we can lock each shard only once
+            u32 offsets[ShardsCount + 1]{};
+
+            for (const auto& str : strings)
+            {
+                const auto& h = hashed.emplace_back(str);
+                ++offsets[get_shard_index(h.hash()) + 1];
+            }
+
+            for (u32 i = 1; i <= ShardsCount; ++i)
+            {
+                offsets[i] += offsets[i - 1];
+            }
+
+            dynamic_array<u32> sorted;
+            sorted.resize_default(strings.size());
+
+            for (u32 i = 0; i < hashed.size32(); ++i)
+            {
+                sorted[offsets[get_shard_index(hashed[i].hash())]++] = i;
+            }
+
+            // Offsets were shifted by the previous loop, now offsets[i] is the end of shard i
+            u32 begin = 0;
+
+            for (u32 shardIndex = 0; shardIndex < ShardsCount; ++shardIndex)
+            {
+                const u32 end = offsets[shardIndex];
+
+                if (begin == end)
+                {
+                    continue;
+                }
+
+                auto& s = shards[shardIndex];
+                const std::unique_lock lock{s.mutex};
+
+                for (u32 i = begin; i < end; ++i)
+                {
+                    const u32 stringIndex = sorted[i];
+                    outHandles[stringIndex] = h32<string>{add_locked(s, hashed[stringIndex])};
+                }
+
+                begin = end;
+            }
+        }
     };
 
     string_interner::string_interner(string_interner&& other) noexcept
@@ -54,29 +287,59 @@ namespace oblo
         return *this;
     }
 
-    void string_interner::init(u32 estimatedStringsCount)
+    void string_interner::init(u32 estimatedStringsCount, allocator* allocator)
     {
         shutdown();
 
         OBLO_ASSERT(!m_impl);
         m_impl = new impl{};
-        m_impl->sparse.reserve(estimatedStringsCount);
-        m_impl->strings.reserve(estimatedStringsCount);
-        m_impl->chunks = nullptr;
+        m_impl->allocator = allocator ? allocator : get_global_allocator(allocation_tag::strings);
+
+        const u32 estimatedPerShard = estimatedStringsCount / ShardsCount;
+
+        for (auto& s : m_impl->shards)
+        {
+            s.sparse.reserve(estimatedPerShard);
+        }
 
         // This deals with handle 0 being invalid (it will return an empty string)
-        m_impl->strings.emplace_back();
+        new (&m_impl->acquire_storage(0)) string_storage{};
+        m_impl->nextIndex.store(1, std::memory_order_relaxed);
     }
 
     void string_interner::shutdown()
     {
         if (m_impl)
         {
-            for (auto* chunk = m_impl->chunks; chunk != nullptr;)
+            auto* const allocator = m_impl->allocator;
+
+            for (auto& s : m_impl->shards)
+            {
+                for (auto* chunk = s.chunks; chunk != nullptr;)
+                {
+                    auto* next = chunk->next;
+                    allocator->deallocate(reinterpret_cast<byte*>(chunk), sizeof(string_chunk), alignof(string_chunk));
+                    chunk = next;
+                }
+
+                for (auto* block = s.largeStrings; block != nullptr;)
+                {
+                    auto* next = block->next;
+                    allocator->deallocate(reinterpret_cast<byte*>(block),
+                        sizeof(large_string_block) + block->size,
+                        alignof(large_string_block));
+                    block = next;
+                }
+            }
+
+            for (u32 page = 0; page < MaxPages; ++page)
             {
-                auto* next = chunk->next;
-                delete chunk;
-                chunk = next;
+                if (auto* const storage = m_impl->pages[page].load(std::memory_order_relaxed))
+                {
+                    allocator->deallocate(reinterpret_cast<byte*>(storage),
+                        sizeof(string_storage) * get_page_size(page),
+                        alignof(string_storage));
+                }
             }
 
             delete m_impl;
@@ -91,50 +354,17 @@ namespace oblo
 
     h32<string> string_interner::get_or_add(hashed_string_view str)
     {
-        OBLO_ASSERT(str.size() <= MaxStringLength);
-        auto& sparse = m_impl->sparse;
-        const auto it = sparse.find(str);
-
-        if (it == sparse.end())
-        {
-            const auto stringIndex = m_impl->strings.size32();
-
-            const auto stringLength = str.size();
-            const auto storageLength = stringLength + 1;
-
-            char* newStringPtr;
-
-            const auto oldFirstFree = m_impl->firstFree;
-            const auto newFirstFree = oldFirstFree + storageLength;
-
-            if (newFirstFree > string_chunk::Size)
-            {
-                auto* const newChunk = new string_chunk;
-                newChunk->next = m_impl->chunks;
-                m_impl->chunks = newChunk;
-                m_impl->firstFree = u16(storageLength);
-                newStringPtr = m_impl->chunks->buf;
-            }
-            else
-            {
-                newStringPtr = m_impl->chunks->buf + oldFirstFree;
-                m_impl->firstFree = u16(newFirstFree);
-            }
-
-            std::memcpy(newStringPtr, str.data(), stringLength);
-            newStringPtr[stringLength] = '\0';
-
-            const hashed_string_view sv{newStringPtr, stringLength};
+        return {m_impl->get_or_add(str)};
+    }
 
-            m_impl->strings.emplace_back(cstring_view{newStringPtr, stringLength}, sv.hash());
-            m_impl->sparse.emplace(sv, stringIndex);
+    void string_interner::get_or_add(std::span<const string_view> strings, std::span<h32<string>> outHandles)
+    {
+        m_impl->get_or_add(strings, outHandles);
+    }
 
-            return {stringIndex};
-        }
-        else
-        {
-            return {it->second};
-        }
+    void string_interner::get_or_add(std::span<const hashed_string_view> strings, std::span<h32<string>> outHandles)
+    {
+        m_impl->get_or_add(strings, outHandles);
     }
 
     h32<string> string_interner::get(string_view str) const
@@ -144,27 +374,35 @@ namespace oblo
 
     h32<string> string_interner::get(hashed_string_view str) const
     {
-        auto& sparse = m_impl->sparse;
-        const auto it = sparse.find(str);
-        return {it == sparse.end() ? 0u : it->second};
+        const auto& s = m_impl->shards[get_shard_index(str.hash())];
+
+        const std::shared_lock lock{s.mutex};
+        const auto it = s.sparse.find(str);
+        return {it == s.sparse.end() ? 0u : it->second};
     }
 
     cstring_view string_interner::str(h32<string> handle) const
     {
-        OBLO_ASSERT(handle && handle.value < m_impl->strings.size());
-        return m_impl->strings[handle.value].view;
+        OBLO_ASSERT(handle && handle.value <= size());
+        return m_impl->get_storage(handle.value).view;
     }
 
     hashed_string_view string_interner::h_str(h32<string> handle) const
     {
-        OBLO_ASSERT(handle && handle.value < m_impl->strings.size());
-        const auto& str = m_impl->strings[handle.value];
+        OBLO_ASSERT(handle && handle.value <= size());
+        const auto& str = m_impl->get_storage(handle.value);
         return hashed_string_view{str.view, str.hash};
     }
 
     const char* string_interner::c_str(h32<string> handle) const
     {
-        OBLO_ASSERT(handle && handle.value < m_impl->strings.size());
-        return m_impl->strings[handle.value].view.c_str();
+        OBLO_ASSERT(handle && handle.value <= size());
+        return m_impl->get_storage(handle.value).view.c_str();
+    }
+
+    u32 string_interner::size() const
+    {
+        // Handle 0 is reserved for the invalid handle, it's not an interned string
+        return m_impl->nextIndex.load(std::memory_order_relaxed) - 1;
     }
-}
\ No newline at end of file
+}
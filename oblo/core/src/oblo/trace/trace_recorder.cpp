@@ -0,0 +1,535 @@
+#include <oblo/trace/trace_recorder.hpp>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/filesystem/file.hpp>
+#include <oblo/core/platform/compiler.hpp>
+#include <oblo/core/string/string_builder.hpp>
+#include <oblo/core/unique_ptr.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define OBLO_TRACE_USE_TSC
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#endif
+
+namespace oblo::trace
+{
+    namespace
+    {
+        enum class event_kind : u8
+        {
+            begin,
+            end,
+            frame,
+            tag,
+        };
+
+        constexpr u32 TagChunkLength{24};
+        constexpr u32 MaxTagChunks{5};
+
+        struct event
+        {
+            union {
+                struct
+                {
+                    u64 timestamp;
+                    const char* name;
+                } scope;
+
+                // Tags are copied in chunks of consecutive events, following the event they refer to
+                char text[TagChunkLength];
+            };
+
+            u8 length;
+            event_kind kind;
+        };
+
+        static_assert(sizeof(event) == 32);
+
+        constexpr u32 MaxThreadNameLength{63};
+
+        struct thread_buffer
+        {
+            unique_ptr<event[]> events;
+            u64 mask;
+
+            // Only written by the owning thread
+            std::atomic<u64> head;
+
+            // Events before this index were discarded by clear_recording
+            std::atomic<u64> tail;
+
+            u32 threadIndex;
+
+            std::mutex nameMutex;
+            char name[MaxThreadNameLength + 1];
+        };
+
+        struct timestamp_calibration
+        {
+            u64 ticks;
+            std::chrono::steady_clock::time_point time;
+        };
+
+        struct registry
+        {
+            std::mutex mutex;
+            dynamic_array<unique_ptr<thread_buffer>> buffers;
+
+            // Buffers of threads that exited, which can be reused by new threads
+            dynamic_array<thread_buffer*> freeBuffers;
+            std::atomic<u32> eventsPerThread{1u << 16};
+            timestamp_calibration calibration;
+        };
+
+        u64 read_timestamp() noexcept
+        {
+#ifdef OBLO_TRACE_USE_TSC
+            return __rdtsc();
+#else
+            return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                    .count());
+#endif
+        }
+
+        timestamp_calibration make_calibration()
+        {
+            return {
+                .ticks = read_timestamp(),
+                .time = std::chrono::steady_clock::now(),
+            };
+        }
+
+        registry& get_registry()
+        {
+            static registry r{.calibration = make_calibration()};
+            return r;
+        }
+
+        thread_local thread_buffer* s_tlsBuffer{};
+
+        // Returns the buffer of the thread to the registry when the thread exits
+        struct thread_buffer_owner
+        {
+            thread_buffer* buffer{};
+
+            ~thread_buffer_owner()
+            {
+                if (!buffer)
+                {
+                    return;
+                }
+
+                auto& r = get_registry();
+                const std::lock_guard lock{r.mutex};
+
+                r.freeBuffers.push_back(buffer);
+                s_tlsBuffer = nullptr;
+            }
+        };
+
+        // Kept separate from s_tlsBuffer, which is trivial and cheaper to access when recording
+        thread_local thread_buffer_owner s_tlsBufferOwner;
+
+        void set_default_thread_name(thread_buffer& b)
+        {
+            std::snprintf(b.name, sizeof(b.name), "Thread #%u", b.threadIndex);
+        }
+
+        thread_buffer* reuse_thread_buffer(registry& r, u64 capacity)
+        {
+            const std::lock_guard lock{r.mutex};
+
+            const auto it = std::find_if(r.freeBuffers.begin(),
+                r.freeBuffers.end(),
+                [capacity](const thread_buffer* b) { return b->mask + 1 == capacity; });
+
+            if (it == r.freeBuffers.end())
+            {
+                return nullptr;
+            }
+
+            thread_buffer* const buffer = *it;
+            r.freeBuffers.erase_unordered(it);
+
+            // The events of the previous thread are kept, they are shown on the same track since they happened before
+            set_default_thread_name(*buffer);
+
+            return buffer;
+        }
+
+        OBLO_NOINLINE thread_buffer* create_thread_buffer() noexcept
+        {
+            auto& r = get_registry();
+
+            // Leaves room for valid events besides the ones the exporter skips as possibly being written
+            const u64 capacity =
+                std::bit_ceil(std::max(r.eventsPerThread.load(std::memory_order_relaxed), 2 * MaxTagChunks));
+
+            thread_buffer* buffer = reuse_thread_buffer(r, capacity);
+
+            if (!buffer)
+            {
+                auto newBuffer = allocate_unique<thread_buffer>();
+                newBuffer->events = allocate_unique<event[]>(capacity);
+                newBuffer->mask = capacity - 1;
+
+                const std::lock_guard lock{r.mutex};
+
+                newBuffer->threadIndex = r.buffers.size32();
+                set_default_thread_name(*newBuffer);
+
+                buffer = newBuffer.get();
+                r.buffers.push_back(std::move(newBuffer));
+            }
+
+            s_tlsBuffer = buffer;
+            s_tlsBufferOwner.buffer = buffer;
+
+            return buffer;
+        }
+
+        OBLO_FORCEINLINE thread_buffer* get_thread_buffer() noexcept
+        {
+            thread_buffer* b = s_tlsBuffer;
+            return b ? b : create_thread_buffer();
+        }
+
+        OBLO_FORCEINLINE event& push_event(thread_buffer& b) noexcept
+        {
+            const u64 head = b.head.load(std::memory_order_relaxed);
+            return b.events[head & b.mask];
+        }
+
+        OBLO_FORCEINLINE void commit_events(thread_buffer& b, u64 count) noexcept
+        {
+            const u64 head = b.head.load(std::memory_order_relaxed);
+            b.head.store(head + count, std::memory_order_release);
+        }
+
+        void record_scope_event(event_kind kind, const char* name) noexcept
+        {
+            auto& b = *get_thread_buffer();
+
+            event& e = push_event(b);
+            e.scope.timestamp = read_timestamp();
+            e.scope.name = name;
+            e.kind = kind;
+
+            commit_events(b, 1);
+        }
+
+        void append_json_string(string_builder& out, string_view str)
+        {
+            out.append('"');
+
+            for (const char c : str)
+            {
+                switch (c)
+                {
+                case '"':
+                    out.append("\\\"");
+                    break;
+
+                case '\\':
+                    out.append("\\\\");
+                    break;
+
+                default:
+                    if (u8(c) < 0x20)
+                    {
+                        constexpr const char* hex = "0123456789abcdef";
+                        out.append("\\u00").append(hex[u8(c) >> 4]).append(hex[u8(c) & 0xf]);
+                    }
+                    else
+                    {
+                        out.append(c);
+                    }
+
+                    break;
+                }
+            }
+
+            out.append('"');
+        }
+    }
+
+    namespace detail
+    {
+        constinit std::atomic<bool> g_recordingEnabled{false};
+
+        void record_begin(const char* name) noexcept
+        {
+            record_scope_event(event_kind::begin, name);
+        }
+
+        void record_end() noexcept
+        {
+            record_scope_event(event_kind::end, nullptr);
+        }
+
+        void record_tag(string_view text) noexcept
+        {
+            auto& b = *get_thread_buffer();
+
+            const u64 head = b.head.load(std::memory_order_relaxed);
+            const u32 length = u32(std::min<usize>(text.size(), TagChunkLength * MaxTagChunks));
+
+            u64 count = 0;
+
+            for (u32 offset = 0; offset < length || count == 0; offset += TagChunkLength, ++count)
+            {
+                event& e = b.events[(head + count) & b.mask];
+
+                const u32 chunkLength = std::min(length - offset, TagChunkLength);
+                std::memcpy(e.text, text.data() + offset, chunkLength);
+
+                e.length = u8(chunkLength);
+                e.kind = event_kind::tag;
+            }
+
+            commit_events(b, count);
+        }
+    }
+
+    void set_recording_enabled(bool enabled)
+    {
+        // Makes sure the registry and the timestamp calibration are initialized before we start recording
+        get_registry();
+        detail::g_recordingEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void set_events_per_thread(u32 count)
+    {
+        get_registry().eventsPerThread.store(count, std::memory_order_relaxed);
+    }
+
+    void set_thread_name(string_view name)
+    {
+        auto& b = *get_thread_buffer();
+
+        const std::lock_guard lock{b.nameMutex};
+
+        const usize length = std::min<usize>(name.size(), MaxThreadNameLength);
+        std::memcpy(b.name, name.data(), length);
+        b.name[length] = '\0';
+    }
+
+    void clear_recording()
+    {
+        auto& r = get_registry();
+        const std::lock_guard lock{r.mutex};
+
+        for (auto& b : r.buffers)
+        {
+            b->tail.store(b->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    void mark_frame() noexcept
+    {
+        if (is_recording_enabled())
+        {
+            record_scope_event(event_kind::frame, nullptr);
+        }
+    }
+
+    void write_chrome_trace(string_builder& out)
+    {
+        auto& r = get_registry();
+
+        // Calibrate the timestamps against the steady clock, over a long enough interval to be accurate
+        const auto minCalibrationTime = std::chrono::milliseconds{10};
+
+        if (std::chrono::steady_clock::now() - r.calibration.time < minCalibrationTime)
+        {
+            std::this_thread::sleep_for(minCalibrationTime);
+        }
+
+        const timestamp_calibration now = make_calibration();
+
+        const f64 elapsedUs = std::chrono::duration<f64, std::micro>(now.time - r.calibration.time).count();
+        const f64 ticksToUs = elapsedUs / f64(now.ticks - r.calibration.ticks);
+
+        const auto toUs = [&r, ticksToUs](u64 ticks) { return f64(i64(ticks - r.calibration.ticks)) * ticksToUs; };
+
+        const std::lock_guard lock{r.mutex};
+
+        out.append(R"({"displayTimeUnit":"ns","traceEvents":[)");
+
+        bool first = true;
+
+        const auto beginEvent = [&out, &first]
+        {
+            if (!first)
+            {
+                out.append(",\n");
+            }
+
+            first = false;
+        };
+
+        struct open_zone
+        {
+            // The range of the zone in zoneTags, the tags following the begin event end at beginTagsEnd
+            usize tagsOffset;
+            usize beginTagsEnd;
+        };
+
+        dynamic_array<event> events;
+
+        // Zones that are still open, innermost last, and their tags stored in the same order
+        dynamic_array<open_zone> openZones;
+        dynamic_array<char> zoneTags;
+
+        const auto appendTags = [&events, &zoneTags](usize& i)
+        {
+            for (; i + 1 < events.size() && events[i + 1].kind == event_kind::tag; ++i)
+            {
+                const event& tagEvent = events[i + 1];
+                zoneTags.append(tagEvent.text, tagEvent.text + tagEvent.length);
+            }
+        };
+
+        const auto appendTagsArgs = [&out, &zoneTags](usize offset)
+        {
+            out.append(R"(,"args":{"tag":)");
+            append_json_string(out, string_view{zoneTags.data() + offset, zoneTags.size() - offset});
+            out.append("}");
+        };
+
+        for (const auto& b : r.buffers)
+        {
+            {
+                const std::lock_guard nameLock{b->nameMutex};
+
+                beginEvent();
+                out.format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":)", b->threadIndex);
+                append_json_string(out, b->name);
+                out.append("}}");
+            }
+
+            const u64 capacity = b->mask + 1;
+            const u64 head = b->head.load(std::memory_order_acquire);
+            const u64 tail = b->tail.load(std::memory_order_relaxed);
+            const u64 begin = std::max(tail, head > capacity ? head - capacity : 0);
+
+            events.clear();
+            events.reserve(head - begin);
+
+            for (u64 i = begin; i < head; ++i)
+            {
+                events.push_back(b->events[i & b->mask]);
+            }
+
+            // The owning thread might have overwritten the oldest events while we were copying, including the ones
+            // currently being written, which can be up to MaxTagChunks since tags are published all at once
+            const u64 headAfterCopy = b->head.load(std::memory_order_acquire);
+            const u64 writeEnd = headAfterCopy + MaxTagChunks;
+            const u64 firstValid = writeEnd > capacity ? writeEnd - capacity : 0;
+            const usize skip = usize(firstValid > begin ? std::min(firstValid - begin, head - begin) : 0);
+
+            openZones.clear();
+            zoneTags.clear();
+
+            for (usize i = skip; i < events.size(); ++i)
+            {
+                const event& e = events[i];
+
+                switch (e.kind)
+                {
+                case event_kind::begin: {
+                    beginEvent();
+                    out.format(R"({{"ph":"B","pid":1,"tid":{},"ts":{:.3f},"name":)",
+                        b->threadIndex,
+                        toUs(e.scope.timestamp));
+                    append_json_string(out, e.scope.name ? e.scope.name : "");
+
+                    // Tags following the begin event are attached to it as arguments
+                    const usize tagsOffset = zoneTags.size();
+                    appendTags(i);
+
+                    if (zoneTags.size() > tagsOffset)
+                    {
+                        appendTagsArgs(tagsOffset);
+                    }
+
+                    out.append("}");
+                    openZones.push_back({tagsOffset, zoneTags.size()});
+                }
+                break;
+
+                case event_kind::end:
+                    // We might have lost the begin event if it was overwritten
+                    if (!openZones.empty())
+                    {
+                        const open_zone zone = openZones.back();
+                        openZones.pop_back();
+
+                        beginEvent();
+                        out.format(R"({{"ph":"E","pid":1,"tid":{},"ts":{:.3f})",
+                            b->threadIndex,
+                            toUs(e.scope.timestamp));
+
+                        // The arguments of the end event are merged with the ones of the begin, so we write all tags
+                        if (zoneTags.size() > zone.beginTagsEnd)
+                        {
+                            appendTagsArgs(zone.tagsOffset);
+                        }
+
+                        out.append("}");
+                        zoneTags.resize(zone.tagsOffset);
+                    }
+
+                    break;
+
+                case event_kind::frame:
+                    beginEvent();
+                    out.format(R"({{"name":"Frame","ph":"i","s":"g","pid":1,"tid":{},"ts":{:.3f}}})",
+                        b->threadIndex,
+                        toUs(e.scope.timestamp));
+                    break;
+
+                case event_kind::tag:
+                    // Tags following other events, e.g. the end of a nested zone, belong to the innermost open zone,
+                    // otherwise they are orphans, e.g. the scope they belonged to was overwritten
+                    if (!openZones.empty())
+                    {
+                        if (zoneTags.size() > openZones.back().tagsOffset)
+                        {
+                            zoneTags.push_back('\n');
+                        }
+
+                        zoneTags.append(e.text, e.text + e.length);
+                        appendTags(i);
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        out.append("]}\n");
+    }
+
+    expected<> write_chrome_trace(cstring_view path)
+    {
+        string_builder out;
+        write_chrome_trace(out);
+
+        return filesystem::write_file(path, as_bytes(std::span{out.data(), out.size()}), {});
+    }
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/allocation_tracking.hpp>
+#include <oblo/core/dynamic_array.hpp>
+
+namespace oblo
+{
+    TEST(tracking_allocator, live_and_peak_bytes)
+    {
+        constexpr auto tag = allocation_tag::importers;
+
+        tracking_allocator allocator{get_global_allocator(), tag};
+
+        const auto before = get_allocation_snapshot().tags[u32(tag)];
+
+        byte* const a = allocator.allocate(100, 8);
+        byte* const b = allocator.allocate(3000, 16);
+
+        ASSERT_TRUE(a);
+        ASSERT_TRUE(b);
+        ASSERT_EQ(uintptr(b) % 16, 0);
+
+        const auto during = get_allocation_snapshot().tags[u32(tag)];
+
+        ASSERT_EQ(during.liveBytes - before.liveBytes, 3100);
+        ASSERT_EQ(during.totalBytes - before.totalBytes, 3100);
+        ASSERT_EQ(during.allocations - before.allocations, 2);
+        ASSERT_GE(during.peakBytes, during.liveBytes);
+
+        ASSERT_EQ(during.sizeHistogram[6] - before.sizeHistogram[6], 1);
+        ASSERT_EQ(during.sizeHistogram[11] - before.sizeHistogram[11], 1);
+
+        // Sizes passed to deallocate are ignored, the header is used instead
+        allocator.deallocate(a, 1, 1);
+        allocator.deallocate(b, 3000, 16);
+
+        const auto after = get_allocation_snapshot().tags[u32(tag)];
+
+        ASSERT_EQ(after.liveBytes, before.liveBytes);
+        ASSERT_EQ(after.deallocations - before.deallocations, 2);
+        ASSERT_GE(after.peakBytes, before.liveBytes + 3100);
+    }
+
+    TEST(tracking_allocator, over_aligned)
+    {
+        tracking_allocator allocator{get_global_aligned_allocator(), allocation_tag::ecs};
+
+        constexpr usize alignment{256};
+
+        byte* const ptr = allocator.allocate(1024, alignment);
+        ASSERT_TRUE(ptr);
+        ASSERT_EQ(uintptr(ptr) % alignment, 0);
+
+        allocator.deallocate(ptr, 1024, alignment);
+    }
+
+    TEST(tracking_allocator, containers)
+    {
+        constexpr auto tag = allocation_tag::strings;
+
+        tracking_allocator allocator{get_global_allocator(), tag};
+
+        const auto before = get_allocation_snapshot();
+
+        {
+            dynamic_array<u32> array{&allocator};
+            array.resize(1024);
+
+            const auto during = get_allocation_snapshot();
+            ASSERT_GE(during.tags[u32(tag)].liveBytes - before.tags[u32(tag)].liveBytes, 1024 * sizeof(u32));
+
+            const auto rate = compute_allocation_rate(before, during, tag);
+            ASSERT_GE(rate.allocationsPerSecond, 0.0);
+            ASSERT_GE(rate.bytesPerSecond, 0.0);
+        }
+
+        const auto after = get_allocation_snapshot();
+        ASSERT_EQ(after.tags[u32(tag)].liveBytes, before.tags[u32(tag)].liveBytes);
+    }
+}
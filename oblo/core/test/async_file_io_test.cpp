@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/filesystem/async_file_io.hpp>
+#include <oblo/core/filesystem/file.hpp>
+#include <oblo/core/filesystem/filesystem.hpp>
+
+#include <atomic>
+
+namespace oblo
+{
+    namespace
+    {
+        struct completion_counter
+        {
+            std::atomic<u32> completed;
+            std::atomic<u32> cancelled;
+            std::atomic<u32> failed;
+            std::atomic<u32> bytes;
+        };
+
+        void count_completion(const filesystem::async_io_result& result, void* userdata)
+        {
+            auto* const counter = static_cast<completion_counter*>(userdata);
+
+            switch (result.status)
+            {
+            case filesystem::async_io_status::completed:
+                ++counter->completed;
+                counter->bytes += result.bytesTransferred;
+                break;
+
+            case filesystem::async_io_status::cancelled:
+                ++counter->cancelled;
+                break;
+
+            default:
+                ++counter->failed;
+                break;
+            }
+        }
+
+        bool init_test(filesystem::async_file_io& io, bool forceFallback)
+        {
+            return filesystem::remove_all("./async_file_io_test").has_value() &&
+                filesystem::create_directories("./async_file_io_test").has_value() &&
+                io.init({.queueDepth = 4, .forceFallback = forceFallback}).has_value();
+        }
+
+        template <bool ForceFallback>
+        void write_and_read_test()
+        {
+            filesystem::async_file_io io;
+            ASSERT_TRUE(init_test(io, ForceFallback));
+
+            constexpr u32 blocksCount{32};
+            constexpr u32 blockSize{4096};
+
+            dynamic_array<byte> source;
+            source.resize(blocksCount * blockSize);
+
+            for (u32 i = 0; i < source.size32(); ++i)
+            {
+                source[i] = byte(i * 31 + i / blockSize);
+            }
+
+            platform::file file;
+            ASSERT_TRUE(file.open("./async_file_io_test/data.bin", platform::file::open_mode::write));
+
+            completion_counter writes{};
+            dynamic_array<filesystem::async_io_request> requests;
+
+            for (u32 i = 0; i < blocksCount; ++i)
+            {
+                requests.push_back({
+                    .file = &file,
+                    .operation = filesystem::async_io_operation::write,
+                    .offset = u64{i} * blockSize,
+                    .buffer = source.data() + i * blockSize,
+                    .size = blockSize,
+                    .callback = count_completion,
+                    .userdata = &writes,
+                });
+            }
+
+            // Submits more requests than the queue depth, to exercise queueing
+            io.submit(requests);
+            io.wait_idle();
+
+            ASSERT_EQ(writes.completed, blocksCount);
+            ASSERT_EQ(writes.bytes, source.size32());
+
+            file.close();
+            ASSERT_TRUE(file.open("./async_file_io_test/data.bin", platform::file::open_mode::read));
+            ASSERT_EQ(file.get_size().value_or(0), source.size());
+
+            dynamic_array<byte> destination;
+            destination.resize(source.size() + blockSize);
+
+            completion_counter reads{};
+
+            for (u32 i = 0; i < blocksCount; ++i)
+            {
+                auto& r = requests[i];
+                r.file = &file;
+                r.operation = filesystem::async_io_operation::read;
+                r.buffer = destination.data() + i * blockSize;
+                r.userdata = &reads;
+            }
+
+            // Reading past the end of the file completes with no bytes transferred
+            requests.push_back({
+                .file = &file,
+                .operation = filesystem::async_io_operation::read,
+                .offset = source.size(),
+                .buffer = destination.data() + source.size(),
+                .size = blockSize,
+                .callback = count_completion,
+                .userdata = &reads,
+            });
+
+            dynamic_array<filesystem::async_io_handle> handles;
+            handles.resize(requests.size());
+
+            io.submit(requests, handles);
+            io.wait_idle();
+
+            for (auto h : handles)
+            {
+                ASSERT_TRUE(h);
+
+                // Already completed
+                ASSERT_FALSE(io.cancel(h));
+            }
+
+            ASSERT_EQ(reads.completed, blocksCount + 1);
+            ASSERT_EQ(reads.bytes, source.size32());
+            ASSERT_EQ(std::memcmp(source.data(), destination.data(), source.size()), 0);
+        }
+
+        template <bool ForceFallback>
+        void cancel_test()
+        {
+            filesystem::async_file_io io;
+            ASSERT_TRUE(init_test(io, ForceFallback));
+
+            constexpr string_view content = "Some content";
+            ASSERT_TRUE(filesystem::write_file("./async_file_io_test/small.bin", as_bytes(std::span{content}), {}));
+
+            platform::file file;
+            ASSERT_TRUE(file.open("./async_file_io_test/small.bin", platform::file::open_mode::read));
+
+            constexpr u32 requestsCount{64};
+
+            byte buffer[requestsCount][16];
+            completion_counter counter{};
+
+            dynamic_array<filesystem::async_io_request> requests;
+
+            for (u32 i = 0; i < requestsCount; ++i)
+            {
+                requests.push_back({
+                    .file = &file,
+                    .operation = filesystem::async_io_operation::read,
+                    .buffer = buffer[i],
+                    .size = sizeof(buffer[i]),
+                    .callback = count_completion,
+                    .userdata = &counter,
+                });
+            }
+
+            dynamic_array<filesystem::async_io_handle> handles;
+            handles.resize(requestsCount);
+
+            io.submit(requests, handles);
+
+            // Whether requests are cancelled depends on timing, but each of them invokes the callback exactly once
+            for (auto h : handles)
+            {
+                io.cancel(h);
+            }
+
+            io.wait_idle();
+
+            ASSERT_EQ(counter.completed + counter.cancelled, requestsCount);
+            ASSERT_EQ(counter.failed, 0);
+        }
+    }
+
+    TEST(async_file_io, write_and_read)
+    {
+        write_and_read_test<false>();
+    }
+
+    TEST(async_file_io, write_and_read_thread_pool)
+    {
+        write_and_read_test<true>();
+    }
+
+    TEST(async_file_io, cancel)
+    {
+        cancel_test<false>();
+    }
+
+    TEST(async_file_io, cancel_thread_pool)
+    {
+        cancel_test<true>();
+    }
+}
@@ -3,6 +3,7 @@
 #include <oblo/core/filesystem/directory_watcher.hpp>
 #include <oblo/core/filesystem/file.hpp>
 #include <oblo/core/filesystem/filesystem.hpp>
+#include <oblo/core/filesystem/mapped_file.hpp>
 #include <oblo/core/platform/core.hpp>
 
 namespace oblo
@@ -198,4 +199,195 @@ namespace oblo
     {
         watch_directory_test<true>();
     }
-}
\ No newline at end of file
+
+    namespace
+    {
+        struct watcher_events_count
+        {
+            u32 added;
+            u32 modified;
+            u32 removed;
+            u32 renamed;
+
+            bool operator==(const watcher_events_count&) const = default;
+        };
+
+        watcher_events_count process_and_count(const filesystem::directory_watcher& w)
+        {
+            watcher_events_count count{};
+
+            EXPECT_TRUE(w.process(
+                [&](const filesystem::directory_watcher_event& evt)
+                {
+                    switch (evt.eventKind)
+                    {
+                    case filesystem::directory_watcher_event_kind::added:
+                        ++count.added;
+                        break;
+                    case filesystem::directory_watcher_event_kind::modified:
+                        ++count.modified;
+                        break;
+                    case filesystem::directory_watcher_event_kind::removed:
+                        ++count.removed;
+                        break;
+                    case filesystem::directory_watcher_event_kind::renamed:
+                        ++count.renamed;
+                        break;
+                    default:
+                        break;
+                    }
+                }));
+
+            return count;
+        }
+    }
+
+    TEST(directory_watcher, coalesce_events)
+    {
+        EXPECT_TRUE(make_clear_directory("./directory_watcher_coalesce_test/"));
+
+        filesystem::directory_watcher w;
+
+        EXPECT_TRUE(w.init({
+            .path = "./directory_watcher_coalesce_test",
+            .isRecursive = true,
+            .coalesceEvents = true,
+        }));
+
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/a.foo", "A"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/a.foo", "AA"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/a.foo", "AAA"));
+
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.added = 1}));
+
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/a.foo", "B"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/a.foo", "BB"));
+
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.modified = 1}));
+
+        // Files created in a new directory before we started watching it are reported as well
+        EXPECT_TRUE(filesystem::create_directories("./directory_watcher_coalesce_test/bar/baz"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/bar/baz/b.foo", "B"));
+
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.added = 3}));
+
+        EXPECT_TRUE(
+            filesystem::rename("./directory_watcher_coalesce_test/bar", "./directory_watcher_coalesce_test/qux"));
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.renamed = 1}));
+
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/qux/baz/b.foo", "BBB"));
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.modified = 1}));
+
+        // Creating and removing a file before processing should not report anything
+        EXPECT_TRUE(write_text_file("./directory_watcher_coalesce_test/c.foo", "C"));
+        EXPECT_TRUE(filesystem::remove("./directory_watcher_coalesce_test/c.foo"));
+        EXPECT_TRUE(filesystem::remove("./directory_watcher_coalesce_test/a.foo"));
+
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.removed = 1}));
+
+        // Removing a directory reports every entry in it, whichever event is processed first
+        EXPECT_TRUE(filesystem::remove_all("./directory_watcher_coalesce_test/qux"));
+        ASSERT_EQ(process_and_count(w), (watcher_events_count{.removed = 3}));
+    }
+
+    TEST(directory_watcher, debounce)
+    {
+        EXPECT_TRUE(make_clear_directory("./directory_watcher_debounce_test/"));
+
+        filesystem::directory_watcher w;
+
+        EXPECT_TRUE(w.init({
+            .path = "./directory_watcher_debounce_test",
+            .coalesceEvents = true,
+            .debounceTime = time::from_seconds(3600.f),
+        }));
+
+        EXPECT_TRUE(write_text_file("./directory_watcher_debounce_test/a.foo", "A"));
+
+        // The file was touched too recently, nothing should be reported yet
+        ASSERT_EQ(process_and_count(w), watcher_events_count{});
+    }
+
+    TEST(directory_watcher, persistent_index)
+    {
+        EXPECT_TRUE(make_clear_directory("./directory_watcher_index_test/dir/sub"));
+        EXPECT_TRUE(make_clear_directory("./directory_watcher_index_test/index"));
+
+        EXPECT_TRUE(write_text_file("./directory_watcher_index_test/dir/a.foo", "A"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_index_test/dir/sub/b.foo", "B"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_index_test/dir/sub/c.foo", "C"));
+
+        const filesystem::directory_watcher_initializer initializer{
+            .path = "./directory_watcher_index_test/dir",
+            .isRecursive = true,
+            .coalesceEvents = true,
+            .hashContents = true,
+            .indexPath = "./directory_watcher_index_test/index/watcher.idx",
+        };
+
+        {
+            filesystem::directory_watcher w;
+            EXPECT_TRUE(w.init(initializer));
+
+            // Without an index there is nothing to report
+            ASSERT_EQ(process_and_count(w), watcher_events_count{});
+        }
+
+        // Changes done while not watching
+        EXPECT_TRUE(write_text_file("./directory_watcher_index_test/dir/a.foo", "AAAA"));
+        EXPECT_TRUE(write_text_file("./directory_watcher_index_test/dir/sub/d.foo", "D"));
+        EXPECT_TRUE(filesystem::remove("./directory_watcher_index_test/dir/sub/c.foo"));
+
+        {
+            filesystem::directory_watcher w;
+            EXPECT_TRUE(w.init(initializer));
+
+            ASSERT_EQ(process_and_count(w), (watcher_events_count{.added = 1, .modified = 1, .removed = 1}));
+            ASSERT_EQ(process_and_count(w), watcher_events_count{});
+
+            EXPECT_TRUE(w.save_index());
+        }
+
+        {
+            filesystem::directory_watcher w;
+            EXPECT_TRUE(w.init(initializer));
+
+            ASSERT_EQ(process_and_count(w), watcher_events_count{});
+        }
+    }
+
+    TEST(mapped_file, read)
+    {
+        EXPECT_TRUE(make_clear_directory("./mapped_file_test/"));
+
+        constexpr string_view content = "Some content to map";
+        EXPECT_TRUE(write_text_file("./mapped_file_test/a.txt", content));
+        EXPECT_TRUE(write_text_file("./mapped_file_test/empty.txt", ""));
+
+        filesystem::mapped_file f;
+        ASSERT_FALSE(f.is_open());
+        ASSERT_FALSE(f.open("./mapped_file_test/missing.txt"));
+
+        ASSERT_TRUE(f.open("./mapped_file_test/a.txt", filesystem::mapped_file_hint::sequential));
+        ASSERT_TRUE(f.is_open());
+        ASSERT_EQ(f.size(), content.size());
+        ASSERT_EQ(string_view(reinterpret_cast<const char*>(f.data()), f.size()), content);
+
+        // Prefetching out of bounds ranges should be harmless
+        f.advise(filesystem::mapped_file_hint::will_need);
+        f.prefetch(5, 1024);
+        f.prefetch(1024, 1024);
+
+        filesystem::mapped_file moved = std::move(f);
+        ASSERT_FALSE(f.is_open());
+        ASSERT_TRUE(moved.is_open());
+        ASSERT_EQ(moved.get_bytes().size(), content.size());
+
+        ASSERT_TRUE(f.open("./mapped_file_test/empty.txt"));
+        ASSERT_TRUE(f.is_open());
+        ASSERT_TRUE(f.get_bytes().empty());
+
+        f.close();
+        ASSERT_FALSE(f.is_open());
+    }
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/frame_allocator.hpp>
+#include <oblo/core/frame_arena_ring.hpp>
+
+namespace oblo
+{
+    TEST(frame_allocator, high_water_mark)
+    {
+        frame_allocator allocator;
+        ASSERT_TRUE(allocator.init(1u << 24));
+
+        ASSERT_EQ(allocator.get_allocated_memory_size(), 0);
+        ASSERT_EQ(allocator.get_high_water_mark(), 0);
+
+        {
+            const auto scope = allocator.make_scoped_restore();
+
+            ASSERT_TRUE(allocator.allocate(1024, 16));
+            ASSERT_TRUE(allocator.allocate(1024, 16));
+
+            ASSERT_EQ(allocator.get_allocated_memory_size(), 2048);
+            ASSERT_EQ(allocator.get_high_water_mark(), 2048);
+        }
+
+        ASSERT_EQ(allocator.get_allocated_memory_size(), 0);
+        ASSERT_EQ(allocator.get_high_water_mark(), 2048);
+
+        ASSERT_TRUE(allocator.allocate(512, 16));
+        ASSERT_EQ(allocator.get_high_water_mark(), 2048);
+
+        allocator.reset_high_water_mark();
+        ASSERT_EQ(allocator.get_high_water_mark(), 512);
+
+        allocator.restore_all();
+        ASSERT_EQ(allocator.get_high_water_mark(), 512);
+    }
+
+    TEST(frame_allocator, shrink_policy)
+    {
+        constexpr usize chunkSize{64u << 10};
+
+        frame_allocator allocator;
+        ASSERT_TRUE(allocator.init({
+            .maxSize = 1u << 24,
+            .chunkSize = chunkSize,
+            .startingChunks = 1,
+            .shrinkFrames = 2,
+        }));
+
+        ASSERT_EQ(allocator.get_committed_memory_size(), chunkSize);
+
+        const auto runFrame = [&allocator](usize size)
+        {
+            if (size > 0)
+            {
+                ASSERT_TRUE(allocator.allocate(size, 16));
+            }
+
+            allocator.restore_all();
+            allocator.end_frame();
+        };
+
+        runFrame(5 * chunkSize);
+        ASSERT_EQ(allocator.get_committed_memory_size(), 5 * chunkSize);
+
+        // The spike is still within the window, nothing is decommitted
+        runFrame(chunkSize + chunkSize / 2);
+        ASSERT_EQ(allocator.get_committed_memory_size(), 5 * chunkSize);
+
+        runFrame(chunkSize + chunkSize / 2);
+        ASSERT_EQ(allocator.get_committed_memory_size(), 5 * chunkSize);
+
+        // A whole window below the spike shrinks to the highest high-water mark of the window
+        runFrame(chunkSize);
+        ASSERT_EQ(allocator.get_committed_memory_size(), 2 * chunkSize);
+
+        // The starting chunks are never released
+        runFrame(0);
+        runFrame(0);
+        ASSERT_EQ(allocator.get_committed_memory_size(), chunkSize);
+
+        // Memory is committed again when needed
+        runFrame(3 * chunkSize);
+        ASSERT_EQ(allocator.get_committed_memory_size(), 3 * chunkSize);
+    }
+
+    TEST(frame_allocator, huge_pages_prefault)
+    {
+        constexpr usize chunkSize{2u << 20};
+
+        for (const auto pages : {frame_allocator_pages::transparent_huge, frame_allocator_pages::huge})
+        {
+            frame_allocator allocator;
+            ASSERT_TRUE(allocator.init({
+                .maxSize = 1u << 26,
+                .chunkSize = chunkSize,
+                .startingChunks = 2,
+                .pages = pages,
+                .prefault = true,
+            }));
+
+            // Support depends on the system configuration, but we should always be able to fall back to regular pages
+            ASSERT_LE(u8(allocator.get_pages()), u8(pages));
+            ASSERT_EQ(allocator.get_committed_memory_size(), 2 * chunkSize);
+
+            auto* const first = allocator.allocate(chunkSize, 16);
+            ASSERT_TRUE(first);
+            ASSERT_EQ(first[0], byte{});
+            ASSERT_EQ(first[chunkSize - 1], byte{});
+
+            // Allocate past the prefaulted range, to commit more
+            auto* const second = allocator.allocate(2 * chunkSize, 16);
+            ASSERT_TRUE(second);
+            second[2 * chunkSize - 1] = byte{42};
+
+            ASSERT_EQ(allocator.get_committed_memory_size(), 3 * chunkSize);
+        }
+
+        // Explicit huge pages require the chunk size to be a multiple of the huge page size
+        frame_allocator allocator;
+        ASSERT_TRUE(allocator.init({
+            .maxSize = 1u << 24,
+            .chunkSize = 64u << 10,
+            .pages = frame_allocator_pages::huge,
+        }));
+
+        ASSERT_NE(allocator.get_pages(), frame_allocator_pages::huge);
+    }
+
+    TEST(frame_arena_ring, reuse_after_retire)
+    {
+        constexpr u32 buffersCount{2};
+
+        frame_arena_ring ring;
+        ASSERT_TRUE(ring.init(buffersCount, 1u << 24));
+        ASSERT_EQ(ring.get_buffers_count(), buffersCount);
+
+        ASSERT_TRUE(ring.begin_frame(0));
+        auto* const frame0 = ring.get_current().allocate(64, 16);
+        ASSERT_TRUE(frame0);
+
+        ASSERT_TRUE(ring.begin_frame(1));
+        auto* const frame1 = ring.get_current().allocate(64, 16);
+        ASSERT_TRUE(frame1);
+        ASSERT_NE(frame0, frame1);
+
+        // Frame 0 was not retired yet, so its arena cannot be reset
+        ASSERT_FALSE(ring.can_begin_frame(2));
+        ASSERT_FALSE(ring.begin_frame(2));
+
+        ring.retire_frames(0);
+
+        ASSERT_TRUE(ring.begin_frame(2));
+        ASSERT_EQ(ring.get_current().allocate(64, 16), frame0);
+
+        ASSERT_FALSE(ring.can_begin_frame(3));
+
+        ring.retire_frames(2);
+
+        ASSERT_TRUE(ring.begin_frame(3));
+        ASSERT_EQ(ring.get_current().allocate(64, 16), frame1);
+
+        ASSERT_EQ(ring.get_high_water_mark(), 64);
+    }
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/hash.hpp>
+#include <oblo/core/unordered_set.hpp>
+#include <oblo/core/utility.hpp>
+#include <oblo/core/uuid.hpp>
+
+#include <bit>
+
+namespace oblo
+{
+    TEST(hash, hasher_matches_one_shot)
+    {
+        dynamic_array<u8> data;
+        data.resize(4096);
+
+        for (usize i = 0; i < data.size(); ++i)
+        {
+            data[i] = u8(i * 31 + 7);
+        }
+
+        // XXH3 switches strategy at a few size thresholds, try sizes around each of them
+        constexpr usize sizes[] = {0, 1, 3, 4, 8, 9, 16, 17, 128, 129, 240, 241, 1024, 4096};
+        constexpr usize chunkSizes[] = {1, 7, 64, 1000};
+
+        for (const usize size : sizes)
+        {
+            const u64 expected = hash_xxh3(data.data(), size, 42);
+
+            for (const usize chunkSize : chunkSizes)
+            {
+                hasher h{42};
+
+                for (usize offset = 0; offset < size; offset += chunkSize)
+                {
+                    h.update(data.data() + offset, min(chunkSize, size - offset));
+                }
+
+                ASSERT_EQ(h.digest(), expected);
+
+                // Copies carry the state over
+                const hasher copy = h;
+                ASSERT_EQ(copy.digest(), expected);
+            }
+        }
+
+        hasher h;
+        h.update(data.data(), 100);
+        h.reset();
+
+        ASSERT_EQ(h.digest(), hash_xxh3(nullptr, 0));
+    }
+
+    TEST(hash, integer_mixers)
+    {
+        static_assert(hash_integer(u64{0}) == 0);
+        static_assert(hash<u32>{}(42u) == hash<u32>{}(42u));
+
+        unordered_set<u64> seen64;
+        unordered_set<u32> seen32;
+
+        // Sequential keys are the typical input, the mixers are bijective so they can't collide
+        for (u32 i = 0; i < 1u << 16; ++i)
+        {
+            ASSERT_TRUE(seen64.emplace(hash_integer(u64{i})).second);
+            ASSERT_TRUE(seen32.emplace(hash_integer(i)).second);
+        }
+
+        // Flipping a single input bit should change about half of the output bits
+        u32 flippedBits{};
+        constexpr u32 samples{1024};
+
+        for (u32 i = 0; i < samples; ++i)
+        {
+            const u64 x = hash_integer(u64{i} * u64{0x9e3779b97f4a7c15});
+            flippedBits += u32(std::popcount(hash_integer(x) ^ hash_integer(x ^ (u64{1} << (i % 64)))));
+        }
+
+        const f32 averageFlipped = f32(flippedBits) / samples;
+        ASSERT_GT(averageFlipped, 28.f);
+        ASSERT_LT(averageFlipped, 36.f);
+    }
+
+    TEST(hash, uuid)
+    {
+        constexpr uuid a = "fc0a3b9c-6d45-4b74-b4c5-1b2a0b3cfa11"_uuid;
+        constexpr uuid b = "fc0a3b9c-6d45-4b74-b4c5-1b2a0b3cfa12"_uuid;
+
+        static_assert(hash<uuid>{}(a) != hash<uuid>{}(b));
+        ASSERT_NE(hash<uuid>{}(uuid{}), hash<uuid>{}(a));
+    }
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/thread/mpmc_ring_buffer.hpp>
+#include <oblo/core/unique_ptr.hpp>
+
+#include <thread>
+
+namespace oblo
+{
+    TEST(mpmc_ring_buffer, push_pop)
+    {
+        mpmc_ring_buffer<u32> q{4};
+        ASSERT_EQ(q.capacity(), 4u);
+
+        u32 value;
+        ASSERT_FALSE(q.try_pop(value));
+
+        for (u32 lap = 0; lap < 3; ++lap)
+        {
+            for (u32 i = 0; i < 4; ++i)
+            {
+                ASSERT_TRUE(q.try_push(i + lap));
+            }
+
+            ASSERT_FALSE(q.try_push(0u));
+            ASSERT_EQ(q.size(), 4u);
+
+            for (u32 i = 0; i < 4; ++i)
+            {
+                ASSERT_TRUE(q.try_pop(value));
+                ASSERT_EQ(value, i + lap);
+            }
+
+            ASSERT_FALSE(q.try_pop(value));
+        }
+    }
+
+    TEST(mpmc_ring_buffer, batch)
+    {
+        mpmc_ring_buffer<u32> q{8};
+
+        const u32 values[] = {0, 1, 2, 3, 4, 5};
+        ASSERT_EQ(q.try_push_batch(values), 6u);
+        ASSERT_EQ(q.try_push_batch(values), 2u);
+        ASSERT_EQ(q.try_push_batch(values), 0u);
+
+        u32 out[4];
+        ASSERT_EQ(q.try_pop_batch(out), 4u);
+        ASSERT_EQ(out[0], 0u);
+        ASSERT_EQ(out[3], 3u);
+
+        ASSERT_EQ(q.try_push_batch(values), 4u);
+
+        const u32 expected[] = {4, 5, 0, 1, 0, 1, 2, 3};
+
+        for (u32 e : expected)
+        {
+            ASSERT_EQ(q.pop(), e);
+        }
+
+        ASSERT_EQ(q.try_pop_batch(out), 0u);
+    }
+
+    TEST(mpmc_ring_buffer, non_trivial)
+    {
+        mpmc_ring_buffer<unique_ptr<u32>> q{4};
+
+        ASSERT_TRUE(q.try_push(allocate_unique<u32>(42u)));
+        ASSERT_TRUE(q.try_push(allocate_unique<u32>(43u)));
+
+        unique_ptr<u32> out;
+        ASSERT_TRUE(q.try_pop(out));
+        ASSERT_EQ(*out, 42u);
+    }
+
+    TEST(mpmc_ring_buffer, threads)
+    {
+        constexpr u32 ProducersCount = 4;
+        constexpr u32 ConsumersCount = 4;
+        constexpr u32 ValuesPerProducer = 1u << 14;
+
+        mpmc_ring_buffer<u32> q{128};
+
+        dynamic_array<std::thread> threads;
+        threads.reserve(ProducersCount + ConsumersCount);
+
+        // Each consumer counts how many times it saw each value
+        dynamic_array<dynamic_array<u8>> seen;
+        seen.resize(ConsumersCount);
+
+        std::atomic<u32> consumed{};
+
+        for (u32 p = 0; p < ProducersCount; ++p)
+        {
+            threads.emplace_back(
+                [&q, p]
+                {
+                    const u32 first = p * ValuesPerProducer;
+                    u32 batch[3];
+
+                    for (u32 i = 0; i < ValuesPerProducer;)
+                    {
+                        if (p % 2 == 0 && i + 3 <= ValuesPerProducer)
+                        {
+                            batch[0] = first + i;
+                            batch[1] = first + i + 1;
+                            batch[2] = first + i + 2;
+
+                            q.push_batch(batch);
+                            i += 3;
+                        }
+                        else
+                        {
+                            q.push(first + i);
+                            ++i;
+                        }
+                    }
+                });
+        }
+
+        for (u32 c = 0; c < ConsumersCount; ++c)
+        {
+            seen[c].resize(ProducersCount * ValuesPerProducer);
+
+            threads.emplace_back(
+                [&q, &consumed, &counts = seen[c], c]
+                {
+                    constexpr u32 Total = ProducersCount * ValuesPerProducer;
+                    u32 batch[4];
+
+                    for (spin_wait sw; consumed.load() < Total;)
+                    {
+                        usize count;
+
+                        if (c % 2 == 0)
+                        {
+                            count = q.try_pop_batch(batch);
+                        }
+                        else
+                        {
+                            count = q.try_pop(batch[0]) ? 1 : 0;
+                        }
+
+                        if (count == 0)
+                        {
+                            sw.wait();
+                        }
+
+                        for (usize i = 0; i < count; ++i)
+                        {
+                            ++counts[batch[i]];
+                        }
+
+                        consumed += u32(count);
+                    }
+                });
+        }
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        ASSERT_TRUE(q.empty());
+
+        for (u32 i = 0; i < ProducersCount * ValuesPerProducer; ++i)
+        {
+            u32 total = 0;
+
+            for (const auto& counts : seen)
+            {
+                total += counts[i];
+            }
+
+            ASSERT_EQ(total, 1u);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/thread/spsc_ring_buffer.hpp>
+#include <oblo/core/unique_ptr.hpp>
+
+#include <thread>
+
+namespace oblo
+{
+    TEST(spsc_ring_buffer, push_pop)
+    {
+        spsc_ring_buffer<u32> q{5};
+        ASSERT_EQ(q.capacity(), 8u);
+        ASSERT_TRUE(q.empty());
+
+        u32 value;
+        ASSERT_FALSE(q.try_pop(value));
+
+        for (u32 i = 0; i < 8; ++i)
+        {
+            ASSERT_TRUE(q.try_push(i));
+        }
+
+        ASSERT_FALSE(q.try_push(8u));
+        ASSERT_EQ(q.size(), 8u);
+
+        for (u32 i = 0; i < 8; ++i)
+        {
+            ASSERT_TRUE(q.try_pop(value));
+            ASSERT_EQ(value, i);
+        }
+
+        ASSERT_FALSE(q.try_pop(value));
+        ASSERT_TRUE(q.empty());
+    }
+
+    TEST(spsc_ring_buffer, batch)
+    {
+        spsc_ring_buffer<u32> q{8};
+
+        const u32 values[] = {0, 1, 2, 3, 4, 5};
+        ASSERT_EQ(q.try_push_batch(values), 6u);
+        ASSERT_EQ(q.try_push_batch(values), 2u);
+
+        u32 out[4];
+        ASSERT_EQ(q.try_pop_batch(out), 4u);
+        ASSERT_EQ(out[0], 0u);
+        ASSERT_EQ(out[3], 3u);
+
+        // Wraps around the end of the buffer
+        ASSERT_EQ(q.try_push_batch(values), 4u);
+
+        const u32 expected[] = {4, 5, 0, 1, 0, 1, 2, 3};
+
+        for (u32 e : expected)
+        {
+            ASSERT_EQ(q.pop(), e);
+        }
+
+        ASSERT_EQ(q.try_pop_batch(out), 0u);
+    }
+
+    TEST(spsc_ring_buffer, non_trivial)
+    {
+        spsc_ring_buffer<unique_ptr<u32>> q{4};
+
+        ASSERT_TRUE(q.try_push(allocate_unique<u32>(42u)));
+        ASSERT_TRUE(q.try_push(allocate_unique<u32>(43u)));
+
+        unique_ptr<u32> out;
+        ASSERT_TRUE(q.try_pop(out));
+        ASSERT_EQ(*out, 42u);
+
+        // The remaining element is destroyed by the queue
+    }
+
+    TEST(spsc_ring_buffer, threads)
+    {
+        constexpr u32 N = 1u << 16;
+
+        spsc_ring_buffer<u32> q{64};
+
+        std::thread producer{[&q]
+            {
+                u32 batch[7];
+
+                for (u32 i = 0; i < N;)
+                {
+                    if (i % 3 == 0 && i + 7 <= N)
+                    {
+                        for (u32 j = 0; j < 7; ++j)
+                        {
+                            batch[j] = i + j;
+                        }
+
+                        q.push_batch(batch);
+                        i += 7;
+                    }
+                    else
+                    {
+                        q.push(i);
+                        ++i;
+                    }
+                }
+            }};
+
+        u32 expected = 0;
+        u32 batch[5];
+
+        for (spin_wait sw; expected < N;)
+        {
+            const usize count = q.try_pop_batch(batch);
+
+            if (count == 0)
+            {
+                sw.wait();
+            }
+
+            for (usize i = 0; i < count; ++i)
+            {
+                ASSERT_EQ(batch[i], expected);
+                ++expected;
+            }
+        }
+
+        producer.join();
+
+        ASSERT_TRUE(q.empty());
+    }
+}
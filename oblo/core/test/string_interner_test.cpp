@@ -1,11 +1,15 @@
 #include <gtest/gtest.h>
 
+#include <oblo/core/debug.hpp>
 #include <oblo/core/string/cstring_view.hpp>
 #include <oblo/core/string/hashed_string_view.hpp>
 #include <oblo/core/string/string_interner.hpp>
 #include <oblo/core/unordered_map.hpp>
 
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace oblo
 {
@@ -14,6 +18,9 @@ namespace oblo
         string_interner interner;
         interner.init(32);
 
+        // The reserved invalid handle is not counted
+        ASSERT_EQ(interner.size(), 0u);
+
         ASSERT_FALSE(interner.get("A"_hsv));
         ASSERT_FALSE(interner.get("B"_hsv));
         ASSERT_FALSE(interner.get("C"_hsv));
@@ -30,6 +37,10 @@ namespace oblo
         ASSERT_NE(a, c);
         ASSERT_NE(b, c);
 
+        ASSERT_EQ(interner.size(), 3u);
+        ASSERT_EQ(a, interner.get_or_add("A"_hsv));
+        ASSERT_EQ(interner.size(), 3u);
+
         ASSERT_EQ(a, interner.get("A"_hsv));
         ASSERT_EQ(b, interner.get("B"_hsv));
         ASSERT_EQ(c, interner.get("C"_hsv));
@@ -43,6 +54,35 @@ namespace oblo
         ASSERT_EQ(interner.c_str(c), string_view{"C"});
     }
 
+    TEST(string_interner, last_handle)
+    {
+        string_interner interner;
+        interner.init(32);
+
+        interner.get_or_add("A"_hsv);
+        const auto last = interner.get_or_add("B"_hsv);
+
+        // Handles start at 1, so the newest one is equal to the size and has to pass the range check
+        ASSERT_EQ(last.value, interner.size());
+
+        testing::internal::CaptureStderr();
+
+        const cstring_view str = interner.str(last);
+        const hashed_string_view hashed = interner.h_str(last);
+        const char* const cStr = interner.c_str(last);
+
+        const std::string asserts = testing::internal::GetCapturedStderr();
+
+        ASSERT_EQ(str, "B");
+        ASSERT_EQ(hashed, "B"_hsv);
+        ASSERT_EQ(cStr, string_view{"B"});
+
+        if constexpr (assert_enabled)
+        {
+            ASSERT_EQ(asserts, "");
+        }
+    }
+
     TEST(string_interner, random)
     {
         string_interner interner;
@@ -93,4 +133,117 @@ namespace oblo
             }
         }
     }
-}
\ No newline at end of file
+
+    TEST(string_interner, long_strings)
+    {
+        string_interner interner;
+        interner.init(32);
+
+        const std::string longString(string_interner::MaxStringLength * 8 + 3, 'x');
+        const std::string otherLongString(string_interner::MaxStringLength + 1, 'y');
+
+        const auto a = interner.get_or_add(string_view{longString});
+        const auto b = interner.get_or_add(string_view{otherLongString});
+        const auto c = interner.get_or_add("C"_hsv);
+
+        ASSERT_TRUE(a);
+        ASSERT_TRUE(b);
+        ASSERT_NE(a, b);
+
+        ASSERT_EQ(a, interner.get(string_view{longString}));
+        ASSERT_EQ(b, interner.get(string_view{otherLongString}));
+
+        ASSERT_EQ(interner.str(a), string_view{longString});
+        ASSERT_EQ(interner.str(b), string_view{otherLongString});
+        ASSERT_EQ(interner.str(c), "C");
+    }
+
+    TEST(string_interner, bulk)
+    {
+        string_interner interner;
+        interner.init(1024);
+
+        std::vector<std::string> storage;
+
+        for (u32 i = 0; i < 1024; ++i)
+        {
+            storage.push_back(std::to_string(i % 700));
+        }
+
+        const auto single = interner.get_or_add("42"_hsv);
+
+        std::vector<string_view> strings{storage.begin(), storage.end()};
+        std::vector<h32<string>> handles(strings.size());
+
+        interner.get_or_add(strings, handles);
+
+        // Strings 0..699, "42" is among them
+        ASSERT_EQ(interner.size(), 700u);
+
+        for (u32 i = 0; i < strings.size(); ++i)
+        {
+            ASSERT_TRUE(handles[i]);
+            ASSERT_EQ(interner.str(handles[i]), strings[i]);
+            ASSERT_EQ(handles[i], handles[i % 700]);
+        }
+
+        ASSERT_EQ(handles[42], single);
+    }
+
+    TEST(string_interner, concurrent)
+    {
+        string_interner interner;
+        interner.init(32);
+
+        constexpr u32 threadsCount{8};
+        constexpr u32 stringsCount{1u << 13};
+
+        std::vector<std::string> storage;
+        storage.reserve(stringsCount);
+
+        for (u32 i = 0; i < stringsCount; ++i)
+        {
+            storage.push_back(std::to_string(i * 7919u));
+        }
+
+        std::vector<std::vector<h32<string>>> handles(threadsCount);
+        std::vector<std::thread> threads;
+
+        for (u32 t = 0; t < threadsCount; ++t)
+        {
+            threads.emplace_back(
+                [&, t]
+                {
+                    auto& out = handles[t];
+                    out.resize(stringsCount);
+
+                    // Each thread walks the strings with a different stride to maximize contention on insertion
+                    for (u32 i = 0; i < stringsCount; ++i)
+                    {
+                        const u32 index = (i * (2 * t + 1)) % stringsCount;
+                        out[index] = interner.get_or_add(string_view{storage[index]});
+
+                        // Reading right after insertion should be safe as well
+                        EXPECT_EQ(interner.str(out[index]), string_view{storage[index]});
+                    }
+                });
+        }
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        ASSERT_EQ(interner.size(), stringsCount);
+
+        for (u32 i = 0; i < stringsCount; ++i)
+        {
+            for (u32 t = 1; t < threadsCount; ++t)
+            {
+                ASSERT_EQ(handles[0][i], handles[t][i]);
+            }
+
+            ASSERT_EQ(interner.str(handles[0][i]), string_view{storage[i]});
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/string/string_builder.hpp>
+#include <oblo/trace/trace_recorder.hpp>
+
+#include <thread>
+
+namespace oblo
+{
+    namespace
+    {
+        usize count_occurrences(string_view str, string_view pattern)
+        {
+            usize count = 0;
+
+            for (auto pos = str.find(pattern); pos != string_view::npos; pos = str.find(pattern, pos + 1))
+            {
+                ++count;
+            }
+
+            return count;
+        }
+
+        void record_nested_scopes(u32 count)
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                const trace::scope outer{"outer"};
+                outer.tag("a tag that is long enough to be split in multiple chunks");
+
+                const trace::scope inner{"inner \"quoted\""};
+            }
+        }
+    }
+
+    TEST(trace_recorder, record_and_export)
+    {
+        trace::clear_recording();
+
+        {
+            // Nothing is recorded while disabled
+            const trace::scope s{"disabled"};
+        }
+
+        trace::set_recording_enabled(true);
+        ASSERT_TRUE(trace::is_recording_enabled());
+
+        record_nested_scopes(4);
+        trace::mark_frame();
+
+        std::thread t{[]
+            {
+                trace::set_thread_name("test thread");
+                record_nested_scopes(2);
+            }};
+
+        t.join();
+
+        trace::set_recording_enabled(false);
+
+        {
+            const trace::scope s{"disabled"};
+            trace::mark_frame();
+        }
+
+        string_builder out;
+        trace::write_chrome_trace(out);
+
+        const string_view json = out.view();
+
+        ASSERT_TRUE(json.starts_with(R"({"displayTimeUnit":"ns","traceEvents":[)"));
+        ASSERT_TRUE(json.ends_with("]}\n"));
+
+        ASSERT_EQ(count_occurrences(json, "disabled"), 0);
+        ASSERT_EQ(count_occurrences(json, R"("name":"outer")"), 6);
+        ASSERT_EQ(count_occurrences(json, R"("name":"inner \"quoted\"")"), 6);
+        ASSERT_EQ(count_occurrences(json, R"("ph":"B")"), 12);
+        ASSERT_EQ(count_occurrences(json, R"("ph":"E")"), 12);
+        ASSERT_EQ(count_occurrences(json, R"("name":"Frame")"), 1);
+        ASSERT_EQ(count_occurrences(json, R"("test thread")"), 1);
+        ASSERT_EQ(count_occurrences(json, R"("tag":"a tag that is long enough to be split in multiple chunks")"), 6);
+
+        trace::clear_recording();
+
+        out.clear();
+        trace::write_chrome_trace(out);
+
+        ASSERT_EQ(count_occurrences(out.view(), R"("ph":"B")"), 0);
+    }
+
+    TEST(trace_recorder, tags_after_nested_zones)
+    {
+        trace::clear_recording();
+        trace::set_recording_enabled(true);
+
+        {
+            const trace::scope outer{"outer"};
+            outer.tag("first");
+
+            {
+                const trace::scope inner{"inner"};
+            }
+
+            // Belongs to the outer zone, which is the innermost one still open
+            outer.tag("second");
+        }
+
+        // There's no zone left to attach it to
+        trace::tag("orphan");
+
+        trace::set_recording_enabled(false);
+
+        string_builder out;
+        trace::write_chrome_trace(out);
+
+        const string_view json = out.view();
+
+        // The end event carries all the tags of the zone, since its arguments are merged with the begin ones
+        ASSERT_EQ(count_occurrences(json, R"("tag":"first"})"), 1);
+        ASSERT_EQ(count_occurrences(json, R"("tag":"first\u000asecond"})"), 1);
+        ASSERT_EQ(count_occurrences(json, R"("ph":"E")"), 2);
+        ASSERT_EQ(count_occurrences(json, "orphan"), 0);
+
+        trace::clear_recording();
+    }
+
+    TEST(trace_recorder, reuse_thread_buffers)
+    {
+        trace::clear_recording();
+        trace::set_recording_enabled(true);
+
+        const auto recordOnThread = []
+        {
+            std::thread t{[] { record_nested_scopes(1); }};
+            t.join();
+        };
+
+        recordOnThread();
+
+        string_builder out;
+        trace::write_chrome_trace(out);
+
+        const usize threadsCount = count_occurrences(out.view(), R"("name":"thread_name")");
+
+        // Threads that exited give their buffer back, so new ones don't need to create one
+        for (u32 i = 0; i < 4; ++i)
+        {
+            recordOnThread();
+        }
+
+        trace::set_recording_enabled(false);
+
+        out.clear();
+        trace::write_chrome_trace(out);
+
+        const string_view json = out.view();
+
+        ASSERT_EQ(count_occurrences(json, R"("name":"thread_name")"), threadsCount);
+
+        // The events recorded by the previous owners are still there
+        ASSERT_EQ(count_occurrences(json, R"("name":"outer")"), 5);
+
+        trace::clear_recording();
+    }
+
+    TEST(trace_recorder, overwrite_oldest)
+    {
+        trace::clear_recording();
+        trace::set_recording_enabled(true);
+
+        // Only affects the thread we are about to create
+        trace::set_events_per_thread(64);
+
+        std::thread t{[] { record_nested_scopes(1000); }};
+        t.join();
+
+        trace::set_events_per_thread(1u << 16);
+        trace::set_recording_enabled(false);
+
+        string_builder out;
+        trace::write_chrome_trace(out);
+
+        const string_view json = out.view();
+
+        const usize begins = count_occurrences(json, R"("ph":"B")");
+        const usize ends = count_occurrences(json, R"("ph":"E")");
+
+        // Each iteration takes 7 events: 2 begin, 2 end and 3 tag chunks, the oldest ones are dropped
+        ASSERT_GT(begins, 0);
+        ASSERT_LE(begins, 64 / 2);
+        ASSERT_EQ(begins, ends);
+
+        trace::clear_recording();
+    }
+}
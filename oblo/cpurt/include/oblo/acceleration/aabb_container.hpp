@@ -36,6 +36,9 @@ namespace oblo
 
         void add(std::span<const aabb> aabbs, u32 startingId);
 
+        /// @brief Replaces the box at the given index, e.g. to refit a tree built on the container after it moved.
+        void set_aabb(u32 index, const aabb& aabb);
+
         aabb primitives_bounds(u32 begin, u32 end) const;
         aabb centroids_bounds(u32 begin, u32 end) const;
 
@@ -1,19 +1,49 @@
 #pragma once
 
+#include <oblo/acceleration/ray_packet.hpp>
 #include <oblo/core/debug.hpp>
-#include <oblo/core/deque.hpp>
+#include <oblo/core/dynamic_array.hpp>
 #include <oblo/core/types.hpp>
 #include <oblo/math/aabb.hpp>
 #include <oblo/math/ray_intersection.hpp>
+#include <oblo/thread/job_manager.hpp>
+#include <oblo/thread/parallel_for.hpp>
 
+#include <bit>
 #include <concepts>
 #include <limits>
-#include <numeric>
+#include <span>
 
 namespace oblo
 {
+    template <u32 Width>
+    class wide_bvh;
+
+    class quantized_bvh;
+    struct bvh_serializer;
+
+    /// @brief Binary BVH, stored as a depth-first linearized array of nodes.
+    /// The first child of an internal node is the node right after it, the second child is referenced by index.
     class bvh
     {
+    public:
+        /// @brief The maximum depth of the tree, nodes at this depth are turned into leaves.
+        /// It bounds the size of the stack used for traversal.
+        static constexpr u32 MaxDepth{64};
+
+        /// @brief Nodes with at most this many primitives become leaves.
+        static constexpr u32 MaxLeafPrimitives{4};
+
+        /// @brief The number of bins used on each axis to evaluate the SAH cost of the candidate splits.
+        static constexpr u32 BinsCount{16};
+
+        /// @brief In parallel builds, nodes with at least this many primitives build their first subtree in a job.
+        static constexpr u32 ParallelSubtreeThreshold{1u << 12};
+
+        /// @brief In parallel builds, nodes with at least this many primitives compute bounds and bins in chunks.
+        static constexpr u32 ParallelBinningThreshold{1u << 16};
+        static constexpr u32 ParallelBinningGranularity{1u << 14};
+
     public:
         bvh() = default;
         bvh(bvh&&) noexcept = default;
@@ -21,286 +51,839 @@ namespace oblo
 
         ~bvh() = default;
 
+        /// @brief Builds the tree on the calling thread.
         template <typename PrimitiveContainer>
         void build(PrimitiveContainer& primitives)
         {
-            OBLO_ASSERT(primitives.size() <= ~u32{});
-            clear();
-
-            if (primitives.empty())
-            {
-                return;
-            }
-
-            m_root = &m_nodes.emplace_back();
+            build_impl(primitives, nullptr);
+        }
 
-            const auto size = narrow_cast<u32>(primitives.size());
-            build_impl_sah(*m_root, primitives, 0, size);
+        /// @brief Builds the tree running large subtrees and the binning of large nodes as jobs on the job manager of
+        /// the calling thread. It produces the same tree as build, which is used outside of job manager threads.
+        template <typename PrimitiveContainer>
+        void build_parallel(PrimitiveContainer& primitives)
+        {
+            build_impl(primitives, job_manager::get());
         }
 
         bool empty() const
         {
-            return m_root == nullptr;
+            return m_nodes.empty();
         }
 
         void clear()
         {
             m_nodes.clear();
-            m_root = {};
+        }
+
+        u32 get_nodes_count() const
+        {
+            return m_nodes.size32();
+        }
+
+        /// @brief The size of the nodes in bytes.
+        usize get_memory_footprint() const
+        {
+            return m_nodes.size() * sizeof(bvh_node);
         }
 
         template <typename F>
         void visit(F&& visitor) const
             requires std::invocable<F, u32, aabb, u32, u32>
         {
-            if (m_root)
+            if (!m_nodes.empty())
             {
-                visit_impl(*m_root, visitor);
+                visit_impl(0, visitor);
             }
         }
 
         template <typename F>
         void traverse(const ray& ray, F&& f) const
         {
-            deque<const bvh_node*> nodesStack;
-            nodesStack.emplace_back(m_root);
+            if (m_nodes.empty())
+            {
+                return;
+            }
+
+            const vec3 invDirection{1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z};
+            const bool directionIsNegative[3] = {invDirection.x < 0.f, invDirection.y < 0.f, invDirection.z < 0.f};
+
+            u32 stack[MaxDepth];
+            u32 stackSize{0};
+            u32 current{0};
 
             f32 distance = std::numeric_limits<f32>::max();
 
-            while (!nodesStack.empty())
+            while (true)
             {
-                const bvh_node* const node = nodesStack.back();
-                nodesStack.pop_back();
+                const bvh_node& node = m_nodes[current];
 
-                if (float t0, t1; !oblo::intersect(ray, node->bounds, distance, t0, t1))
+                if (intersect_node(ray.origin, invDirection, node.bounds, distance))
                 {
-                    continue;
+                    if (node.numPrimitives > 0)
+                    {
+                        f(node.offset, node.numPrimitives, distance);
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < MaxDepth);
+
+                        // Visit the child closest to the ray origin first, so the distance shrinks early
+                        if (directionIsNegative[node.splitAxis])
+                        {
+                            stack[stackSize++] = current + 1;
+                            current = node.offset;
+                        }
+                        else
+                        {
+                            stack[stackSize++] = node.offset;
+                            current = current + 1;
+                        }
+
+                        continue;
+                    }
+                }
+
+                if (stackSize == 0)
+                {
+                    break;
+                }
+
+                current = stack[--stackSize];
+            }
+        }
+
+        /// @brief Traverses the tree looking for any hit closer than maxDistance, as needed for occlusion queries.
+        /// Children are visited in a fixed order since the closest hit doesn't matter, and the traversal stops as soon
+        /// as the function, called on the leaves as (offset, numPrimitives), returns true.
+        /// @return Whether the function returned true on any leaf.
+        template <typename F>
+        bool traverse_any(const ray& ray, f32 maxDistance, F&& f) const
+            requires std::invocable<F, u32, u16>
+        {
+            if (m_nodes.empty())
+            {
+                return false;
+            }
+
+            const vec3 invDirection{1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z};
+
+            u32 stack[MaxDepth];
+            u32 stackSize{0};
+            u32 current{0};
+
+            while (true)
+            {
+                const bvh_node& node = m_nodes[current];
+
+                if (intersect_node(ray.origin, invDirection, node.bounds, maxDistance))
+                {
+                    if (node.numPrimitives > 0)
+                    {
+                        if (f(node.offset, node.numPrimitives))
+                        {
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < MaxDepth);
+                        stack[stackSize++] = node.offset;
+                        current = current + 1;
+                        continue;
+                    }
+                }
+
+                if (stackSize == 0)
+                {
+                    return false;
+                }
+
+                current = stack[--stackSize];
+            }
+        }
+
+        /// @brief Traverses the tree with a packet of rays, visiting the nodes hit by any of the active rays.
+        /// The function receives the leaves as (offset, numPrimitives, rayMask, distances), where rayMask are the
+        /// active rays that hit the leaf, and can shrink the distances of the rays that hit a primitive.
+        /// @remarks The children are visited in the order of the first active ray, so packets should be coherent.
+        template <typename F>
+        void traverse_packet(const ray_packet& packet, u32 activeMask, f32x8& distances, F&& f) const
+        {
+            if (m_nodes.empty() || activeMask == 0)
+            {
+                return;
+            }
+
+            const f32x8 origin[3] = {
+                f32x8::load(packet.origin[0]),
+                f32x8::load(packet.origin[1]),
+                f32x8::load(packet.origin[2]),
+            };
+
+            const f32x8 one = f32x8::broadcast(1.f);
+
+            const f32x8 invDirection[3] = {
+                one / f32x8::load(packet.direction[0]),
+                one / f32x8::load(packet.direction[1]),
+                one / f32x8::load(packet.direction[2]),
+            };
+
+            const u32 firstLane = u32(std::countr_zero(activeMask));
+
+            const bool directionIsNegative[3] = {
+                packet.direction[0][firstLane] < 0.f,
+                packet.direction[1][firstLane] < 0.f,
+                packet.direction[2][firstLane] < 0.f,
+            };
+
+            u32 stack[MaxDepth];
+            u32 stackSize{0};
+            u32 current{0};
+
+            while (true)
+            {
+                const bvh_node& node = m_nodes[current];
+
+                if (const u32 hitMask = intersect_packet(origin, invDirection, node.bounds, distances).movemask() &
+                        activeMask;
+                    hitMask != 0)
+                {
+                    if (node.numPrimitives > 0)
+                    {
+                        f(node.offset, node.numPrimitives, hitMask, distances);
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < MaxDepth);
+
+                        if (directionIsNegative[node.splitAxis])
+                        {
+                            stack[stackSize++] = current + 1;
+                            current = node.offset;
+                        }
+                        else
+                        {
+                            stack[stackSize++] = node.offset;
+                            current = current + 1;
+                        }
+
+                        continue;
+                    }
                 }
 
-                if (node->numPrimitives > 0)
+                if (stackSize == 0)
                 {
-                    OBLO_ASSERT(node->children[0] == nullptr);
-                    f(node->offset, node->numPrimitives, distance);
+                    break;
                 }
-                else if (node->children[0])
+
+                current = stack[--stackSize];
+            }
+        }
+
+        /// @brief Traverses the tree with a packet of rays looking for any hit closer than the distance of each ray, as
+        /// needed for occlusion queries on packets.
+        /// The function receives the leaves as (offset, numPrimitives, rayMask) and returns the mask of the rays that
+        /// hit a primitive, which are retired from the traversal. Children are visited in a fixed order since the
+        /// closest hit doesn't matter, and the traversal stops as soon as every active ray hit something.
+        /// @return The mask of the active rays that hit something.
+        template <typename F>
+        u32 traverse_packet_any(const ray_packet& packet, u32 activeMask, const f32x8& maxDistances, F&& f) const
+            requires std::invocable<F, u32, u16, u32>
+        {
+            if (m_nodes.empty() || activeMask == 0)
+            {
+                return 0;
+            }
+
+            const f32x8 origin[3] = {
+                f32x8::load(packet.origin[0]),
+                f32x8::load(packet.origin[1]),
+                f32x8::load(packet.origin[2]),
+            };
+
+            const f32x8 one = f32x8::broadcast(1.f);
+
+            const f32x8 invDirection[3] = {
+                one / f32x8::load(packet.direction[0]),
+                one / f32x8::load(packet.direction[1]),
+                one / f32x8::load(packet.direction[2]),
+            };
+
+            u32 stack[MaxDepth];
+            u32 stackSize{0};
+            u32 current{0};
+
+            u32 remainingMask = activeMask;
+
+            while (true)
+            {
+                const bvh_node& node = m_nodes[current];
+
+                if (const u32 hitMask = intersect_packet(origin, invDirection, node.bounds, maxDistances).movemask() &
+                        remainingMask;
+                    hitMask != 0)
                 {
-                    // TODO: Pick the closest child first
-                    nodesStack.emplace_back(node->children[0]);
-                    nodesStack.emplace_back(node->children[1]);
+                    if (node.numPrimitives > 0)
+                    {
+                        remainingMask &= ~f(node.offset, node.numPrimitives, hitMask);
+
+                        if (remainingMask == 0)
+                        {
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < MaxDepth);
+                        stack[stackSize++] = node.offset;
+                        current = current + 1;
+                        continue;
+                    }
                 }
+
+                if (stackSize == 0)
+                {
+                    break;
+                }
+
+                current = stack[--stackSize];
             }
+
+            return activeMask & ~remainingMask;
         }
 
         aabb get_bounds() const
         {
-            return m_root ? m_root->bounds : aabb::make_invalid();
+            return m_nodes.empty() ? aabb::make_invalid() : m_nodes[0].bounds;
+        }
+
+        /// @brief Updates the bounds of all nodes after the primitives moved, keeping the structure of the tree.
+        /// @remarks The primitives have to be in the same order as when the tree was built, only their bounds can
+        /// change. The quality of the tree degrades as primitives move away from where they were at build time, which
+        /// can be tracked with compute_sah_cost to decide when to rebuild.
+        template <typename PrimitiveContainer>
+        void refit(const PrimitiveContainer& primitives)
+        {
+            // Children are always stored after their parent, so a reverse pass updates the tree bottom-up
+            for (u32 nodeIndex = m_nodes.size32(); nodeIndex-- > 0;)
+            {
+                bvh_node& node = m_nodes[nodeIndex];
+
+                node.bounds = node.numPrimitives > 0
+                    ? primitives.primitives_bounds(node.offset, node.offset + node.numPrimitives)
+                    : extend(m_nodes[nodeIndex + 1].bounds, m_nodes[node.offset].bounds);
+            }
+        }
+
+        /// @brief Computes the SAH cost of the tree, i.e. the expected number of nodes visited and primitives tested by
+        /// a random ray hitting the root, with unit costs for both.
+        f32 compute_sah_cost() const
+        {
+            if (m_nodes.empty())
+            {
+                return 0.f;
+            }
+
+            const f32 rootSurface = half_surface(m_nodes[0].bounds);
+
+            if (!(rootSurface > 0.f))
+            {
+                return 1.f + m_nodes[0].numPrimitives;
+            }
+
+            f32 cost{0.f};
+
+            for (const bvh_node& node : m_nodes)
+            {
+                cost += half_surface(node.bounds) * (1.f + node.numPrimitives);
+            }
+
+            return cost / rootSurface;
         }
 
         template <typename F>
         void intersect_aabb(const aabb& query, F&& f) const
             requires std::invocable<F, u32, u32>
         {
-            deque<const bvh_node*> nodesStack;
-            nodesStack.emplace_back(m_root);
+            if (m_nodes.empty())
+            {
+                return;
+            }
 
-            while (!nodesStack.empty())
+            u32 stack[MaxDepth];
+            u32 stackSize{0};
+            u32 current{0};
+
+            while (true)
             {
-                const bvh_node* const node = nodesStack.back();
-                nodesStack.pop_back();
+                const bvh_node& node = m_nodes[current];
 
-                if (!oblo::overlap(query, node->bounds))
+                if (oblo::overlap(query, node.bounds))
                 {
-                    continue;
+                    if (node.numPrimitives > 0)
+                    {
+                        f(node.offset, node.numPrimitives);
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < MaxDepth);
+                        stack[stackSize++] = node.offset;
+                        current = current + 1;
+                        continue;
+                    }
                 }
 
-                if (node->numPrimitives > 0)
-                {
-                    f(node->offset, node->numPrimitives);
-                }
-                else if (node->children[0])
+                if (stackSize == 0)
                 {
-                    nodesStack.emplace_back(node->children[0]);
-                    nodesStack.emplace_back(node->children[1]);
+                    break;
                 }
+
+                current = stack[--stackSize];
             }
         }
 
     private:
+        template <u32 Width>
+        friend class wide_bvh;
+
+        friend class quantized_bvh;
+        friend struct bvh_serializer;
+
         struct bvh_node
         {
             aabb bounds;
-            bvh_node* children[2];
+            /// @brief For leaves it's the first primitive, for internal nodes the index of the second child.
             u32 offset;
+            /// @brief The number of primitives in a leaf, 0 for internal nodes.
             u16 numPrimitives;
-            i8 splitAxis;
+            u8 splitAxis;
+            u8 padding;
         };
 
+        static_assert(sizeof(bvh_node) == 32);
+
     private:
+        static bool intersect_node(const vec3& origin, const vec3& invDirection, const aabb& bounds, f32 maxDistance)
+        {
+            f32 t0 = 0.f;
+            f32 t1 = maxDistance;
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                f32 tNear = (bounds.min[axis] - origin[axis]) * invDirection[axis];
+                f32 tFar = (bounds.max[axis] - origin[axis]) * invDirection[axis];
+
+                if (tNear > tFar)
+                {
+                    std::swap(tNear, tFar);
+                }
+
+                t0 = max(t0, tNear);
+                t1 = min(t1, tFar);
+            }
+
+            return t0 <= t1;
+        }
+
+        template <typename PrimitiveContainer>
+        struct build_context
+        {
+            PrimitiveContainer& primitives;
+            bvh_node* nodes;
+            job_manager* jobManager;
+        };
+
+        struct bin
+        {
+            aabb bounds;
+            u32 count;
+        };
+
+        struct axis_bins
+        {
+            bin axes[3][BinsCount];
+        };
+
         template <typename PrimitiveContainer>
-        void build_impl(bvh_node& node, PrimitiveContainer& primitives, u32 begin, u32 end)
+        void build_impl(PrimitiveContainer& primitives, job_manager* jobManager)
         {
-            node.bounds = primitives.primitives_bounds(begin, end);
+            OBLO_ASSERT(primitives.size() <= ~u32{} / 2);
+            clear();
 
-            if (const auto numPrimitives = end - begin; numPrimitives <= 1)
+            if (primitives.empty())
             {
-                init_leaf(node, begin, numPrimitives);
+                return;
+            }
+
+            const auto size = narrow_cast<u32>(primitives.size());
+
+            // Each subtree with N primitives owns a range of 2N-1 nodes, which is the most it can need with at least
+            // one primitive per leaf. Subtrees can be built concurrently this way, the holes are removed at the end.
+            dynamic_array<bvh_node> sparseNodes;
+            sparseNodes.resize_default(2 * usize{size} - 1);
+
+            const build_context<PrimitiveContainer> ctx{primitives, sparseNodes.data(), jobManager};
+            const u32 nodesCount = build_node(ctx, 0, 0, size, 0);
+
+            compact(sparseNodes, nodesCount);
+        }
+
+        /// @brief Builds the subtree rooted at the given node of the sparse array.
+        /// @return The number of nodes in the subtree.
+        template <typename PrimitiveContainer>
+        static u32 build_node(
+            const build_context<PrimitiveContainer>& ctx, u32 nodeIndex, u32 begin, u32 end, u32 depth)
+        {
+            bvh_node& node = ctx.nodes[nodeIndex];
+
+            const u32 numPrimitives = end - begin;
+            const bool isLargeNode = ctx.jobManager && numPrimitives >= ParallelBinningThreshold;
+
+            aabb centroidsBounds;
+            compute_bounds(ctx.primitives, begin, end, isLargeNode, node.bounds, centroidsBounds);
+
+            if (numPrimitives <= MaxLeafPrimitives || depth + 1 >= MaxDepth)
+            {
+                init_leaf(node, begin, narrow_cast<u16>(numPrimitives));
+                return 1;
+            }
+
+            u8 splitAxis;
+            const u32 midIndex = find_split(ctx.primitives, begin, end, centroidsBounds, isLargeNode, splitAxis);
+            OBLO_ASSERT(midIndex > begin && midIndex < end);
+
+            // The first child is always the next node, the second one is placed after the range of the first subtree
+            const u32 firstChild = nodeIndex + 1;
+            const u32 secondChild = nodeIndex + 2 * (midIndex - begin);
+
+            node.offset = secondChild;
+            node.numPrimitives = 0;
+            node.splitAxis = splitAxis;
+
+            u32 firstCount, secondCount;
+
+            if (ctx.jobManager && numPrimitives >= ParallelSubtreeThreshold)
+            {
+                job_manager& jm = *ctx.jobManager;
+
+                const job_handle firstJob = jm.push_waitable(
+                    [&ctx, &firstCount, firstChild, begin, midIndex, depth]
+                    { firstCount = build_node(ctx, firstChild, begin, midIndex, depth + 1); });
+
+                secondCount = build_node(ctx, secondChild, midIndex, end, depth + 1);
+
+                jm.wait(firstJob);
             }
             else
             {
-                const auto centroidsBounds = primitives.centroids_bounds(begin, end);
-                const auto maxExtentAxis = max_extent(centroidsBounds);
+                firstCount = build_node(ctx, firstChild, begin, midIndex, depth + 1);
+                secondCount = build_node(ctx, secondChild, midIndex, end, depth + 1);
+            }
 
-                f32 midPoint = (centroidsBounds.min[maxExtentAxis] + centroidsBounds.max[maxExtentAxis]) / 2;
-                u32 midIndex = primitives.partition_by_axis(begin, end, maxExtentAxis, midPoint);
+            return 1 + firstCount + secondCount;
+        }
 
-                if (midIndex == begin || midIndex == end)
-                {
-                    // TODO: Could split using different heuristics
-                    init_leaf(node, begin, end - begin);
-                }
-                else
+        template <typename PrimitiveContainer>
+        static void compute_bounds(const PrimitiveContainer& primitives,
+            u32 begin,
+            u32 end,
+            bool parallel,
+            aabb& bounds,
+            aabb& centroidsBounds)
+        {
+            if (!parallel)
+            {
+                bounds = primitives.primitives_bounds(begin, end);
+                centroidsBounds = primitives.centroids_bounds(begin, end);
+                return;
+            }
+
+            struct chunk_bounds
+            {
+                aabb bounds;
+                aabb centroidsBounds;
+            };
+
+            dynamic_array<chunk_bounds> chunks;
+            chunks.resize_default((end - begin + ParallelBinningGranularity - 1) / ParallelBinningGranularity);
+
+            parallel_for(
+                [&](const job_range range)
                 {
-                    node.children[0] = &m_nodes.emplace_back();
-                    node.children[1] = &m_nodes.emplace_back();
-                    build_impl(*node.children[0], primitives, begin, midIndex);
-                    build_impl(*node.children[1], primitives, midIndex, end);
-                }
+                    auto& chunk = chunks[(range.begin - begin) / ParallelBinningGranularity];
+                    chunk.bounds = primitives.primitives_bounds(range.begin, range.end);
+                    chunk.centroidsBounds = primitives.centroids_bounds(range.begin, range.end);
+                },
+                job_range{begin, end},
+                ParallelBinningGranularity);
+
+            bounds = aabb::make_invalid();
+            centroidsBounds = aabb::make_invalid();
+
+            for (const auto& chunk : chunks)
+            {
+                bounds = extend(bounds, chunk.bounds);
+                centroidsBounds = extend(centroidsBounds, chunk.centroidsBounds);
             }
         }
 
+        /// @brief Partitions the primitives in two non-empty ranges, picking the split with the lowest SAH cost across
+        /// all axes. When binning can't separate the primitives, it falls back to a spatial median split, then to an
+        /// object median split.
+        /// @return The index of the first primitive of the second range.
         template <typename PrimitiveContainer>
-        void build_impl_sah(bvh_node& node, PrimitiveContainer& primitives, u32 begin, u32 end)
+        static u32 find_split(PrimitiveContainer& primitives,
+            u32 begin,
+            u32 end,
+            const aabb& centroidsBounds,
+            bool parallelBinning,
+            u8& splitAxis)
         {
-            node.bounds = primitives.primitives_bounds(begin, end);
+            const u8 maxExtentAxis = max_extent(centroidsBounds);
+            const vec3 extent = centroidsBounds.max - centroidsBounds.min;
 
-            if (const auto numPrimitives = end - begin; numPrimitives <= 4)
+            splitAxis = maxExtentAxis;
+
+            if (!(extent[maxExtentAxis] > 0.f))
             {
-                init_leaf(node, begin, narrow_cast<u16>(numPrimitives));
+                // All centroids are in the same spot, any partition is as good as another
+                return begin + (end - begin) / 2;
+            }
+
+            axis_bins bins;
+
+            if (!parallelBinning)
+            {
+                bin_primitives(primitives, begin, end, centroidsBounds, bins);
             }
             else
             {
-                const auto centroidsBounds = primitives.centroids_bounds(begin, end);
-                const auto maxExtentAxis = max_extent(centroidsBounds);
+                dynamic_array<axis_bins> chunks;
+                chunks.resize_default((end - begin + ParallelBinningGranularity - 1) / ParallelBinningGranularity);
+
+                parallel_for(
+                    [&](const job_range range)
+                    {
+                        auto& chunk = chunks[(range.begin - begin) / ParallelBinningGranularity];
+                        bin_primitives(primitives, range.begin, range.end, centroidsBounds, chunk);
+                    },
+                    job_range{begin, end},
+                    ParallelBinningGranularity);
+
+                init_bins(bins);
 
-                const auto centroids = primitives.get_centroids();
-                const auto bounds = primitives.get_aabbs();
+                for (const auto& chunk : chunks)
+                {
+                    for (u32 axis = 0; axis < 3; ++axis)
+                    {
+                        for (u32 i = 0; i < BinsCount; ++i)
+                        {
+                            bins.axes[axis][i].bounds = extend(bins.axes[axis][i].bounds, chunk.axes[axis][i].bounds);
+                            bins.axes[axis][i].count += chunk.axes[axis][i].count;
+                        }
+                    }
+                }
+            }
 
-                constexpr auto numBuckets = 16;
+            f32 bestCost = std::numeric_limits<f32>::infinity();
+            u32 bestAxis{0};
+            u32 bestBin{0};
 
-                struct bucket_data
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                if (!(extent[axis] > 0.f))
                 {
-                    u32 count;
-                    aabb bounds;
-                };
+                    continue;
+                }
+
+                const auto& axisBins = bins.axes[axis];
 
-                constexpr auto init_bucket_data = [] { return bucket_data{0, aabb::make_invalid()}; };
+                // Cost of the right side when splitting after the bin i, i.e. the sum over bins i+1 and later
+                f32 rightCosts[BinsCount - 1];
+                u32 rightCounts[BinsCount - 1];
 
-                bucket_data buckets[numBuckets];
+                aabb accumulatedBounds = aabb::make_invalid();
+                u32 accumulatedCount{0};
 
-                for (auto& bucket : buckets)
+                for (u32 i = BinsCount - 1; i > 0; --i)
                 {
-                    bucket = init_bucket_data();
+                    accumulatedBounds = extend(accumulatedBounds, axisBins[i].bounds);
+                    accumulatedCount += axisBins[i].count;
+
+                    rightCounts[i - 1] = accumulatedCount;
+                    rightCosts[i - 1] = accumulatedCount * half_surface(accumulatedBounds);
                 }
 
-                const auto maxDistance = centroidsBounds.max[maxExtentAxis] - centroidsBounds.min[maxExtentAxis];
-                OBLO_ASSERT(maxDistance > 0.f);
+                accumulatedBounds = aabb::make_invalid();
+                accumulatedCount = 0;
 
-                for (u32 primitiveIndex = begin; primitiveIndex < end; ++primitiveIndex)
+                for (u32 i = 0; i < BinsCount - 1; ++i)
                 {
-                    const auto distance = centroids[primitiveIndex][maxExtentAxis] - centroidsBounds.min[maxExtentAxis];
-                    const auto bucketIndex = min(narrow_cast<i32>(numBuckets * distance / maxDistance), numBuckets - 1);
+                    accumulatedBounds = extend(accumulatedBounds, axisBins[i].bounds);
+                    accumulatedCount += axisBins[i].count;
 
-                    auto& bucket = buckets[bucketIndex];
+                    if (accumulatedCount == 0 || rightCounts[i] == 0)
+                    {
+                        continue;
+                    }
 
-                    ++bucket.count;
-                    bucket.bounds = extend(bucket.bounds, bounds[primitiveIndex]);
+                    const f32 cost = accumulatedCount * half_surface(accumulatedBounds) + rightCosts[i];
+
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = i;
+                    }
                 }
+            }
 
-                bucket_data forwardScan[numBuckets];
-                bucket_data backwardScan[numBuckets];
+            if (bestCost < std::numeric_limits<f32>::infinity())
+            {
+                const auto axis = narrow_cast<u8>(bestAxis);
+                const f32 splitPoint = centroidsBounds.min[axis] + (bestBin + 1) * extent[axis] / BinsCount;
 
-                constexpr auto accumulate = [](const bucket_data& lhs, const bucket_data& rhs)
-                { return bucket_data{lhs.count + rhs.count, extend(lhs.bounds, rhs.bounds)}; };
+                if (const u32 midIndex = primitives.partition_by_axis(begin, end, axis, splitPoint);
+                    midIndex != begin && midIndex != end)
+                {
+                    splitAxis = axis;
+                    return midIndex;
+                }
+            }
 
-                std::inclusive_scan(std::begin(buckets),
-                    std::end(buckets),
-                    std::begin(forwardScan),
-                    accumulate,
-                    init_bucket_data());
+            // Binning failed to separate the primitives, split at the middle of the centroids instead
+            const f32 midPoint = (centroidsBounds.min[maxExtentAxis] + centroidsBounds.max[maxExtentAxis]) / 2;
 
-                std::exclusive_scan(std::rbegin(buckets),
-                    std::rend(buckets),
-                    std::rbegin(backwardScan),
-                    init_bucket_data(),
-                    accumulate);
+            if (const u32 midIndex = primitives.partition_by_axis(begin, end, maxExtentAxis, midPoint);
+                midIndex != begin && midIndex != end)
+            {
+                return midIndex;
+            }
 
-                constexpr auto cost = [](const bucket_data& a, const bucket_data& b)
-                {
-                    constexpr auto half_surface = [](const aabb& bounds)
-                    {
-                        const auto d = bounds.max - bounds.min;
-                        return d.x * d.y + d.x * d.z + d.y * d.z;
-                    };
+            // Only reachable when the extent is too small for the float precision, split the range in half
+            return begin + (end - begin) / 2;
+        }
 
-                    return a.count * half_surface(a.bounds) + b.count * half_surface(b.bounds);
-                };
+        template <typename PrimitiveContainer>
+        static void bin_primitives(
+            const PrimitiveContainer& primitives, u32 begin, u32 end, const aabb& centroidsBounds, axis_bins& bins)
+        {
+            init_bins(bins);
 
-                float minCost = cost(forwardScan[0], backwardScan[0]);
-                i32 bucketIndex = 0;
+            const auto centroids = primitives.get_centroids();
+            const auto bounds = primitives.get_aabbs();
 
-                // The last element actually makes no sense
-                for (i32 i = 1; i < numBuckets - 1; ++i)
+            const vec3 extent = centroidsBounds.max - centroidsBounds.min;
+
+            f32 scale[3];
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                scale[axis] = extent[axis] > 0.f ? BinsCount / extent[axis] : 0.f;
+            }
+
+            for (u32 primitiveIndex = begin; primitiveIndex < end; ++primitiveIndex)
+            {
+                const vec3 distance = centroids[primitiveIndex] - centroidsBounds.min;
+
+                for (u32 axis = 0; axis < 3; ++axis)
                 {
-                    const auto currentCost = cost(forwardScan[i], backwardScan[i]);
+                    const u32 binIndex = min(u32(distance[axis] * scale[axis]), BinsCount - 1);
 
-                    if (currentCost < minCost)
-                    {
-                        minCost = currentCost;
-                        bucketIndex = i;
-                    }
+                    auto& b = bins.axes[axis][binIndex];
+                    b.bounds = extend(b.bounds, bounds[primitiveIndex]);
+                    ++b.count;
                 }
+            }
+        }
 
-                const auto splitPoint = centroidsBounds.min[maxExtentAxis] + bucketIndex * maxDistance / numBuckets;
-                u32 midIndex = primitives.partition_by_axis(begin, end, maxExtentAxis, splitPoint);
+        static void init_bins(axis_bins& bins)
+        {
+            for (auto& axisBins : bins.axes)
+            {
+                for (auto& b : axisBins)
+                {
+                    b = {aabb::make_invalid(), 0};
+                }
+            }
+        }
 
-                if (midIndex == begin || midIndex == end)
+        static f32 half_surface(const aabb& bounds)
+        {
+            const auto d = bounds.max - bounds.min;
+            return d.x * d.y + d.x * d.z + d.y * d.z;
+        }
+
+        /// @brief Copies the nodes reachable from the root of the sparse array in depth-first order, patching the
+        /// indices of the second children.
+        void compact(std::span<const bvh_node> sparseNodes, u32 nodesCount)
+        {
+            struct pending_node
+            {
+                u32 sparseIndex;
+                u32 parent;
+            };
+
+            constexpr u32 noParent{~0u};
+
+            m_nodes.reserve(nodesCount);
+
+            pending_node stack[MaxDepth + 1];
+            u32 stackSize{0};
+
+            stack[stackSize++] = {0, noParent};
+
+            while (stackSize > 0)
+            {
+                const auto [sparseIndex, parent] = stack[--stackSize];
+                const u32 nodeIndex = m_nodes.size32();
+
+                if (parent != noParent)
                 {
-                    // TODO: Could split using different heuristics
-                    init_leaf(node, begin, narrow_cast<u16>(end - begin));
+                    m_nodes[parent].offset = nodeIndex;
                 }
-                else
+
+                const bvh_node& node = sparseNodes[sparseIndex];
+                m_nodes.push_back(node);
+
+                if (node.numPrimitives == 0)
                 {
-                    node.splitAxis = narrow_cast<i8>(maxExtentAxis);
-                    node.children[0] = &m_nodes.emplace_back();
-                    node.children[1] = &m_nodes.emplace_back();
-                    build_impl_sah(*node.children[0], primitives, begin, midIndex);
-                    build_impl_sah(*node.children[1], primitives, midIndex, end);
+                    OBLO_ASSERT(stackSize + 2 <= MaxDepth + 1);
+                    stack[stackSize++] = {node.offset, nodeIndex};
+                    stack[stackSize++] = {sparseIndex + 1, noParent};
                 }
             }
+
+            OBLO_ASSERT(m_nodes.size32() == nodesCount);
         }
 
-        void init_leaf(bvh_node& node, u32 offset, u16 numPrimitives) const
+        static void init_leaf(bvh_node& node, u32 offset, u16 numPrimitives)
         {
-            OBLO_ASSERT(!node.children[0]);
+            OBLO_ASSERT(numPrimitives > 0);
             node.offset = offset;
             node.numPrimitives = numPrimitives;
-            node.splitAxis = -1;
+            node.splitAxis = 0;
         }
 
         template <typename F>
-        void visit_impl(bvh_node& node, F&& visitor, u32 depth = 0) const
+        void visit_impl(u32 nodeIndex, F&& visitor, u32 depth = 0) const
         {
-            visitor(depth, node.bounds, node.offset, node.numPrimitives);
+            const bvh_node& node = m_nodes[nodeIndex];
 
-            if (node.children[0])
+            if (node.numPrimitives > 0)
+            {
+                visitor(depth, node.bounds, node.offset, u32{node.numPrimitives});
+            }
+            else
             {
-                visit_impl(*node.children[0], visitor, depth + 1);
-                visit_impl(*node.children[1], visitor, depth + 1);
+                visitor(depth, node.bounds, 0u, 0u);
+                visit_impl(nodeIndex + 1, visitor, depth + 1);
+                visit_impl(node.offset, visitor, depth + 1);
             }
         }
 
     private:
-        deque<bvh_node> m_nodes;
-        bvh_node* m_root{};
+        dynamic_array<bvh_node> m_nodes;
     };
-}
\ No newline at end of file
+}
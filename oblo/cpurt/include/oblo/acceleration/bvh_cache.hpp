@@ -0,0 +1,49 @@
+#pragma once
+
+#include <oblo/core/expected.hpp>
+#include <oblo/core/string/cstring_view.hpp>
+#include <oblo/core/types.hpp>
+
+#include <span>
+
+namespace oblo
+{
+    class bvh;
+    class string_builder;
+    class triangle_container;
+
+    struct triangle;
+
+    enum class bvh_cache_status : u8
+    {
+        /// @brief The BVH was loaded from the cache.
+        hit,
+        /// @brief The BVH was built and written to the cache.
+        miss,
+        /// @brief The BVH was built, but it could not be written to the cache.
+        write_failed,
+    };
+
+    /// @brief Hashes the triangles of a mesh, to identify the BVH built on them in the cache.
+    u64 hash_triangles(std::span<const triangle> triangles);
+
+    /// @brief Appends the path of the cache file for the mesh with the given hash to a directory.
+    void make_bvh_cache_path(string_builder& out, cstring_view directory, u64 meshHash);
+
+    /// @brief Writes a built BVH together with the triangles it was built on, in the order the build left them.
+    /// @remarks The file starts with a versioned header, followed by the nodes and the triangles as plain arrays
+    /// aligned to 32 bytes, so it can be memory mapped and loaded without any parsing.
+    /// @param meshHash The hash of the triangles before the build, as returned by hash_triangles.
+    expected<> save_bvh_cache(cstring_view path, u64 meshHash, const bvh& bvh, const triangle_container& triangles);
+
+    /// @brief Loads a BVH written by save_bvh_cache, replacing the content of the triangle container with the
+    /// triangles it was built on.
+    /// @remarks Fails when the file was written with a different version or for a mesh with a different hash, or when
+    /// the nodes don't form a valid tree. Only the build is skipped, the data derived from the triangles (e.g. bounds
+    /// and normals) is still computed when they are added to the container, which is linear in the triangles count.
+    expected<> load_bvh_cache(cstring_view path, u64 meshHash, bvh& bvh, triangle_container& triangles);
+
+    /// @brief Looks up the BVH of the triangles in a cache directory, e.g. the directory of the mesh artifact, and
+    /// builds it when it's missing or stale, storing the result for the next run.
+    bvh_cache_status load_or_build_bvh(cstring_view directory, triangle_container& triangles, bvh& bvh);
+}
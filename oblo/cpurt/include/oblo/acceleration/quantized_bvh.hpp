@@ -0,0 +1,681 @@
+#pragma once
+
+#include <oblo/acceleration/bvh.hpp>
+#include <oblo/acceleration/ray_packet.hpp>
+#include <oblo/core/debug.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/ray.hpp>
+
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <utility>
+
+namespace oblo
+{
+    /// @brief Compact binary BVH, compressed from a bvh to reduce the memory footprint and the cache misses during
+    /// traversal.
+    /// Each node holds both its children: their bounds are quantized on 8 bits in the space of the decoded bounds of
+    /// the node, and leaves are stored in their parent rather than in nodes of their own. A node takes 24 bytes, and a
+    /// tree has about half the nodes of the source, which are 32 bytes each.
+    /// @remarks Bounds are decoded on the fly during traversal, and always contain the source bounds. Since they are
+    /// looser, more nodes and leaves might be visited than with the source tree. The tree has to be built again when
+    /// the source is refit.
+    class quantized_bvh
+    {
+    public:
+        quantized_bvh() = default;
+        quantized_bvh(quantized_bvh&&) noexcept = default;
+        quantized_bvh& operator=(quantized_bvh&&) noexcept = default;
+
+        ~quantized_bvh() = default;
+
+        /// @brief Compresses a binary bvh, the primitive offsets in the leaves are the same as the source.
+        void build(const bvh& source)
+        {
+            clear();
+
+            if (source.empty())
+            {
+                return;
+            }
+
+            const auto& root = source.m_nodes[0];
+            m_bounds = root.bounds;
+
+            if (root.numPrimitives > 0)
+            {
+                m_root = {.child = root.offset, .numPrimitives = root.numPrimitives};
+                return;
+            }
+
+            // A binary tree with N leaves has N - 1 internal nodes
+            m_nodes.reserve(source.get_nodes_count() / 2);
+            m_nodes.emplace_back();
+
+            compress(source, 0, 0, m_bounds);
+        }
+
+        bool empty() const
+        {
+            return m_bounds.min.x > m_bounds.max.x;
+        }
+
+        void clear()
+        {
+            m_nodes.clear();
+            m_bounds = aabb::make_invalid();
+            m_root = {};
+        }
+
+        /// @brief The number of internal nodes, leaves are stored in their parents.
+        u32 get_nodes_count() const
+        {
+            return m_nodes.size32();
+        }
+
+        /// @brief The size of the nodes in bytes.
+        usize get_memory_footprint() const
+        {
+            return m_nodes.size() * sizeof(quantized_node);
+        }
+
+        aabb get_bounds() const
+        {
+            return m_bounds;
+        }
+
+        /// @brief Traverses the tree, calling the function on the leaves hit by the ray closer than the current
+        /// distance, visiting the closest child first.
+        /// @remarks The function has the same signature as the one passed to bvh::traverse, and can shrink the distance
+        /// when a primitive is hit.
+        template <typename F>
+        void traverse(const ray& ray, F&& f) const
+            requires std::invocable<F, u32, u16, f32&>
+        {
+            const vec3 invDirection{1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z};
+
+            f32 distance = std::numeric_limits<f32>::max();
+
+            if (f32 tNear; empty() || !intersect_node(ray.origin, invDirection, m_bounds, distance, tNear))
+            {
+                return;
+            }
+
+            if (m_root.numPrimitives > 0)
+            {
+                f(m_root.child, m_root.numPrimitives, distance);
+                return;
+            }
+
+            stack_entry stack[StackSize];
+            u32 stackSize{0};
+
+            node_entry current{m_bounds, m_root.child};
+
+            while (true)
+            {
+                const quantized_node& node = m_nodes[current.node];
+                const vec3 step = get_step_size(current.bounds);
+
+                aabb childBounds[2];
+                f32 tNear[2];
+                bool isHit[2];
+
+                for (u32 i = 0; i < 2; ++i)
+                {
+                    childBounds[i] = decode(current.bounds, step, node.bounds[i]);
+                    isHit[i] = intersect_node(ray.origin, invDirection, childBounds[i], distance, tNear[i]);
+                }
+
+                // Leaves are visited right away and the closest internal child is next, the others are pushed on the
+                // stack to be popped in order of distance
+                const u32 first = u32{isHit[0] && isHit[1] && tNear[1] < tNear[0]};
+                bool hasNext{false};
+
+                for (u32 k = 0; k < 2; ++k)
+                {
+                    const u32 i = first ^ k;
+
+                    if (!isHit[i] || tNear[i] > distance)
+                    {
+                        continue;
+                    }
+
+                    if (node.numPrimitives[i] > 0 && !hasNext)
+                    {
+                        f(node.children[i], node.numPrimitives[i], distance);
+                    }
+                    else if (!hasNext)
+                    {
+                        current = {childBounds[i], node.children[i]};
+                        hasNext = true;
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < StackSize);
+                        stack[stackSize++] = {childBounds[i], node.children[i], node.numPrimitives[i], tNear[i]};
+                    }
+                }
+
+                while (!hasNext && stackSize > 0)
+                {
+                    const stack_entry& entry = stack[--stackSize];
+
+                    if (entry.distance > distance)
+                    {
+                        continue;
+                    }
+
+                    if (entry.numPrimitives > 0)
+                    {
+                        f(entry.child, entry.numPrimitives, distance);
+                    }
+                    else
+                    {
+                        current = {entry.bounds, entry.child};
+                        hasNext = true;
+                    }
+                }
+
+                if (!hasNext)
+                {
+                    break;
+                }
+            }
+        }
+
+        /// @brief Traverses the tree looking for any hit closer than maxDistance, as needed for occlusion queries.
+        /// @remarks The function has the same signature as the one passed to bvh::traverse_any.
+        /// @return Whether the function returned true on any leaf.
+        template <typename F>
+        bool traverse_any(const ray& ray, f32 maxDistance, F&& f) const
+            requires std::invocable<F, u32, u16>
+        {
+            const vec3 invDirection{1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z};
+
+            if (f32 tNear; empty() || !intersect_node(ray.origin, invDirection, m_bounds, maxDistance, tNear))
+            {
+                return false;
+            }
+
+            if (m_root.numPrimitives > 0)
+            {
+                return f(m_root.child, m_root.numPrimitives);
+            }
+
+            node_entry stack[StackSize];
+            u32 stackSize{0};
+
+            stack[stackSize++] = {m_bounds, m_root.child};
+
+            while (stackSize > 0)
+            {
+                const node_entry entry = stack[--stackSize];
+                const quantized_node& node = m_nodes[entry.node];
+                const vec3 step = get_step_size(entry.bounds);
+
+                for (u32 i = 0; i < 2; ++i)
+                {
+                    const aabb childBounds = decode(entry.bounds, step, node.bounds[i]);
+
+                    if (f32 tNear; !intersect_node(ray.origin, invDirection, childBounds, maxDistance, tNear))
+                    {
+                        continue;
+                    }
+
+                    if (node.numPrimitives[i] > 0)
+                    {
+                        if (f(node.children[i], node.numPrimitives[i]))
+                        {
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < StackSize);
+                        stack[stackSize++] = {childBounds, node.children[i]};
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        /// @brief Traverses the tree with a packet of rays, calling the function on the leaves hit by any of the active
+        /// rays closer than their current distance.
+        /// @remarks The function has the same signature as the one passed to bvh::traverse_packet. Since nodes don't
+        /// store a split axis, children are ordered by the distance of their centers along the first active ray, so
+        /// packets should be coherent.
+        template <typename F>
+        void traverse_packet(const ray_packet& packet, u32 activeMask, f32x8& distances, F&& f) const
+            requires std::invocable<F, u32, u16, u32, f32x8&>
+        {
+            if (empty() || activeMask == 0)
+            {
+                return;
+            }
+
+            const f32x8 origin[3] = {
+                f32x8::load(packet.origin[0]),
+                f32x8::load(packet.origin[1]),
+                f32x8::load(packet.origin[2]),
+            };
+
+            const f32x8 one = f32x8::broadcast(1.f);
+
+            const f32x8 invDirection[3] = {
+                one / f32x8::load(packet.direction[0]),
+                one / f32x8::load(packet.direction[1]),
+                one / f32x8::load(packet.direction[2]),
+            };
+
+            const u32 rootMask = intersect_packet(origin, invDirection, m_bounds, distances).movemask() & activeMask;
+
+            if (rootMask == 0)
+            {
+                return;
+            }
+
+            if (m_root.numPrimitives > 0)
+            {
+                f(m_root.child, m_root.numPrimitives, rootMask, distances);
+                return;
+            }
+
+            const u32 firstLane = u32(std::countr_zero(activeMask));
+
+            const vec3 firstDirection{
+                packet.direction[0][firstLane],
+                packet.direction[1][firstLane],
+                packet.direction[2][firstLane],
+            };
+
+            packet_stack_entry stack[StackSize];
+            u32 stackSize{0};
+
+            node_entry current{m_bounds, m_root.child};
+
+            while (true)
+            {
+                const quantized_node& node = m_nodes[current.node];
+                const vec3 step = get_step_size(current.bounds);
+
+                aabb childBounds[2];
+                u32 hitMask[2];
+
+                for (u32 i = 0; i < 2; ++i)
+                {
+                    childBounds[i] = decode(current.bounds, step, node.bounds[i]);
+                    hitMask[i] =
+                        intersect_packet(origin, invDirection, childBounds[i], distances).movemask() & activeMask;
+                }
+
+                // Bounds are decoded in the same space, so comparing the sum of min and max is enough to tell which
+                // center comes first along the ray
+                const vec3 centerDelta =
+                    childBounds[1].min + childBounds[1].max - childBounds[0].min - childBounds[0].max;
+                const u32 first = u32{dot(centerDelta, firstDirection) < 0.f};
+
+                bool hasNext{false};
+
+                for (u32 k = 0; k < 2; ++k)
+                {
+                    const u32 i = first ^ k;
+
+                    if (hitMask[i] == 0)
+                    {
+                        continue;
+                    }
+
+                    if (node.numPrimitives[i] > 0 && !hasNext)
+                    {
+                        f(node.children[i], node.numPrimitives[i], hitMask[i], distances);
+                    }
+                    else if (!hasNext)
+                    {
+                        current = {childBounds[i], node.children[i]};
+                        hasNext = true;
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < StackSize);
+                        stack[stackSize++] = {childBounds[i], node.children[i], node.numPrimitives[i]};
+                    }
+                }
+
+                while (!hasNext && stackSize > 0)
+                {
+                    const packet_stack_entry& entry = stack[--stackSize];
+
+                    // Distances might have shrunk since the entry was pushed, so it's tested again
+                    const u32 entryMask =
+                        intersect_packet(origin, invDirection, entry.bounds, distances).movemask() & activeMask;
+
+                    if (entryMask == 0)
+                    {
+                        continue;
+                    }
+
+                    if (entry.numPrimitives > 0)
+                    {
+                        f(entry.child, entry.numPrimitives, entryMask, distances);
+                    }
+                    else
+                    {
+                        current = {entry.bounds, entry.child};
+                        hasNext = true;
+                    }
+                }
+
+                if (!hasNext)
+                {
+                    break;
+                }
+            }
+        }
+
+        /// @brief Traverses the tree with a packet of rays looking for any hit closer than the distance of each ray.
+        /// @remarks The function has the same signature as the one passed to bvh::traverse_packet_any, and the rays it
+        /// reports as hit are retired from the traversal.
+        /// @return The mask of the active rays that hit something.
+        template <typename F>
+        u32 traverse_packet_any(const ray_packet& packet, u32 activeMask, const f32x8& maxDistances, F&& f) const
+            requires std::invocable<F, u32, u16, u32>
+        {
+            if (empty() || activeMask == 0)
+            {
+                return 0;
+            }
+
+            const f32x8 origin[3] = {
+                f32x8::load(packet.origin[0]),
+                f32x8::load(packet.origin[1]),
+                f32x8::load(packet.origin[2]),
+            };
+
+            const f32x8 one = f32x8::broadcast(1.f);
+
+            const f32x8 invDirection[3] = {
+                one / f32x8::load(packet.direction[0]),
+                one / f32x8::load(packet.direction[1]),
+                one / f32x8::load(packet.direction[2]),
+            };
+
+            const u32 rootMask = intersect_packet(origin, invDirection, m_bounds, maxDistances).movemask() & activeMask;
+
+            if (rootMask == 0)
+            {
+                return 0;
+            }
+
+            if (m_root.numPrimitives > 0)
+            {
+                return f(m_root.child, m_root.numPrimitives, rootMask) & rootMask;
+            }
+
+            node_entry stack[StackSize];
+            u32 stackSize{0};
+
+            stack[stackSize++] = {m_bounds, m_root.child};
+
+            u32 remainingMask = activeMask;
+
+            while (stackSize > 0)
+            {
+                const node_entry entry = stack[--stackSize];
+                const quantized_node& node = m_nodes[entry.node];
+                const vec3 step = get_step_size(entry.bounds);
+
+                for (u32 i = 0; i < 2; ++i)
+                {
+                    const aabb childBounds = decode(entry.bounds, step, node.bounds[i]);
+
+                    const u32 hitMask =
+                        intersect_packet(origin, invDirection, childBounds, maxDistances).movemask() & remainingMask;
+
+                    if (hitMask == 0)
+                    {
+                        continue;
+                    }
+
+                    if (node.numPrimitives[i] > 0)
+                    {
+                        remainingMask &= ~f(node.children[i], node.numPrimitives[i], hitMask);
+
+                        if (remainingMask == 0)
+                        {
+                            return activeMask;
+                        }
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < StackSize);
+                        stack[stackSize++] = {childBounds, node.children[i]};
+                    }
+                }
+            }
+
+            return activeMask & ~remainingMask;
+        }
+
+        template <typename F>
+        void intersect_aabb(const aabb& query, F&& f) const
+            requires std::invocable<F, u32, u32>
+        {
+            if (empty() || !oblo::overlap(query, m_bounds))
+            {
+                return;
+            }
+
+            if (m_root.numPrimitives > 0)
+            {
+                f(m_root.child, u32{m_root.numPrimitives});
+                return;
+            }
+
+            node_entry stack[StackSize];
+            u32 stackSize{0};
+
+            stack[stackSize++] = {m_bounds, m_root.child};
+
+            while (stackSize > 0)
+            {
+                const node_entry entry = stack[--stackSize];
+                const quantized_node& node = m_nodes[entry.node];
+                const vec3 step = get_step_size(entry.bounds);
+
+                for (u32 i = 0; i < 2; ++i)
+                {
+                    const aabb childBounds = decode(entry.bounds, step, node.bounds[i]);
+
+                    if (!oblo::overlap(query, childBounds))
+                    {
+                        continue;
+                    }
+
+                    if (node.numPrimitives[i] > 0)
+                    {
+                        f(node.children[i], u32{node.numPrimitives[i]});
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < StackSize);
+                        stack[stackSize++] = {childBounds, node.children[i]};
+                    }
+                }
+            }
+        }
+
+    private:
+        /// @brief Each node visited pushes at most 2 children and pops itself.
+        static constexpr u32 StackSize{bvh::MaxDepth + 1};
+
+        static constexpr f32 QuantizationSteps{255.f};
+
+        /// @brief The bounds of a child, as 6 planes quantized in the space of the bounds of the parent.
+        /// The minimum planes are stored as steps from the minimum of the parent, the maximum planes as steps from the
+        /// maximum of the parent, so that children touching the bounds of the parent are decoded exactly.
+        struct quantized_bounds
+        {
+            u8 min[3];
+            u8 max[3];
+        };
+
+        struct quantized_node
+        {
+            quantized_bounds bounds[2];
+            /// @brief For leaves it's the first primitive, for internal children the index of the node.
+            u32 children[2];
+            /// @brief The number of primitives in a leaf, 0 for internal children.
+            u16 numPrimitives[2];
+        };
+
+        static_assert(sizeof(quantized_node) == 24);
+
+        struct child_reference
+        {
+            u32 child;
+            u16 numPrimitives;
+        };
+
+        struct stack_entry
+        {
+            aabb bounds;
+            u32 child;
+            u16 numPrimitives;
+            f32 distance;
+        };
+
+        struct packet_stack_entry
+        {
+            aabb bounds;
+            u32 child;
+            u16 numPrimitives;
+        };
+
+        struct node_entry
+        {
+            aabb bounds;
+            u32 node;
+        };
+
+    private:
+        void compress(const bvh& source, u32 sourceIndex, u32 nodeIndex, const aabb& bounds)
+        {
+            const auto& sourceNodes = source.m_nodes;
+            const u32 sourceChildren[2] = {sourceIndex + 1, sourceNodes[sourceIndex].offset};
+
+            for (u32 i = 0; i < 2; ++i)
+            {
+                const auto& child = sourceNodes[sourceChildren[i]];
+
+                const quantized_bounds q = quantize(bounds, child.bounds);
+
+                // The reference to the node is not stable, since children are appended while recursing
+                m_nodes[nodeIndex].bounds[i] = q;
+                m_nodes[nodeIndex].numPrimitives[i] = child.numPrimitives;
+
+                if (child.numPrimitives > 0)
+                {
+                    m_nodes[nodeIndex].children[i] = child.offset;
+                }
+                else
+                {
+                    const u32 childIndex = m_nodes.size32();
+                    m_nodes.emplace_back();
+                    m_nodes[nodeIndex].children[i] = childIndex;
+
+                    // Children are quantized relative to the decoded bounds, which is what traversal sees
+                    compress(source, sourceChildren[i], childIndex, decode(bounds, get_step_size(bounds), q));
+                }
+            }
+        }
+
+        static vec3 get_step_size(const aabb& parent)
+        {
+            return (parent.max - parent.min) * (1.f / QuantizationSteps);
+        }
+
+        static aabb decode(const aabb& parent, const vec3& step, const quantized_bounds& q)
+        {
+            return {
+                .min = parent.min + vec3{f32(q.min[0]), f32(q.min[1]), f32(q.min[2])} * step,
+                .max = parent.max - vec3{f32(q.max[0]), f32(q.max[1]), f32(q.max[2])} * step,
+            };
+        }
+
+        /// @brief Quantizes the child bounds conservatively, the decoded bounds are guaranteed to contain them.
+        static quantized_bounds quantize(const aabb& parent, const aabb& child)
+        {
+            const vec3 step = get_step_size(parent);
+
+            const auto toSteps = [](f32 distance, f32 step) -> u8
+            {
+                if (!(step > 0.f && distance > 0.f))
+                {
+                    return 0;
+                }
+
+                return u8(min(std::floor(distance / step), QuantizationSteps));
+            };
+
+            quantized_bounds q;
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                q.min[axis] = toSteps(child.min[axis] - parent.min[axis], step[axis]);
+                q.max[axis] = toSteps(parent.max[axis] - child.max[axis], step[axis]);
+            }
+
+            // Rounding may still push the decoded planes slightly inside the child, which is fixed by stepping back
+            // towards the parent planes, where 0 steps decode exactly
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                while (q.min[axis] > 0 && decode(parent, step, q).min[axis] > child.min[axis])
+                {
+                    --q.min[axis];
+                }
+
+                while (q.max[axis] > 0 && decode(parent, step, q).max[axis] < child.max[axis])
+                {
+                    --q.max[axis];
+                }
+            }
+
+            return q;
+        }
+
+        static bool intersect_node(
+            const vec3& origin, const vec3& invDirection, const aabb& bounds, f32 maxDistance, f32& tNear)
+        {
+            f32 t0 = 0.f;
+            f32 t1 = maxDistance;
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                f32 tEnter = (bounds.min[axis] - origin[axis]) * invDirection[axis];
+                f32 tExit = (bounds.max[axis] - origin[axis]) * invDirection[axis];
+
+                if (tEnter > tExit)
+                {
+                    std::swap(tEnter, tExit);
+                }
+
+                t0 = max(t0, tEnter);
+                t1 = min(t1, tExit);
+            }
+
+            tNear = t0;
+            return t0 <= t1;
+        }
+
+    private:
+        dynamic_array<quantized_node> m_nodes;
+        aabb m_bounds{aabb::make_invalid()};
+        child_reference m_root{};
+    };
+}
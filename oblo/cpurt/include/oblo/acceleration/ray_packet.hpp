@@ -0,0 +1,318 @@
+#pragma once
+
+#include <oblo/core/types.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/ray.hpp>
+
+#include <bit>
+
+#if defined(__AVX__)
+    #define OBLO_RAY_PACKET_AVX
+    #include <immintrin.h>
+#endif
+
+namespace oblo
+{
+    /// @brief 8 floats processed in lockstep, with AVX when available or with plain loops the compiler can vectorize.
+    /// Comparisons return masks with all bits set in the lanes where the comparison is true.
+    struct f32x8
+    {
+        static constexpr u32 Width{8};
+
+#if defined(OBLO_RAY_PACKET_AVX)
+        __m256 v;
+
+        static f32x8 load(const f32* p)
+        {
+            return {_mm256_load_ps(p)};
+        }
+
+        static f32x8 broadcast(f32 x)
+        {
+            return {_mm256_set1_ps(x)};
+        }
+
+        void store(f32* p) const
+        {
+            _mm256_store_ps(p, v);
+        }
+
+        /// @brief Returns a bitmask with the sign bits of the lanes, i.e. the lanes set in a comparison mask.
+        u32 movemask() const
+        {
+            return u32(_mm256_movemask_ps(v));
+        }
+
+        friend f32x8 operator+(f32x8 a, f32x8 b)
+        {
+            return {_mm256_add_ps(a.v, b.v)};
+        }
+
+        friend f32x8 operator-(f32x8 a, f32x8 b)
+        {
+            return {_mm256_sub_ps(a.v, b.v)};
+        }
+
+        friend f32x8 operator*(f32x8 a, f32x8 b)
+        {
+            return {_mm256_mul_ps(a.v, b.v)};
+        }
+
+        friend f32x8 operator/(f32x8 a, f32x8 b)
+        {
+            return {_mm256_div_ps(a.v, b.v)};
+        }
+
+        friend f32x8 operator&(f32x8 a, f32x8 b)
+        {
+            return {_mm256_and_ps(a.v, b.v)};
+        }
+
+        friend f32x8 operator|(f32x8 a, f32x8 b)
+        {
+            return {_mm256_or_ps(a.v, b.v)};
+        }
+
+        friend f32x8 operator<(f32x8 a, f32x8 b)
+        {
+            return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+        }
+
+        friend f32x8 operator<=(f32x8 a, f32x8 b)
+        {
+            return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};
+        }
+
+        friend f32x8 operator>(f32x8 a, f32x8 b)
+        {
+            return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+        }
+
+        friend f32x8 operator>=(f32x8 a, f32x8 b)
+        {
+            return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};
+        }
+
+        friend f32x8 min(f32x8 a, f32x8 b)
+        {
+            return {_mm256_min_ps(a.v, b.v)};
+        }
+
+        friend f32x8 max(f32x8 a, f32x8 b)
+        {
+            return {_mm256_max_ps(a.v, b.v)};
+        }
+
+        /// @brief Picks the lanes of a where the mask is set, the lanes of b otherwise.
+        friend f32x8 select(f32x8 mask, f32x8 a, f32x8 b)
+        {
+            return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+        }
+#else
+        alignas(32) f32 v[Width];
+
+        static f32x8 load(const f32* p)
+        {
+            f32x8 r;
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                r.v[i] = p[i];
+            }
+
+            return r;
+        }
+
+        static f32x8 broadcast(f32 x)
+        {
+            f32x8 r;
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                r.v[i] = x;
+            }
+
+            return r;
+        }
+
+        void store(f32* p) const
+        {
+            for (u32 i = 0; i < Width; ++i)
+            {
+                p[i] = v[i];
+            }
+        }
+
+        /// @brief Returns a bitmask with the sign bits of the lanes, i.e. the lanes set in a comparison mask.
+        u32 movemask() const
+        {
+            u32 mask{0};
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                mask |= (std::bit_cast<u32>(v[i]) >> 31) << i;
+            }
+
+            return mask;
+        }
+
+        template <typename Op>
+        static f32x8 apply(f32x8 a, f32x8 b, Op op)
+        {
+            f32x8 r;
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                r.v[i] = op(a.v[i], b.v[i]);
+            }
+
+            return r;
+        }
+
+        static f32 make_mask(bool b)
+        {
+            return std::bit_cast<f32>(b ? ~0u : 0u);
+        }
+
+        friend f32x8 operator+(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return x + y; });
+        }
+
+        friend f32x8 operator-(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return x - y; });
+        }
+
+        friend f32x8 operator*(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return x * y; });
+        }
+
+        friend f32x8 operator/(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return x / y; });
+        }
+
+        friend f32x8 operator&(f32x8 a, f32x8 b)
+        {
+            return apply(a,
+                b,
+                [](f32 x, f32 y) { return std::bit_cast<f32>(std::bit_cast<u32>(x) & std::bit_cast<u32>(y)); });
+        }
+
+        friend f32x8 operator|(f32x8 a, f32x8 b)
+        {
+            return apply(a,
+                b,
+                [](f32 x, f32 y) { return std::bit_cast<f32>(std::bit_cast<u32>(x) | std::bit_cast<u32>(y)); });
+        }
+
+        friend f32x8 operator<(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return make_mask(x < y); });
+        }
+
+        friend f32x8 operator<=(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return make_mask(x <= y); });
+        }
+
+        friend f32x8 operator>(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return make_mask(x > y); });
+        }
+
+        friend f32x8 operator>=(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return make_mask(x >= y); });
+        }
+
+        // Same semantics as the SSE/AVX instructions: the second operand is returned when either one is NaN
+        friend f32x8 min(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return x < y ? x : y; });
+        }
+
+        friend f32x8 max(f32x8 a, f32x8 b)
+        {
+            return apply(a, b, [](f32 x, f32 y) { return x > y ? x : y; });
+        }
+
+        /// @brief Picks the lanes of a where the mask is set, the lanes of b otherwise.
+        friend f32x8 select(f32x8 mask, f32x8 a, f32x8 b)
+        {
+            f32x8 r;
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                r.v[i] = (std::bit_cast<u32>(mask.v[i]) >> 31) ? a.v[i] : b.v[i];
+            }
+
+            return r;
+        }
+#endif
+
+        /// @brief Creates a mask with all bits set in the lanes set in the bitmask, i.e. the inverse of movemask.
+        static f32x8 from_bitmask(u32 bitmask)
+        {
+            alignas(32) f32 lanes[Width];
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                lanes[i] = std::bit_cast<f32>((bitmask >> i) & 1 ? ~0u : 0u);
+            }
+
+            return load(lanes);
+        }
+    };
+
+    /// @brief A group of up to 8 rays stored as a structure of arrays, to be traced together.
+    /// Lanes that are not part of the packet are excluded through the active mask passed along with it.
+    struct ray_packet
+    {
+        static constexpr u32 Size{f32x8::Width};
+
+        alignas(32) f32 origin[3][Size];
+        alignas(32) f32 direction[3][Size];
+
+        void set(u32 lane, const ray& r)
+        {
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                origin[axis][lane] = r.origin[axis];
+                direction[axis][lane] = r.direction[axis];
+            }
+        }
+
+        ray get(u32 lane) const
+        {
+            return {
+                .origin = {origin[0][lane], origin[1][lane], origin[2][lane]},
+                .direction = {direction[0][lane], direction[1][lane], direction[2][lane]},
+            };
+        }
+    };
+
+    /// @brief Tests all rays of a packet against a box with the slab test.
+    /// @param invDirection The inverse of the directions of the rays, one f32x8 per axis.
+    /// @param maxDistance The distance up to which each ray is considered.
+    /// @return A mask with the lanes that hit the box.
+    inline f32x8 intersect_packet(
+        const f32x8 (&origin)[3], const f32x8 (&invDirection)[3], const aabb& box, f32x8 maxDistance)
+    {
+        f32x8 t0 = f32x8::broadcast(0.f);
+        f32x8 t1 = maxDistance;
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            const f32x8 tA = (f32x8::broadcast(box.min[axis]) - origin[axis]) * invDirection[axis];
+            const f32x8 tB = (f32x8::broadcast(box.max[axis]) - origin[axis]) * invDirection[axis];
+
+            t0 = max(t0, min(tA, tB));
+            t1 = min(t1, max(tA, tB));
+        }
+
+        return t0 <= t1;
+    }
+}
@@ -9,8 +9,10 @@
 namespace oblo
 {
     struct aabb;
+    struct f32x8;
     struct triangle;
     struct ray;
+    struct ray_packet;
     struct vec3;
 
     class triangle_container
@@ -44,16 +46,66 @@ namespace oblo
 
         bool intersect(const ray& ray, u32 beginIndex, u16 numPrimitives, f32& distance, hit_result& result) const;
 
+        /// @brief Checks whether the ray hits any triangle in the range closer than maxDistance.
+        bool intersect_any(const ray& ray, u32 beginIndex, u16 numPrimitives, f32 maxDistance) const;
+
+        /// @brief Intersects the rays of a packet with a range of triangles, shrinking the distance of each ray hit.
+        /// @param rayMask The lanes of the packet to intersect.
+        /// @param triangleIndices Receives the index of the closest triangle for the lanes that were hit.
+        /// @return The mask of the lanes that hit a triangle closer than their distance.
+        u32 intersect_packet(const ray_packet& packet,
+            u32 beginIndex,
+            u16 numPrimitives,
+            u32 rayMask,
+            f32x8& distances,
+            u32* triangleIndices) const;
+
+        /// @brief Checks which rays of a packet hit any triangle in the range closer than their distance.
+        /// @param rayMask The lanes of the packet to intersect, the test stops as soon as all of them hit.
+        /// @return The mask of the lanes that hit a triangle.
+        u32 intersect_packet_any(const ray_packet& packet,
+            u32 beginIndex,
+            u16 numPrimitives,
+            u32 rayMask,
+            const f32x8& maxDistances) const;
+
         std::span<const triangle> get_triangles() const;
         std::span<const aabb> get_aabbs() const;
         std::span<const vec3> get_centroids() const;
         std::span<const vec3> get_normals() const;
 
+        /// @brief The size in bytes of the triangles and of the data derived from them, e.g. bounds and normals.
+        usize get_memory_footprint() const;
+
+    private:
+        void update_packed(u32 beginIndex, u32 endIndex);
+
+        /// @brief Intersects the rays in the mask with a single triangle of the packed arrays.
+        /// @param t Receives the distance of each lane from the triangle, only meaningful for the lanes that hit.
+        /// @return The mask of the lanes that hit the triangle closer than their distance.
+        u32 intersect_packed(const f32x8 (&o)[3],
+            const f32x8 (&d)[3],
+            u32 triangleIndex,
+            u32 rayMask,
+            const f32x8& distances,
+            f32x8& t) const;
+
+    private:
+        /// @brief The first vertex and the two edges from it, one array per component, kept in the same order as the
+        /// triangles for the SIMD intersection of packets.
+        struct packed_triangles
+        {
+            std::vector<f32> v0[3];
+            std::vector<f32> e1[3];
+            std::vector<f32> e2[3];
+        };
+
     private:
         std::vector<triangle> m_triangles;
         std::vector<aabb> m_aabbs;
         std::vector<vec3> m_centroids;
         std::vector<vec3> m_normals;
+        packed_triangles m_packed;
     };
 
     struct triangle_container::hit_result
@@ -0,0 +1,491 @@
+#pragma once
+
+#include <oblo/acceleration/bvh.hpp>
+#include <oblo/core/debug.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/ray.hpp>
+
+#include <bit>
+#include <concepts>
+#include <limits>
+
+#if defined(__AVX__)
+    #define OBLO_WIDE_BVH_AVX
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define OBLO_WIDE_BVH_SSE
+    #include <emmintrin.h>
+#endif
+
+namespace oblo
+{
+    /// @brief BVH with Width children per node, collapsed from a binary bvh.
+    /// The bounds of the children are stored as a structure of arrays, so that a ray or a box can be tested against
+    /// all of them at once with SIMD instructions.
+    /// @tparam Width The number of children per node, either 4 or 8.
+    template <u32 Width>
+    class wide_bvh
+    {
+        static_assert(Width == 4 || Width == 8);
+
+    public:
+        wide_bvh() = default;
+        wide_bvh(wide_bvh&&) noexcept = default;
+        wide_bvh& operator=(wide_bvh&&) noexcept = default;
+
+        ~wide_bvh() = default;
+
+        /// @brief Collapses a binary bvh, the primitive offsets in the leaves are the same as the source.
+        void build(const bvh& source)
+        {
+            clear();
+
+            if (source.empty())
+            {
+                return;
+            }
+
+            m_nodes.emplace_back();
+            collapse(source, 0, 0);
+        }
+
+        bool empty() const
+        {
+            return m_nodes.empty();
+        }
+
+        void clear()
+        {
+            m_nodes.clear();
+        }
+
+        u32 get_nodes_count() const
+        {
+            return m_nodes.size32();
+        }
+
+        aabb get_bounds() const
+        {
+            aabb bounds = aabb::make_invalid();
+
+            if (!m_nodes.empty())
+            {
+                const wide_node& root = m_nodes[0];
+
+                for (u32 i = 0; i < Width; ++i)
+                {
+                    bounds = extend(bounds, root.get_child_bounds(i));
+                }
+            }
+
+            return bounds;
+        }
+
+        /// @brief Traverses the tree, calling the function on the leaves hit by the ray closer than the current
+        /// distance, sorted front to back among siblings.
+        /// @remarks The function has the same signature as the one passed to bvh::traverse, and can shrink the distance
+        /// when a primitive is hit.
+        template <typename F>
+        void traverse(const ray& ray, F&& f) const
+        {
+            if (m_nodes.empty())
+            {
+                return;
+            }
+
+            const ray_query query = make_ray_query(ray);
+
+            stack_entry stack[StackSize];
+            u32 stackSize{0};
+            u32 current{0};
+
+            f32 distance = std::numeric_limits<f32>::max();
+
+            while (true)
+            {
+                const wide_node& node = m_nodes[current];
+
+                alignas(32) f32 tNear[Width];
+                u32 hitMask = intersect_ray(node, query, distance, tNear);
+
+                // Insert the children sorted by distance, the closest one ends up on top of the stack
+                const u32 stackBase = stackSize;
+
+                for (; hitMask != 0; hitMask &= hitMask - 1)
+                {
+                    const u32 lane = u32(std::countr_zero(hitMask));
+                    const stack_entry entry{node.children[lane], node.numPrimitives[lane], tNear[lane]};
+
+                    OBLO_ASSERT(stackSize < StackSize);
+
+                    u32 position = stackSize++;
+
+                    for (; position > stackBase && stack[position - 1].distance < entry.distance; --position)
+                    {
+                        stack[position] = stack[position - 1];
+                    }
+
+                    stack[position] = entry;
+                }
+
+                bool hasNext{false};
+
+                while (stackSize > 0)
+                {
+                    const stack_entry& entry = stack[--stackSize];
+
+                    if (entry.distance > distance)
+                    {
+                        continue;
+                    }
+
+                    if (entry.numPrimitives > 0)
+                    {
+                        f(entry.child, entry.numPrimitives, distance);
+                    }
+                    else
+                    {
+                        current = entry.child;
+                        hasNext = true;
+                        break;
+                    }
+                }
+
+                if (!hasNext)
+                {
+                    break;
+                }
+            }
+        }
+
+        template <typename F>
+        void intersect_aabb(const aabb& query, F&& f) const
+            requires std::invocable<F, u32, u32>
+        {
+            if (m_nodes.empty())
+            {
+                return;
+            }
+
+            u32 stack[StackSize];
+            u32 stackSize{0};
+
+            stack[stackSize++] = 0;
+
+            while (stackSize > 0)
+            {
+                const wide_node& node = m_nodes[stack[--stackSize]];
+
+                for (u32 overlapMask = overlap_aabb(node, query); overlapMask != 0; overlapMask &= overlapMask - 1)
+                {
+                    const u32 lane = u32(std::countr_zero(overlapMask));
+
+                    if (node.numPrimitives[lane] > 0)
+                    {
+                        f(node.children[lane], u32{node.numPrimitives[lane]});
+                    }
+                    else
+                    {
+                        OBLO_ASSERT(stackSize < StackSize);
+                        stack[stackSize++] = node.children[lane];
+                    }
+                }
+            }
+        }
+
+    private:
+        /// @brief Each node visited pushes at most Width children and pops itself.
+        static constexpr u32 StackSize{bvh::MaxDepth * (Width - 1) + 1};
+
+        enum bounds_plane : u8
+        {
+            min_x,
+            min_y,
+            min_z,
+            max_x,
+            max_y,
+            max_z,
+        };
+
+        struct alignas(32) wide_node
+        {
+            /// @brief The bounds of the children, one array per plane. Unused children have inverted bounds, which
+            /// fail both the ray and the overlap tests.
+            f32 bounds[6][Width];
+            /// @brief For leaves it's the first primitive, for internal nodes the index of the child node.
+            u32 children[Width];
+            /// @brief The number of primitives in a leaf, 0 for internal nodes and unused children.
+            u16 numPrimitives[Width];
+
+            aabb get_child_bounds(u32 i) const
+            {
+                return {
+                    .min = {bounds[min_x][i], bounds[min_y][i], bounds[min_z][i]},
+                    .max = {bounds[max_x][i], bounds[max_y][i], bounds[max_z][i]},
+                };
+            }
+
+            void set_child_bounds(u32 i, const aabb& b)
+            {
+                bounds[min_x][i] = b.min.x;
+                bounds[min_y][i] = b.min.y;
+                bounds[min_z][i] = b.min.z;
+                bounds[max_x][i] = b.max.x;
+                bounds[max_y][i] = b.max.y;
+                bounds[max_z][i] = b.max.z;
+            }
+        };
+
+        struct ray_query
+        {
+            vec3 origin;
+            vec3 invDirection;
+            /// @brief The planes the ray enters and exits on each axis, depending on the sign of the direction.
+            u8 nearPlane[3];
+            u8 farPlane[3];
+        };
+
+        struct stack_entry
+        {
+            u32 child;
+            u16 numPrimitives;
+            f32 distance;
+        };
+
+    private:
+        void collapse(const bvh& source, u32 sourceIndex, u32 nodeIndex)
+        {
+            const auto& sourceNodes = source.m_nodes;
+
+            u32 candidates[Width];
+            u32 numCandidates{0};
+
+            if (const auto& sourceNode = sourceNodes[sourceIndex]; sourceNode.numPrimitives > 0)
+            {
+                // Only happens when the root is a leaf
+                candidates[numCandidates++] = sourceIndex;
+            }
+            else
+            {
+                candidates[numCandidates++] = sourceIndex + 1;
+                candidates[numCandidates++] = sourceNode.offset;
+            }
+
+            // Pull up the grandchildren of the largest internal children, until the node is full
+            while (numCandidates < Width)
+            {
+                u32 largest{~0u};
+                f32 largestArea{-1.f};
+
+                for (u32 i = 0; i < numCandidates; ++i)
+                {
+                    const auto& candidate = sourceNodes[candidates[i]];
+
+                    if (candidate.numPrimitives == 0)
+                    {
+                        const vec3 d = candidate.bounds.max - candidate.bounds.min;
+
+                        if (const f32 area = d.x * d.y + d.x * d.z + d.y * d.z; area > largestArea)
+                        {
+                            largestArea = area;
+                            largest = i;
+                        }
+                    }
+                }
+
+                if (largest == ~0u)
+                {
+                    break;
+                }
+
+                const u32 expanded = candidates[largest];
+                candidates[largest] = expanded + 1;
+                candidates[numCandidates++] = sourceNodes[expanded].offset;
+            }
+
+            {
+                wide_node& node = m_nodes[nodeIndex];
+
+                for (u32 i = 0; i < Width; ++i)
+                {
+                    node.set_child_bounds(i, aabb::make_invalid());
+                    node.children[i] = 0;
+                    node.numPrimitives[i] = 0;
+                }
+            }
+
+            for (u32 i = 0; i < numCandidates; ++i)
+            {
+                const auto& candidate = sourceNodes[candidates[i]];
+
+                // The reference to the node is not stable, since children are appended while recursing
+                m_nodes[nodeIndex].set_child_bounds(i, candidate.bounds);
+
+                if (candidate.numPrimitives > 0)
+                {
+                    m_nodes[nodeIndex].children[i] = candidate.offset;
+                    m_nodes[nodeIndex].numPrimitives[i] = candidate.numPrimitives;
+                }
+                else
+                {
+                    const u32 childIndex = m_nodes.size32();
+                    m_nodes.emplace_back();
+                    m_nodes[nodeIndex].children[i] = childIndex;
+
+                    collapse(source, candidates[i], childIndex);
+                }
+            }
+        }
+
+        static ray_query make_ray_query(const ray& ray)
+        {
+            ray_query query{
+                .origin = ray.origin,
+                .invDirection = {1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z},
+                .nearPlane = {},
+                .farPlane = {},
+            };
+
+            for (u8 axis = 0; axis < 3; ++axis)
+            {
+                const bool isNegative = query.invDirection[axis] < 0.f;
+                query.nearPlane[axis] = isNegative ? u8(max_x + axis) : u8(min_x + axis);
+                query.farPlane[axis] = isNegative ? u8(min_x + axis) : u8(max_x + axis);
+            }
+
+            return query;
+        }
+
+        /// @brief Tests the ray against the bounds of all children.
+        /// @return A mask with a bit set for each child hit closer than maxDistance.
+        static u32 intersect_ray(const wide_node& node, const ray_query& q, f32 maxDistance, f32* tNear)
+        {
+#if defined(OBLO_WIDE_BVH_AVX)
+            if constexpr (Width == 8)
+            {
+                const __m256 ox = _mm256_set1_ps(q.origin.x);
+                const __m256 oy = _mm256_set1_ps(q.origin.y);
+                const __m256 oz = _mm256_set1_ps(q.origin.z);
+                const __m256 ix = _mm256_set1_ps(q.invDirection.x);
+                const __m256 iy = _mm256_set1_ps(q.invDirection.y);
+                const __m256 iz = _mm256_set1_ps(q.invDirection.z);
+
+                const __m256 nx = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[q.nearPlane[0]]), ox), ix);
+                const __m256 ny = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[q.nearPlane[1]]), oy), iy);
+                const __m256 nz = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[q.nearPlane[2]]), oz), iz);
+                const __m256 fx = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[q.farPlane[0]]), ox), ix);
+                const __m256 fy = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[q.farPlane[1]]), oy), iy);
+                const __m256 fz = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[q.farPlane[2]]), oz), iz);
+
+                const __m256 t0 = _mm256_max_ps(_mm256_max_ps(nx, ny), _mm256_max_ps(nz, _mm256_setzero_ps()));
+                const __m256 t1 = _mm256_min_ps(_mm256_min_ps(fx, fy), _mm256_min_ps(fz, _mm256_set1_ps(maxDistance)));
+
+                _mm256_store_ps(tNear, t0);
+                return u32(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+            }
+            else
+#endif
+#if defined(OBLO_WIDE_BVH_AVX) || defined(OBLO_WIDE_BVH_SSE)
+            {
+                const __m128 ox = _mm_set1_ps(q.origin.x);
+                const __m128 oy = _mm_set1_ps(q.origin.y);
+                const __m128 oz = _mm_set1_ps(q.origin.z);
+                const __m128 ix = _mm_set1_ps(q.invDirection.x);
+                const __m128 iy = _mm_set1_ps(q.invDirection.y);
+                const __m128 iz = _mm_set1_ps(q.invDirection.z);
+                const __m128 tMax = _mm_set1_ps(maxDistance);
+
+                u32 mask{0};
+
+                // Without AVX the 8-wide nodes are tested in two halves
+                for (u32 i = 0; i < Width; i += 4)
+                {
+                    const __m128 nx = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[q.nearPlane[0]] + i), ox), ix);
+                    const __m128 ny = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[q.nearPlane[1]] + i), oy), iy);
+                    const __m128 nz = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[q.nearPlane[2]] + i), oz), iz);
+                    const __m128 fx = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[q.farPlane[0]] + i), ox), ix);
+                    const __m128 fy = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[q.farPlane[1]] + i), oy), iy);
+                    const __m128 fz = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[q.farPlane[2]] + i), oz), iz);
+
+                    const __m128 t0 = _mm_max_ps(_mm_max_ps(nx, ny), _mm_max_ps(nz, _mm_setzero_ps()));
+                    const __m128 t1 = _mm_min_ps(_mm_min_ps(fx, fy), _mm_min_ps(fz, tMax));
+
+                    _mm_store_ps(tNear + i, t0);
+                    mask |= u32(_mm_movemask_ps(_mm_cmple_ps(t0, t1))) << i;
+                }
+
+                return mask;
+            }
+#else
+            {
+                u32 mask{0};
+
+                for (u32 i = 0; i < Width; ++i)
+                {
+                    f32 t0 = 0.f;
+                    f32 t1 = maxDistance;
+
+                    for (u32 axis = 0; axis < 3; ++axis)
+                    {
+                        const f32 tEnter = (node.bounds[q.nearPlane[axis]][i] - q.origin[axis]) * q.invDirection[axis];
+                        const f32 tExit = (node.bounds[q.farPlane[axis]][i] - q.origin[axis]) * q.invDirection[axis];
+
+                        t0 = max(t0, tEnter);
+                        t1 = min(t1, tExit);
+                    }
+
+                    tNear[i] = t0;
+                    mask |= u32{t0 <= t1} << i;
+                }
+
+                return mask;
+            }
+#endif
+        }
+
+        /// @brief Tests the query box against the bounds of all children.
+        /// @return A mask with a bit set for each child overlapping the query.
+        static u32 overlap_aabb(const wide_node& node, const aabb& query)
+        {
+#if defined(OBLO_WIDE_BVH_AVX) || defined(OBLO_WIDE_BVH_SSE)
+            u32 mask{0};
+
+            for (u32 i = 0; i < Width; i += 4)
+            {
+                __m128 overlaps = _mm_cmplt_ps(_mm_load_ps(node.bounds[min_x] + i), _mm_set1_ps(query.max.x));
+                overlaps = _mm_and_ps(overlaps,
+                    _mm_cmplt_ps(_mm_load_ps(node.bounds[min_y] + i), _mm_set1_ps(query.max.y)));
+                overlaps = _mm_and_ps(overlaps,
+                    _mm_cmplt_ps(_mm_load_ps(node.bounds[min_z] + i), _mm_set1_ps(query.max.z)));
+                overlaps = _mm_and_ps(overlaps,
+                    _mm_cmplt_ps(_mm_set1_ps(query.min.x), _mm_load_ps(node.bounds[max_x] + i)));
+                overlaps = _mm_and_ps(overlaps,
+                    _mm_cmplt_ps(_mm_set1_ps(query.min.y), _mm_load_ps(node.bounds[max_y] + i)));
+                overlaps = _mm_and_ps(overlaps,
+                    _mm_cmplt_ps(_mm_set1_ps(query.min.z), _mm_load_ps(node.bounds[max_z] + i)));
+
+                mask |= u32(_mm_movemask_ps(overlaps)) << i;
+            }
+
+            return mask;
+#else
+            u32 mask{0};
+
+            for (u32 i = 0; i < Width; ++i)
+            {
+                mask |= u32{overlap(query, node.get_child_bounds(i))} << i;
+            }
+
+            return mask;
+#endif
+        }
+
+    private:
+        dynamic_array<wide_node> m_nodes;
+    };
+
+    using bvh4 = wide_bvh<4>;
+    using bvh8 = wide_bvh<8>;
+}
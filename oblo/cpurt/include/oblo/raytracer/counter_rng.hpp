@@ -0,0 +1,53 @@
+#pragma once
+
+#include <oblo/core/hash.hpp>
+#include <oblo/core/types.hpp>
+
+namespace oblo
+{
+    /// @brief Counter-based random engine, every value is a hash of a key and the index of the value in the stream.
+    /// Streams with different keys are independent, so they can be assigned to units of work (e.g. tiles and frames)
+    /// and reproduced regardless of which thread runs them or in which order.
+    /// @remarks Satisfies the UniformRandomBitGenerator requirements, so it can be used with the standard
+    /// distributions.
+    class counter_rng
+    {
+    public:
+        using result_type = u32;
+
+    public:
+        constexpr explicit counter_rng(u64 key, u64 counter = 0) : m_key{hash_integer(key)}, m_counter{counter} {}
+
+        /// @brief Creates the key for a stream from a few integers, e.g. seed, frame and tile.
+        static constexpr u64 make_key(u32 seed, u32 a, u32 b)
+        {
+            return hash_mix(u64{seed}, (u64{a} << 32) | b);
+        }
+
+        constexpr u32 operator()()
+        {
+            // Same sequence as splitmix64, with the key as starting state
+            const u64 x = hash_integer(u64(m_key + ++m_counter * 0x9e3779b97f4a7c15ull));
+            return u32(x >> 32);
+        }
+
+        constexpr u64 get_counter() const
+        {
+            return m_counter;
+        }
+
+        static constexpr u32 min()
+        {
+            return 0u;
+        }
+
+        static constexpr u32 max()
+        {
+            return ~0u;
+        }
+
+    private:
+        u64 m_key;
+        u64 m_counter;
+    };
+}
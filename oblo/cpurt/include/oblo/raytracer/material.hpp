@@ -4,7 +4,7 @@
 
 namespace oblo
 {
-    struct material
+    struct raytracer_material
     {
         vec3 albedo;
         vec3 emissive;
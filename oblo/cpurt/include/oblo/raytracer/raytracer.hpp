@@ -2,19 +2,24 @@
 
 #include <oblo/acceleration/aabb_container.hpp>
 #include <oblo/acceleration/bvh.hpp>
+#include <oblo/core/invoke/function_ref.hpp>
+#include <oblo/core/time/time.hpp>
 #include <oblo/core/utility.hpp>
+#include <oblo/math/mat4.hpp>
 #include <oblo/raytracer/camera.hpp>
 
-#include <random>
 #include <span>
 #include <vector>
 
 namespace oblo
 {
+    class counter_rng;
+    class quantized_bvh;
+    struct ray_packet;
     class raytracer_state;
     class triangle_container;
 
-    struct material;
+    struct raytracer_material;
 
     struct raytracer_metrics
     {
@@ -22,15 +27,41 @@ namespace oblo
         u16 height;
         u32 numObjects;
         u32 numTriangles;
+        /// @brief The number of pixels that received samples.
         u32 numPrimaryRays;
+        /// @brief The lowest number of samples accumulated in a pixel.
         u32 numTotalSamples;
+        /// @brief The number of rays traced, including bounces.
+        u32 numTracedRays;
+        u32 numTiles;
+        /// @brief The number of tiles that adaptive sampling stopped sampling because they reached the noise threshold.
+        u32 numConvergedTiles;
+    };
+
+    /// @brief Controls how samples are distributed among the pixels of a tile on each pass.
+    struct raytracer_sampling
+    {
+        /// @brief When disabled every pixel receives the same number of samples on each pass. When enabled, passes
+        /// spend the same number of samples but on the pixels with the highest estimated error, and tiles stop being
+        /// sampled once all their pixels are below the noise threshold.
+        bool isAdaptive{false};
+
+        /// @brief Samples taken uniformly before the error of a pixel is estimated.
+        u32 minSamples{16};
+
+        /// @brief Samples past which a pixel is considered converged regardless of its error.
+        u32 maxSamples{4096};
+
+        /// @brief Relative standard error of the mean luminance of a pixel below which the pixel is converged.
+        f32 noiseThreshold{.05f};
     };
 
     struct render_instance
     {
         u32 mesh;
         u32 material;
-        // TODO: Add transform
+        /// @brief The local to world transform of the instance, it has to be affine and invertible.
+        mat4 transform{mat4::identity()};
     };
 
     struct raytracer_result
@@ -59,35 +90,125 @@ namespace oblo
         void reserve(u32 numMeshes);
 
         u32 add_mesh(triangle_container triangles);
-        u32 add_material(const material& material);
+
+        /// @brief Adds a mesh with a BLAS that was already built on its triangles, e.g. loaded from a cache.
+        u32 add_mesh(triangle_container triangles, bvh blas);
+        u32 add_material(const raytracer_material& material);
         u32 add_instance(const render_instance& instance);
 
+        /// @brief When enabled, the BLAS of the meshes added afterwards is compressed into a quantized_bvh, which
+        /// takes less memory at the cost of looser bounds during traversal. Meshes that were already added are left as
+        /// they are.
+        void set_quantized_blas(bool enable);
+
+        /// @brief Moves an instance, the TLAS is updated on the next call to update_tlas.
+        void set_instance_transform(u32 instance, const mat4& transform);
+
+        /// @brief Removes an instance, moving the last instance to its index.
+        /// @remarks The TLAS has to be updated before running any query.
+        void remove_instance(u32 instance);
+
+        u32 get_instances_count() const;
+
         std::span<const triangle_container> get_meshes() const;
 
         void clear();
 
         void render_tile(raytracer_state& state, const camera& camera, u16 minX, u16 minY, u16 maxX, u16 maxY) const;
 
+        /// @brief Renders one sample pass on all tiles of the state, running tiles as jobs when called on a job manager
+        /// thread. The metrics of the tiles are aggregated in the state once all tiles are done.
+        /// @remarks Each tile draws random numbers from its own stream, keyed by the seed of the state, the tile and
+        /// the number of samples accumulated so far, so the result doesn't depend on scheduling.
+        void render_frame(raytracer_state& state, const camera& camera) const;
+
+        /// @brief Renders passes with render_frame until the time budget is spent, or until all tiles converged when
+        /// sampling is adaptive. At least one pass is rendered, and no pass is started when the previous one suggests
+        /// it would not fit in the remaining budget. The metrics of the state sum the rays of all passes.
+        /// @remarks Nothing is rendered when the scene or the state are empty.
+        /// @return The number of passes rendered.
+        u32 render_progressive(raytracer_state& state, const camera& camera, time budget) const;
+
+        /// @brief Builds the TLAS from scratch on the current instances.
         void rebuild_tlas();
 
+        /// @brief Brings the TLAS up to date with the instances, meant to be called every frame.
+        /// When instances only moved since the last build, the TLAS is refit in place. It's rebuilt instead when
+        /// instances were added or removed, or when refitting degraded its SAH cost past the rebuild threshold.
+        void update_tlas();
+
+        /// @brief Sets the ratio between the SAH cost of the refit TLAS and the cost it had when it was built, past
+        /// which update_tlas rebuilds it.
+        void set_tlas_rebuild_threshold(f32 threshold);
+
+        /// @brief The number of times the TLAS was built, either explicitly or by update_tlas.
+        u32 get_tlas_builds_count() const;
+
         const bvh& get_tlas() const;
 
         bool intersect(const ray& ray, raytracer_result& out) const;
 
+        /// @brief Checks whether anything is hit by the ray closer than maxDistance, e.g. for shadow or ambient
+        /// occlusion rays. The traversal stops on the first hit found.
+        bool occluded(const ray& ray, f32 maxDistance) const;
+
+        /// @brief Runs occlusion queries on a batch of rays, tracing them in packets of ray_packet::Size rays.
+        /// Batches should be sorted so that consecutive rays are coherent, e.g. rays sampled from the same point.
+        /// @param maxDistances The maximum distance for each ray.
+        /// @param results Receives whether each ray is occluded.
+        /// @return The number of occluded rays.
+        u32 occluded(std::span<const ray> rays, std::span<const f32> maxDistances, std::span<bool> results) const;
+
+        /// @brief Finds the closest hit for each active ray of a packet, traversing the acceleration structures once
+        /// for the whole packet. Meant for coherent rays, e.g. primary rays of nearby pixels.
+        /// @param out Receives the results for the lanes that hit, must have room for ray_packet::Size elements.
+        /// @return The mask of the lanes that hit.
+        u32 intersect_packet(const ray_packet& packet, u32 activeMask, raytracer_result* out) const;
+
+        /// @brief Calls the function with the index of each instance whose world space bounds overlap the box.
+        void overlap(const aabb& box, function_ref<void(u32 instance)> f) const;
+
     private:
         struct trace_context;
-        void trace(trace_context& context, std::span<const ray> initialRays, raytracer_state& state) const;
+
+        void render_tile_impl(raytracer_state& state,
+            const camera& camera,
+            u16 minX,
+            u16 minY,
+            u16 maxX,
+            u16 maxY,
+            trace_context& context,
+            raytracer_metrics& metrics) const;
+
+        void trace(trace_context& context, std::span<const ray> initialRays, counter_rng& rng) const;
+
+        aabb compute_instance_bounds(u32 instance) const;
 
     private:
         bvh m_tlas;
         aabb_container m_aabbs;
 
+        /// @brief The BLAS of each mesh, empty when the mesh uses the quantized one instead.
         std::vector<bvh> m_blas;
+        std::vector<quantized_bvh> m_quantizedBlas;
         std::vector<triangle_container> m_meshes;
 
-        std::vector<material> m_materials;
+        std::vector<raytracer_material> m_materials;
         std::vector<render_instance> m_instances;
 
+        /// @brief The inverse of the transform of each instance, used to move rays into the space of the BLAS.
+        std::vector<mat4> m_worldToLocal;
+
+        /// @brief The index of the box of each instance in the TLAS primitives, which are reordered by the build.
+        std::vector<u32> m_tlasIndices;
+
+        f32 m_tlasBuildCost{0.f};
+        f32 m_tlasRebuildThreshold{1.5f};
+        u32 m_tlasBuildsCount{0};
+        bool m_isTlasRefitNeeded{false};
+        bool m_isTlasRebuildNeeded{false};
+        bool m_isBlasQuantized{false};
+
         u32 m_numTriangles{0};
     };
 
@@ -103,6 +224,30 @@ namespace oblo
 
         void reset_accumulation();
 
+        /// @brief Sets how samples are distributed, clearing the converged state of the tiles.
+        void set_sampling(const raytracer_sampling& sampling);
+
+        const raytracer_sampling& get_sampling() const
+        {
+            return m_sampling;
+        }
+
+        /// @brief Sets the seed the random streams of the tiles are derived from.
+        void set_seed(u32 seed)
+        {
+            m_seed = seed;
+        }
+
+        u16 get_tile_size() const
+        {
+            return m_tileSize;
+        }
+
+        u32 get_tiles_count() const;
+
+        /// @brief The number of tiles that adaptive sampling stopped sampling.
+        u32 get_converged_tiles_count() const;
+
         u16 get_width() const
         {
             return m_width;
@@ -123,10 +268,23 @@ namespace oblo
             return m_radianceBuffer;
         }
 
+        /// @brief The number of samples accumulated in a pixel, the radiance buffer holds their sum.
         u32 get_num_samples_at(u16 x, u16 y) const;
 
     private:
-        u32 get_accumulation_offset(u16 x, u16 y) const;
+        struct tile_accumulation
+        {
+            /// @brief The number of passes rendered on the tile, which keys the random stream of the next pass.
+            u32 passes;
+
+            /// @brief The lowest number of samples accumulated in a pixel of the tile.
+            u32 minSamples;
+
+            bool isConverged;
+        };
+
+    private:
+        u32 get_tile_index(u16 x, u16 y) const;
 
     private:
         friend class raytracer;
@@ -136,8 +294,16 @@ namespace oblo
         u16 m_tileSize{0};
         u16 m_numTilesX{0};
         raytracer_metrics m_metrics{};
+        raytracer_sampling m_sampling{};
         std::vector<vec3> m_radianceBuffer;
-        std::vector<u32> m_accumulationBuffer;
-        std::mt19937 m_rng;
+
+        /// @brief The number of samples accumulated in each pixel.
+        std::vector<u32> m_samplesBuffer;
+
+        /// @brief The sum of the squared luminance of the samples of each pixel, to estimate their variance.
+        std::vector<f32> m_luminanceSquaredBuffer;
+
+        std::vector<tile_accumulation> m_tiles;
+        u32 m_seed{0};
     };
 }
\ No newline at end of file
@@ -64,6 +64,12 @@ namespace oblo
         }
     }
 
+    void aabb_container::set_aabb(u32 index, const aabb& aabb)
+    {
+        m_aabbs[index] = aabb;
+        m_centroids[index] = (aabb.max + aabb.min) * .5f;
+    }
+
     aabb aabb_container::primitives_bounds(u32 begin, u32 end) const
     {
         return oblo::compute_aabb(std::span(m_aabbs).subspan(begin, end - begin));
@@ -76,7 +82,7 @@ namespace oblo
 
     u32 aabb_container::partition_by_axis(u32 beginIndex, u32 endIndex, u8 axisIndex, f32 midPoint)
     {
-        const auto beginIt = zip_iterator{m_aabbs.begin(), m_aabbs.begin(), m_centroids.begin()};
+        const auto beginIt = zip_iterator{m_ids.begin(), m_aabbs.begin(), m_centroids.begin()};
 
         const auto rangeBegin = beginIt + beginIndex;
         const auto rangeEnd = beginIt + endIndex;
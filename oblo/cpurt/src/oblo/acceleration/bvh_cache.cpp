@@ -0,0 +1,248 @@
+#include <oblo/acceleration/bvh_cache.hpp>
+
+#include <oblo/acceleration/bvh.hpp>
+#include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/filesystem/file.hpp>
+#include <oblo/core/filesystem/filesystem.hpp>
+#include <oblo/core/filesystem/mapped_file.hpp>
+#include <oblo/core/hash.hpp>
+#include <oblo/core/string/string_builder.hpp>
+#include <oblo/math/power_of_two.hpp>
+#include <oblo/math/triangle.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+namespace oblo
+{
+    struct bvh_serializer
+    {
+        using node = bvh::bvh_node;
+
+        static std::span<const node> get_nodes(const bvh& bvh)
+        {
+            return bvh.m_nodes;
+        }
+
+        static void set_nodes(bvh& bvh, std::span<const node> nodes)
+        {
+            bvh.m_nodes.assign(nodes.begin(), nodes.end());
+        }
+    };
+
+    namespace
+    {
+        using bvh_node = bvh_serializer::node;
+
+        constexpr u32 CacheMagic{0x4856424F};
+
+        // Has to be increased whenever the layout of the file, of the nodes, or the way trees are built changes
+        constexpr u32 CacheVersion{1};
+
+        constexpr u64 SectionAlignment{32};
+
+        static_assert(std::is_trivially_copyable_v<bvh_node> && std::is_trivially_copyable_v<triangle>);
+        static_assert(SectionAlignment % alignof(bvh_node) == 0 && SectionAlignment % alignof(triangle) == 0);
+
+        struct cache_header
+        {
+            u32 magic;
+            u32 version;
+            u64 meshHash;
+            u32 nodesCount;
+            u32 trianglesCount;
+            u64 nodesOffset;
+            u64 trianglesOffset;
+        };
+
+        bool is_valid_section(std::span<const byte> file, u64 offset, u64 count, u64 elementSize)
+        {
+            return offset % SectionAlignment == 0 && offset <= file.size() &&
+                count <= (file.size() - offset) / elementSize;
+        }
+
+        /// @brief Checks that the nodes form a single tree no deeper than the traversal stacks allow, with children
+        /// after their parent and triangles in range, so that a corrupted file can't make traversals read out of
+        /// bounds or overflow their stack.
+        bool is_valid_tree(std::span<const bvh_node> nodes, u32 trianglesCount)
+        {
+            if (nodes.empty())
+            {
+                return true;
+            }
+
+            constexpr u8 Unreached{0xff};
+            static_assert(bvh::MaxDepth < Unreached);
+
+            // Children are stored after their parent, so a forward pass sees every parent before its children
+            dynamic_array<u8> depths;
+            depths.resize(nodes.size(), Unreached);
+            depths[0] = 0;
+
+            for (u32 nodeIndex = 0; nodeIndex < nodes.size(); ++nodeIndex)
+            {
+                const bvh_node& node = nodes[nodeIndex];
+
+                // Nodes that no parent references are not part of the tree
+                if (depths[nodeIndex] == Unreached)
+                {
+                    return false;
+                }
+
+                if (node.numPrimitives > 0)
+                {
+                    if (node.offset > trianglesCount || node.numPrimitives > trianglesCount - node.offset)
+                    {
+                        return false;
+                    }
+
+                    continue;
+                }
+
+                const u32 childDepth = depths[nodeIndex] + 1u;
+
+                if (node.offset <= nodeIndex + 1 || node.offset >= nodes.size() || childDepth >= bvh::MaxDepth)
+                {
+                    return false;
+                }
+
+                // Traversals index the direction signs of the ray with the split axis
+                if (node.splitAxis >= 3)
+                {
+                    return false;
+                }
+
+                for (const u32 child : {nodeIndex + 1, node.offset})
+                {
+                    // A node reached twice would be traversed more than once
+                    if (depths[child] != Unreached)
+                    {
+                        return false;
+                    }
+
+                    depths[child] = u8(childDepth);
+                }
+            }
+
+            return true;
+        }
+    }
+
+    u64 hash_triangles(std::span<const triangle> triangles)
+    {
+        return hash_xxh3(triangles.data(), triangles.size_bytes());
+    }
+
+    void make_bvh_cache_path(string_builder& out, cstring_view directory, u64 meshHash)
+    {
+        out.append(directory).append_path_separator().format("{:016x}.obvh", meshHash);
+    }
+
+    expected<> save_bvh_cache(cstring_view path, u64 meshHash, const bvh& bvh, const triangle_container& triangles)
+    {
+        const auto nodes = bvh_serializer::get_nodes(bvh);
+        const auto trianglesArray = triangles.get_triangles();
+
+        const u64 nodesOffset = align_power_of_two(u64{sizeof(cache_header)}, SectionAlignment);
+        const u64 trianglesOffset = align_power_of_two(nodesOffset + nodes.size_bytes(), SectionAlignment);
+
+        const cache_header header{
+            .magic = CacheMagic,
+            .version = CacheVersion,
+            .meshHash = meshHash,
+            .nodesCount = narrow_cast<u32>(nodes.size()),
+            .trianglesCount = narrow_cast<u32>(trianglesArray.size()),
+            .nodesOffset = nodesOffset,
+            .trianglesOffset = trianglesOffset,
+        };
+
+        dynamic_array<byte> out;
+        out.resize(trianglesOffset + trianglesArray.size_bytes(), byte{});
+
+        std::memcpy(out.data(), &header, sizeof(header));
+        std::memcpy(out.data() + nodesOffset, nodes.data(), nodes.size_bytes());
+        std::memcpy(out.data() + trianglesOffset, trianglesArray.data(), trianglesArray.size_bytes());
+
+        return filesystem::write_file(path, out, filesystem::write_mode::binary);
+    }
+
+    expected<> load_bvh_cache(cstring_view path, u64 meshHash, bvh& bvh, triangle_container& triangles)
+    {
+        filesystem::mapped_file file;
+
+        if (!file.open(path, filesystem::mapped_file_hint::sequential))
+        {
+            return "Failed to read BVH cache"_err;
+        }
+
+        const std::span<const byte> bytes = file.get_bytes();
+
+        cache_header header;
+
+        if (bytes.size() < sizeof(header))
+        {
+            return "Invalid BVH cache"_err;
+        }
+
+        std::memcpy(&header, bytes.data(), sizeof(header));
+
+        if (header.magic != CacheMagic || header.version != CacheVersion)
+        {
+            return "Invalid BVH cache"_err;
+        }
+
+        if (header.meshHash != meshHash)
+        {
+            return "The BVH cache was built on a different mesh"_err;
+        }
+
+        if (!is_valid_section(bytes, header.nodesOffset, header.nodesCount, sizeof(bvh_node)) ||
+            !is_valid_section(bytes, header.trianglesOffset, header.trianglesCount, sizeof(triangle)))
+        {
+            return "Invalid BVH cache"_err;
+        }
+
+        // Sections are aligned within the mapping, which is page aligned, so they can be read in place
+        const std::span nodes{reinterpret_cast<const bvh_node*>(bytes.data() + header.nodesOffset), header.nodesCount};
+
+        const std::span trianglesArray{
+            reinterpret_cast<const triangle*>(bytes.data() + header.trianglesOffset),
+            header.trianglesCount,
+        };
+
+        if (!is_valid_tree(nodes, header.trianglesCount))
+        {
+            return "Invalid BVH cache"_err;
+        }
+
+        bvh_serializer::set_nodes(bvh, nodes);
+
+        triangles.clear();
+        triangles.add(trianglesArray);
+
+        return no_error;
+    }
+
+    bvh_cache_status load_or_build_bvh(cstring_view directory, triangle_container& triangles, bvh& bvh)
+    {
+        const u64 meshHash = hash_triangles(triangles.get_triangles());
+
+        string_builder path;
+        make_bvh_cache_path(path, directory, meshHash);
+
+        if (load_bvh_cache(path, meshHash, bvh, triangles))
+        {
+            return bvh_cache_status::hit;
+        }
+
+        bvh.build_parallel(triangles);
+
+        if (!filesystem::create_directories(directory) || !save_bvh_cache(path, meshHash, bvh, triangles))
+        {
+            return bvh_cache_status::write_failed;
+        }
+
+        return bvh_cache_status::miss;
+    }
+}
@@ -1,5 +1,6 @@
 #include <oblo/acceleration/triangle_container.hpp>
 
+#include <oblo/acceleration/ray_packet.hpp>
 #include <oblo/core/iterator/zip_iterator.hpp>
 #include <oblo/core/utility.hpp>
 #include <oblo/math/aabb.hpp>
@@ -8,6 +9,7 @@
 #include <oblo/math/vec3.hpp>
 
 #include <algorithm>
+#include <bit>
 
 namespace oblo
 {
@@ -37,6 +39,14 @@ namespace oblo
         m_triangles.clear();
         m_aabbs.clear();
         m_centroids.clear();
+        m_normals.clear();
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            m_packed.v0[axis].clear();
+            m_packed.e1[axis].clear();
+            m_packed.e2[axis].clear();
+        }
     }
 
     void triangle_container::add(std::span<const triangle> triangles)
@@ -59,6 +69,15 @@ namespace oblo
             m_centroids.emplace_back(centroid);
             m_normals.emplace_back(normal);
         }
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            m_packed.v0[axis].resize(newSize);
+            m_packed.e1[axis].resize(newSize);
+            m_packed.e2[axis].resize(newSize);
+        }
+
+        update_packed(u32(currentSize), u32(newSize));
     }
 
     void triangle_container::reserve(std::size_t numTriangles)
@@ -67,6 +86,13 @@ namespace oblo
         m_aabbs.reserve(numTriangles);
         m_centroids.reserve(numTriangles);
         m_normals.reserve(numTriangles);
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            m_packed.v0[axis].reserve(numTriangles);
+            m_packed.e1[axis].reserve(numTriangles);
+            m_packed.e2[axis].reserve(numTriangles);
+        }
     }
 
     aabb triangle_container::primitives_bounds(u32 begin, u32 end) const
@@ -81,7 +107,22 @@ namespace oblo
 
     u32 triangle_container::partition_by_axis(u32 beginIndex, u32 endIndex, u8 axisIndex, f32 midPoint)
     {
-        const auto beginIt = zip_iterator{m_triangles.begin(), m_aabbs.begin(), m_centroids.begin(), m_normals.begin()};
+        auto& p = m_packed;
+
+        // The packed triangles are moved along with the others, rather than recomputed on the range at every level
+        const auto beginIt = zip_iterator{m_triangles.begin(),
+            m_aabbs.begin(),
+            m_centroids.begin(),
+            m_normals.begin(),
+            p.v0[0].begin(),
+            p.v0[1].begin(),
+            p.v0[2].begin(),
+            p.e1[0].begin(),
+            p.e1[1].begin(),
+            p.e1[2].begin(),
+            p.e2[0].begin(),
+            p.e2[1].begin(),
+            p.e2[2].begin()};
 
         const auto rangeBegin = beginIt + beginIndex;
         const auto rangeEnd = beginIt + endIndex;
@@ -116,6 +157,185 @@ namespace oblo
         return hit;
     }
 
+    bool triangle_container::intersect_any(const ray& ray, u32 beginIndex, u16 numPrimitives, f32 maxDistance) const
+    {
+        for (const auto& triangle : std::span{m_triangles}.subspan(beginIndex, numPrimitives))
+        {
+            if (f32 distance; oblo::intersect(ray, triangle, distance) && distance < maxDistance)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    u32 triangle_container::intersect_packet(const ray_packet& packet,
+        u32 beginIndex,
+        u16 numPrimitives,
+        u32 rayMask,
+        f32x8& distances,
+        u32* triangleIndices) const
+    {
+        const f32x8 o[3] = {
+            f32x8::load(packet.origin[0]),
+            f32x8::load(packet.origin[1]),
+            f32x8::load(packet.origin[2]),
+        };
+
+        const f32x8 d[3] = {
+            f32x8::load(packet.direction[0]),
+            f32x8::load(packet.direction[1]),
+            f32x8::load(packet.direction[2]),
+        };
+
+        f32x8 indices = f32x8::broadcast(0.f);
+        u32 hitMask{0};
+
+        for (u32 triangleIndex = beginIndex; triangleIndex < beginIndex + numPrimitives; ++triangleIndex)
+        {
+            f32x8 t;
+
+            if (const u32 laneMask = intersect_packed(o, d, triangleIndex, rayMask, distances, t); laneMask != 0)
+            {
+                // Inactive lanes may have hit as well, only keep the ones in the mask
+                const f32x8 selection = f32x8::from_bitmask(laneMask);
+
+                distances = select(selection, t, distances);
+                indices = select(selection, f32x8::broadcast(std::bit_cast<f32>(triangleIndex)), indices);
+
+                hitMask |= laneMask;
+            }
+        }
+
+        if (hitMask != 0)
+        {
+            alignas(32) f32 laneIndices[f32x8::Width];
+            indices.store(laneIndices);
+
+            for (u32 lane = 0; lane < f32x8::Width; ++lane)
+            {
+                if ((hitMask >> lane) & 1)
+                {
+                    triangleIndices[lane] = std::bit_cast<u32>(laneIndices[lane]);
+                }
+            }
+        }
+
+        return hitMask;
+    }
+
+    u32 triangle_container::intersect_packet_any(const ray_packet& packet,
+        u32 beginIndex,
+        u16 numPrimitives,
+        u32 rayMask,
+        const f32x8& maxDistances) const
+    {
+        const f32x8 o[3] = {
+            f32x8::load(packet.origin[0]),
+            f32x8::load(packet.origin[1]),
+            f32x8::load(packet.origin[2]),
+        };
+
+        const f32x8 d[3] = {
+            f32x8::load(packet.direction[0]),
+            f32x8::load(packet.direction[1]),
+            f32x8::load(packet.direction[2]),
+        };
+
+        u32 hitMask{0};
+
+        for (u32 triangleIndex = beginIndex; triangleIndex < beginIndex + numPrimitives; ++triangleIndex)
+        {
+            f32x8 t;
+            hitMask |= intersect_packed(o, d, triangleIndex, rayMask & ~hitMask, maxDistances, t);
+
+            if (hitMask == rayMask)
+            {
+                break;
+            }
+        }
+
+        return hitMask;
+    }
+
+    u32 triangle_container::intersect_packed(const f32x8 (&o)[3],
+        const f32x8 (&d)[3],
+        u32 triangleIndex,
+        u32 rayMask,
+        const f32x8& distances,
+        f32x8& t) const
+    {
+        // Same algorithm as moeller_trumbore::intersect, one lane per ray, with the triangle broadcast to all lanes
+        constexpr f32 Epsilon = .0000001f;
+
+        const f32x8 zero = f32x8::broadcast(0.f);
+        const f32x8 one = f32x8::broadcast(1.f);
+        const f32x8 epsilon = f32x8::broadcast(Epsilon);
+        const f32x8 negativeEpsilon = f32x8::broadcast(-Epsilon);
+
+        f32x8 v0[3], e1[3], e2[3];
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            v0[axis] = f32x8::broadcast(m_packed.v0[axis][triangleIndex]);
+            e1[axis] = f32x8::broadcast(m_packed.e1[axis][triangleIndex]);
+            e2[axis] = f32x8::broadcast(m_packed.e2[axis][triangleIndex]);
+        }
+
+        const f32x8 h[3] = {
+            d[1] * e2[2] - d[2] * e2[1],
+            d[2] * e2[0] - d[0] * e2[2],
+            d[0] * e2[1] - d[1] * e2[0],
+        };
+
+        const f32x8 det = e1[0] * h[0] + e1[1] * h[1] + e1[2] * h[2];
+        f32x8 valid = (det <= negativeEpsilon) | (det >= epsilon);
+
+        if ((valid.movemask() & rayMask) == 0)
+        {
+            return 0;
+        }
+
+        const f32x8 invDet = one / det;
+        const f32x8 s[3] = {o[0] - v0[0], o[1] - v0[1], o[2] - v0[2]};
+
+        const f32x8 u = invDet * (s[0] * h[0] + s[1] * h[1] + s[2] * h[2]);
+        valid = valid & (u >= zero) & (u <= one);
+
+        const f32x8 q[3] = {
+            s[1] * e1[2] - s[2] * e1[1],
+            s[2] * e1[0] - s[0] * e1[2],
+            s[0] * e1[1] - s[1] * e1[0],
+        };
+
+        const f32x8 v = invDet * (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]);
+        valid = valid & (v >= zero) & (u + v <= one);
+
+        t = invDet * (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]);
+        valid = valid & (t > epsilon) & (t < distances);
+
+        return valid.movemask() & rayMask;
+    }
+
+    void triangle_container::update_packed(u32 beginIndex, u32 endIndex)
+    {
+        for (u32 i = beginIndex; i < endIndex; ++i)
+        {
+            const triangle& t = m_triangles[i];
+
+            const vec3 e1 = t.v[1] - t.v[0];
+            const vec3 e2 = t.v[2] - t.v[0];
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                m_packed.v0[axis][i] = t.v[0][axis];
+                m_packed.e1[axis][i] = e1[axis];
+                m_packed.e2[axis][i] = e2[axis];
+            }
+        }
+    }
+
     std::span<const triangle> triangle_container::get_triangles() const
     {
         return m_triangles;
@@ -135,4 +355,17 @@ namespace oblo
     {
         return m_normals;
     }
+
+    usize triangle_container::get_memory_footprint() const
+    {
+        usize size = m_triangles.size() * sizeof(triangle) + m_aabbs.size() * sizeof(aabb) +
+            m_centroids.size() * sizeof(vec3) + m_normals.size() * sizeof(vec3);
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            size += (m_packed.v0[axis].size() + m_packed.e1[axis].size() + m_packed.e2[axis].size()) * sizeof(f32);
+        }
+
+        return size;
+    }
 }
\ No newline at end of file
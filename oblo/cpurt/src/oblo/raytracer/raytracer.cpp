@@ -1,9 +1,19 @@
 #include <oblo/raytracer/raytracer.hpp>
 
 #include <oblo/acceleration/bvh.hpp>
+#include <oblo/acceleration/quantized_bvh.hpp>
+#include <oblo/acceleration/ray_packet.hpp>
 #include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/core/time/clock.hpp>
 #include <oblo/math/random.hpp>
+#include <oblo/raytracer/counter_rng.hpp>
 #include <oblo/raytracer/material.hpp>
+#include <oblo/thread/job_manager.hpp>
+#include <oblo/thread/parallel_for.hpp>
+
+#include <bit>
+#include <limits>
+#include <random>
 
 namespace oblo
 {
@@ -22,12 +32,138 @@ namespace oblo
             vec3 reflectance;
             u32 parentIndex;
         };
+
+        /// @brief The samples each pixel receives on a pass, adaptive passes spend the same total on the tile.
+        constexpr u32 SamplesPerPass{4};
+
+        /// @brief The most samples a single pixel can receive on an adaptive pass.
+        constexpr u32 MaxAdaptiveSamplesPerPass{4 * SamplesPerPass};
+
+        f32 luminance(const vec3& c)
+        {
+            return dot(c, vec3{.2126f, .7152f, .0722f});
+        }
+
+        /// @brief Estimates the standard error of the mean luminance of a pixel, relative to the mean.
+        f32 estimate_relative_error(const vec3& radianceSum, f32 luminanceSquaredSum, u32 samples)
+        {
+            if (samples < 2)
+            {
+                return std::numeric_limits<f32>::infinity();
+            }
+
+            // Dark pixels would need a huge number of samples to reach a relative threshold, below this luminance the
+            // error is measured in absolute terms instead
+            constexpr f32 minLuminance{1e-2f};
+
+            const f32 n = f32(samples);
+            const f32 mean = luminance(radianceSum) / n;
+            const f32 variance = max(0.f, luminanceSquaredSum / n - mean * mean) * n / (n - 1.f);
+
+            return std::sqrt(variance / n) / max(mean, minLuminance);
+        }
+
+        vec3 transform_point(const mat4& m, const vec3& p)
+        {
+            const vec4 r = m * vec4{p.x, p.y, p.z, 1.f};
+            return {r.x, r.y, r.z};
+        }
+
+        vec3 transform_direction(const mat4& m, const vec3& d)
+        {
+            const vec4 r = m * vec4{d.x, d.y, d.z, 0.f};
+            return {r.x, r.y, r.z};
+        }
+
+        /// @brief Transforms a normal with the inverse transpose of a transform, given its inverse.
+        vec3 transform_normal(const mat4& inverseTransform, const vec3& n)
+        {
+            vec3 r;
+
+            for (u32 i = 0; i < 3; ++i)
+            {
+                r[i] = inverseTransform.at(0, i) * n.x + inverseTransform.at(1, i) * n.y +
+                    inverseTransform.at(2, i) * n.z;
+            }
+
+            return normalize(r);
+        }
+
+        /// @brief Moves a ray into the space of a BLAS. The direction is not normalized, so that distances along the
+        /// ray are the same in both spaces and can be compared across instances.
+        ray transform_ray(const mat4& worldToLocal, const ray& r)
+        {
+            return {transform_point(worldToLocal, r.origin), transform_direction(worldToLocal, r.direction)};
+        }
+
+        ray_packet transform_packet(const mat4& worldToLocal, const ray_packet& packet)
+        {
+            ray_packet r;
+
+            for (u32 i = 0; i < 3; ++i)
+            {
+                for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+                {
+                    const f32 ox = packet.origin[0][lane];
+                    const f32 oy = packet.origin[1][lane];
+                    const f32 oz = packet.origin[2][lane];
+
+                    const f32 dx = packet.direction[0][lane];
+                    const f32 dy = packet.direction[1][lane];
+                    const f32 dz = packet.direction[2][lane];
+
+                    r.origin[i][lane] = worldToLocal.at(i, 0) * ox + worldToLocal.at(i, 1) * oy +
+                        worldToLocal.at(i, 2) * oz + worldToLocal.at(i, 3);
+
+                    r.direction[i][lane] =
+                        worldToLocal.at(i, 0) * dx + worldToLocal.at(i, 1) * dy + worldToLocal.at(i, 2) * dz;
+                }
+            }
+
+            return r;
+        }
+
+        /// @brief Computes the bounds of a transformed box, without going through its 8 corners.
+        aabb transform_aabb(const mat4& m, const aabb& box)
+        {
+            aabb r;
+
+            for (u32 i = 0; i < 3; ++i)
+            {
+                r.min[i] = m.at(i, 3);
+                r.max[i] = m.at(i, 3);
+
+                for (u32 j = 0; j < 3; ++j)
+                {
+                    const f32 a = m.at(i, j) * box.min[j];
+                    const f32 b = m.at(i, j) * box.max[j];
+
+                    r.min[i] += min(a, b);
+                    r.max[i] += max(a, b);
+                }
+            }
+
+            return r;
+        }
+
+        /// @brief Calls the function on the quantized BLAS of a mesh when it has one, on the regular one otherwise.
+        template <typename F>
+        decltype(auto) visit_blas(const bvh& blas, const quantized_bvh& quantizedBlas, F&& f)
+        {
+            if (!quantizedBlas.empty())
+            {
+                return f(quantizedBlas);
+            }
+
+            return f(blas);
+        }
     }
 
     struct raytracer::trace_context
     {
         std::vector<trace_cast> casts[2];
         std::vector<trace_output> output;
+        u32 numTracedRays;
     };
 
     raytracer::raytracer() = default;
@@ -37,22 +173,40 @@ namespace oblo
     void raytracer::reserve(u32 numMeshes)
     {
         m_blas.reserve(numMeshes);
+        m_quantizedBlas.reserve(numMeshes);
         m_meshes.reserve(numMeshes);
     }
 
     u32 raytracer::add_mesh(triangle_container inTriangles)
     {
-        u32 index = narrow_cast<u32>(m_meshes.size());
-        auto& triangles = m_meshes.emplace_back(std::move(inTriangles));
-        auto& bvh = m_blas.emplace_back();
+        bvh blas;
+        blas.build_parallel(inTriangles);
+
+        return add_mesh(std::move(inTriangles), std::move(blas));
+    }
 
+    u32 raytracer::add_mesh(triangle_container triangles, bvh blas)
+    {
+        u32 index = narrow_cast<u32>(m_meshes.size());
         m_numTriangles += triangles.size();
 
-        bvh.build(triangles);
+        m_meshes.emplace_back(std::move(triangles));
+
+        auto& quantizedBlas = m_quantizedBlas.emplace_back();
+
+        if (m_isBlasQuantized)
+        {
+            // Only the quantized tree is kept, the empty bvh is left in place to keep indices aligned
+            quantizedBlas.build(blas);
+            blas = {};
+        }
+
+        m_blas.emplace_back(std::move(blas));
+
         return index;
     }
 
-    u32 raytracer::add_material(const material& material)
+    u32 raytracer::add_material(const raytracer_material& material)
     {
         u32 index = narrow_cast<u32>(m_materials.size());
         m_materials.emplace_back(material);
@@ -63,9 +217,45 @@ namespace oblo
     {
         u32 index = narrow_cast<u32>(m_instances.size());
         m_instances.emplace_back(instance);
+        m_worldToLocal.emplace_back(inverse(instance.transform).assert_value_or(mat4::identity()));
+        m_isTlasRebuildNeeded = true;
         return index;
     }
 
+    void raytracer::set_instance_transform(u32 instance, const mat4& transform)
+    {
+        m_instances[instance].transform = transform;
+        m_worldToLocal[instance] = inverse(transform).assert_value_or(mat4::identity());
+
+        // When instances were added or removed the TLAS is going to be rebuilt anyway
+        if (!m_isTlasRebuildNeeded)
+        {
+            m_aabbs.set_aabb(m_tlasIndices[instance], compute_instance_bounds(instance));
+            m_isTlasRefitNeeded = true;
+        }
+    }
+
+    void raytracer::remove_instance(u32 instance)
+    {
+        m_instances[instance] = m_instances.back();
+        m_instances.pop_back();
+
+        m_worldToLocal[instance] = m_worldToLocal.back();
+        m_worldToLocal.pop_back();
+
+        m_isTlasRebuildNeeded = true;
+    }
+
+    void raytracer::set_quantized_blas(bool enable)
+    {
+        m_isBlasQuantized = enable;
+    }
+
+    u32 raytracer::get_instances_count() const
+    {
+        return narrow_cast<u32>(m_instances.size());
+    }
+
     std::span<const triangle_container> raytracer::get_meshes() const
     {
         return m_meshes;
@@ -74,13 +264,20 @@ namespace oblo
     void raytracer::clear()
     {
         m_blas.clear();
+        m_quantizedBlas.clear();
         m_tlas.clear();
 
         m_meshes.clear();
         m_materials.clear();
         m_instances.clear();
+        m_worldToLocal.clear();
+        m_tlasIndices.clear();
         m_aabbs.clear();
 
+        m_tlasBuildCost = 0.f;
+        m_isTlasRefitNeeded = false;
+        m_isTlasRebuildNeeded = false;
+
         m_numTriangles = 0;
     }
 
@@ -92,58 +289,296 @@ namespace oblo
             return;
         }
 
-        constexpr u32 numSamples = 4;
+        trace_context context{};
+        render_tile_impl(state, camera, minX, minY, maxX, maxY, context, state.m_metrics);
+    }
+
+    void raytracer::render_frame(raytracer_state& state, const camera& camera) const
+    {
+        if (m_tlas.empty())
+        {
+            return;
+        }
+
+        const u16 tileSize = state.m_tileSize;
+        OBLO_ASSERT(tileSize > 0, "The state has to be resized with a tile size");
 
-        constexpr vec2 uvStart{-1.f, -1.f};
-        const vec2 uvOffset{2.f / state.m_width, 2.f / state.m_height};
+        const u32 numTilesX = state.m_numTilesX;
+        const u32 numTiles = state.get_tiles_count();
 
-        std::uniform_real_distribution<f32> jitterDistX{-1.f / state.m_width, 1.f / state.m_width};
-        std::uniform_real_distribution<f32> jitterDistY{-1.f / state.m_height, 1.f / state.m_height};
+        std::vector<raytracer_metrics> tileMetrics(numTiles);
 
-        const auto accumulationBuffer = state.m_accumulationBuffer.data() + state.get_accumulation_offset(minX, minY);
-        *accumulationBuffer += numSamples;
-        state.m_metrics.numTotalSamples = *accumulationBuffer;
+        const auto renderTiles = [&](const job_range range)
+        {
+            trace_context context{};
 
-        trace_context context{};
+            for (u32 tileIndex = range.begin; tileIndex < range.end; ++tileIndex)
+            {
+                const auto minX = u16((tileIndex % numTilesX) * tileSize);
+                const auto minY = u16((tileIndex / numTilesX) * tileSize);
+                const auto maxX = u16(min(u32{minX} + tileSize, u32{state.m_width}));
+                const auto maxY = u16(min(u32{minY} + tileSize, u32{state.m_height}));
+
+                render_tile_impl(state, camera, minX, minY, maxX, maxY, context, tileMetrics[tileIndex]);
+            }
+        };
+
+        if (job_manager::get())
+        {
+            // One tile per job, tiles write to disjoint parts of the buffers and to their own metrics
+            parallel_for(renderTiles, job_range{0, numTiles}, 1);
+        }
+        else
+        {
+            renderTiles(job_range{0, numTiles});
+        }
+
+        raytracer_metrics metrics{
+            .width = state.m_width,
+            .height = state.m_height,
+            .numObjects = m_aabbs.size(),
+            .numTriangles = m_numTriangles,
+            .numPrimaryRays = 0,
+            .numTotalSamples = ~0u,
+            .numTracedRays = 0,
+            .numTiles = numTiles,
+            .numConvergedTiles = 0,
+        };
+
+        for (const auto& tile : tileMetrics)
+        {
+            metrics.numPrimaryRays += tile.numPrimaryRays;
+            metrics.numTotalSamples = min(metrics.numTotalSamples, tile.numTotalSamples);
+            metrics.numTracedRays += tile.numTracedRays;
+            metrics.numConvergedTiles += tile.numConvergedTiles;
+        }
+
+        state.m_metrics = metrics;
+    }
+
+    u32 raytracer::render_progressive(raytracer_state& state, const camera& camera, time budget) const
+    {
+        // Passes don't render anything in this case, so they would never converge and spin for the whole budget
+        if (m_tlas.empty() || state.m_tiles.empty())
+        {
+            return 0;
+        }
+
+        const time start = clock::now();
+
+        u32 passes{0};
+        u32 numPrimaryRays{0};
+        u32 numTracedRays{0};
+
+        while (true)
+        {
+            const time passStart = clock::now();
+
+            render_frame(state, camera);
+
+            ++passes;
+            numPrimaryRays += state.m_metrics.numPrimaryRays;
+            numTracedRays += state.m_metrics.numTracedRays;
+
+            if (state.m_metrics.numConvergedTiles == state.get_tiles_count())
+            {
+                break;
+            }
+
+            // Passes get cheaper as tiles converge, so the last one is a conservative estimate of the next
+            const time now = clock::now();
+
+            if (now - start + (now - passStart) > budget)
+            {
+                break;
+            }
+        }
+
+        state.m_metrics.numPrimaryRays = numPrimaryRays;
+        state.m_metrics.numTracedRays = numTracedRays;
+
+        return passes;
+    }
+
+    void raytracer::render_tile_impl(raytracer_state& state,
+        const camera& camera,
+        u16 minX,
+        u16 minY,
+        u16 maxX,
+        u16 maxY,
+        trace_context& context,
+        raytracer_metrics& metrics) const
+    {
+        const raytracer_sampling& sampling = state.m_sampling;
+
+        const u32 tileIndex = state.get_tile_index(minX, minY);
+        raytracer_state::tile_accumulation& tile = state.m_tiles[tileIndex];
+
+        const auto w = u16(maxX - minX);
+        const auto h = u16(maxY - minY);
+
+        context.numTracedRays = 0;
 
-        vec2 uv;
+        u32 numSampledPixels{0};
 
-        for (u16 y = minY; y < maxY; ++y)
+        // Adaptive passes only start once every pixel has enough samples to estimate its variance
+        const bool isAdaptivePass = sampling.isAdaptive && tile.minSamples >= max(sampling.minSamples, 2u);
+
+        // Adaptive passes spend the same number of samples as uniform ones, distributed proportionally to the error
+        // of the pixels that are above the threshold
+        f32 samplesPerError{0.f};
+
+        const auto getPixelError = [&state, &sampling](u32 pixelIndex)
         {
-            const auto baseY = uvStart.y + uvOffset.y * y;
-            vec3* pixelOut = state.m_radianceBuffer.data() + state.m_width * y + minX;
+            const u32 samples = state.m_samplesBuffer[pixelIndex];
 
-            for (u16 x = minX; x < maxX; ++x)
+            if (samples >= sampling.maxSamples)
             {
-                ray rays[numSamples];
+                return 0.f;
+            }
+
+            const f32 error = estimate_relative_error(state.m_radianceBuffer[pixelIndex],
+                state.m_luminanceSquaredBuffer[pixelIndex],
+                samples);
+
+            return error > sampling.noiseThreshold ? error : 0.f;
+        };
 
-                for (auto& ray : rays)
+        if (isAdaptivePass && !tile.isConverged)
+        {
+            f32 totalError{0.f};
+
+            for (u16 y = minY; y < maxY; ++y)
+            {
+                for (u16 x = minX; x < maxX; ++x)
                 {
-                    uv.y = baseY + jitterDistY(state.m_rng);
-                    uv.x = uvStart.x + uvOffset.x * x + jitterDistX(state.m_rng);
+                    totalError += getPixelError(u32{state.m_width} * y + x);
+                }
+            }
+
+            if (totalError > 0.f)
+            {
+                samplesPerError = f32(SamplesPerPass * w * h) / totalError;
+            }
+            else
+            {
+                tile.isConverged = true;
+            }
+        }
+
+        if (!tile.isConverged)
+        {
+            constexpr vec2 uvStart{-1.f, -1.f};
+            const vec2 uvOffset{2.f / state.m_width, 2.f / state.m_height};
+
+            std::uniform_real_distribution<f32> jitterDistX{-1.f / state.m_width, 1.f / state.m_width};
+            std::uniform_real_distribution<f32> jitterDistY{-1.f / state.m_height, 1.f / state.m_height};
+
+            counter_rng rng{counter_rng::make_key(state.m_seed, tileIndex, tile.passes)};
+            ++tile.passes;
 
-                    ray = ray_cast(camera, uv);
+            // Rays are gathered in scanline order and traced in batches, so that primary rays of neighbouring pixels
+            // fill the same packets even when pixels receive different numbers of samples
+            constexpr u32 batchSize{MaxAdaptiveSamplesPerPass};
+            static_assert(batchSize % ray_packet::Size == 0);
+
+            ray rays[batchSize];
+            u32 rayPixels[batchSize];
+            u32 numRays{0};
+
+            const auto traceBatch = [&]
+            {
+                trace(context, std::span{rays}.first(numRays), rng);
+
+                for (u32 i = 0; i < numRays; ++i)
+                {
+                    const u32 pixelIndex = rayPixels[i];
+                    const vec3& irradiance = context.output[i].irradiance;
+                    const f32 l = luminance(irradiance);
+
+                    state.m_radianceBuffer[pixelIndex] += irradiance;
+                    state.m_luminanceSquaredBuffer[pixelIndex] += l * l;
+                    ++state.m_samplesBuffer[pixelIndex];
                 }
 
-                trace(context, rays, state);
+                numRays = 0;
+            };
+
+            vec2 uv;
+
+            for (u16 y = minY; y < maxY; ++y)
+            {
+                const auto baseY = uvStart.y + uvOffset.y * y;
 
-                for (const auto& sample : std::span{context.output}.first(numSamples))
+                for (u16 x = minX; x < maxX; ++x)
                 {
-                    *pixelOut += sample.irradiance;
+                    const u32 pixelIndex = u32{state.m_width} * y + x;
+
+                    u32 numSamples = SamplesPerPass;
+
+                    if (isAdaptivePass)
+                    {
+                        numSamples = 0;
+
+                        if (const f32 error = getPixelError(pixelIndex); error > 0.f)
+                        {
+                            const u32 remaining = sampling.maxSamples - state.m_samplesBuffer[pixelIndex];
+                            const u32 maxSamples = min(MaxAdaptiveSamplesPerPass, remaining);
+
+                            // Pixels above the threshold get at least one sample, so that no pixel is starved
+                            numSamples = min(max(u32(error * samplesPerError + .5f), 1u), maxSamples);
+                        }
+                    }
+
+                    if (numSamples == 0)
+                    {
+                        continue;
+                    }
+
+                    ++numSampledPixels;
+
+                    for (u32 sample = 0; sample < numSamples; ++sample)
+                    {
+                        uv.y = baseY + jitterDistY(rng);
+                        uv.x = uvStart.x + uvOffset.x * x + jitterDistX(rng);
+
+                        rays[numRays] = ray_cast(camera, uv);
+                        rayPixels[numRays] = pixelIndex;
+
+                        if (++numRays == batchSize)
+                        {
+                            traceBatch();
+                        }
+                    }
                 }
+            }
+
+            if (numRays > 0)
+            {
+                traceBatch();
+            }
 
-                ++pixelOut;
+            tile.minSamples = ~0u;
+
+            for (u16 y = minY; y < maxY; ++y)
+            {
+                for (u16 x = minX; x < maxX; ++x)
+                {
+                    tile.minSamples = min(tile.minSamples, state.m_samplesBuffer[u32{state.m_width} * y + x]);
+                }
             }
         }
 
         {
-            const auto w = u16(maxX - minX);
-            const auto h = u16(maxY - minY);
-            state.m_metrics.width = w;
-            state.m_metrics.height = h;
-            state.m_metrics.numObjects = m_aabbs.size();
-            state.m_metrics.numTriangles = m_numTriangles;
-            state.m_metrics.numPrimaryRays = w * h;
+            metrics.width = w;
+            metrics.height = h;
+            metrics.numObjects = m_aabbs.size();
+            metrics.numTriangles = m_numTriangles;
+            metrics.numPrimaryRays = numSampledPixels;
+            metrics.numTotalSamples = tile.minSamples;
+            metrics.numTracedRays = context.numTracedRays;
+            metrics.numTiles = 1;
+            metrics.numConvergedTiles = u32{tile.isConverged};
         }
     }
 
@@ -156,14 +591,70 @@ namespace oblo
         u32 id = 0;
         m_aabbs.reserve(numInstances);
 
-        for (const auto& instance : m_instances)
+        for (u32 instance = 0; instance < numInstances; ++instance)
         {
-            const auto meshIndex = instance.mesh;
-            const auto aabb = m_blas[meshIndex].get_bounds();
+            const auto aabb = compute_instance_bounds(instance);
             m_aabbs.add({&aabb, 1}, id++);
         }
 
         m_tlas.build(m_aabbs);
+
+        m_tlasIndices.resize(numInstances);
+
+        const auto ids = m_aabbs.get_ids();
+
+        for (u32 index = 0; index < numInstances; ++index)
+        {
+            m_tlasIndices[ids[index]] = index;
+        }
+
+        m_tlasBuildCost = m_tlas.compute_sah_cost();
+        m_isTlasRefitNeeded = false;
+        m_isTlasRebuildNeeded = false;
+        ++m_tlasBuildsCount;
+    }
+
+    void raytracer::update_tlas()
+    {
+        if (m_isTlasRebuildNeeded)
+        {
+            rebuild_tlas();
+            return;
+        }
+
+        if (!m_isTlasRefitNeeded)
+        {
+            return;
+        }
+
+        m_tlas.refit(m_aabbs);
+        m_isTlasRefitNeeded = false;
+
+        if (m_tlas.compute_sah_cost() > m_tlasBuildCost * m_tlasRebuildThreshold)
+        {
+            rebuild_tlas();
+        }
+    }
+
+    void raytracer::set_tlas_rebuild_threshold(f32 threshold)
+    {
+        m_tlasRebuildThreshold = threshold;
+    }
+
+    u32 raytracer::get_tlas_builds_count() const
+    {
+        return m_tlasBuildsCount;
+    }
+
+    aabb raytracer::compute_instance_bounds(u32 instance) const
+    {
+        const auto& renderInstance = m_instances[instance];
+        const auto mesh = renderInstance.mesh;
+
+        const aabb bounds =
+            visit_blas(m_blas[mesh], m_quantizedBlas[mesh], [](const auto& blas) { return blas.get_bounds(); });
+
+        return transform_aabb(renderInstance.transform, bounds);
     }
 
     bool raytracer::intersect(const ray& ray, raytracer_result& out) const
@@ -194,21 +685,27 @@ namespace oblo
                         u32 triangle;
                         bool bestResult = false;
 
-                        m_blas[meshIndex].traverse(ray,
+                        const auto localRay = transform_ray(m_worldToLocal[instanceIndex], ray);
+
+                        const auto intersectLeaf =
                             [&, &container = m_meshes[meshIndex]](u32 firstIndex, u16 numPrimitives, f32& distance)
-                            {
-                                triangle_container::hit_result hitResult;
+                        {
+                            triangle_container::hit_result hitResult;
 
-                                const bool anyIntersection =
-                                    container.intersect(ray, firstIndex, numPrimitives, distance, hitResult);
+                            const bool anyIntersection =
+                                container.intersect(localRay, firstIndex, numPrimitives, distance, hitResult);
 
-                                if (anyIntersection && distance < currentDistance)
-                                {
-                                    bestResult = true;
-                                    currentDistance = distance;
-                                    triangle = hitResult.index;
-                                }
-                            });
+                            if (anyIntersection && distance < currentDistance)
+                            {
+                                bestResult = true;
+                                currentDistance = distance;
+                                triangle = hitResult.index;
+                            }
+                        };
+
+                        visit_blas(m_blas[meshIndex],
+                            m_quantizedBlas[meshIndex],
+                            [&](const auto& blas) { blas.traverse(localRay, intersectLeaf); });
 
                         if (bestResult)
                         {
@@ -228,7 +725,252 @@ namespace oblo
         return found;
     }
 
-    void raytracer::trace(trace_context& context, std::span<const ray> initialRays, raytracer_state& state) const
+    bool raytracer::occluded(const ray& ray, f32 maxDistance) const
+    {
+        const auto allAabbs = m_aabbs.get_aabbs();
+        const auto allIds = m_aabbs.get_ids();
+
+        return m_tlas.traverse_any(ray,
+            maxDistance,
+            [&](u32 firstIndex, u16 numPrimitives)
+            {
+                for (u32 aabbIndex = firstIndex; aabbIndex < firstIndex + numPrimitives; ++aabbIndex)
+                {
+                    if (f32 t0, t1; !oblo::intersect(ray, allAabbs[aabbIndex], maxDistance, t0, t1))
+                    {
+                        continue;
+                    }
+
+                    const auto instanceIndex = allIds[aabbIndex];
+                    const auto meshIndex = m_instances[instanceIndex].mesh;
+                    const auto& container = m_meshes[meshIndex];
+
+                    const auto localRay = transform_ray(m_worldToLocal[instanceIndex], ray);
+
+                    const auto intersectLeaf = [&](u32 firstTriangle, u16 numTriangles)
+                    { return container.intersect_any(localRay, firstTriangle, numTriangles, maxDistance); };
+
+                    const bool anyHit = visit_blas(m_blas[meshIndex],
+                        m_quantizedBlas[meshIndex],
+                        [&](const auto& blas) { return blas.traverse_any(localRay, maxDistance, intersectLeaf); });
+
+                    if (anyHit)
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            });
+    }
+
+    u32 raytracer::occluded(std::span<const ray> rays, std::span<const f32> maxDistances, std::span<bool> results) const
+    {
+        OBLO_ASSERT(rays.size() == maxDistances.size() && rays.size() == results.size());
+
+        const auto allAabbs = m_aabbs.get_aabbs();
+        const auto allIds = m_aabbs.get_ids();
+
+        u32 numOccluded{0};
+
+        for (usize first = 0; first < rays.size(); first += ray_packet::Size)
+        {
+            const usize numRays = min(usize{ray_packet::Size}, rays.size() - first);
+
+            ray_packet packet;
+            alignas(32) f32 laneDistances[ray_packet::Size];
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                // Unused lanes are masked out, but they are filled to avoid operating on garbage
+                const usize index = first + (lane < numRays ? lane : 0);
+                packet.set(lane, rays[index]);
+                laneDistances[lane] = maxDistances[index];
+            }
+
+            const f32x8 origin[3] = {
+                f32x8::load(packet.origin[0]),
+                f32x8::load(packet.origin[1]),
+                f32x8::load(packet.origin[2]),
+            };
+
+            const f32x8 one = f32x8::broadcast(1.f);
+
+            const f32x8 invDirection[3] = {
+                one / f32x8::load(packet.direction[0]),
+                one / f32x8::load(packet.direction[1]),
+                one / f32x8::load(packet.direction[2]),
+            };
+
+            const f32x8 distances = f32x8::load(laneDistances);
+            const u32 activeMask = (1u << numRays) - 1;
+
+            const u32 occludedMask = m_tlas.traverse_packet_any(packet,
+                activeMask,
+                distances,
+                [&](u32 firstIndex, u16 numPrimitives, u32 rayMask)
+                {
+                    u32 hitMask{0};
+
+                    for (u32 aabbIndex = firstIndex; aabbIndex < firstIndex + numPrimitives; ++aabbIndex)
+                    {
+                        const u32 instanceMask =
+                            oblo::intersect_packet(origin, invDirection, allAabbs[aabbIndex], distances).movemask() &
+                            rayMask & ~hitMask;
+
+                        if (instanceMask == 0)
+                        {
+                            continue;
+                        }
+
+                        const auto instanceIndex = allIds[aabbIndex];
+                        const auto meshIndex = m_instances[instanceIndex].mesh;
+                        const auto& container = m_meshes[meshIndex];
+
+                        const ray_packet localPacket = transform_packet(m_worldToLocal[instanceIndex], packet);
+
+                        const auto intersectLeaf = [&](u32 firstTriangle, u16 numTriangles, u32 leafMask)
+                        {
+                            return container.intersect_packet_any(localPacket,
+                                firstTriangle,
+                                numTriangles,
+                                leafMask,
+                                distances);
+                        };
+
+                        hitMask |= visit_blas(m_blas[meshIndex],
+                            m_quantizedBlas[meshIndex],
+                            [&](const auto& blas)
+                            { return blas.traverse_packet_any(localPacket, instanceMask, distances, intersectLeaf); });
+
+                        if (hitMask == rayMask)
+                        {
+                            break;
+                        }
+                    }
+
+                    return hitMask;
+                });
+
+            for (u32 lane = 0; lane < numRays; ++lane)
+            {
+                const bool isOccluded = (occludedMask >> lane) & 1;
+                results[first + lane] = isOccluded;
+                numOccluded += u32{isOccluded};
+            }
+        }
+
+        return numOccluded;
+    }
+
+    u32 raytracer::intersect_packet(const ray_packet& packet, u32 activeMask, raytracer_result* out) const
+    {
+        const auto allAabbs = m_aabbs.get_aabbs();
+        const auto allIds = m_aabbs.get_ids();
+
+        const f32x8 origin[3] = {
+            f32x8::load(packet.origin[0]),
+            f32x8::load(packet.origin[1]),
+            f32x8::load(packet.origin[2]),
+        };
+
+        const f32x8 one = f32x8::broadcast(1.f);
+
+        const f32x8 invDirection[3] = {
+            one / f32x8::load(packet.direction[0]),
+            one / f32x8::load(packet.direction[1]),
+            one / f32x8::load(packet.direction[2]),
+        };
+
+        f32x8 distances = f32x8::broadcast(std::numeric_limits<f32>::max());
+        u32 foundMask{0};
+
+        m_tlas.traverse_packet(packet,
+            activeMask,
+            distances,
+            [&](u32 firstIndex, u16 numPrimitives, u32 rayMask, f32x8& currentDistances)
+            {
+                for (u32 aabbIndex = firstIndex; aabbIndex < firstIndex + numPrimitives; ++aabbIndex)
+                {
+                    const u32 instanceMask =
+                        oblo::intersect_packet(origin, invDirection, allAabbs[aabbIndex], currentDistances).movemask() &
+                        rayMask;
+
+                    if (instanceMask == 0)
+                    {
+                        continue;
+                    }
+
+                    const auto instanceIndex = allIds[aabbIndex];
+
+                    const auto& instance = m_instances[instanceIndex];
+                    const auto meshIndex = instance.mesh;
+                    const auto& container = m_meshes[meshIndex];
+
+                    const ray_packet localPacket = transform_packet(m_worldToLocal[instanceIndex], packet);
+
+                    u32 triangles[ray_packet::Size];
+
+                    const auto intersectLeaf =
+                        [&](u32 firstTriangle, u16 numTriangles, u32 leafMask, f32x8& leafDistances)
+                    {
+                        const u32 hitMask = container.intersect_packet(
+                            localPacket, firstTriangle, numTriangles, leafMask, leafDistances, triangles);
+
+                        for (u32 mask = hitMask; mask != 0; mask &= mask - 1)
+                        {
+                            const u32 lane = u32(std::countr_zero(mask));
+
+                            out[lane].instance = instanceIndex;
+                            out[lane].mesh = meshIndex;
+                            out[lane].material = instance.material;
+                            out[lane].triangle = triangles[lane];
+                        }
+
+                        foundMask |= hitMask;
+                    };
+
+                    visit_blas(m_blas[meshIndex],
+                        m_quantizedBlas[meshIndex],
+                        [&](const auto& blas)
+                        { blas.traverse_packet(localPacket, instanceMask, currentDistances, intersectLeaf); });
+                }
+            });
+
+        if (foundMask != 0)
+        {
+            alignas(32) f32 laneDistances[ray_packet::Size];
+            distances.store(laneDistances);
+
+            for (u32 mask = foundMask; mask != 0; mask &= mask - 1)
+            {
+                const u32 lane = u32(std::countr_zero(mask));
+                out[lane].distance = laneDistances[lane];
+            }
+        }
+
+        return foundMask;
+    }
+
+    void raytracer::overlap(const aabb& box, function_ref<void(u32 instance)> f) const
+    {
+        const auto allAabbs = m_aabbs.get_aabbs();
+        const auto allIds = m_aabbs.get_ids();
+
+        m_tlas.intersect_aabb(box,
+            [&](u32 firstIndex, u32 numPrimitives)
+            {
+                for (u32 aabbIndex = firstIndex; aabbIndex < firstIndex + numPrimitives; ++aabbIndex)
+                {
+                    if (oblo::overlap(box, allAabbs[aabbIndex]))
+                    {
+                        f(allIds[aabbIndex]);
+                    }
+                }
+            });
+    }
+
+    void raytracer::trace(trace_context& context, std::span<const ray> initialRays, counter_rng& rng) const
     {
         context.casts[0].clear();
         context.casts[1].clear();
@@ -249,36 +991,68 @@ namespace oblo
 
             nextCasts.clear();
 
-            for (const auto& cast : currentCasts)
+            context.numTracedRays += narrow_cast<u32>(currentCasts.size());
+
+            const auto onHit = [&](const trace_cast& cast, const raytracer_result& result)
             {
-                raytracer_result result{};
+                const auto& material = m_materials[result.material];
+
+                context.output[cast.outputIndex].irradiance += material.emissive;
+
+                constexpr auto maxBounces = 4;
 
-                if (!intersect(cast.ray, result))
+                if (cast.bounce < maxBounces)
                 {
-                    continue;
+                    const auto normal = transform_normal(m_worldToLocal[result.instance],
+                        m_meshes[result.mesh].get_normals()[result.triangle]);
+
+                    const auto scatterDirection = hemisphere_uniform_sample(rng, normal);
+                    const auto selfIntersectBias = scatterDirection * .001f;
+                    const auto position = cast.ray.direction * result.distance + cast.ray.origin + selfIntersectBias;
+
+                    const auto outputIndex = narrow_cast<u32>(context.output.size());
+                    context.output.push_back(
+                        {vec3{}, max(0.f, dot(normal, scatterDirection)) * material.albedo, cast.outputIndex});
+
+                    nextCasts.push_back({ray{position, scatterDirection}, outputIndex, cast.bounce + 1});
                 }
-                else
-                {
-                    const auto& material = m_materials[result.material];
+            };
 
-                    context.output[cast.outputIndex].irradiance += material.emissive;
+            // All casts in a pass have the same bounce, primary rays are coherent and traced in packets while
+            // bounces scatter in random directions and are traced one by one
+            if (currentCasts.front().bounce == 0)
+            {
+                for (usize first = 0; first < currentCasts.size(); first += ray_packet::Size)
+                {
+                    const usize numCasts = min(usize{ray_packet::Size}, currentCasts.size() - first);
+                    const auto casts = std::span{currentCasts}.subspan(first, numCasts);
 
-                    constexpr auto maxBounces = 4;
+                    ray_packet packet;
 
-                    if (cast.bounce < maxBounces)
+                    for (u32 lane = 0; lane < ray_packet::Size; ++lane)
                     {
-                        const auto normal = m_meshes[result.mesh].get_normals()[result.triangle];
-
-                        const auto scatterDirection = hemisphere_uniform_sample(state.m_rng, normal);
-                        const auto selfIntersectBias = scatterDirection * .001f;
-                        const auto position =
-                            cast.ray.direction * result.distance + cast.ray.origin + selfIntersectBias;
+                        // Unused lanes are masked out, but they are filled to avoid operating on garbage
+                        packet.set(lane, casts[lane < casts.size() ? lane : 0].ray);
+                    }
 
-                        const auto outputIndex = narrow_cast<u32>(context.output.size());
-                        context.output.push_back(
-                            {vec3{}, max(0.f, dot(normal, scatterDirection)) * material.albedo, cast.outputIndex});
+                    raytracer_result results[ray_packet::Size];
+                    const u32 activeMask = (1u << casts.size()) - 1;
 
-                        nextCasts.push_back({ray{position, scatterDirection}, outputIndex, cast.bounce + 1});
+                    for (u32 hitMask = intersect_packet(packet, activeMask, results); hitMask != 0;
+                        hitMask &= hitMask - 1)
+                    {
+                        const u32 lane = u32(std::countr_zero(hitMask));
+                        onHit(casts[lane], results[lane]);
+                    }
+                }
+            }
+            else
+            {
+                for (const auto& cast : currentCasts)
+                {
+                    if (raytracer_result result{}; intersect(cast.ray, result))
+                    {
+                        onHit(cast, result);
                     }
                 }
             }
@@ -306,44 +1080,78 @@ namespace oblo
         if (width > 0 && height > 0)
         {
             m_radianceBuffer.resize(width * height);
+            m_samplesBuffer.resize(width * height);
+            m_luminanceSquaredBuffer.resize(width * height);
         }
     }
 
     void raytracer_state::resize(u16 width, u16 height, u16 tileSize)
     {
         m_radianceBuffer.clear();
-        m_accumulationBuffer.clear();
+        m_samplesBuffer.clear();
+        m_luminanceSquaredBuffer.clear();
+        m_tiles.clear();
 
         const auto area = i32{width} * height;
 
         m_width = width;
         m_height = height;
         m_radianceBuffer.resize(area);
+        m_samplesBuffer.resize(area);
+        m_luminanceSquaredBuffer.resize(area);
 
         m_tileSize = tileSize;
         m_numTilesX = round_up_div(width, tileSize);
 
         const auto numTiles = m_numTilesX * round_up_div(height, tileSize);
-        m_accumulationBuffer.resize(numTiles);
+        m_tiles.resize(numTiles);
     }
 
     void raytracer_state::reset_accumulation()
     {
         std::fill(m_radianceBuffer.begin(), m_radianceBuffer.end(), vec3{});
-        std::fill(m_accumulationBuffer.begin(), m_accumulationBuffer.end(), 0u);
+        std::fill(m_samplesBuffer.begin(), m_samplesBuffer.end(), 0u);
+        std::fill(m_luminanceSquaredBuffer.begin(), m_luminanceSquaredBuffer.end(), 0.f);
+        std::fill(m_tiles.begin(), m_tiles.end(), tile_accumulation{});
         m_metrics = {};
     }
 
+    void raytracer_state::set_sampling(const raytracer_sampling& sampling)
+    {
+        m_sampling = sampling;
+
+        for (auto& tile : m_tiles)
+        {
+            tile.isConverged = false;
+        }
+    }
+
+    u32 raytracer_state::get_tiles_count() const
+    {
+        return narrow_cast<u32>(m_tiles.size());
+    }
+
+    u32 raytracer_state::get_converged_tiles_count() const
+    {
+        u32 count{0};
+
+        for (const auto& tile : m_tiles)
+        {
+            count += u32{tile.isConverged};
+        }
+
+        return count;
+    }
+
     u32 raytracer_state::get_num_samples_at(u16 x, u16 y) const
     {
-        const auto offset = get_accumulation_offset(x, y);
-        return m_accumulationBuffer[offset];
+        return m_samplesBuffer[u32{m_width} * y + x];
     }
 
-    u32 raytracer_state::get_accumulation_offset(u16 x, u16 y) const
+    u32 raytracer_state::get_tile_index(u16 x, u16 y) const
     {
-        const auto tileX = round_up_div(x, m_tileSize);
-        const auto tileY = round_up_div(y, m_tileSize);
+        const auto tileX = x / m_tileSize;
+        const auto tileY = y / m_tileSize;
         return u32{m_numTilesX} * tileY + tileX;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+
+#include <oblo/acceleration/bvh.hpp>
+#include <oblo/acceleration/bvh_cache.hpp>
+#include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/core/filesystem/file.hpp>
+#include <oblo/core/filesystem/filesystem.hpp>
+#include <oblo/core/string/string_builder.hpp>
+#include <oblo/math/triangle.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace oblo
+{
+    namespace
+    {
+        bool make_clear_directory(cstring_view path)
+        {
+            return filesystem::remove_all(path).has_value() && filesystem::create_directories(path).has_value();
+        }
+
+        std::vector<triangle> make_random_triangles(u32 count, u32 seed)
+        {
+            std::mt19937 rng{seed};
+            std::uniform_real_distribution<f32> position{-10.f, 10.f};
+            std::uniform_real_distribution<f32> offset{-.5f, .5f};
+
+            std::vector<triangle> triangles;
+            triangles.reserve(count);
+
+            for (u32 i = 0; i < count; ++i)
+            {
+                const vec3 center{position(rng), position(rng), position(rng)};
+
+                triangles.push_back({{
+                    center + vec3{offset(rng), offset(rng), offset(rng)},
+                    center + vec3{offset(rng), offset(rng), offset(rng)},
+                    center + vec3{offset(rng), offset(rng), offset(rng)},
+                }});
+            }
+
+            return triangles;
+        }
+
+        struct visited_node
+        {
+            aabb bounds;
+            u32 offset;
+            u32 numPrimitives;
+        };
+
+        std::vector<visited_node> collect_nodes(const bvh& bvh)
+        {
+            std::vector<visited_node> nodes;
+
+            bvh.visit([&nodes](u32, aabb bounds, u32 offset, u32 numPrimitives)
+                { nodes.push_back({bounds, offset, numPrimitives}); });
+
+            return nodes;
+        }
+
+        void expect_same_bvh(const bvh& lhs,
+            const triangle_container& lhsTriangles,
+            const bvh& rhs,
+            const triangle_container& rhsTriangles)
+        {
+            const auto lhsNodes = collect_nodes(lhs);
+            const auto rhsNodes = collect_nodes(rhs);
+
+            ASSERT_EQ(lhsNodes.size(), rhsNodes.size());
+
+            for (usize i = 0; i < lhsNodes.size(); ++i)
+            {
+                ASSERT_EQ(lhsNodes[i].bounds.min, rhsNodes[i].bounds.min);
+                ASSERT_EQ(lhsNodes[i].bounds.max, rhsNodes[i].bounds.max);
+                ASSERT_EQ(lhsNodes[i].offset, rhsNodes[i].offset);
+                ASSERT_EQ(lhsNodes[i].numPrimitives, rhsNodes[i].numPrimitives);
+            }
+
+            ASSERT_EQ(lhsTriangles.size(), rhsTriangles.size());
+
+            for (u32 i = 0; i < lhsTriangles.size(); ++i)
+            {
+                for (u32 v = 0; v < 3; ++v)
+                {
+                    ASSERT_EQ(lhsTriangles.get_triangles()[i].v[v], rhsTriangles.get_triangles()[i].v[v]);
+                }
+
+                ASSERT_EQ(lhsTriangles.get_normals()[i], rhsTriangles.get_normals()[i]);
+            }
+        }
+    }
+
+    TEST(bvh_cache, save_load)
+    {
+        ASSERT_TRUE(make_clear_directory("./bvh_cache_test/save_load"));
+
+        const auto triangles = make_random_triangles(4096, 7);
+        const u64 meshHash = hash_triangles(triangles);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        constexpr cstring_view path{"./bvh_cache_test/save_load/mesh.obvh"};
+        ASSERT_TRUE(save_bvh_cache(path, meshHash, bvh, container));
+
+        oblo::bvh loadedBvh;
+        triangle_container loadedContainer;
+
+        ASSERT_TRUE(load_bvh_cache(path, meshHash, loadedBvh, loadedContainer));
+        expect_same_bvh(bvh, container, loadedBvh, loadedContainer);
+
+        // The cache is bound to the mesh it was built on
+        ASSERT_FALSE(load_bvh_cache(path, meshHash + 1, loadedBvh, loadedContainer));
+
+        dynamic_array<byte> bytes;
+        ASSERT_TRUE(filesystem::load_binary_file_into_memory(bytes, path));
+
+        // Truncated files are rejected rather than read out of bounds
+        const auto truncated = std::span{bytes}.first(bytes.size() - 1);
+        ASSERT_TRUE(filesystem::write_file(path, truncated, filesystem::write_mode::binary));
+        ASSERT_FALSE(load_bvh_cache(path, meshHash, loadedBvh, loadedContainer));
+
+        ASSERT_FALSE(load_bvh_cache("./bvh_cache_test/save_load/missing.obvh", meshHash, loadedBvh, loadedContainer));
+    }
+
+    TEST(bvh_cache, reject_invalid_trees)
+    {
+        ASSERT_TRUE(make_clear_directory("./bvh_cache_test/reject_invalid_trees"));
+
+        const auto triangles = make_random_triangles(4096, 11);
+        const u64 meshHash = hash_triangles(triangles);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        constexpr cstring_view path{"./bvh_cache_test/reject_invalid_trees/mesh.obvh"};
+        ASSERT_TRUE(save_bvh_cache(path, meshHash, bvh, container));
+
+        dynamic_array<byte> bytes;
+        ASSERT_TRUE(filesystem::load_binary_file_into_memory(bytes, path));
+
+        // Same layout as the nodes in the file, which start with the root, i.e. with the bounds of the whole tree
+        struct cached_node
+        {
+            aabb bounds;
+            u32 offset;
+            u16 numPrimitives;
+            u8 splitAxis;
+            u8 padding;
+        };
+
+        const auto nodes = collect_nodes(bvh);
+        ASSERT_GT(nodes.size(), 2 * bvh::MaxDepth);
+        ASSERT_EQ(nodes[1].numPrimitives, 0u);
+
+        const aabb rootBounds = bvh.get_bounds();
+        const auto rootIt = std::search(bytes.begin(),
+            bytes.end(),
+            reinterpret_cast<const byte*>(&rootBounds),
+            reinterpret_cast<const byte*>(&rootBounds) + sizeof(aabb));
+
+        ASSERT_NE(rootIt, bytes.end());
+
+        const usize nodesOffset = usize(rootIt - bytes.begin());
+
+        const auto writeNodes = [&](auto&& patch)
+        {
+            dynamic_array<byte> corrupted = bytes;
+            std::span cachedNodes{reinterpret_cast<cached_node*>(corrupted.data() + nodesOffset), nodes.size()};
+            patch(cachedNodes);
+            return filesystem::write_file(path, corrupted, filesystem::write_mode::binary);
+        };
+
+        oblo::bvh loadedBvh;
+        triangle_container loadedContainer;
+
+        // The second child of the root points inside the first subtree, so those nodes would be reached twice
+        ASSERT_TRUE(writeNodes([](std::span<cached_node> cachedNodes) { cachedNodes[0].offset = 2; }));
+        ASSERT_FALSE(load_bvh_cache(path, meshHash, loadedBvh, loadedContainer));
+
+        // A chain of nodes, each with a leaf as first child, is too deep for the traversal stack
+        ASSERT_TRUE(writeNodes(
+            [](std::span<cached_node> cachedNodes)
+            {
+                for (u32 i = 0; i < cachedNodes.size(); ++i)
+                {
+                    const bool isInternal = i % 2 == 0 && i + 2 < cachedNodes.size();
+                    cachedNodes[i].offset = isInternal ? i + 2 : 0;
+                    cachedNodes[i].numPrimitives = isInternal ? 0 : 1;
+                }
+            }));
+
+        ASSERT_FALSE(load_bvh_cache(path, meshHash, loadedBvh, loadedContainer));
+
+        // The split axis of internal nodes is used as an index by traversals
+        ASSERT_TRUE(writeNodes([](std::span<cached_node> cachedNodes) { cachedNodes[1].splitAxis = 3; }));
+        ASSERT_FALSE(load_bvh_cache(path, meshHash, loadedBvh, loadedContainer));
+
+        // The untouched file still loads
+        ASSERT_TRUE(filesystem::write_file(path, bytes, filesystem::write_mode::binary));
+        ASSERT_TRUE(load_bvh_cache(path, meshHash, loadedBvh, loadedContainer));
+    }
+
+    TEST(bvh_cache, load_or_build)
+    {
+        constexpr cstring_view directory{"./bvh_cache_test/load_or_build"};
+        ASSERT_TRUE(filesystem::remove_all(directory));
+
+        const auto triangles = make_random_triangles(1024, 9);
+
+        triangle_container builtContainer;
+        builtContainer.add(triangles);
+
+        bvh builtBvh;
+        ASSERT_EQ(load_or_build_bvh(directory, builtContainer, builtBvh), bvh_cache_status::miss);
+
+        string_builder path;
+        make_bvh_cache_path(path, directory, hash_triangles(triangles));
+        ASSERT_TRUE(filesystem::exists(path).value_or(false));
+
+        triangle_container cachedContainer;
+        cachedContainer.add(triangles);
+
+        bvh cachedBvh;
+        ASSERT_EQ(load_or_build_bvh(directory, cachedContainer, cachedBvh), bvh_cache_status::hit);
+
+        expect_same_bvh(builtBvh, builtContainer, cachedBvh, cachedContainer);
+
+        // A different mesh gets its own file
+        triangle_container otherContainer;
+        otherContainer.add(make_random_triangles(1024, 10));
+
+        bvh otherBvh;
+        ASSERT_EQ(load_or_build_bvh(directory, otherContainer, otherBvh), bvh_cache_status::miss);
+    }
+}
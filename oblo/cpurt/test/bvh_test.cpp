@@ -1,8 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <oblo/acceleration/aabb_container.hpp>
 #include <oblo/acceleration/bvh.hpp>
+#include <oblo/acceleration/quantized_bvh.hpp>
+#include <oblo/acceleration/ray_packet.hpp>
 #include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/acceleration/wide_bvh.hpp>
 #include <oblo/math/triangle.hpp>
+#include <oblo/thread/job_manager.hpp>
+
+#include <limits>
+#include <random>
+#include <vector>
 
 namespace oblo
 {
@@ -28,6 +37,281 @@ namespace oblo
             {{{-.5f, -.5f, .5f}, {-.5f, -.5f, -.5f}, {.5f, -.5f, .5f}}},
             {{{.5f, -.5f, .5f}, {-.5f, -.5f, -.5f}, {.5f, -.5f, -.5f}}},
         };
+
+        std::vector<triangle> make_random_triangles(u32 count, u32 seed)
+        {
+            std::mt19937 rng{seed};
+            std::uniform_real_distribution<f32> position{-10.f, 10.f};
+            std::uniform_real_distribution<f32> offset{-.5f, .5f};
+
+            std::vector<triangle> triangles;
+            triangles.reserve(count);
+
+            for (u32 i = 0; i < count; ++i)
+            {
+                const vec3 center{position(rng), position(rng), position(rng)};
+
+                triangles.push_back({{
+                    center + vec3{offset(rng), offset(rng), offset(rng)},
+                    center + vec3{offset(rng), offset(rng), offset(rng)},
+                    center + vec3{offset(rng), offset(rng), offset(rng)},
+                }});
+            }
+
+            return triangles;
+        }
+
+        struct visited_node
+        {
+            u32 depth;
+            aabb bounds;
+            u32 offset;
+            u32 numPrimitives;
+
+            bool operator==(const visited_node& other) const
+            {
+                return depth == other.depth && bounds.min == other.bounds.min && bounds.max == other.bounds.max &&
+                    offset == other.offset && numPrimitives == other.numPrimitives;
+            }
+        };
+
+        std::vector<visited_node> collect_nodes(const bvh& bvh)
+        {
+            std::vector<visited_node> nodes;
+
+            bvh.visit([&nodes](u32 depth, aabb bounds, u32 offset, u32 numPrimitives)
+                { nodes.push_back({depth, bounds, offset, numPrimitives}); });
+
+            return nodes;
+        }
+
+        template <u32 Width>
+        void check_wide_bvh_closest_hit()
+        {
+            const auto triangles = make_random_triangles(4096, 5);
+
+            triangle_container container;
+            container.add(triangles);
+
+            bvh binaryBvh;
+            binaryBvh.build(container);
+
+            wide_bvh<Width> wideBvh;
+            wideBvh.build(binaryBvh);
+
+            ASSERT_FALSE(wideBvh.empty());
+            ASSERT_LT(wideBvh.get_nodes_count(), binaryBvh.get_nodes_count());
+
+            const aabb bounds = wideBvh.get_bounds();
+            ASSERT_EQ(bounds.min, binaryBvh.get_bounds().min);
+            ASSERT_EQ(bounds.max, binaryBvh.get_bounds().max);
+
+            std::mt19937 rng{13};
+            std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+
+            u32 numHits{0};
+
+            for (u32 i = 0; i < 512; ++i)
+            {
+                // Shoot from the outside as well, and include axis aligned rays to exercise infinite inverse directions
+                const ray r{
+                    .origin = i % 2 == 0 ? vec3{} : vec3{coordinate(rng), coordinate(rng), coordinate(rng)} * 20.f,
+                    .direction = i % 64 == 1 ? vec3{0.f, 0.f, 1.f}
+                                             : normalize(vec3{coordinate(rng), coordinate(rng), coordinate(rng)}),
+                };
+
+                f32 expectedDistance = std::numeric_limits<f32>::max();
+                u32 expectedTriangle = ~0u;
+
+                binaryBvh.traverse(r,
+                    [&](u32 offset, u16 numPrimitives, f32& distance)
+                    {
+                        triangle_container::hit_result result;
+
+                        if (container.intersect(r, offset, numPrimitives, distance, result))
+                        {
+                            expectedDistance = distance;
+                            expectedTriangle = result.index;
+                        }
+                    });
+
+                f32 bestDistance = std::numeric_limits<f32>::max();
+                u32 bestTriangle = ~0u;
+
+                wideBvh.traverse(r,
+                    [&](u32 offset, u16 numPrimitives, f32& distance)
+                    {
+                        triangle_container::hit_result result;
+
+                        if (container.intersect(r, offset, numPrimitives, distance, result))
+                        {
+                            bestDistance = distance;
+                            bestTriangle = result.index;
+                        }
+                    });
+
+                ASSERT_EQ(bestTriangle, expectedTriangle);
+
+                if (expectedTriangle != ~0u)
+                {
+                    ASSERT_FLOAT_EQ(bestDistance, expectedDistance);
+                    ++numHits;
+                }
+            }
+
+            ASSERT_GT(numHits, 0u);
+        }
+
+        template <u32 Width>
+        void check_wide_bvh_intersect_aabb()
+        {
+            std::mt19937 rng{17};
+            std::uniform_real_distribution<f32> position{-20.f, 20.f};
+            std::uniform_real_distribution<f32> extent{.1f, 2.f};
+
+            std::vector<aabb> boxes;
+
+            for (u32 i = 0; i < 2048; ++i)
+            {
+                const vec3 center{position(rng), position(rng), position(rng)};
+                const vec3 halfSize{extent(rng), extent(rng), extent(rng)};
+                boxes.push_back({center - halfSize, center + halfSize});
+            }
+
+            aabb_container container;
+            container.add(boxes, 0);
+
+            bvh binaryBvh;
+            binaryBvh.build(container);
+
+            wide_bvh<Width> wideBvh;
+            wideBvh.build(binaryBvh);
+
+            const auto sortedBoxes = container.get_aabbs();
+
+            for (u32 i = 0; i < 64; ++i)
+            {
+                const vec3 center{position(rng), position(rng), position(rng)};
+                const vec3 halfSize{4.f, 4.f, 4.f};
+                const aabb query{center - halfSize, center + halfSize};
+
+                u32 expected{0};
+
+                for (const auto& box : sortedBoxes)
+                {
+                    expected += u32{overlap(query, box)};
+                }
+
+                u32 found{0};
+                u32 visited{0};
+
+                wideBvh.intersect_aabb(query,
+                    [&](u32 offset, u32 numPrimitives)
+                    {
+                        visited += numPrimitives;
+
+                        for (u32 j = offset; j < offset + numPrimitives; ++j)
+                        {
+                            found += u32{overlap(query, sortedBoxes[j])};
+                        }
+                    });
+
+                ASSERT_EQ(found, expected);
+                ASSERT_LT(visited, sortedBoxes.size());
+            }
+        }
+
+        void check_quantized_bvh_ray_queries(const vec3& translation)
+        {
+            auto triangles = make_random_triangles(4096, 41);
+
+            for (triangle& t : triangles)
+            {
+                for (vec3& v : t.v)
+                {
+                    v = v + translation;
+                }
+            }
+
+            triangle_container container;
+            container.add(triangles);
+
+            bvh binaryBvh;
+            binaryBvh.build(container);
+
+            quantized_bvh quantizedBvh;
+            quantizedBvh.build(binaryBvh);
+
+            ASSERT_FALSE(quantizedBvh.empty());
+            ASSERT_LT(quantizedBvh.get_memory_footprint(), binaryBvh.get_memory_footprint() / 2);
+            ASSERT_EQ(quantizedBvh.get_bounds().min, binaryBvh.get_bounds().min);
+            ASSERT_EQ(quantizedBvh.get_bounds().max, binaryBvh.get_bounds().max);
+
+            std::mt19937 rng{43};
+            std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+            std::uniform_real_distribution<f32> maxDistance{0.f, 15.f};
+
+            u32 numHits{0};
+
+            for (u32 i = 0; i < 512; ++i)
+            {
+                const ray r{
+                    .origin = translation +
+                        (i % 2 == 0 ? vec3{} : vec3{coordinate(rng), coordinate(rng), coordinate(rng)} * 20.f),
+                    .direction = i % 64 == 1 ? vec3{0.f, 0.f, 1.f}
+                                             : normalize(vec3{coordinate(rng), coordinate(rng), coordinate(rng)}),
+                };
+
+                f32 expectedDistance = std::numeric_limits<f32>::max();
+                u32 expectedTriangle = ~0u;
+
+                binaryBvh.traverse(r,
+                    [&](u32 offset, u16 numPrimitives, f32& distance)
+                    {
+                        triangle_container::hit_result result;
+
+                        if (container.intersect(r, offset, numPrimitives, distance, result))
+                        {
+                            expectedDistance = distance;
+                            expectedTriangle = result.index;
+                        }
+                    });
+
+                f32 bestDistance = std::numeric_limits<f32>::max();
+                u32 bestTriangle = ~0u;
+
+                quantizedBvh.traverse(r,
+                    [&](u32 offset, u16 numPrimitives, f32& distance)
+                    {
+                        triangle_container::hit_result result;
+
+                        if (container.intersect(r, offset, numPrimitives, distance, result))
+                        {
+                            bestDistance = distance;
+                            bestTriangle = result.index;
+                        }
+                    });
+
+                ASSERT_EQ(bestTriangle, expectedTriangle);
+
+                if (expectedTriangle != ~0u)
+                {
+                    ASSERT_FLOAT_EQ(bestDistance, expectedDistance);
+                    ++numHits;
+                }
+
+                const f32 tMax = maxDistance(rng);
+
+                const bool isOccluded = quantizedBvh.traverse_any(r,
+                    tMax,
+                    [&](u32 offset, u16 numPrimitives)
+                    { return container.intersect_any(r, offset, numPrimitives, tMax); });
+
+                ASSERT_EQ(isOccluded, expectedDistance < tMax);
+            }
+
+            ASSERT_GT(numHits, 0u);
+        }
     }
 
     TEST(triangle_container, cube_bounds)
@@ -81,4 +365,751 @@ namespace oblo
 
         ASSERT_EQ(std::size(s_cube), numTotalTriangles);
     }
-}
\ No newline at end of file
+
+    TEST(bvh, traverse_closest_hit)
+    {
+        const auto triangles = make_random_triangles(2048, 42);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        ASSERT_FALSE(bvh.empty());
+        ASSERT_LT(bvh.get_nodes_count(), 2 * container.size());
+
+        u32 numLeafTriangles{0};
+        u32 maxDepth{0};
+
+        bvh.visit(
+            [&](u32 depth, aabb, u32, u32 numPrimitives)
+            {
+                numLeafTriangles += numPrimitives;
+                maxDepth = max(maxDepth, depth);
+            });
+
+        ASSERT_EQ(numLeafTriangles, container.size());
+        ASSERT_LT(maxDepth, bvh::MaxDepth);
+
+        std::mt19937 rng{7};
+        std::uniform_real_distribution<f32> direction{-1.f, 1.f};
+
+        u32 numHits{0};
+
+        for (u32 i = 0; i < 256; ++i)
+        {
+            const ray r{
+                .origin = {0.f, 0.f, 0.f},
+                .direction = normalize(vec3{direction(rng), direction(rng), direction(rng)}),
+            };
+
+            f32 expectedDistance = std::numeric_limits<f32>::max();
+            u32 expectedTriangle = ~0u;
+
+            const auto sortedTriangles = container.get_triangles();
+
+            for (u32 t = 0; t < sortedTriangles.size(); ++t)
+            {
+                if (f32 d; intersect(r, sortedTriangles[t], d) && d < expectedDistance)
+                {
+                    expectedDistance = d;
+                    expectedTriangle = t;
+                }
+            }
+
+            f32 bestDistance = std::numeric_limits<f32>::max();
+            u32 bestTriangle = ~0u;
+
+            bvh.traverse(r,
+                [&](u32 offset, u16 numPrimitives, f32& distance)
+                {
+                    triangle_container::hit_result result;
+
+                    if (container.intersect(r, offset, numPrimitives, distance, result))
+                    {
+                        bestDistance = distance;
+                        bestTriangle = result.index;
+                    }
+                });
+
+            ASSERT_EQ(bestTriangle, expectedTriangle);
+
+            if (expectedTriangle != ~0u)
+            {
+                ASSERT_FLOAT_EQ(bestDistance, expectedDistance);
+                ++numHits;
+            }
+        }
+
+        ASSERT_GT(numHits, 0u);
+    }
+
+    TEST(bvh, intersect_aabb)
+    {
+        std::mt19937 rng{3};
+        std::uniform_real_distribution<f32> position{-20.f, 20.f};
+        std::uniform_real_distribution<f32> extent{.1f, 2.f};
+
+        std::vector<aabb> boxes;
+
+        for (u32 i = 0; i < 1024; ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const vec3 halfSize{extent(rng), extent(rng), extent(rng)};
+            boxes.push_back({center - halfSize, center + halfSize});
+        }
+
+        aabb_container container;
+        container.add(boxes, 0);
+
+        bvh bvh;
+        bvh.build(container);
+
+        const auto sortedBoxes = container.get_aabbs();
+
+        for (u32 i = 0; i < 64; ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const vec3 halfSize{4.f, 4.f, 4.f};
+            const aabb query{center - halfSize, center + halfSize};
+
+            u32 expected{0};
+
+            for (const auto& box : sortedBoxes)
+            {
+                expected += u32{overlap(query, box)};
+            }
+
+            u32 found{0};
+
+            bvh.intersect_aabb(query,
+                [&](u32 offset, u32 numPrimitives)
+                {
+                    for (u32 j = offset; j < offset + numPrimitives; ++j)
+                    {
+                        found += u32{overlap(query, sortedBoxes[j])};
+                    }
+                });
+
+            ASSERT_EQ(found, expected);
+        }
+    }
+
+    TEST(bvh, build_parallel)
+    {
+        job_manager jm;
+        ASSERT_TRUE(jm.init({.numThreads = 4}));
+
+        // Large enough for the root to use parallel binning
+        const auto triangles = make_random_triangles(bvh::ParallelBinningThreshold * 2, 11);
+
+        triangle_container serialContainer;
+        serialContainer.add(triangles);
+
+        triangle_container parallelContainer = serialContainer;
+
+        bvh serialBvh;
+        serialBvh.build(serialContainer);
+
+        bvh parallelBvh;
+        parallelBvh.build_parallel(parallelContainer);
+
+        jm.shutdown();
+
+        ASSERT_EQ(serialBvh.get_nodes_count(), parallelBvh.get_nodes_count());
+
+        const auto serialNodes = collect_nodes(serialBvh);
+        const auto parallelNodes = collect_nodes(parallelBvh);
+
+        ASSERT_EQ(serialNodes.size(), parallelNodes.size());
+
+        u32 numLeafTriangles{0};
+
+        for (usize i = 0; i < serialNodes.size(); ++i)
+        {
+            ASSERT_EQ(serialNodes[i], parallelNodes[i]);
+            ASSERT_LE(serialNodes[i].numPrimitives, bvh::MaxLeafPrimitives);
+
+            numLeafTriangles += serialNodes[i].numPrimitives;
+        }
+
+        ASSERT_EQ(numLeafTriangles, serialContainer.size());
+
+        const auto serialTriangles = serialContainer.get_triangles();
+        const auto parallelTriangles = parallelContainer.get_triangles();
+
+        for (u32 i = 0; i < serialTriangles.size(); ++i)
+        {
+            for (u32 v = 0; v < 3; ++v)
+            {
+                ASSERT_EQ(serialTriangles[i].v[v], parallelTriangles[i].v[v]);
+            }
+        }
+    }
+
+    TEST(bvh, coincident_centroids)
+    {
+        // Copies of the same triangles can't be told apart by binning, they should still not end up in a single leaf
+        std::vector<triangle> triangles;
+
+        for (u32 i = 0; i < 256; ++i)
+        {
+            triangles.insert(triangles.end(), std::begin(s_cube), std::end(s_cube));
+        }
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        u32 numLeafTriangles{0};
+
+        bvh.visit(
+            [&](u32, aabb, u32, u32 numPrimitives)
+            {
+                ASSERT_LE(numPrimitives, bvh::MaxLeafPrimitives);
+                numLeafTriangles += numPrimitives;
+            });
+
+        ASSERT_EQ(numLeafTriangles, container.size());
+    }
+
+    TEST(bvh, refit)
+    {
+        std::mt19937 rng{17};
+        std::uniform_real_distribution<f32> position{-20.f, 20.f};
+        std::uniform_real_distribution<f32> extent{.1f, 2.f};
+
+        std::vector<aabb> boxes;
+
+        for (u32 i = 0; i < 1024; ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const vec3 halfSize{extent(rng), extent(rng), extent(rng)};
+            boxes.push_back({center - halfSize, center + halfSize});
+        }
+
+        aabb_container container;
+        container.add(boxes, 0);
+
+        bvh bvh;
+        bvh.build(container);
+
+        const auto builtNodes = collect_nodes(bvh);
+        const f32 builtCost = bvh.compute_sah_cost();
+
+        ASSERT_GT(builtCost, 1.f);
+
+        // Refitting without moving anything gives back the same tree
+        bvh.refit(container);
+        ASSERT_EQ(collect_nodes(bvh), builtNodes);
+
+        // Move every box to a random spot, as if the whole scene was shuffled
+        for (u32 i = 0; i < container.size(); ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const vec3 halfSize{extent(rng), extent(rng), extent(rng)};
+            container.set_aabb(i, {center - halfSize, center + halfSize});
+        }
+
+        bvh.refit(container);
+
+        const auto refitNodes = collect_nodes(bvh);
+        ASSERT_EQ(refitNodes.size(), builtNodes.size());
+
+        for (usize i = 0; i < refitNodes.size(); ++i)
+        {
+            const auto& node = refitNodes[i];
+
+            ASSERT_EQ(node.numPrimitives, builtNodes[i].numPrimitives);
+
+            if (node.numPrimitives > 0)
+            {
+                const aabb expected = container.primitives_bounds(node.offset, node.offset + node.numPrimitives);
+                ASSERT_EQ(node.bounds.min, expected.min);
+                ASSERT_EQ(node.bounds.max, expected.max);
+            }
+        }
+
+        const aabb root = container.primitives_bounds(0, container.size());
+        ASSERT_EQ(bvh.get_bounds().min, root.min);
+        ASSERT_EQ(bvh.get_bounds().max, root.max);
+
+        // The nodes now overlap much more than in a tree built on the new positions
+        ASSERT_GT(bvh.compute_sah_cost(), builtCost);
+    }
+
+    TEST(wide_bvh, closest_hit)
+    {
+        check_wide_bvh_closest_hit<4>();
+        check_wide_bvh_closest_hit<8>();
+    }
+
+    TEST(wide_bvh, intersect_aabb)
+    {
+        check_wide_bvh_intersect_aabb<4>();
+        check_wide_bvh_intersect_aabb<8>();
+    }
+
+    TEST(wide_bvh, single_leaf)
+    {
+        triangle_container container;
+        container.add({s_cube, 2});
+
+        bvh binaryBvh;
+        binaryBvh.build(container);
+
+        bvh4 wideBvh;
+        wideBvh.build(binaryBvh);
+
+        ASSERT_EQ(wideBvh.get_nodes_count(), 1u);
+
+        u32 numLeaves{0};
+
+        wideBvh.traverse({.origin = {0.f, 0.f, -2.f}, .direction = {0.f, 0.f, 1.f}},
+            [&](u32 offset, u16 numPrimitives, f32&)
+            {
+                ASSERT_EQ(offset, 0u);
+                ASSERT_EQ(numPrimitives, 2u);
+                ++numLeaves;
+            });
+
+        ASSERT_EQ(numLeaves, 1u);
+    }
+
+    TEST(bvh, traverse_packet)
+    {
+        const auto triangles = make_random_triangles(2048, 23);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        std::mt19937 rng{29};
+        std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+        std::uniform_real_distribution<f32> spread{-.05f, .05f};
+
+        u32 numHits{0};
+
+        for (u32 packetIndex = 0; packetIndex < 128; ++packetIndex)
+        {
+            // Mostly coherent packets, but every few ones the rays go in random directions
+            const bool isCoherent = packetIndex % 4 != 0;
+            const vec3 mainDirection{coordinate(rng), coordinate(rng), coordinate(rng)};
+
+            // Also leave a few lanes inactive
+            const u32 activeMask = packetIndex % 8 == 1 ? 0b10110101u : 0xffu;
+
+            ray_packet packet;
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                const vec3 direction = isCoherent
+                    ? mainDirection + vec3{spread(rng), spread(rng), spread(rng)}
+                    : vec3{coordinate(rng), coordinate(rng), coordinate(rng)};
+
+                packet.set(lane, {.origin = {0.f, 0.f, 0.f}, .direction = normalize(direction)});
+            }
+
+            f32x8 distances = f32x8::broadcast(std::numeric_limits<f32>::max());
+            u32 packetTriangles[ray_packet::Size];
+            u32 packetHitMask{0};
+
+            bvh.traverse_packet(packet,
+                activeMask,
+                distances,
+                [&](u32 offset, u16 numPrimitives, u32 rayMask, f32x8& leafDistances)
+                {
+                    packetHitMask |= container.intersect_packet(
+                        packet, offset, numPrimitives, rayMask, leafDistances, packetTriangles);
+                });
+
+            alignas(32) f32 packetDistances[ray_packet::Size];
+            distances.store(packetDistances);
+
+            ASSERT_EQ(packetHitMask & ~activeMask, 0u);
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                if ((activeMask & (1u << lane)) == 0)
+                {
+                    continue;
+                }
+
+                const ray r = packet.get(lane);
+
+                f32 expectedDistance = std::numeric_limits<f32>::max();
+                u32 expectedTriangle = ~0u;
+
+                bvh.traverse(r,
+                    [&](u32 offset, u16 numPrimitives, f32& distance)
+                    {
+                        triangle_container::hit_result result;
+
+                        if (container.intersect(r, offset, numPrimitives, distance, result))
+                        {
+                            expectedDistance = distance;
+                            expectedTriangle = result.index;
+                        }
+                    });
+
+                const bool isHit = (packetHitMask & (1u << lane)) != 0;
+                ASSERT_EQ(isHit, expectedTriangle != ~0u);
+
+                if (isHit)
+                {
+                    ASSERT_EQ(packetTriangles[lane], expectedTriangle);
+                    ASSERT_NEAR(packetDistances[lane], expectedDistance, 1e-4f);
+                    ++numHits;
+                }
+            }
+        }
+
+        ASSERT_GT(numHits, 0u);
+    }
+
+    TEST(bvh, traverse_any)
+    {
+        const auto triangles = make_random_triangles(2048, 31);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        std::mt19937 rng{37};
+        std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+        std::uniform_real_distribution<f32> maxDistance{0.f, 15.f};
+
+        u32 numOccluded{0};
+
+        for (u32 i = 0; i < 512; ++i)
+        {
+            const ray r{
+                .origin = vec3{coordinate(rng), coordinate(rng), coordinate(rng)} * 5.f,
+                .direction = normalize(vec3{coordinate(rng), coordinate(rng), coordinate(rng)}),
+            };
+
+            const f32 tMax = maxDistance(rng);
+
+            f32 closestDistance = std::numeric_limits<f32>::max();
+
+            bvh.traverse(r,
+                [&](u32 offset, u16 numPrimitives, f32& distance)
+                {
+                    triangle_container::hit_result result;
+
+                    if (container.intersect(r, offset, numPrimitives, distance, result))
+                    {
+                        closestDistance = distance;
+                    }
+                });
+
+            const bool isOccluded = bvh.traverse_any(r,
+                tMax,
+                [&](u32 offset, u16 numPrimitives) { return container.intersect_any(r, offset, numPrimitives, tMax); });
+
+            ASSERT_EQ(isOccluded, closestDistance < tMax);
+            numOccluded += u32{isOccluded};
+        }
+
+        ASSERT_GT(numOccluded, 0u);
+        ASSERT_LT(numOccluded, 512u);
+    }
+
+    TEST(bvh, traverse_packet_any)
+    {
+        const auto triangles = make_random_triangles(2048, 41);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh bvh;
+        bvh.build(container);
+
+        std::mt19937 rng{43};
+        std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+        std::uniform_real_distribution<f32> maxDistance{0.f, 15.f};
+
+        u32 numOccluded{0};
+
+        for (u32 packetIndex = 0; packetIndex < 64; ++packetIndex)
+        {
+            const u32 activeMask = packetIndex % 8 == 1 ? 0b01101011u : 0xffu;
+
+            ray_packet packet;
+            alignas(32) f32 laneDistances[ray_packet::Size];
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                packet.set(lane,
+                    {
+                        .origin = vec3{coordinate(rng), coordinate(rng), coordinate(rng)} * 5.f,
+                        .direction = normalize(vec3{coordinate(rng), coordinate(rng), coordinate(rng)}),
+                    });
+
+                laneDistances[lane] = maxDistance(rng);
+            }
+
+            const f32x8 distances = f32x8::load(laneDistances);
+
+            const u32 occludedMask = bvh.traverse_packet_any(packet,
+                activeMask,
+                distances,
+                [&](u32 offset, u16 numPrimitives, u32 rayMask)
+                {
+                    // Lanes that already hit are retired, they are never passed again
+                    EXPECT_EQ(rayMask & ~activeMask, 0u);
+                    return container.intersect_packet_any(packet, offset, numPrimitives, rayMask, distances);
+                });
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                const bool isOccluded = (occludedMask >> lane) & 1;
+
+                if ((activeMask & (1u << lane)) == 0)
+                {
+                    ASSERT_FALSE(isOccluded);
+                    continue;
+                }
+
+                const ray r = packet.get(lane);
+                const f32 tMax = laneDistances[lane];
+
+                const bool expected = bvh.traverse_any(r,
+                    tMax,
+                    [&](u32 offset, u16 numPrimitives)
+                    { return container.intersect_any(r, offset, numPrimitives, tMax); });
+
+                ASSERT_EQ(isOccluded, expected);
+                numOccluded += u32{isOccluded};
+            }
+        }
+
+        ASSERT_GT(numOccluded, 0u);
+    }
+
+    TEST(quantized_bvh, ray_queries)
+    {
+        check_quantized_bvh_ray_queries({});
+
+        // Far from the origin the bounds of the small nodes are close to the float precision
+        check_quantized_bvh_ray_queries({1000.f, -2000.f, 500.f});
+    }
+
+    TEST(quantized_bvh, packet_queries)
+    {
+        const auto triangles = make_random_triangles(2048, 41);
+
+        triangle_container container;
+        container.add(triangles);
+
+        bvh binaryBvh;
+        binaryBvh.build(container);
+
+        quantized_bvh quantizedBvh;
+        quantizedBvh.build(binaryBvh);
+
+        std::mt19937 rng{53};
+        std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+        std::uniform_real_distribution<f32> maxDistance{0.f, 15.f};
+
+        u32 numHits{0};
+        u32 numOccluded{0};
+
+        for (u32 packetIndex = 0; packetIndex < 64; ++packetIndex)
+        {
+            const u32 activeMask = packetIndex % 8 == 1 ? 0b10110110u : 0xffu;
+
+            // Coherent packets share the origin, as primary or ambient occlusion rays would
+            const vec3 origin = vec3{coordinate(rng), coordinate(rng), coordinate(rng)} * 5.f;
+
+            ray_packet packet;
+            alignas(32) f32 laneDistances[ray_packet::Size];
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                packet.set(lane,
+                    {
+                        .origin = origin,
+                        .direction = normalize(vec3{coordinate(rng), coordinate(rng), coordinate(rng)}),
+                    });
+
+                laneDistances[lane] = maxDistance(rng);
+            }
+
+            f32x8 distances = f32x8::broadcast(std::numeric_limits<f32>::max());
+            u32 triangleIndices[ray_packet::Size];
+            u32 foundMask{0};
+
+            quantizedBvh.traverse_packet(packet,
+                activeMask,
+                distances,
+                [&](u32 offset, u16 numPrimitives, u32 rayMask, f32x8& leafDistances)
+                {
+                    EXPECT_EQ(rayMask & ~activeMask, 0u);
+                    foundMask |= container.intersect_packet(
+                        packet, offset, numPrimitives, rayMask, leafDistances, triangleIndices);
+                });
+
+            alignas(32) f32 closestDistances[ray_packet::Size];
+            distances.store(closestDistances);
+
+            const f32x8 maxDistances = f32x8::load(laneDistances);
+
+            const u32 occludedMask = quantizedBvh.traverse_packet_any(packet,
+                activeMask,
+                maxDistances,
+                [&](u32 offset, u16 numPrimitives, u32 rayMask)
+                { return container.intersect_packet_any(packet, offset, numPrimitives, rayMask, maxDistances); });
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                const bool isHit = (foundMask >> lane) & 1;
+                const bool isOccluded = (occludedMask >> lane) & 1;
+
+                if ((activeMask & (1u << lane)) == 0)
+                {
+                    ASSERT_FALSE(isHit);
+                    ASSERT_FALSE(isOccluded);
+                    continue;
+                }
+
+                const ray r = packet.get(lane);
+
+                f32 expectedDistance = std::numeric_limits<f32>::max();
+                u32 expectedTriangle = ~0u;
+
+                binaryBvh.traverse(r,
+                    [&](u32 offset, u16 numPrimitives, f32& distance)
+                    {
+                        triangle_container::hit_result result;
+
+                        if (container.intersect(r, offset, numPrimitives, distance, result))
+                        {
+                            expectedDistance = distance;
+                            expectedTriangle = result.index;
+                        }
+                    });
+
+                ASSERT_EQ(isHit, expectedTriangle != ~0u);
+
+                if (isHit)
+                {
+                    ASSERT_EQ(triangleIndices[lane], expectedTriangle);
+                    ASSERT_NEAR(closestDistances[lane], expectedDistance, 1e-4f);
+                    ++numHits;
+                }
+
+                ASSERT_EQ(isOccluded, expectedDistance < laneDistances[lane]);
+                numOccluded += u32{isOccluded};
+            }
+        }
+
+        ASSERT_GT(numHits, 0u);
+        ASSERT_GT(numOccluded, 0u);
+    }
+
+    TEST(quantized_bvh, intersect_aabb)
+    {
+        std::mt19937 rng{47};
+        std::uniform_real_distribution<f32> position{-20.f, 20.f};
+        std::uniform_real_distribution<f32> extent{.1f, 2.f};
+
+        std::vector<aabb> boxes;
+
+        for (u32 i = 0; i < 2048; ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const vec3 halfSize{extent(rng), extent(rng), extent(rng)};
+            boxes.push_back({center - halfSize, center + halfSize});
+        }
+
+        aabb_container container;
+        container.add(boxes, 0);
+
+        bvh binaryBvh;
+        binaryBvh.build(container);
+
+        quantized_bvh quantizedBvh;
+        quantizedBvh.build(binaryBvh);
+
+        const auto sortedBoxes = container.get_aabbs();
+
+        for (u32 i = 0; i < 64; ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const vec3 halfSize{4.f, 4.f, 4.f};
+            const aabb query{center - halfSize, center + halfSize};
+
+            u32 expected{0};
+            u32 expectedVisited{0};
+
+            binaryBvh.intersect_aabb(query,
+                [&](u32 offset, u32 numPrimitives)
+                {
+                    expectedVisited += numPrimitives;
+
+                    for (u32 j = offset; j < offset + numPrimitives; ++j)
+                    {
+                        expected += u32{overlap(query, sortedBoxes[j])};
+                    }
+                });
+
+            u32 found{0};
+            u32 visited{0};
+
+            quantizedBvh.intersect_aabb(query,
+                [&](u32 offset, u32 numPrimitives)
+                {
+                    visited += numPrimitives;
+
+                    for (u32 j = offset; j < offset + numPrimitives; ++j)
+                    {
+                        found += u32{overlap(query, sortedBoxes[j])};
+                    }
+                });
+
+            ASSERT_EQ(found, expected);
+
+            // Looser bounds can only add leaves to the ones the source visits
+            ASSERT_GE(visited, expectedVisited);
+            ASSERT_LT(visited, sortedBoxes.size());
+        }
+    }
+
+    TEST(quantized_bvh, single_leaf)
+    {
+        triangle_container container;
+        container.add({s_cube, 2});
+
+        bvh binaryBvh;
+        binaryBvh.build(container);
+
+        quantized_bvh quantizedBvh;
+        quantizedBvh.build(binaryBvh);
+
+        ASSERT_FALSE(quantizedBvh.empty());
+        ASSERT_EQ(quantizedBvh.get_nodes_count(), 0u);
+
+        u32 numLeaves{0};
+
+        quantizedBvh.traverse({.origin = {0.f, 0.f, -2.f}, .direction = {0.f, 0.f, 1.f}},
+            [&](u32 offset, u16 numPrimitives, f32&)
+            {
+                ASSERT_EQ(offset, 0u);
+                ASSERT_EQ(numPrimitives, 2u);
+                ++numLeaves;
+            });
+
+        ASSERT_EQ(numLeaves, 1u);
+
+        quantizedBvh.clear();
+        ASSERT_TRUE(quantizedBvh.empty());
+    }
+}
@@ -0,0 +1,546 @@
+#include <gtest/gtest.h>
+
+#include <oblo/acceleration/ray_packet.hpp>
+#include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/math/triangle.hpp>
+#include <oblo/raytracer/material.hpp>
+#include <oblo/raytracer/raytracer.hpp>
+#include <oblo/thread/job_manager.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <random>
+#include <vector>
+
+namespace oblo
+{
+    namespace
+    {
+        constexpr triangle s_box[] = {
+            {{{-5.f, -5.f, -5.f}, {-5.f, 5.f, -5.f}, {5.f, 5.f, -5.f}}},
+            {{{5.f, -5.f, -5.f}, {-5.f, -5.f, -5.f}, {5.f, 5.f, -5.f}}},
+            {{{-5.f, -5.f, 5.f}, {5.f, 5.f, 5.f}, {-5.f, 5.f, 5.f}}},
+            {{{5.f, -5.f, 5.f}, {5.f, 5.f, 5.f}, {-5.f, -5.f, 5.f}}},
+            {{{5.f, -5.f, -5.f}, {5.f, 5.f, -5.f}, {5.f, 5.f, 5.f}}},
+            {{{5.f, -5.f, -5.f}, {5.f, 5.f, 5.f}, {5.f, -5.f, 5.f}}},
+            {{{-5.f, -5.f, -5.f}, {-5.f, 5.f, 5.f}, {-5.f, 5.f, -5.f}}},
+            {{{-5.f, -5.f, -5.f}, {-5.f, -5.f, 5.f}, {-5.f, 5.f, 5.f}}},
+            {{{-5.f, 5.f, 5.f}, {5.f, 5.f, 5.f}, {-5.f, 5.f, -5.f}}},
+            {{{5.f, 5.f, 5.f}, {5.f, 5.f, -5.f}, {-5.f, 5.f, -5.f}}},
+            {{{-5.f, -5.f, 5.f}, {-5.f, -5.f, -5.f}, {5.f, -5.f, 5.f}}},
+            {{{5.f, -5.f, 5.f}, {-5.f, -5.f, -5.f}, {5.f, -5.f, -5.f}}},
+        };
+
+        void init_scene(raytracer& rt, camera& cam)
+        {
+            triangle_container box;
+            box.add(s_box);
+
+            const u32 mesh = rt.add_mesh(std::move(box));
+            const u32 material = rt.add_material({.albedo = {.5f, .5f, .5f}, .emissive = {1.f, .5f, .25f}});
+
+            rt.add_instance({.mesh = mesh, .material = material});
+            rt.rebuild_tlas();
+
+            camera_set_look_at(cam, vec3{0.f, 0.f, -2.f}, vec3{0.f, 0.f, 0.f}, vec3{0.f, 1.f, 0.f});
+            camera_set_horizontal_fov(cam, 90_deg);
+            camera_set_vertical_fov(cam, 60_deg);
+        }
+
+        mat4 make_transform(const vec3& position, f32 scale)
+        {
+            mat4 m = mat4::identity() * scale;
+            m.columns[3] = {position.x, position.y, position.z, 1.f};
+            return m;
+        }
+    }
+
+    TEST(raytracer, render_frame_parallel)
+    {
+        raytracer rt;
+        camera cam{};
+        init_scene(rt, cam);
+
+        constexpr u16 width{40};
+        constexpr u16 height{27};
+        constexpr u16 tileSize{8};
+
+        raytracer_state serialState;
+        serialState.resize(width, height, tileSize);
+        serialState.set_seed(42);
+
+        raytracer_state parallelState;
+        parallelState.resize(width, height, tileSize);
+        parallelState.set_seed(42);
+
+        for (u32 frame = 0; frame < 2; ++frame)
+        {
+            rt.render_frame(serialState, cam);
+        }
+
+        {
+            job_manager jm;
+            ASSERT_TRUE(jm.init({.numThreads = 4}));
+
+            for (u32 frame = 0; frame < 2; ++frame)
+            {
+                rt.render_frame(parallelState, cam);
+            }
+
+            jm.shutdown();
+        }
+
+        const auto& metrics = parallelState.get_metrics();
+        ASSERT_EQ(metrics.width, width);
+        ASSERT_EQ(metrics.height, height);
+        ASSERT_EQ(metrics.numTiles, 5u * 4u);
+        ASSERT_EQ(metrics.numPrimaryRays, u32{width} * height);
+        ASSERT_EQ(metrics.numTotalSamples, 8u);
+        ASSERT_GT(metrics.numTracedRays, metrics.numPrimaryRays);
+
+        ASSERT_EQ(parallelState.get_num_samples_at(width - 1, height - 1), 8u);
+
+        // The random streams only depend on seed, tile and sample count, so scheduling doesn't affect the result
+        const auto serialRadiance = serialState.get_radiance_buffer();
+        const auto parallelRadiance = parallelState.get_radiance_buffer();
+
+        ASSERT_EQ(serialRadiance.size(), parallelRadiance.size());
+
+        for (usize i = 0; i < serialRadiance.size(); ++i)
+        {
+            ASSERT_EQ(serialRadiance[i], parallelRadiance[i]);
+            ASSERT_GT(parallelRadiance[i].x, 0.f);
+        }
+
+        ASSERT_EQ(serialState.get_metrics().numTracedRays, metrics.numTracedRays);
+    }
+
+    TEST(raytracer, intersect_packet)
+    {
+        raytracer rt;
+        camera cam{};
+        init_scene(rt, cam);
+
+        ray_packet packet;
+
+        for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+        {
+            const vec2 uv{-1.f + lane * .25f, .5f - lane * .1f};
+            packet.set(lane, ray_cast(cam, uv));
+        }
+
+        // Leave the last lane out
+        constexpr u32 activeMask{0x7f};
+
+        raytracer_result results[ray_packet::Size];
+        const u32 hitMask = rt.intersect_packet(packet, activeMask, results);
+
+        ASSERT_EQ(hitMask, activeMask);
+
+        for (u32 lane = 0; lane < ray_packet::Size - 1; ++lane)
+        {
+            raytracer_result expected{};
+            ASSERT_TRUE(rt.intersect(packet.get(lane), expected));
+
+            ASSERT_EQ(results[lane].instance, expected.instance);
+            ASSERT_EQ(results[lane].mesh, expected.mesh);
+            ASSERT_EQ(results[lane].material, expected.material);
+            ASSERT_EQ(results[lane].triangle, expected.triangle);
+            ASSERT_NEAR(results[lane].distance, expected.distance, 1e-4f);
+        }
+    }
+
+    TEST(raytracer, occluded)
+    {
+        raytracer rt;
+        camera cam{};
+        init_scene(rt, cam);
+
+        std::mt19937 rng{41};
+        std::uniform_real_distribution<f32> coordinate{-1.f, 1.f};
+        std::uniform_real_distribution<f32> maxDistance{0.f, 12.f};
+
+        // Hemisphere-like batches from a few points, as ambient occlusion would issue them, with a partial last packet
+        constexpr u32 numRays{203};
+
+        std::vector<ray> rays;
+        std::vector<f32> maxDistances;
+
+        for (u32 i = 0; i < numRays; ++i)
+        {
+            const vec3 origin = i % 32 == 0 || rays.empty() ? vec3{coordinate(rng), coordinate(rng), coordinate(rng)}
+                                                            : rays.back().origin;
+
+            rays.push_back({origin, normalize(vec3{coordinate(rng), coordinate(rng), coordinate(rng)})});
+            maxDistances.push_back(maxDistance(rng));
+        }
+
+        u32 expectedOccluded{0};
+
+        for (u32 i = 0; i < numRays; ++i)
+        {
+            raytracer_result result{};
+            ASSERT_TRUE(rt.intersect(rays[i], result));
+
+            const bool isOccluded = rt.occluded(rays[i], maxDistances[i]);
+            ASSERT_EQ(isOccluded, result.distance < maxDistances[i]);
+
+            expectedOccluded += u32{isOccluded};
+        }
+
+        bool results[numRays];
+        const u32 numOccluded = rt.occluded(rays, maxDistances, results);
+
+        ASSERT_EQ(numOccluded, expectedOccluded);
+        ASSERT_GT(numOccluded, 0u);
+        ASSERT_LT(numOccluded, numRays);
+
+        for (u32 i = 0; i < numRays; ++i)
+        {
+            ASSERT_EQ(results[i], rt.occluded(rays[i], maxDistances[i]));
+        }
+    }
+
+    TEST(raytracer, instance_transforms)
+    {
+        raytracer rt;
+
+        triangle_container box;
+        box.add(s_box);
+
+        const u32 mesh = rt.add_mesh(std::move(box));
+        const u32 material = rt.add_material({.albedo = {.5f, .5f, .5f}, .emissive = {}});
+
+        // A row of boxes along x, scaled up by 2 so they are 20 units wide
+        constexpr u32 numInstances{8};
+        constexpr f32 spacing{40.f};
+
+        for (u32 i = 0; i < numInstances; ++i)
+        {
+            rt.add_instance({.mesh = mesh, .material = material, .transform = make_transform({i * spacing, 0, 0}, 2)});
+        }
+
+        rt.update_tlas();
+        ASSERT_EQ(rt.get_tlas_builds_count(), 1u);
+
+        const auto castDown = [&rt](const vec3& origin, raytracer_result& result)
+        { return rt.intersect({.origin = origin, .direction = {0.f, 0.f, 1.f}}, result); };
+
+        for (u32 i = 0; i < numInstances; ++i)
+        {
+            raytracer_result result{};
+            ASSERT_TRUE(castDown({i * spacing + 9.f, 9.f, -50.f}, result));
+            ASSERT_EQ(result.instance, i);
+            ASSERT_NEAR(result.distance, 40.f, 1e-4f);
+
+            ASSERT_TRUE(rt.occluded({.origin = {i * spacing, 0.f, -50.f}, .direction = {0.f, 0.f, 1.f}}, 41.f));
+            ASSERT_FALSE(rt.occluded({.origin = {i * spacing, 0.f, -50.f}, .direction = {0.f, 0.f, 1.f}}, 39.f));
+        }
+
+        // Nothing between the boxes
+        raytracer_result result{};
+        ASSERT_FALSE(castDown({spacing * .5f, 0.f, -50.f}, result));
+
+        // A small move only refits the tree
+        rt.set_instance_transform(3, make_transform({3 * spacing, 5.f, 0.f}, 2));
+        rt.update_tlas();
+        ASSERT_EQ(rt.get_tlas_builds_count(), 1u);
+
+        ASSERT_FALSE(castDown({3 * spacing, -12.f, -50.f}, result));
+        ASSERT_TRUE(castDown({3 * spacing, 12.f, -50.f}, result));
+        ASSERT_EQ(result.instance, 3u);
+
+        // Rotating by 90 degrees around y, the ray hits the side of the box which is now facing it
+        mat4 rotated = make_transform({3 * spacing, 5.f, 0.f}, 2);
+        rotated.columns[0] = {0.f, 0.f, -2.f, 0.f};
+        rotated.columns[2] = {2.f, 0.f, 0.f, 0.f};
+
+        rt.set_instance_transform(3, rotated);
+        rt.update_tlas();
+
+        ray_packet packet;
+
+        for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+        {
+            packet.set(lane, {.origin = {3 * spacing + lane - 4.f, 0.f, -50.f}, .direction = {0.f, 0.f, 1.f}});
+        }
+
+        raytracer_result results[ray_packet::Size];
+        ASSERT_EQ(rt.intersect_packet(packet, 0xff, results), 0xffu);
+
+        for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+        {
+            ASSERT_EQ(results[lane].instance, 3u);
+            ASSERT_NEAR(results[lane].distance, 40.f, 1e-4f);
+        }
+
+        // Swapping the boxes at the ends makes both halves of the tree span the whole row, which triggers a rebuild
+        rt.set_instance_transform(0, make_transform({(numInstances - 1) * spacing, 0, 0}, 2));
+        rt.set_instance_transform(numInstances - 1, make_transform({0, 0, 0}, 2));
+        rt.update_tlas();
+        ASSERT_EQ(rt.get_tlas_builds_count(), 2u);
+
+        ASSERT_TRUE(castDown({0.f, 0.f, -50.f}, result));
+        ASSERT_EQ(result.instance, numInstances - 1);
+
+        ASSERT_TRUE(castDown({(numInstances - 1) * spacing, 0.f, -50.f}, result));
+        ASSERT_EQ(result.instance, 0u);
+    }
+
+    TEST(raytracer, quantized_blas)
+    {
+        std::mt19937 rng{59};
+        std::uniform_real_distribution<f32> coordinate{-5.f, 5.f};
+        std::uniform_real_distribution<f32> offset{-.5f, .5f};
+
+        std::vector<triangle> triangles;
+
+        for (u32 i = 0; i < 1024; ++i)
+        {
+            const vec3 v{coordinate(rng), coordinate(rng), coordinate(rng)};
+            const vec3 a = v + vec3{offset(rng), offset(rng), 0.f};
+            const vec3 b = v + vec3{0.f, offset(rng), offset(rng)};
+            triangles.push_back({{v, a, b}});
+        }
+
+        // The reference uses regular BLASes, the other one mixes a regular box with a quantized soup of triangles
+        raytracer reference;
+        raytracer quantized;
+
+        for (raytracer* rt : {&reference, &quantized})
+        {
+            triangle_container box;
+            box.add(s_box);
+            rt->add_mesh(std::move(box));
+
+            rt->set_quantized_blas(rt == &quantized);
+
+            triangle_container soup;
+            soup.add(triangles);
+            rt->add_mesh(std::move(soup));
+
+            const u32 material = rt->add_material({.albedo = {.5f, .5f, .5f}, .emissive = {}});
+
+            rt->add_instance({.mesh = 0, .material = material, .transform = make_transform({0.f, 0.f, 30.f}, 4)});
+            rt->add_instance({.mesh = 1, .material = material, .transform = make_transform({0.f, 0.f, 0.f}, 1)});
+            rt->add_instance({.mesh = 1, .material = material, .transform = make_transform({12.f, 3.f, 5.f}, 2)});
+
+            rt->rebuild_tlas();
+        }
+
+        std::uniform_real_distribution<f32> direction{-1.f, 1.f};
+        std::uniform_real_distribution<f32> maxDistance{0.f, 40.f};
+
+        std::vector<ray> rays;
+        std::vector<f32> maxDistances;
+
+        for (u32 i = 0; i < 256; ++i)
+        {
+            const vec3 origin = i % 8 == 0 ? vec3{direction(rng), direction(rng), -1.f} * 20.f : rays.back().origin;
+            rays.push_back({origin, normalize(vec3{direction(rng) * .5f, direction(rng) * .5f, 1.f})});
+            maxDistances.push_back(maxDistance(rng));
+        }
+
+        u32 numHits{0};
+
+        for (usize i = 0; i < rays.size(); ++i)
+        {
+            raytracer_result expected{};
+            const bool isHit = reference.intersect(rays[i], expected);
+
+            raytracer_result result{};
+            ASSERT_EQ(quantized.intersect(rays[i], result), isHit);
+
+            if (isHit)
+            {
+                ASSERT_EQ(result.instance, expected.instance);
+                ASSERT_EQ(result.triangle, expected.triangle);
+                ASSERT_NEAR(result.distance, expected.distance, 1e-4f);
+                ++numHits;
+            }
+
+            ASSERT_EQ(quantized.occluded(rays[i], maxDistances[i]), reference.occluded(rays[i], maxDistances[i]));
+        }
+
+        ASSERT_GT(numHits, 0u);
+
+        bool expectedOccluded[256];
+        bool occluded[256];
+
+        ASSERT_EQ(quantized.occluded(rays, maxDistances, occluded),
+            reference.occluded(rays, maxDistances, expectedOccluded));
+
+        ASSERT_TRUE(std::equal(std::begin(occluded), std::end(occluded), std::begin(expectedOccluded)));
+
+        for (usize first = 0; first < rays.size(); first += ray_packet::Size)
+        {
+            ray_packet packet;
+
+            for (u32 lane = 0; lane < ray_packet::Size; ++lane)
+            {
+                packet.set(lane, rays[first + lane]);
+            }
+
+            raytracer_result expected[ray_packet::Size];
+            raytracer_result results[ray_packet::Size];
+
+            const u32 hitMask = quantized.intersect_packet(packet, 0xff, results);
+            ASSERT_EQ(hitMask, reference.intersect_packet(packet, 0xff, expected));
+
+            for (u32 mask = hitMask; mask != 0; mask &= mask - 1)
+            {
+                const u32 lane = u32(std::countr_zero(mask));
+
+                ASSERT_EQ(results[lane].instance, expected[lane].instance);
+                ASSERT_EQ(results[lane].triangle, expected[lane].triangle);
+                ASSERT_NEAR(results[lane].distance, expected[lane].distance, 1e-4f);
+            }
+        }
+    }
+
+    TEST(raytracer, remove_instances)
+    {
+        raytracer rt;
+
+        triangle_container box;
+        box.add(s_box);
+
+        const u32 mesh = rt.add_mesh(std::move(box));
+        const u32 material = rt.add_material({});
+
+        constexpr u32 numInstances{4};
+
+        for (u32 i = 0; i < numInstances; ++i)
+        {
+            rt.add_instance({.mesh = mesh, .material = material, .transform = make_transform({i * 20.f, 0, 0}, 1)});
+        }
+
+        rt.update_tlas();
+
+        const auto collectOverlaps = [&rt](const aabb& box)
+        {
+            std::vector<u32> instances;
+            rt.overlap(box, [&instances](u32 instance) { instances.push_back(instance); });
+            std::sort(instances.begin(), instances.end());
+            return instances;
+        };
+
+        ASSERT_EQ(collectOverlaps({{-1.f, -1.f, -1.f}, {25.f, 1.f, 1.f}}), (std::vector<u32>{0, 1}));
+        ASSERT_EQ(collectOverlaps({{6.f, -1.f, -1.f}, {14.f, 1.f, 1.f}}), std::vector<u32>{});
+
+        // The last instance takes the place of the removed one
+        rt.remove_instance(1);
+        ASSERT_EQ(rt.get_instances_count(), numInstances - 1);
+
+        rt.set_instance_transform(1, make_transform({20.f, 0.f, 0.f}, 1));
+        rt.update_tlas();
+
+        ASSERT_EQ(collectOverlaps({{-1.f, -1.f, -1.f}, {25.f, 1.f, 1.f}}), (std::vector<u32>{0, 1}));
+        ASSERT_EQ(collectOverlaps({{55.f, -1.f, -1.f}, {65.f, 1.f, 1.f}}), std::vector<u32>{});
+
+        raytracer_result result{};
+        ASSERT_TRUE(rt.intersect({.origin = {40.f, 0.f, -20.f}, .direction = {0.f, 0.f, 1.f}}, result));
+        ASSERT_EQ(result.instance, 2u);
+
+        ASSERT_FALSE(rt.intersect({.origin = {60.f, 0.f, -20.f}, .direction = {0.f, 0.f, 1.f}}, result));
+    }
+
+    TEST(raytracer, adaptive_sampling)
+    {
+        raytracer rt;
+
+        triangle_container box;
+        box.add(s_box);
+
+        // Without albedo every sample that hits the box has the same radiance, so only the pixels on its silhouette,
+        // where the jittered samples partially miss it, have any variance
+        const u32 mesh = rt.add_mesh(std::move(box));
+        const u32 material = rt.add_material({.albedo = {}, .emissive = {1.f, 1.f, 1.f}});
+
+        rt.add_instance({.mesh = mesh, .material = material, .transform = make_transform({0.f, 0.f, 20.f}, .5f)});
+        rt.rebuild_tlas();
+
+        camera cam{};
+        camera_set_look_at(cam, vec3{0.f, 0.f, -2.f}, vec3{0.f, 0.f, 0.f}, vec3{0.f, 1.f, 0.f});
+        camera_set_horizontal_fov(cam, 90_deg);
+        camera_set_vertical_fov(cam, 60_deg);
+
+        constexpr u16 width{64};
+        constexpr u16 height{48};
+        constexpr u16 tileSize{8};
+        constexpr u32 minSamples{8};
+
+        raytracer_state state;
+        state.resize(width, height, tileSize);
+        state.set_sampling({.isAdaptive = true, .minSamples = minSamples, .maxSamples = 64, .noiseThreshold = .01f});
+
+        // Uniform passes until every pixel has the minimum number of samples
+        for (u32 i = 0; i < minSamples / 4; ++i)
+        {
+            rt.render_frame(state, cam);
+            ASSERT_EQ(state.get_metrics().numPrimaryRays, u32{width} * height);
+        }
+
+        ASSERT_EQ(state.get_converged_tiles_count(), 0u);
+
+        rt.render_frame(state, cam);
+
+        // Tiles that are entirely inside or outside of the box converge right away
+        const u32 convergedTiles = state.get_converged_tiles_count();
+        ASSERT_GT(convergedTiles, 0u);
+        ASSERT_LT(convergedTiles, state.get_tiles_count());
+        ASSERT_EQ(state.get_metrics().numConvergedTiles, convergedTiles);
+        ASSERT_LT(state.get_metrics().numPrimaryRays, u32{width} * height);
+
+        // The center of the box and the corners of the image are noiseless, the extra samples went to the silhouette
+        ASSERT_EQ(state.get_num_samples_at(width / 2, height / 2), minSamples);
+        ASSERT_EQ(state.get_num_samples_at(0, 0), minSamples);
+        ASSERT_EQ(state.get_num_samples_at(width - 1, height - 1), minSamples);
+
+        u32 maxPixelSamples{0};
+
+        for (u16 y = 0; y < height; ++y)
+        {
+            for (u16 x = 0; x < width; ++x)
+            {
+                maxPixelSamples = max(maxPixelSamples, state.get_num_samples_at(x, y));
+            }
+        }
+
+        ASSERT_GT(maxPixelSamples, minSamples + 4);
+
+        // Pixels stop at the maximum number of samples, so the whole image eventually converges
+        const u32 passes = rt.render_progressive(state, cam, time::from_seconds(60.f));
+
+        ASSERT_GE(passes, 1u);
+        ASSERT_EQ(state.get_converged_tiles_count(), state.get_tiles_count());
+        ASSERT_EQ(state.get_metrics().numConvergedTiles, state.get_tiles_count());
+
+        // Once converged, passes don't trace anything
+        rt.render_frame(state, cam);
+        ASSERT_EQ(state.get_metrics().numTracedRays, 0u);
+
+        // Resetting the accumulation starts over
+        state.reset_accumulation();
+        ASSERT_EQ(state.get_converged_tiles_count(), 0u);
+        ASSERT_EQ(state.get_num_samples_at(0, 0), 0u);
+
+        // A budget of zero still renders a single pass
+        ASSERT_EQ(rt.render_progressive(state, cam, time{}), 1u);
+        ASSERT_EQ(state.get_num_samples_at(0, 0), 4u);
+    }
+
+    TEST(raytracer, progressive_empty_scene)
+    {
+        raytracer rt;
+
+        raytracer_state state;
+        state.resize(16, 16, 8);
+
+        const camera cam{};
+
+        // There's nothing to trace, so no pass is rendered regardless of the budget
+        ASSERT_EQ(rt.render_progressive(state, cam, time::from_seconds(60.f)), 0u);
+        ASSERT_EQ(state.get_converged_tiles_count(), 0u);
+    }
+}
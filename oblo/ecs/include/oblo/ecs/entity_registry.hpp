@@ -138,6 +138,19 @@ namespace oblo::ecs
 
         bool is_notified(entity e, u64 modificationId) const;
 
+        /// @brief Starts recording the entities that are destroyed or lose components or tags, to be fetched with
+        /// fetch_removals.
+        /// @remarks This allows keeping a copy of some entities elsewhere, e.g. in an acceleration structure, without
+        /// scanning it for the ones that went away. Tracking stops when calling untrack_removals.
+        h32<removal_queue> track_removals();
+
+        void untrack_removals(h32<removal_queue> queue);
+
+        /// @brief Retrieves the entities recorded since the last call, clearing the queue.
+        /// @remarks Entities are recorded on every removal, so they might appear more than once, and the ones that
+        /// only lost some components or tags are still alive.
+        void fetch_removals(h32<removal_queue> queue, dynamic_array<entity>& out);
+
         /// @brief Extracts the entity index.
         /// @remarks Entity handles are composed of a number of generation bits, while te rest is an index in an array.
         /// This function allows extracting the index part of the handle.
@@ -183,6 +196,8 @@ namespace oblo::ecs
 
         void move_archetype(entity_data& entityData, const archetype_storage& newStorage);
 
+        void record_removal(entity e);
+
         template <typename DoCreateEntity>
         void create_entities(const component_and_tag_sets& types, u32 count, DoCreateEntity&& doCreate);
 
@@ -193,6 +208,7 @@ namespace oblo::ecs
         entities_map m_entities;
         dynamic_array<archetype_storage> m_componentsStorage;
         u64 m_modificationId{};
+        h32_flat_pool_dense_map<removal_queue, dynamic_array<entity>> m_removalQueues;
     };
 
     template <typename... Components>
@@ -341,8 +357,8 @@ namespace oblo::ecs
         const auto querySets = make_type_sets<ComponentsOrTags...>(*m_typeRegistry);
         const auto entitySets = get_type_sets(e);
 
-        return querySets.components.intersection(entitySets.components) == querySets.components &&
-            querySets.tags.intersection(entitySets.tags) == querySets.tags;
+        return entitySets.components.contains_all(querySets.components) &&
+            entitySets.tags.contains_all(querySets.tags);
     }
 
     inline const type_registry& entity_registry::get_type_registry() const
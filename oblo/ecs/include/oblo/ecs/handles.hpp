@@ -7,6 +7,7 @@ namespace oblo::ecs
     struct entity_handle;
     struct component_type_handle;
     struct tag_type_handle;
+    struct removal_queue;
 
     using entity = h32<entity_handle>;
     using component_type = h32<component_type_handle>;
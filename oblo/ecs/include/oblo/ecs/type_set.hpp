@@ -7,7 +7,17 @@
 #include <oblo/ecs/traits.hpp>
 #include <oblo/ecs/type_registry.hpp>
 
+#include <bit>
 #include <compare>
+#include <type_traits>
+
+#if defined(__AVX2__)
+    #define OBLO_ECS_TYPE_SET_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define OBLO_ECS_TYPE_SET_SSE2
+    #include <emmintrin.h>
+#endif
 
 namespace oblo::ecs
 {
@@ -25,10 +35,17 @@ namespace oblo::ecs
 
         void add(const type_set& other)
         {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+            store(_mm256_or_si256(load(), other.load()));
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+            store(0, _mm_or_si128(load(0), other.load(0)));
+            store(1, _mm_or_si128(load(1), other.load(1)));
+#else
             for (u32 i = 0; i < BlocksCount; ++i)
             {
                 bitset[i] |= other.bitset[i];
             }
+#endif
         }
 
         template <typename T>
@@ -43,14 +60,31 @@ namespace oblo::ecs
 
         void remove(const type_set& other)
         {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+            store(_mm256_andnot_si256(other.load(), load()));
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+            store(0, _mm_andnot_si128(other.load(0), load(0)));
+            store(1, _mm_andnot_si128(other.load(1), load(1)));
+#else
             for (u32 i = 0; i < BlocksCount; ++i)
             {
                 bitset[i] &= ~other.bitset[i];
             }
+#endif
         }
 
         constexpr bool is_empty() const
         {
+            if (!std::is_constant_evaluated())
+            {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+                const __m256i v = load();
+                return _mm256_testz_si256(v, v) != 0;
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+                return is_zero(_mm_or_si128(load(0), load(1)));
+#endif
+            }
+
             return *this == type_set{};
         }
 
@@ -65,10 +99,70 @@ namespace oblo::ecs
             return res != 0;
         }
 
+        /// @brief Checks whether all the types in the other set are also in this set.
+        constexpr bool contains_all(const type_set& other) const
+        {
+            if (!std::is_constant_evaluated())
+            {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+                return _mm256_testc_si256(load(), other.load()) != 0;
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+                return is_zero(_mm_or_si128(
+                    _mm_andnot_si128(load(0), other.load(0)), _mm_andnot_si128(load(1), other.load(1))));
+#endif
+            }
+
+            for (u32 i = 0; i < BlocksCount; ++i)
+            {
+                if ((other.bitset[i] & ~bitset[i]) != 0)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// @brief Checks whether the two sets have at least one type in common.
+        constexpr bool intersects(const type_set& other) const
+        {
+            if (!std::is_constant_evaluated())
+            {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+                return _mm256_testz_si256(load(), other.load()) == 0;
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+                return !is_zero(
+                    _mm_or_si128(_mm_and_si128(load(0), other.load(0)), _mm_and_si128(load(1), other.load(1))));
+#endif
+            }
+
+            for (u32 i = 0; i < BlocksCount; ++i)
+            {
+                if ((other.bitset[i] & bitset[i]) != 0)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
         [[nodiscard]] constexpr type_set intersection(const type_set& other) const
         {
             type_set r;
 
+            if (!std::is_constant_evaluated())
+            {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+                r.store(_mm256_and_si256(load(), other.load()));
+                return r;
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+                r.store(0, _mm_and_si128(load(0), other.load(0)));
+                r.store(1, _mm_and_si128(load(1), other.load(1)));
+                return r;
+#endif
+            }
+
             for (u32 i = 0; i < BlocksCount; ++i)
             {
                 r.bitset[i] = bitset[i] & other.bitset[i];
@@ -77,12 +171,102 @@ namespace oblo::ecs
             return r;
         }
 
+        /// @brief Returns the number of types in the set.
+        constexpr u32 count() const
+        {
+            u32 r{0};
+
+            for (u32 i = 0; i < BlocksCount; ++i)
+            {
+                r += u32(std::popcount(bitset[i]));
+            }
+
+            return r;
+        }
+
+        /// @brief Returns the number of types in the set with an index lower than the given one.
+        /// @remarks When the type is in the set, this is its position among the sorted types of the set.
+        template <typename T>
+        constexpr u32 rank(h32<T> index) const
+        {
+            OBLO_ASSERT(index);
+            const u32 block = index.value / BitsPerBlock;
+            const u64 partialMask = (u64(1) << (index.value % BitsPerBlock)) - 1;
+
+            u32 r{0};
+
+            // Branchless on the block index, blocks below are counted fully and blocks above are masked out
+            for (u32 i = 0; i < BlocksCount; ++i)
+            {
+                const u64 mask = i < block ? ~u64{} : i == block ? partialMask : u64{};
+                r += u32(std::popcount(bitset[i] & mask));
+            }
+
+            return r;
+        }
+
         constexpr auto operator<=>(const type_set&) const = default;
 
+        constexpr bool operator==(const type_set& other) const
+        {
+            if (!std::is_constant_evaluated())
+            {
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+                const __m256i diff = _mm256_xor_si256(load(), other.load());
+                return _mm256_testz_si256(diff, diff) != 0;
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+                return is_zero(
+                    _mm_or_si128(_mm_xor_si128(load(0), other.load(0)), _mm_xor_si128(load(1), other.load(1))));
+#endif
+            }
+
+            for (u32 i = 0; i < BlocksCount; ++i)
+            {
+                if (bitset[i] != other.bitset[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
         static constexpr u32 BitsPerBlock{64u};
         static constexpr u32 BlocksCount{round_up_div(MaxComponentTypes, BitsPerBlock)};
 
         u64 bitset[BlocksCount];
+
+    private:
+#if defined(OBLO_ECS_TYPE_SET_AVX2)
+        static_assert(BlocksCount == 4, "The AVX2 implementation expects the whole set to fit in 256 bits");
+
+        __m256i load() const
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bitset));
+        }
+
+        void store(__m256i v)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(bitset), v);
+        }
+#elif defined(OBLO_ECS_TYPE_SET_SSE2)
+        static_assert(BlocksCount == 4, "The SSE2 implementation expects the whole set to fit in 2x128 bits");
+
+        __m128i load(u32 half) const
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bitset) + half);
+        }
+
+        void store(u32 half, __m128i v)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bitset) + half, v);
+        }
+
+        static bool is_zero(__m128i v)
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+        }
+#endif
     };
 
     struct component_and_tag_sets
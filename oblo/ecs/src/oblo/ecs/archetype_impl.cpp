@@ -8,6 +8,7 @@
 #include <oblo/math/power_of_two.hpp>
 
 #include <algorithm>
+#include <bit>
 
 namespace oblo::ecs
 {
@@ -30,18 +31,12 @@ namespace oblo::ecs
                     continue;
                 }
 
-                u32 nextId = u32(i * 32);
+                const u32 blockOffset = u32(i * type_set::BitsPerBlock);
 
-                // TODO: Could use bitscan reverse instead
-                for (u64 mask = 1; mask != 0; mask <<= 1)
+                for (u64 remaining = v; remaining != 0; remaining &= remaining - 1)
                 {
-                    if (v & mask)
-                    {
-                        inOut[count] = T{nextId};
-                        ++count;
-                    }
-
-                    ++nextId;
+                    inOut[count] = T{blockOffset + u32(std::countr_zero(remaining))};
+                    ++count;
                 }
             }
 
@@ -133,18 +133,21 @@ namespace oblo::ecs
 
     void reserve_chunks(memory_pool& pool, archetype_impl& archetype, u32 newCount);
 
-    // TODO: Could be implemented with bitwise operations and type_set instead
-    inline u8 find_component_index(std::span<const component_type> types, component_type component)
+    /// @brief Finds the index of the component in the archetype, or InvalidComponentIndex if not present.
+    /// @remarks Components are sorted by type, so the index is the number of types in the set that come before it.
+    inline u8 find_component_index(const archetype_impl& archetype, component_type component)
     {
-        for (const component_type& c : types)
+        const type_set& types = archetype.types.components;
+
+        if (!types.contains(component))
         {
-            if (c == component)
-            {
-                return u8(&c - types.data());
-            }
+            return InvalidComponentIndex;
         }
 
-        return InvalidComponentIndex;
+        const u8 index = u8(types.rank(component));
+        OBLO_ASSERT(index < archetype.numComponents && archetype.components[index] == component);
+
+        return index;
     }
 
     struct entity_location
@@ -1,8 +1,10 @@
 #include <oblo/ecs/entity_registry.hpp>
 
+#include <oblo/core/allocation_tracking.hpp>
 #include <oblo/core/debug.hpp>
 #include <oblo/core/iterator/zip_range.hpp>
 #include <oblo/core/memory_pool.hpp>
+#include <oblo/core/stl/memory_resource_adapter.hpp>
 #include <oblo/ecs/archetype_impl.hpp>
 #include <oblo/ecs/handles.hpp>
 #include <oblo/ecs/range.hpp>
@@ -23,8 +25,18 @@ namespace oblo::ecs
         u32 archetypeIndex;
     };
 
+    namespace
+    {
+        std::pmr::memory_resource* get_chunks_upstream_resource()
+        {
+            static memory_resource_adapter s_resource{get_global_aligned_allocator(allocation_tag::ecs)};
+            return &s_resource;
+        }
+    }
+
     struct entity_registry::memory_pool : oblo::memory_pool
     {
+        memory_pool() : oblo::memory_pool{get_chunks_upstream_resource()} {}
     };
 
     entity_registry::entity_registry() = default;
@@ -190,6 +202,8 @@ namespace oblo::ecs
 
         m_entities.erase(e);
         m_pool.release(e.value);
+
+        record_removal(e);
     }
 
     void entity_registry::destroy_all()
@@ -229,6 +243,13 @@ namespace oblo::ecs
             storage.archetype->modificationId = m_modificationId;
         }
 
+        const std::span allEntities = entities();
+
+        for (auto& queue : m_removalQueues.values())
+        {
+            queue.append(allEntities.begin(), allEntities.end());
+        }
+
         m_entities.clear();
         m_pool.clear();
     }
@@ -275,6 +296,8 @@ namespace oblo::ecs
 
         const archetype_storage& newStorage = find_or_create_storage(types);
         move_archetype(*entityData, newStorage);
+
+        record_removal(e);
     }
 
     bool entity_registry::contains(entity e) const
@@ -309,7 +332,7 @@ namespace oblo::ecs
 
         auto* const archetype = entityData->archetype;
 
-        const u8 componentIndex = find_component_index({archetype->components, archetype->numComponents}, component);
+        const u8 componentIndex = find_component_index(*archetype, component);
 
         if (componentIndex == InvalidComponentIndex)
         {
@@ -332,7 +355,7 @@ namespace oblo::ecs
 
         auto* const archetype = entityData->archetype;
 
-        const u8 componentIndex = find_component_index({archetype->components, archetype->numComponents}, component);
+        const u8 componentIndex = find_component_index(*archetype, component);
 
         if (componentIndex == InvalidComponentIndex)
         {
@@ -364,8 +387,7 @@ namespace oblo::ecs
 
             auto* const archetype = entityData->archetype;
 
-            const u8 componentIndex =
-                find_component_index({archetype->components, archetype->numComponents}, component);
+            const u8 componentIndex = find_component_index(*archetype, component);
 
             if (componentIndex == InvalidComponentIndex)
             {
@@ -473,6 +495,36 @@ namespace oblo::ecs
         return archetype->chunks[chunkIndex]->header.modificationId >= modificationId;
     }
 
+    h32<removal_queue> entity_registry::track_removals()
+    {
+        const auto [it, key] = m_removalQueues.emplace();
+        return key;
+    }
+
+    void entity_registry::untrack_removals(h32<removal_queue> queue)
+    {
+        m_removalQueues.erase(queue);
+    }
+
+    void entity_registry::fetch_removals(h32<removal_queue> queue, dynamic_array<entity>& out)
+    {
+        out.clear();
+
+        if (auto* const removals = m_removalQueues.try_find(queue))
+        {
+            // Swapping keeps the capacity of both arrays, so neither side reallocates in steady state
+            removals->swap(out);
+        }
+    }
+
+    void entity_registry::record_removal(entity e)
+    {
+        for (auto& queue : m_removalQueues.values())
+        {
+            queue.push_back(e);
+        }
+    }
+
     u32 entity_registry::extract_entity_index(ecs::entity e) const
     {
         return decltype(m_entities)::extractor_type{}.extract_key(e);
@@ -499,14 +551,10 @@ namespace oblo::ecs
 
             const auto& archetypeTypes = it->archetype->types;
 
-            const auto compInt = archetypeTypes.components.intersection(includes.components);
-            const auto tagsInt = archetypeTypes.tags.intersection(includes.tags);
-
-            const auto forbiddenCompInt = archetypeTypes.components.intersection(excludes.components);
-            const auto forbiddenTagsInt = archetypeTypes.tags.intersection(excludes.tags);
-
-            if (compInt == includes.components && tagsInt == includes.tags && forbiddenCompInt.is_empty() &&
-                forbiddenTagsInt.is_empty())
+            if (archetypeTypes.components.contains_all(includes.components) &&
+                archetypeTypes.tags.contains_all(includes.tags) &&
+                !archetypeTypes.components.intersects(excludes.components) &&
+                !archetypeTypes.tags.intersects(excludes.tags))
             {
                 return it;
             }
@@ -653,8 +701,7 @@ namespace oblo::ecs
                 continue;
             }
 
-            const u8 componentIndex =
-                find_component_index({archetype->components, archetype->numComponents}, component);
+            const u8 componentIndex = find_component_index(*archetype, component);
 
             if (componentIndex == InvalidComponentIndex)
             {
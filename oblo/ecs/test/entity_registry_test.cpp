@@ -10,6 +10,7 @@
 #include <oblo/ecs/utility/registration.hpp>
 #include <oblo/math/vec2.hpp>
 
+#include <algorithm>
 #include <array>
 
 namespace oblo::ecs
@@ -157,4 +158,59 @@ namespace oblo::ecs
             ASSERT_EQ(ecs::get_entities_count(arch), 0);
         }
     }
-}
\ No newline at end of file
+
+    TEST(entity_registry, track_removals)
+    {
+        type_registry typeRegistry;
+        typeRegistry.register_component(make_component_type_desc<mock_sprite_component>());
+        typeRegistry.register_component(make_component_type_desc<mock_name_component>());
+        typeRegistry.register_tag(make_tag_type_desc<mock_selected_tag>());
+
+        entity_registry reg{&typeRegistry};
+
+        const auto A = reg.create<mock_sprite_component, mock_name_component>();
+        const auto B = reg.create<mock_sprite_component, mock_selected_tag>();
+        const auto C = reg.create<mock_name_component>();
+
+        // Removals before tracking starts are not recorded
+        reg.destroy(C);
+
+        const h32<removal_queue> queue = reg.track_removals();
+        ASSERT_TRUE(queue);
+
+        dynamic_array<entity> removed;
+
+        reg.fetch_removals(queue, removed);
+        ASSERT_TRUE(removed.empty());
+
+        // Adding components doesn't remove anything
+        reg.add<mock_selected_tag>(A);
+        reg.remove<mock_name_component>(A);
+        reg.destroy(B);
+
+        reg.fetch_removals(queue, removed);
+        ASSERT_EQ(removed.size(), 2);
+        ASSERT_EQ(removed[0], A);
+        ASSERT_EQ(removed[1], B);
+
+        // The queue is cleared on fetch
+        reg.fetch_removals(queue, removed);
+        ASSERT_TRUE(removed.empty());
+
+        const auto D = reg.create<mock_name_component>();
+        reg.destroy_all();
+
+        reg.fetch_removals(queue, removed);
+        ASSERT_EQ(removed.size(), 2);
+        ASSERT_NE(std::find(removed.begin(), removed.end(), A), removed.end());
+        ASSERT_NE(std::find(removed.begin(), removed.end(), D), removed.end());
+
+        reg.untrack_removals(queue);
+
+        const auto E = reg.create<mock_name_component>();
+        reg.destroy(E);
+
+        reg.fetch_removals(queue, removed);
+        ASSERT_TRUE(removed.empty());
+    }
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/random_generator.hpp>
+#include <oblo/ecs/entity_registry.hpp>
+#include <oblo/ecs/range.hpp>
+#include <oblo/ecs/type_registry.hpp>
+#include <oblo/ecs/type_set.hpp>
+#include <oblo/ecs/utility/registration.hpp>
+
+#include <utility>
+
+namespace oblo::ecs
+{
+    namespace
+    {
+        type_set make_random_set(random_generator& rng, u32 density)
+        {
+            type_set s{};
+
+            for (u32 i = 1; i < MaxComponentTypes; ++i)
+            {
+                if (rng.generate() % 100 < density)
+                {
+                    s.add(component_type{i});
+                }
+            }
+
+            return s;
+        }
+
+        template <u32 N>
+        struct numbered_component
+        {
+            u32 value;
+        };
+
+        template <u32... N>
+        void register_numbered_components(type_registry& typeRegistry, std::integer_sequence<u32, N...>)
+        {
+            (typeRegistry.register_component(make_component_type_desc<numbered_component<N>>()), ...);
+        }
+    }
+
+    TEST(type_set, operations)
+    {
+        random_generator rng;
+        rng.seed(42);
+
+        for (u32 iteration = 0; iteration < 256; ++iteration)
+        {
+            const auto a = make_random_set(rng, iteration % 50);
+            const auto b = make_random_set(rng, iteration % 7);
+
+            type_set united = a;
+            united.add(b);
+
+            type_set difference = a;
+            difference.remove(b);
+
+            const type_set intersection = a.intersection(b);
+
+            u32 count{0};
+            bool intersects{false};
+            bool containsAll{true};
+
+            for (u32 i = 1; i < MaxComponentTypes; ++i)
+            {
+                const component_type c{i};
+
+                ASSERT_EQ(united.contains(c), a.contains(c) || b.contains(c));
+                ASSERT_EQ(difference.contains(c), a.contains(c) && !b.contains(c));
+                ASSERT_EQ(intersection.contains(c), a.contains(c) && b.contains(c));
+
+                if (a.contains(c))
+                {
+                    ASSERT_EQ(a.rank(c), count);
+                    ++count;
+                }
+
+                intersects |= a.contains(c) && b.contains(c);
+                containsAll &= !b.contains(c) || a.contains(c);
+            }
+
+            ASSERT_EQ(a.count(), count);
+            ASSERT_EQ(a.intersects(b), intersects);
+            ASSERT_EQ(a.contains_all(b), containsAll);
+            ASSERT_EQ(a.is_empty(), count == 0);
+
+            ASSERT_TRUE(united.contains_all(a));
+            ASSERT_TRUE(united.contains_all(b));
+            ASSERT_TRUE(a.contains_all(intersection));
+            ASSERT_FALSE(difference.intersects(b));
+
+            ASSERT_EQ(intersection == a, b.contains_all(a));
+            ASSERT_EQ(united == a, a.contains_all(b));
+        }
+
+        constexpr type_set empty{};
+        static_assert(empty.is_empty());
+        static_assert(empty.contains_all(empty));
+        static_assert(!empty.intersects(empty));
+    }
+
+    TEST(type_set, many_component_types)
+    {
+        type_registry typeRegistry;
+
+        // Spans multiple blocks of the set, to make sure component indices match across the whole range
+        register_numbered_components(typeRegistry, std::make_integer_sequence<u32, 200>{});
+
+        entity_registry reg{&typeRegistry};
+
+        const auto e = reg.create<numbered_component<3>, numbered_component<70>, numbered_component<130>>();
+
+        {
+            auto&& [c3, c70, c130] =
+                reg.get<numbered_component<3>, numbered_component<70>, numbered_component<130>>(e);
+
+            c3.value = 3;
+            c70.value = 70;
+            c130.value = 130;
+        }
+
+        ASSERT_TRUE((reg.has<numbered_component<70>, numbered_component<130>>(e)));
+        ASSERT_FALSE((reg.has<numbered_component<71>>(e)));
+        ASSERT_FALSE(reg.try_get<numbered_component<199>>(e));
+
+        ASSERT_EQ(reg.get<numbered_component<3>>(e).value, 3u);
+        ASSERT_EQ(reg.get<numbered_component<70>>(e).value, 70u);
+        ASSERT_EQ(reg.get<numbered_component<130>>(e).value, 130u);
+
+        u32 matches{0};
+
+        for (auto&& chunk : reg.range<numbered_component<130>, numbered_component<70>>())
+        {
+            for (auto&& [entityId, c130, c70] :
+                chunk.zip<const entity, numbered_component<130>, numbered_component<70>>())
+            {
+                ASSERT_EQ(entityId, e);
+                ASSERT_EQ(c130.value, 130u);
+                ASSERT_EQ(c70.value, 70u);
+                ++matches;
+            }
+        }
+
+        ASSERT_EQ(matches, 1u);
+
+        u32 excludedMatches{0};
+
+        auto excludingRange = reg.range<numbered_component<70>>();
+        excludingRange.exclude<numbered_component<3>>();
+
+        for (auto&& chunk : excludingRange)
+        {
+            excludedMatches += u32(chunk.get<numbered_component<70>>().size());
+        }
+
+        ASSERT_EQ(excludedMatches, 0u);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/core/unique_ptr.hpp>
+#include <oblo/ecs/handles.hpp>
+#include <oblo/math/vec3.hpp>
+
+namespace oblo::ecs
+{
+    class entity_registry;
+}
+
+namespace oblo
+{
+    class resource_registry;
+
+    struct aabb;
+    struct ray;
+
+    struct scene_raycast_hit
+    {
+        ecs::entity entity;
+        f32 distance;
+        vec3 position;
+    };
+
+    /// @brief Mirrors the entities with a mesh and a global transform in a CPU acceleration structure, to run
+    /// raycasts and overlap queries synchronously, e.g. for picking or box selection, without going through the GPU.
+    /// @remarks The service is kept up to date by the scene_raycast_system, which is only part of worlds built with
+    /// the scene_raycast usage. Tools without a system graph can call update directly instead.
+    class scene_raycaster
+    {
+    public:
+        scene_raycaster();
+        scene_raycaster(const scene_raycaster&) = delete;
+        scene_raycaster(scene_raycaster&&) noexcept = delete;
+
+        ~scene_raycaster();
+
+        scene_raycaster& operator=(const scene_raycaster&) = delete;
+        scene_raycaster& operator=(scene_raycaster&&) noexcept = delete;
+
+        void init(const resource_registry& resourceRegistry);
+
+        /// @brief Brings the mirrored scene up to date with the entities, only visiting the chunks that were notified
+        /// since the last update and the entities the registry reported as removed.
+        /// @remarks Meshes are loaded asynchronously, entities only become visible to queries once their mesh is
+        /// loaded. Meshes are loaded once and shared among the entities using them. Meshes missing from the resource
+        /// registry are looked up again on later updates, while the ones that failed to load are retried when the
+        /// registry reports them as updated. The first update starts tracking removals on the registry, which has to be
+        /// the same on every call and outlive the raycaster.
+        void update(ecs::entity_registry& entities);
+
+        /// @brief Finds the closest entity hit by the ray.
+        bool raycast(const ray& ray, scene_raycast_hit& out) const;
+
+        /// @brief Appends the entities whose world space bounds overlap the box.
+        void overlap(const aabb& box, dynamic_array<ecs::entity>& out) const;
+
+        /// @brief The number of entities currently visible to queries.
+        u32 get_entities_count() const;
+
+    private:
+        struct impl;
+        unique_ptr<impl> m_impl;
+    };
+}
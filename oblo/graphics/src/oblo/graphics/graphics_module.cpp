@@ -5,12 +5,14 @@
 #include <oblo/core/struct_apply.hpp>
 #include <oblo/ecs/services/world_builder.hpp>
 #include <oblo/ecs/systems/system_graph_builder.hpp>
+#include <oblo/graphics/services/scene_raycaster.hpp>
 #include <oblo/graphics/services/scene_renderer.hpp>
 #include <oblo/graphics/systems/animation_system.hpp>
 #include <oblo/graphics/systems/draw_registry_system.hpp>
 #include <oblo/graphics/systems/graphics_options.hpp>
 #include <oblo/graphics/systems/lighting_system.hpp>
 #include <oblo/graphics/systems/mesh_system.hpp>
+#include <oblo/graphics/systems/scene_raycast_system.hpp>
 #include <oblo/graphics/systems/skybox_system.hpp>
 #include <oblo/graphics/systems/viewport_system.hpp>
 #include <oblo/math/color.hpp>
@@ -21,6 +23,7 @@
 #include <oblo/renderer/draw/resource_cache.hpp>
 #include <oblo/renderer/renderer.hpp>
 #include <oblo/scene/systems/barriers.hpp>
+#include <oblo/scene/systems/usages.hpp>
 #include <oblo/vulkan/vulkan_engine_module.hpp>
 
 namespace oblo
@@ -51,6 +54,13 @@ namespace oblo
                         builder.unique(r.get_frame_graph(), drawRegistry);
                     });
 
+                builder.add<scene_raycaster>().require<const resource_registry>().build(
+                    [](service_builder<scene_raycaster> builder)
+                    {
+                        auto& resourceRegistry = *builder.find<const resource_registry>();
+                        builder.unique()->init(resourceRegistry);
+                    });
+
                 builder.add<resource_cache>().require<renderer>().build(
                     [](service_builder<resource_cache> builder)
                     {
@@ -80,6 +90,11 @@ namespace oblo
             {
                 builder.add_system<animation_system>().before<barriers::transform_update>();
 
+                if (builder.usages().contains(system_graph_usages::scene_raycast))
+                {
+                    builder.add_system<scene_raycast_system>().after<barriers::transform_update>();
+                }
+
                 builder.add_system<lighting_system>()
                     .after<barriers::renderer_extract>()
                     .before<barriers::renderer_update>();
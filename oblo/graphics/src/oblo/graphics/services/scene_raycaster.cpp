@@ -0,0 +1,482 @@
+#include <oblo/graphics/services/scene_raycaster.hpp>
+
+#include <oblo/acceleration/triangle_container.hpp>
+#include <oblo/core/debug.hpp>
+#include <oblo/core/data_format.hpp>
+#include <oblo/core/unordered_map.hpp>
+#include <oblo/core/uuid.hpp>
+#include <oblo/ecs/entity_registry.hpp>
+#include <oblo/ecs/range.hpp>
+#include <oblo/ecs/type_registry.hpp>
+#include <oblo/ecs/utility/entity_map.hpp>
+#include <oblo/graphics/components/mesh_component.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/mat4.hpp>
+#include <oblo/math/ray.hpp>
+#include <oblo/math/triangle.hpp>
+#include <oblo/raytracer/raytracer.hpp>
+#include <oblo/resource/resource_ptr.hpp>
+#include <oblo/resource/resource_ref.hpp>
+#include <oblo/resource/resource_registry.hpp>
+#include <oblo/scene/components/global_transform_component.hpp>
+#include <oblo/scene/resources/mesh.hpp>
+
+#include <cstring>
+
+namespace oblo
+{
+    namespace
+    {
+        constexpr u32 NoIndex{~u32{}};
+
+        enum class mesh_state : u8
+        {
+            loading,
+            ready,
+            /// @brief The resource is not in the registry (yet), e.g. because the asset is still being imported.
+            missing,
+            /// @brief The resource failed to load, or it has no triangles.
+            failed,
+        };
+
+        struct mesh_entry
+        {
+            resource_ptr<mesh> resource;
+            u32 index{NoIndex};
+            mesh_state state{mesh_state::loading};
+
+            /// @brief Entities using the mesh while it's missing or failed, they are added again when it's retried.
+            dynamic_array<ecs::entity> waitingEntities;
+        };
+
+        struct mirrored_entity
+        {
+            uuid mesh;
+            mat4 localToWorld;
+            u32 instance{NoIndex};
+            bool isPending{};
+        };
+
+        bool has_changes(const mat4& lhs, const mat4& rhs)
+        {
+            return std::memcmp(&lhs, &rhs, sizeof(mat4)) != 0;
+        }
+
+        template <typename F>
+        void for_each_triangle(const mesh& m, F&& f)
+        {
+            if (m.has_attribute(attribute_kind::indices))
+            {
+                switch (m.get_attribute_format(attribute_kind::indices))
+                {
+                case data_format::u8: {
+                    const std::span indices = m.get_attribute<u8>(attribute_kind::indices);
+
+                    for (u32 i = 0; i + 2 < m.get_index_count(); i += 3)
+                    {
+                        f(indices[i], indices[i + 1], indices[i + 2]);
+                    }
+
+                    break;
+                }
+
+                case data_format::u16: {
+                    const std::span indices = m.get_attribute<u16>(attribute_kind::indices);
+
+                    for (u32 i = 0; i + 2 < m.get_index_count(); i += 3)
+                    {
+                        f(indices[i], indices[i + 1], indices[i + 2]);
+                    }
+
+                    break;
+                }
+
+                case data_format::u32: {
+                    const std::span indices = m.get_attribute<u32>(attribute_kind::indices);
+
+                    for (u32 i = 0; i + 2 < m.get_index_count(); i += 3)
+                    {
+                        f(indices[i], indices[i + 1], indices[i + 2]);
+                    }
+
+                    break;
+                }
+
+                default:
+                    break;
+                }
+            }
+            else
+            {
+                for (u32 i = 0; i + 2 < m.get_vertex_count(); i += 3)
+                {
+                    f(i, i + 1, i + 2);
+                }
+            }
+        }
+
+        bool make_triangles(const mesh& m, triangle_container& out)
+        {
+            if (m.get_primitive_kind() != primitive_kind::triangle || !m.has_attribute(attribute_kind::position) ||
+                m.get_attribute_format(attribute_kind::position) != data_format::vec3)
+            {
+                return false;
+            }
+
+            const std::span positions = m.get_attribute<vec3>(attribute_kind::position);
+
+            dynamic_array<triangle> triangles;
+            triangles.reserve(m.has_attribute(attribute_kind::indices) ? m.get_index_count() / 3
+                                                                       : m.get_vertex_count() / 3);
+
+            for_each_triangle(m,
+                [&triangles, positions](u32 a, u32 b, u32 c)
+                { triangles.push_back({{positions[a], positions[b], positions[c]}}); });
+
+            if (triangles.empty())
+            {
+                return false;
+            }
+
+            out.add(triangles);
+            return true;
+        }
+    }
+
+    struct scene_raycaster::impl
+    {
+        ~impl()
+        {
+            if (entityRegistry)
+            {
+                entityRegistry->untrack_removals(removals);
+            }
+        }
+
+        const resource_registry* resourceRegistry{};
+
+        ecs::entity_registry* entityRegistry{};
+        h32<ecs::removal_queue> removals{};
+
+        raytracer tracer;
+
+        unordered_map<uuid, mesh_entry> meshes;
+        ecs::entity_map<mirrored_entity> entities;
+
+        /// @brief The entity of each instance in the raytracer.
+        dynamic_array<ecs::entity> instanceEntities;
+
+        /// @brief Entities waiting for their mesh to load, they are not part of the raytracer yet.
+        dynamic_array<ecs::entity> pendingEntities;
+
+        dynamic_array<ecs::entity> removedEntities;
+
+        /// @brief Meshes that were not in the registry when first requested.
+        dynamic_array<uuid> missingMeshes;
+
+        u64 lastModificationId{};
+
+        void remove_instance(mirrored_entity& entity)
+        {
+            if (entity.instance == NoIndex)
+            {
+                return;
+            }
+
+            // The raytracer moves the last instance in place of the removed one, we do the same with the entities
+            tracer.remove_instance(entity.instance);
+
+            const ecs::entity movedEntity = instanceEntities.back();
+            instanceEntities[entity.instance] = movedEntity;
+            instanceEntities.pop_back();
+
+            if (auto* const moved = entities.try_find(movedEntity); moved && moved != &entity)
+            {
+                moved->instance = entity.instance;
+            }
+
+            entity.instance = NoIndex;
+        }
+
+        void remove_dead_entities(ecs::entity_registry& reg)
+        {
+            reg.fetch_removals(removals, removedEntities);
+
+            for (const ecs::entity e : removedEntities)
+            {
+                auto* const mirrored = entities.try_find(e);
+
+                // Entities might have only lost unrelated components, or be reported more than once
+                if (mirrored && (!reg.contains(e) || !reg.has<mesh_component, global_transform_component>(e)))
+                {
+                    remove_instance(*mirrored);
+                    entities.erase(e);
+                }
+            }
+        }
+
+        void sync_entity(ecs::entity e, const uuid& meshId, const mat4& localToWorld)
+        {
+            auto* const mirrored = entities.try_find(e);
+
+            if (!mirrored)
+            {
+                entities.emplace(e,
+                    mirrored_entity{
+                        .mesh = meshId,
+                        .localToWorld = localToWorld,
+                        .isPending = true,
+                    });
+
+                pendingEntities.push_back(e);
+                return;
+            }
+
+            if (mirrored->mesh != meshId)
+            {
+                remove_instance(*mirrored);
+
+                mirrored->mesh = meshId;
+                mirrored->localToWorld = localToWorld;
+
+                if (!mirrored->isPending)
+                {
+                    mirrored->isPending = true;
+                    pendingEntities.push_back(e);
+                }
+
+                return;
+            }
+
+            if (has_changes(mirrored->localToWorld, localToWorld))
+            {
+                mirrored->localToWorld = localToWorld;
+
+                if (mirrored->instance != NoIndex)
+                {
+                    tracer.set_instance_transform(mirrored->instance, localToWorld);
+                }
+            }
+        }
+
+        void start_loading(const uuid& meshId, mesh_entry& entry)
+        {
+            entry.resource = resourceRegistry->get_resource(resource_ref<mesh>{.id = meshId});
+            entry.state = entry.resource ? mesh_state::loading : mesh_state::missing;
+
+            if (entry.state == mesh_state::missing)
+            {
+                missingMeshes.push_back(meshId);
+            }
+        }
+
+        void retry_mesh(const uuid& meshId, mesh_entry& entry)
+        {
+            start_loading(meshId, entry);
+
+            for (const ecs::entity e : entry.waitingEntities)
+            {
+                auto* const mirrored = entities.try_find(e);
+
+                // Skip entities that were removed or switched mesh in the meantime
+                if (mirrored && mirrored->mesh == meshId && mirrored->instance == NoIndex && !mirrored->isPending)
+                {
+                    mirrored->isPending = true;
+                    pendingEntities.push_back(e);
+                }
+            }
+
+            entry.waitingEntities.clear();
+        }
+
+        void retry_meshes()
+        {
+            // Missing meshes might show up once their asset is imported, looking them up is cheap enough to do it on
+            // every update
+            for (usize i = 0; i < missingMeshes.size();)
+            {
+                const uuid meshId = missingMeshes[i];
+
+                if (!resourceRegistry->get_resource(resource_ref<mesh>{.id = meshId}))
+                {
+                    ++i;
+                    continue;
+                }
+
+                missingMeshes[i] = missingMeshes.back();
+                missingMeshes.pop_back();
+
+                retry_mesh(meshId, meshes.at(meshId));
+            }
+
+            // Meshes that failed to load are only retried when they change, e.g. when the asset is reimported
+            for (const uuid& meshId : resourceRegistry->get_updated_events<mesh>())
+            {
+                if (const auto it = meshes.find(meshId); it != meshes.end() && it->second.state == mesh_state::failed)
+                {
+                    retry_mesh(meshId, it->second);
+                }
+            }
+        }
+
+        mesh_entry& get_or_load_mesh(const uuid& meshId)
+        {
+            const auto [it, inserted] = meshes.emplace(meshId, mesh_entry{});
+            mesh_entry& entry = it->second;
+
+            if (inserted)
+            {
+                start_loading(meshId, entry);
+            }
+
+            if (entry.state != mesh_state::loading)
+            {
+                return entry;
+            }
+
+            entry.resource.load_start_async();
+
+            if (entry.resource.is_currently_loading())
+            {
+                return entry;
+            }
+
+            triangle_container triangles;
+
+            if (entry.resource.is_successfully_loaded() && make_triangles(*entry.resource, triangles))
+            {
+                entry.index = tracer.add_mesh(std::move(triangles));
+                entry.state = mesh_state::ready;
+            }
+            else
+            {
+                entry.state = mesh_state::failed;
+            }
+
+            // The CPU copy of the triangles is all we need, the resource can be unloaded
+            entry.resource.reset();
+
+            return entry;
+        }
+
+        void add_pending_instances()
+        {
+            for (usize i = 0; i < pendingEntities.size();)
+            {
+                const ecs::entity e = pendingEntities[i];
+                auto* const mirrored = entities.try_find(e);
+
+                mesh_state state = mesh_state::failed;
+
+                if (mirrored)
+                {
+                    mesh_entry& entry = get_or_load_mesh(mirrored->mesh);
+                    state = entry.state;
+
+                    if (state == mesh_state::ready)
+                    {
+                        // Material 0 is never accessed, queries don't look at materials
+                        mirrored->instance = tracer.add_instance({
+                            .mesh = entry.index,
+                            .material = 0,
+                            .transform = mirrored->localToWorld,
+                        });
+
+                        instanceEntities.push_back(e);
+                    }
+                    else if (state != mesh_state::loading)
+                    {
+                        entry.waitingEntities.push_back(e);
+                    }
+                }
+
+                if (state == mesh_state::loading)
+                {
+                    ++i;
+                    continue;
+                }
+
+                if (mirrored)
+                {
+                    mirrored->isPending = false;
+                }
+
+                pendingEntities[i] = pendingEntities.back();
+                pendingEntities.pop_back();
+            }
+        }
+    };
+
+    scene_raycaster::scene_raycaster() = default;
+
+    scene_raycaster::~scene_raycaster() = default;
+
+    void scene_raycaster::init(const resource_registry& resourceRegistry)
+    {
+        m_impl = allocate_unique<impl>();
+        m_impl->resourceRegistry = &resourceRegistry;
+    }
+
+    void scene_raycaster::update(ecs::entity_registry& entities)
+    {
+        if (!m_impl->entityRegistry)
+        {
+            // Removals are only tracked once the service is in use, so that idle instances don't accumulate them
+            m_impl->entityRegistry = &entities;
+            m_impl->removals = entities.track_removals();
+        }
+
+        OBLO_ASSERT(m_impl->entityRegistry == &entities, "The raycaster can only mirror a single registry");
+
+        const u64 currentModificationId = entities.get_modification_id();
+        const u64 target = m_impl->lastModificationId;
+
+        m_impl->remove_dead_entities(entities);
+
+        // The range has to outlive the loop, notified returns a reference to it
+        auto meshesRange = entities.range<const mesh_component, const global_transform_component>();
+
+        for (auto&& chunk : meshesRange.notified(target))
+        {
+            for (auto&& [e, meshComponent, globalTransform] :
+                chunk.zip<ecs::entity, const mesh_component, const global_transform_component>())
+            {
+                m_impl->sync_entity(e, meshComponent.mesh.id, globalTransform.localToWorld);
+            }
+        }
+
+        m_impl->retry_meshes();
+        m_impl->add_pending_instances();
+        m_impl->tracer.update_tlas();
+
+        m_impl->lastModificationId = currentModificationId;
+    }
+
+    bool scene_raycaster::raycast(const ray& ray, scene_raycast_hit& out) const
+    {
+        raytracer_result result;
+
+        if (!m_impl->tracer.intersect(ray, result))
+        {
+            return false;
+        }
+
+        out = {
+            .entity = m_impl->instanceEntities[result.instance],
+            .distance = result.distance,
+            .position = ray.origin + ray.direction * result.distance,
+        };
+
+        return true;
+    }
+
+    void scene_raycaster::overlap(const aabb& box, dynamic_array<ecs::entity>& out) const
+    {
+        m_impl->tracer.overlap(box, [this, &out](u32 instance) { out.push_back(m_impl->instanceEntities[instance]); });
+    }
+
+    u32 scene_raycaster::get_entities_count() const
+    {
+        return m_impl->tracer.get_instances_count();
+    }
+}
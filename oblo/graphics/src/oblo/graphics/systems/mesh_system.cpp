@@ -16,6 +16,7 @@
 #include <oblo/graphics/components/mesh_internal.hpp>
 #include <oblo/graphics/components/skin_component.hpp>
 #include <oblo/log/log.hpp>
+#include <oblo/math/aabb.hpp>
 #include <oblo/math/transform.hpp>
 #include <oblo/math/vec3.hpp>
 #include <oblo/renderer/data/components.hpp>
@@ -26,9 +27,11 @@
 #include <oblo/resource/resource_registry.hpp>
 #include <oblo/scene/components/children_component.hpp>
 #include <oblo/scene/components/global_transform_component.hpp>
+#include <oblo/scene/components/local_bounds_component.hpp>
 #include <oblo/scene/components/parent_component.hpp>
 #include <oblo/scene/components/tags.hpp>
 #include <oblo/scene/resources/material.hpp>
+#include <oblo/scene/resources/mesh.hpp>
 #include <oblo/scene/resources/pbr_properties.hpp>
 #include <oblo/scene/resources/skeleton.hpp>
 
@@ -108,10 +111,23 @@ namespace oblo
             return out;
         }
 
+        aabb compute_mesh_bounds(const mesh& m)
+        {
+            const aabb bounds = m.get_aabb();
+
+            if (is_valid(bounds) || !m.has_attribute(attribute_kind::position))
+            {
+                return bounds;
+            }
+
+            return compute_aabb(m.get_attribute<vec3>(attribute_kind::position));
+        }
+
         template <bool WithSkin>
         bool try_add_mesh(const resource_registry* resourceRegistry,
             resource_cache* resourceCache,
             draw_registry& drawRegistry,
+            unordered_map<uuid, aabb>& meshBounds,
             ecs::entity entity,
             const mesh_component& meshComponent,
             [[maybe_unused]] const skin_component* skinComponent,
@@ -169,10 +185,11 @@ namespace oblo
             materialRes.load_start_async();
             stillLoading |= materialRes.is_currently_loading();
 
-            // If the mesh is already on GPU we don't care about loading the resource
+            // If the mesh is already on GPU we don't care about loading the resource, unless we still need its bounds
             auto mesh = drawRegistry.try_get_mesh(meshComponent.mesh);
+            auto boundsIt = meshBounds.find(meshComponent.mesh.id);
 
-            if (!mesh)
+            if (!mesh || boundsIt == meshBounds.end())
             {
                 meshRes.load_start_async();
                 stillLoading |= meshRes.is_currently_loading();
@@ -198,6 +215,11 @@ namespace oblo
                 log::debug("Failed to load mesh resources for entity {}", entity.value);
             }
 
+            if (boundsIt == meshBounds.end() && meshRes.is_successfully_loaded())
+            {
+                boundsIt = meshBounds.emplace(meshComponent.mesh.id, compute_mesh_bounds(*meshRes)).first;
+            }
+
             if (!mesh)
             {
                 mesh = drawRegistry.get_or_create_mesh(meshComponent.mesh);
@@ -218,6 +240,19 @@ namespace oblo
 
             deferred.remove<mesh_resources>(entity);
 
+            // The bounds are picked up by the spatial index
+            if (boundsIt != meshBounds.end() && is_valid(boundsIt->second))
+            {
+                deferred.add<local_bounds_component>(entity) = {
+                    .min = boundsIt->second.min,
+                    .max = boundsIt->second.max,
+                };
+            }
+            else
+            {
+                deferred.remove<local_bounds_component>(entity);
+            }
+
             gpuMaterial = convert(*resourceRegistry, *resourceCache, *materialRes);
 
             pickingId.entityId = entity;
@@ -311,6 +346,7 @@ namespace oblo
                     try_add_mesh<withSkin>(m_resourceRegistry,
                         m_resourceCache,
                         *m_drawRegistry,
+                        m_meshBounds,
                         e,
                         meshComponent,
                         nullptr,
@@ -334,6 +370,7 @@ namespace oblo
                     const bool meshAdded = try_add_mesh<withSkin>(m_resourceRegistry,
                         m_resourceCache,
                         *m_drawRegistry,
+                        m_meshBounds,
                         e,
                         meshComponent,
                         &skinComponent,
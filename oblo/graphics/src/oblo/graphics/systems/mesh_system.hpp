@@ -2,6 +2,7 @@
 
 #include <oblo/core/unordered_map.hpp>
 #include <oblo/core/uuid.hpp>
+#include <oblo/math/aabb.hpp>
 #include <oblo/resource/resource_ref.hpp>
 
 namespace oblo::ecs
@@ -44,5 +45,8 @@ namespace oblo
         resource_cache* m_resourceCache;
 
         unordered_map<uuid, skin_info> m_skinInfo;
+
+        /// @brief The local bounds of the meshes that were loaded, so that they are only loaded once for the bounds.
+        unordered_map<uuid, aabb> m_meshBounds;
     };
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include <oblo/graphics/systems/scene_raycast_system.hpp>
+
+#include <oblo/core/debug.hpp>
+#include <oblo/core/service_registry.hpp>
+#include <oblo/ecs/entity_registry.hpp>
+#include <oblo/ecs/systems/system_update_context.hpp>
+#include <oblo/graphics/services/scene_raycaster.hpp>
+
+namespace oblo
+{
+    void scene_raycast_system::first_update(const ecs::system_update_context& ctx)
+    {
+        m_raycaster = ctx.services->find<scene_raycaster>();
+        OBLO_ASSERT(m_raycaster);
+
+        update(ctx);
+    }
+
+    void scene_raycast_system::update(const ecs::system_update_context& ctx)
+    {
+        m_raycaster->update(*ctx.entities);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace oblo::ecs
+{
+    struct system_update_context;
+}
+
+namespace oblo
+{
+    class scene_raycaster;
+
+    class scene_raycast_system
+    {
+    public:
+        void first_update(const ecs::system_update_context& ctx);
+        void update(const ecs::system_update_context& ctx);
+
+    private:
+        scene_raycaster* m_raycaster{};
+    };
+}
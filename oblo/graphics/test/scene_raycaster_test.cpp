@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/data_format.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/expected.hpp>
+#include <oblo/core/finally.hpp>
+#include <oblo/core/type_id.hpp>
+#include <oblo/core/uuid.hpp>
+#include <oblo/ecs/entity_registry.hpp>
+#include <oblo/ecs/type_registry.hpp>
+#include <oblo/ecs/utility/registration.hpp>
+#include <oblo/graphics/components/mesh_component.hpp>
+#include <oblo/graphics/services/scene_raycaster.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/mat4.hpp>
+#include <oblo/math/ray.hpp>
+#include <oblo/resource/descriptors/resource_type_descriptor.hpp>
+#include <oblo/resource/providers/resource_provider.hpp>
+#include <oblo/resource/resource_registry.hpp>
+#include <oblo/scene/components/global_transform_component.hpp>
+#include <oblo/scene/resources/mesh.hpp>
+#include <oblo/scene/resources/traits.hpp>
+#include <oblo/thread/job_manager.hpp>
+
+#include <chrono>
+#include <thread>
+
+namespace oblo
+{
+    namespace
+    {
+        constexpr uuid QuadMeshId = "1c0b0c1e-6a35-4d0f-a0a3-5a9b5f0c6f01"_uuid;
+        constexpr uuid BrokenMeshId = "1c0b0c1e-6a35-4d0f-a0a3-5a9b5f0c6f02"_uuid;
+        constexpr uuid LateMeshId = "1c0b0c1e-6a35-4d0f-a0a3-5a9b5f0c6f03"_uuid;
+
+        constexpr cstring_view QuadSource{"quad"};
+        constexpr cstring_view BrokenSource{"broken"};
+
+        /// @brief Loads a 2x2 quad on the XY plane, centered at the origin, unless the source is BrokenSource.
+        expected<> load_test_mesh(void* ptr, cstring_view source, const any&)
+        {
+            if (source != QuadSource)
+            {
+                return "Broken mesh"_err;
+            }
+
+            auto& m = *static_cast<mesh*>(ptr);
+
+            const mesh_attribute attributes[] = {{attribute_kind::position, data_format::vec3}};
+            m.allocate(primitive_kind::triangle, 6, 0, 0, attributes);
+
+            const std::span positions = m.get_attribute<vec3>(attribute_kind::position);
+
+            positions[0] = {-1.f, -1.f, 0.f};
+            positions[1] = {1.f, -1.f, 0.f};
+            positions[2] = {1.f, 1.f, 0.f};
+            positions[3] = {-1.f, -1.f, 0.f};
+            positions[4] = {1.f, 1.f, 0.f};
+            positions[5] = {-1.f, 1.f, 0.f};
+
+            return no_error;
+        }
+
+        class test_resource_provider final : public resource_provider
+        {
+        public:
+            struct mesh_event
+            {
+                uuid id;
+                cstring_view source;
+            };
+
+            void iterate_resource_events(on_add_fn onAdd, on_remove_fn, on_update_fn onUpdate) override
+            {
+                for (const auto& e : added)
+                {
+                    onAdd({.id = e.id, .typeUuid = resource_type<mesh>, .name = "mesh", .path = e.source});
+                }
+
+                for (const auto& e : updated)
+                {
+                    onUpdate({.id = e.id, .typeUuid = resource_type<mesh>, .name = "mesh", .path = e.source});
+                }
+
+                added.clear();
+                updated.clear();
+            }
+
+            dynamic_array<mesh_event> added;
+            dynamic_array<mesh_event> updated;
+        };
+
+        struct scene_raycaster_test_scene
+        {
+            scene_raycaster_test_scene()
+            {
+                ecs::register_type<mesh_component>(types);
+                ecs::register_type<global_transform_component>(types);
+
+                entities.init(&types);
+
+                resources.register_type({
+                    .typeId = get_type_id<mesh>(),
+                    .typeUuid = resource_type<mesh>,
+                    .create = []() -> void* { return new mesh{}; },
+                    .destroy = [](void* ptr) { delete static_cast<mesh*>(ptr); },
+                    .load = &load_test_mesh,
+                });
+
+                resources.register_provider(&provider);
+
+                provider.added.push_back({QuadMeshId, QuadSource});
+                provider.added.push_back({BrokenMeshId, BrokenSource});
+
+                raycaster.init(resources);
+            }
+
+            ecs::entity create(const uuid& meshId, const vec3& position)
+            {
+                const auto e = entities.create<mesh_component, global_transform_component>();
+                entities.get<mesh_component>(e).mesh = {.id = meshId};
+                move(e, position);
+                return e;
+            }
+
+            void move(ecs::entity e, const vec3& position)
+            {
+                mat4& localToWorld = entities.get<global_transform_component>(e).localToWorld;
+                localToWorld = mat4::identity();
+                localToWorld.columns[3] = {position.x, position.y, position.z, 1.f};
+
+                entities.notify(e);
+            }
+
+            void next_frame()
+            {
+                resources.update();
+                entities.set_modification_id(++modificationId);
+                raycaster.update(entities);
+            }
+
+            /// @brief Updates until the expected number of entities is visible, giving meshes time to load.
+            bool wait_for_entities(u32 count)
+            {
+                for (u32 i = 0; i < 1000; ++i)
+                {
+                    next_frame();
+
+                    if (raycaster.get_entities_count() == count)
+                    {
+                        return true;
+                    }
+
+                    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                }
+
+                return false;
+            }
+
+            /// @brief Casts a ray towards +Z from in front of the given point on the XY plane.
+            bool raycast_at(f32 x, f32 y, scene_raycast_hit& hit) const
+            {
+                return raycaster.raycast({.origin = {x, y, -10.f}, .direction = {0.f, 0.f, 1.f}}, hit);
+            }
+
+            ecs::type_registry types;
+            ecs::entity_registry entities;
+
+            test_resource_provider provider;
+            resource_registry resources;
+
+            // Destroyed first, since it tracks removals on the registry
+            scene_raycaster raycaster;
+
+            u64 modificationId{};
+        };
+    }
+
+    TEST(scene_raycaster, add_move_destroy)
+    {
+        job_manager jm;
+        jm.init();
+
+        const auto cleanup = finally([&jm] { jm.shutdown(); });
+
+        scene_raycaster_test_scene scene;
+
+        const auto a = scene.create(QuadMeshId, {0.f, 0.f, 0.f});
+        const auto b = scene.create(QuadMeshId, {5.f, 0.f, 2.f});
+
+        ASSERT_TRUE(scene.wait_for_entities(2));
+
+        scene_raycast_hit hit;
+
+        ASSERT_TRUE(scene.raycast_at(0.f, 0.f, hit));
+        ASSERT_EQ(hit.entity, a);
+        ASSERT_NEAR(hit.distance, 10.f, 1e-4f);
+
+        ASSERT_TRUE(scene.raycast_at(5.5f, .5f, hit));
+        ASSERT_EQ(hit.entity, b);
+        ASSERT_NEAR(hit.distance, 12.f, 1e-4f);
+        ASSERT_NEAR(hit.position.z, 2.f, 1e-4f);
+
+        ASSERT_FALSE(scene.raycast_at(2.5f, 0.f, hit));
+
+        dynamic_array<ecs::entity> overlapping;
+        scene.raycaster.overlap({.min = {4.f, -1.f, 1.f}, .max = {6.f, 1.f, 3.f}}, overlapping);
+        ASSERT_EQ(overlapping.size(), 1);
+        ASSERT_EQ(overlapping[0], b);
+
+        // Move a in front of b, it should now be the one hit
+        scene.move(a, {5.f, 0.f, -1.f});
+        scene.next_frame();
+
+        ASSERT_FALSE(scene.raycast_at(0.f, 0.f, hit));
+
+        ASSERT_TRUE(scene.raycast_at(5.f, 0.f, hit));
+        ASSERT_EQ(hit.entity, a);
+        ASSERT_NEAR(hit.distance, 9.f, 1e-4f);
+
+        scene.entities.destroy(a);
+        scene.next_frame();
+
+        ASSERT_EQ(scene.raycaster.get_entities_count(), 1u);
+
+        ASSERT_TRUE(scene.raycast_at(5.f, 0.f, hit));
+        ASSERT_EQ(hit.entity, b);
+
+        // Losing the mesh removes the entity as well, even though it's still alive
+        scene.entities.remove<mesh_component>(b);
+        scene.next_frame();
+
+        ASSERT_EQ(scene.raycaster.get_entities_count(), 0u);
+        ASSERT_FALSE(scene.raycast_at(5.f, 0.f, hit));
+    }
+
+    TEST(scene_raycaster, retry_meshes)
+    {
+        job_manager jm;
+        jm.init();
+
+        const auto cleanup = finally([&jm] { jm.shutdown(); });
+
+        scene_raycaster_test_scene scene;
+
+        const auto broken = scene.create(BrokenMeshId, {0.f, 0.f, 0.f});
+        const auto late = scene.create(LateMeshId, {5.f, 0.f, 0.f});
+        scene.create(QuadMeshId, {10.f, 0.f, 0.f});
+
+        // Only the valid mesh shows up, but the others are not given up on
+        ASSERT_TRUE(scene.wait_for_entities(1));
+
+        for (u32 i = 0; i < 10; ++i)
+        {
+            scene.next_frame();
+        }
+
+        ASSERT_EQ(scene.raycaster.get_entities_count(), 1u);
+
+        scene_raycast_hit hit;
+        ASSERT_FALSE(scene.raycast_at(0.f, 0.f, hit));
+        ASSERT_FALSE(scene.raycast_at(5.f, 0.f, hit));
+
+        // A mesh that was not registered yet is picked up once it is
+        scene.provider.added.push_back({LateMeshId, QuadSource});
+        ASSERT_TRUE(scene.wait_for_entities(2));
+
+        ASSERT_TRUE(scene.raycast_at(5.f, 0.f, hit));
+        ASSERT_EQ(hit.entity, late);
+
+        // A mesh that failed to load is retried when it's updated, e.g. after being reimported
+        scene.provider.updated.push_back({BrokenMeshId, QuadSource});
+        ASSERT_TRUE(scene.wait_for_entities(3));
+
+        ASSERT_TRUE(scene.raycast_at(0.f, 0.f, hit));
+        ASSERT_EQ(hit.entity, broken);
+    }
+}
@@ -6,17 +6,25 @@
 #include <oblo/asset/importers/dds.hpp>
 #include <oblo/asset/importers/gltf.hpp>
 #include <oblo/asset/importers/stb_image.hpp>
+#include <oblo/core/allocation_tracking.hpp>
 
 namespace oblo::importers
 {
     namespace
     {
+        template <typename T>
+        unique_ptr<file_importer> create_file_importer(const any&)
+        {
+            auto* const allocator = select_global_allocator<alignof(T)>(allocation_tag::importers);
+            return unique_ptr<T>{new (allocator->allocate(sizeof(T), alignof(T))) T{}, allocator};
+        }
+
         template <typename T>
         file_importer_descriptor make_file_importer_desc(std::span<const string_view> extensions)
         {
             return file_importer_descriptor{
                 .type = get_type_id<T>(),
-                .create = [](const any&) -> unique_ptr<file_importer> { return allocate_unique<T>(); },
+                .create = &create_file_importer<T>,
                 .extensions = extensions,
             };
         }
@@ -4,6 +4,7 @@
 #include <oblo/core/unique_ptr.hpp>
 #include <oblo/log/log_sink.hpp>
 
+#include <atomic>
 #include <mutex>
 
 namespace oblo::log
@@ -13,7 +14,7 @@ namespace oblo::log
         unique_ptr<log_sink> sink;
     };
 
-    inline bool g_isAsync;
+    inline std::atomic<bool> g_isAsync;
     inline deque<sink_storage> g_logSinks;
 
     constexpr cstring_view g_severityStrings[]{
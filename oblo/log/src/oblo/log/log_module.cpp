@@ -1,17 +1,17 @@
 #include <oblo/log/log_module.hpp>
 
-#include <oblo/core/array_size.hpp>
+#include <oblo/core/dynamic_array.hpp>
 #include <oblo/core/platform/core.hpp>
 #include <oblo/core/string/cstring_view.hpp>
+#include <oblo/core/thread/mpmc_ring_buffer.hpp>
 #include <oblo/core/utility.hpp>
 #include <oblo/log/log.hpp>
 #include <oblo/log/log_internal.hpp>
 #include <oblo/modules/module_manager.hpp>
 #include <oblo/thread/job_manager.hpp>
 
-#include <moodycamel/concurrentqueue.h>
-
 #include <cstdlib>
+#include <mutex>
 
 namespace oblo::log
 {
@@ -22,42 +22,44 @@ namespace oblo::log
             time time;
             u16 len;
             severity severity;
-            char data[detail::MaxLogMessageLength];
+            // One more character for the null-terminator added before sinking
+            char data[detail::MaxLogMessageLength + 1];
         };
 
-        struct message_buffer_chunk
+        struct async_queues
         {
-            message_buffer buffers[32];
-        };
+            // When all the buffers are in flight, messages are copied to the overflow list instead
+            static constexpr usize BuffersCount{256};
 
-        struct message_buffer_chunk_deleter
-        {
-            void operator()(message_buffer_chunk* ptr) const
+            async_queues()
             {
-                delete ptr;
-            }
-        };
+                freeBuffers.init(BuffersCount);
+                logs.init(BuffersCount);
 
-        using message_buffer_chunk_ptr = unique_ptr<message_buffer_chunk, message_buffer_chunk_deleter>;
+                for (auto& buffer : buffers)
+                {
+                    [[maybe_unused]] const bool pushed = freeBuffers.try_push(&buffer);
+                    OBLO_ASSERT(pushed);
+                }
+            }
 
-        message_buffer_chunk_ptr message_buffer_chunk_allocate()
-        {
-            return message_buffer_chunk_ptr{new message_buffer_chunk};
-        }
+            message_buffer buffers[BuffersCount];
 
-        struct async_queues
-        {
-            async_queues() = default;
+            mpmc_ring_buffer<message_buffer*> freeBuffers;
+            mpmc_ring_buffer<message_buffer*> logs;
 
-            moodycamel::ConcurrentQueue<message_buffer_chunk_ptr> allocations;
-            moodycamel::ConcurrentQueue<message_buffer*> buffers;
-            moodycamel::ConcurrentQueue<message_buffer*> logs;
+            // Messages that didn't fit in the ring, only touched on bursts, when the flush job is behind
+            std::mutex overflowMutex;
+            dynamic_array<unique_ptr<message_buffer>> overflow;
         };
 
         unique_ptr<async_queues> g_asyncQueues;
         std::atomic<bool> g_stopFlushJob{};
         job_handle g_flushJob{};
 
+        // The threads currently pushing to the async queues, which have to be kept alive until they are done
+        std::atomic<u32> g_asyncWriters{};
+
         void sink_it_now(severity severity, time t, char* str, usize n)
         {
             // Make sure it's null-terminated
@@ -71,6 +73,82 @@ namespace oblo::log
                 storage.sink->sink(severity, t, message);
             }
         }
+
+        usize flush_async_queue()
+        {
+            constexpr u32 n = 32;
+            message_buffer* buffers[n];
+
+            const auto count = g_asyncQueues->logs.try_pop_batch(buffers);
+
+            for (usize i = 0; i < count; ++i)
+            {
+                auto* const buf = buffers[i];
+                sink_it_now(buf->severity, buf->time, buf->data, buf->len);
+            }
+
+            if (count > 0)
+            {
+                g_asyncQueues->freeBuffers.push_batch(std::span{buffers, count});
+            }
+
+            dynamic_array<unique_ptr<message_buffer>> overflow;
+
+            {
+                const std::lock_guard lock{g_asyncQueues->overflowMutex};
+                overflow = std::move(g_asyncQueues->overflow);
+            }
+
+            for (auto& buf : overflow)
+            {
+                sink_it_now(buf->severity, buf->time, buf->data, buf->len);
+            }
+
+            return count + overflow.size();
+        }
+
+        void copy_message(message_buffer& buf, severity severity, time t, const char* str, usize n)
+        {
+            const auto len = min(detail::MaxLogMessageLength, n);
+
+            std::memcpy(buf.data, str, len);
+            buf.severity = severity;
+            buf.time = t;
+            buf.len = u16(len);
+        }
+
+        bool try_sink_async(severity severity, time t, const char* str, usize n)
+        {
+            g_asyncWriters.fetch_add(1);
+
+            // Checked again after registering as a writer, since shutdown might have started in the meantime
+            if (!g_isAsync)
+            {
+                g_asyncWriters.fetch_sub(1);
+                return false;
+            }
+
+            // Waiting for a buffer could deadlock, e.g. when logging from a sink or when all workers are busy, so we
+            // allocate one for the overflow list instead, which the flush job drains after the ring
+            if (message_buffer* buf; g_asyncQueues->freeBuffers.try_pop(buf))
+            {
+                copy_message(*buf, severity, t, str, n);
+
+                // There are as many slots as buffers, so this never waits
+                g_asyncQueues->logs.push(buf);
+            }
+            else
+            {
+                auto overflowBuffer = allocate_unique<message_buffer>();
+                copy_message(*overflowBuffer, severity, t, str, n);
+
+                const std::lock_guard lock{g_asyncQueues->overflowMutex};
+                g_asyncQueues->overflow.push_back(std::move(overflowBuffer));
+            }
+
+            g_asyncWriters.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
     }
 
     bool log_module::startup(const module_initializer&)
@@ -88,23 +166,9 @@ namespace oblo::log
             g_flushJob = jm->push_waitable(
                 []
                 {
-                    constexpr u32 n = 32;
-                    message_buffer* buffers[n];
-
                     while (!g_stopFlushJob)
                     {
-                        const auto count = g_asyncQueues->logs.try_dequeue_bulk(buffers, n);
-
-                        for (usize i = 0; i < count; ++i)
-                        {
-                            auto* const buf = buffers[i];
-                            sink_it_now(buf->severity, buf->time, buf->data, buf->len);
-                        }
-
-                        if (count > 0)
-                        {
-                            g_asyncQueues->buffers.enqueue_bulk(buffers, count);
-                        }
+                        flush_async_queue();
 
                         // Could use a condition variable instead
                         std::this_thread::yield();
@@ -123,10 +187,22 @@ namespace oblo::log
 
         if (g_isAsync)
         {
+            // Messages logged from now on are sunk right away, we only need to wait for the ones being pushed
+            g_isAsync = false;
+
+            while (g_asyncWriters.load() != 0)
+            {
+                std::this_thread::yield();
+            }
+
             g_stopFlushJob = true;
             job_manager::get()->wait(g_flushJob);
             g_flushJob = {};
 
+            while (flush_async_queue() > 0)
+            {
+            }
+
             g_asyncQueues.reset();
         }
 
@@ -144,47 +220,10 @@ namespace oblo::log
     {
         void sink_it(severity severity, time t, char* str, usize n)
         {
-            if (g_isAsync)
-            {
-                message_buffer* buf;
-
-                // Try to get a buffer from the buffer queue first
-                if (!g_asyncQueues->buffers.try_dequeue(buf))
-                {
-                    // Allocate a new chunk, the the first for ourselves and push the rest to the buffers queue
-                    auto chunk = message_buffer_chunk_allocate();
-                    buf = chunk->buffers;
-
-                    constexpr usize buffersCount = array_size(message_buffer_chunk{}.buffers);
-                    static_assert(buffersCount > 2, "This code is a little silly at best with low numbers");
-
-                    // We skip the first, because we take that for ourselves
-                    constexpr usize buffersToPush = buffersCount - 1;
-
-                    message_buffer* newBuffers[buffersToPush];
-
-                    for (u32 i = 0; i < buffersToPush; ++i)
-                    {
-                        newBuffers[i] = &chunk->buffers[i + 1];
-                    }
-
-                    g_asyncQueues->buffers.enqueue_bulk(newBuffers, buffersToPush);
-                    g_asyncQueues->allocations.enqueue(std::move(chunk));
-                }
-
-                const auto len = min(detail::MaxLogMessageLength, n);
-
-                std::memcpy(buf->data, str, len);
-                buf->severity = severity;
-                buf->time = t;
-                buf->len = u16(len);
-
-                g_asyncQueues->logs.enqueue(buf);
-            }
-            else
+            if (!g_isAsync || !try_sink_async(severity, t, str, n))
             {
                 sink_it_now(severity, t, str, n);
             }
         }
     }
-}
\ No newline at end of file
+}
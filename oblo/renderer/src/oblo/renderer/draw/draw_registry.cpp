@@ -634,7 +634,7 @@ namespace oblo
 
             // We filter which archetypes to upload to GPU. Anything that we might want to access in the shader as
             // instance data should be included here.
-            if (!isDrawBatch && typeSets.components.intersection(m_instanceDataTypes).is_empty())
+            if (!isDrawBatch && !typeSets.components.intersects(m_instanceDataTypes))
             {
                 continue;
             }
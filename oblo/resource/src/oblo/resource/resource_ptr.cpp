@@ -1,5 +1,6 @@
 #include <oblo/resource/resource_ptr.hpp>
 
+#include <oblo/core/allocation_tracking.hpp>
 #include <oblo/core/debug.hpp>
 #include <oblo/core/uuid.hpp>
 #include <oblo/resource/descriptors/resource_type_descriptor.hpp>
@@ -9,9 +10,17 @@
 
 namespace oblo::detail
 {
+    namespace
+    {
+        allocator* get_resources_allocator()
+        {
+            return select_global_allocator<alignof(resource)>(allocation_tag::resources);
+        }
+    }
+
     resource* resource_create(const resource_type_descriptor* desc, uuid id, string_view name, string_view path)
     {
-        return new resource{
+        return new (get_resources_allocator()->allocate(sizeof(resource), alignof(resource))) resource{
             .id = id,
             .name = name.as<string>(),
             .path = path.as<string>(),
@@ -38,7 +47,9 @@ namespace oblo::detail
                 resource->descriptor->destroy(resource->data);
             }
 
-            delete resource;
+            resource->~resource();
+            get_resources_allocator()->deallocate(
+                reinterpret_cast<byte*>(resource), sizeof(oblo::resource), alignof(oblo::resource));
         }
     }
 
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <oblo/math/vec3.hpp>
+#include <oblo/reflection/codegen/annotations.hpp>
+
+namespace oblo
+{
+    /// @brief The bounds of the entity in its local space, e.g. the bounds of its mesh, which the spatial index
+    /// transforms by the global transform.
+    struct local_bounds_component
+    {
+        vec3 min;
+        vec3 max;
+    } OBLO_COMPONENT("2e555b76-b55f-492f-a840-1ca5a78f1bf1", Transient);
+}
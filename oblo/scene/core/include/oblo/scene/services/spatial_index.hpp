@@ -0,0 +1,152 @@
+#pragma once
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/ecs/handles.hpp>
+#include <oblo/ecs/utility/entity_map.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/scene/utility/dynamic_aabb_tree.hpp>
+
+#include <span>
+
+namespace oblo::ecs
+{
+    class entity_registry;
+}
+
+namespace oblo
+{
+    struct frustum;
+    struct mat4;
+    struct ray;
+    struct sphere;
+
+    struct spatial_raycast_hit
+    {
+        ecs::entity entity;
+
+        /// @brief The distance at which the ray enters the bounds of the entity.
+        f32 distance;
+    };
+
+    /// @brief The results of a batch of queries, stored contiguously.
+    struct spatial_query_results
+    {
+        dynamic_array<ecs::entity> entities;
+
+        /// @brief The results of the i-th query are the entities in the range [offsets[i], offsets[i + 1]).
+        dynamic_array<u32> offsets;
+
+        std::span<const ecs::entity> get(u32 query) const
+        {
+            return std::span{entities}.subspan(offsets[query], offsets[query + 1] - offsets[query]);
+        }
+
+        u32 get_queries_count() const
+        {
+            return offsets.empty() ? 0 : offsets.size32() - 1;
+        }
+    };
+
+    /// @brief Indexes the world space bounds of the entities with a global transform in a dynamic AABB tree, to run
+    /// range queries without iterating all entities.
+    /// @remarks The bounds of an entity are its local_bounds_component transformed by its global transform. The
+    /// component is written by the modules that know the extent of an entity, e.g. graphics once the mesh is loaded,
+    /// entities without it are indexed as an empty box at their origin.
+    /// Leaves are stored with enlarged bounds, so that entities moving within the margin don't need to be reinserted
+    /// in the tree. Queries always test the exact bounds of the entities.
+    class spatial_index
+    {
+    public:
+        OBLO_SCENE_API spatial_index();
+        spatial_index(const spatial_index&) = delete;
+        spatial_index(spatial_index&&) noexcept = delete;
+
+        OBLO_SCENE_API ~spatial_index();
+
+        spatial_index& operator=(const spatial_index&) = delete;
+        spatial_index& operator=(spatial_index&&) noexcept = delete;
+
+        /// @brief Sets the margin the bounds of the leaves are enlarged by, in world units.
+        /// @remarks Larger margins mean fewer reinsertions for moving entities, at the cost of looser nodes.
+        /// Only affects leaves inserted or reinserted afterwards.
+        OBLO_SCENE_API void set_margin(f32 margin);
+
+        /// @brief Brings the index up to date with the entities, only visiting the chunks that were notified since
+        /// the last update and the entities the registry reported as removed.
+        /// @remarks The first update starts tracking removals on the registry, which has to be the same on every call
+        /// and outlive the index.
+        OBLO_SCENE_API void update(ecs::entity_registry& entities);
+
+        OBLO_SCENE_API void clear();
+
+        /// @brief Appends the entities whose bounds overlap the box.
+        OBLO_SCENE_API void query(const aabb& box, dynamic_array<ecs::entity>& out) const;
+
+        /// @brief Appends the entities whose bounds overlap the sphere.
+        OBLO_SCENE_API void query(const sphere& sphere, dynamic_array<ecs::entity>& out) const;
+
+        /// @brief Appends the entities whose bounds intersect or are contained in the frustum.
+        OBLO_SCENE_API void query(const frustum& frustum, dynamic_array<ecs::entity>& out) const;
+
+        /// @brief Appends the entities whose bounds are hit by the ray within maxDistance.
+        OBLO_SCENE_API void query(const ray& ray, f32 maxDistance, dynamic_array<ecs::entity>& out) const;
+
+        /// @brief Finds the entity whose bounds are hit first by the ray.
+        OBLO_SCENE_API bool raycast(const ray& ray, f32 maxDistance, spatial_raycast_hit& out) const;
+
+        /// @brief Runs a batch of box queries, e.g. the areas of interest of all clients, replacing the content of
+        /// the results.
+        OBLO_SCENE_API void query(std::span<const aabb> boxes, spatial_query_results& out) const;
+
+        /// @brief Runs a batch of sphere queries, replacing the content of the results.
+        OBLO_SCENE_API void query(std::span<const sphere> spheres, spatial_query_results& out) const;
+
+        /// @brief The exact world space bounds of an entity, or nullptr if the entity is not indexed.
+        OBLO_SCENE_API const aabb* get_bounds(ecs::entity e) const;
+
+        OBLO_SCENE_API u32 get_entities_count() const;
+
+        /// @brief The number of times an entity had to be reinserted because it moved out of its enlarged bounds.
+        OBLO_SCENE_API u64 get_reinsertions_count() const;
+
+        const dynamic_aabb_tree& get_tree() const
+        {
+            return m_tree;
+        }
+
+    private:
+        struct entry
+        {
+            ecs::entity entity;
+            u32 proxy;
+            aabb bounds;
+        };
+
+    private:
+        void add_or_update(ecs::entity e, const mat4& localToWorld, const aabb& localBounds);
+        void remove_entry(u32 index);
+        void remove_dead_entities(ecs::entity_registry& entities);
+
+        template <typename Shape>
+        void query_shape(const Shape& shape, dynamic_array<ecs::entity>& out) const;
+
+        template <typename Shape>
+        void query_batch(std::span<const Shape> shapes, spatial_query_results& out) const;
+
+    private:
+        dynamic_aabb_tree m_tree;
+
+        /// @brief The indexed entities, the user data of each leaf is the index of its entry.
+        dynamic_array<entry> m_entries;
+        ecs::entity_map<u32> m_entityToEntry;
+
+        ecs::entity_registry* m_registry{};
+        h32<ecs::removal_queue> m_removals{};
+        dynamic_array<ecs::entity> m_removedEntities;
+
+        f32 m_margin{.1f};
+        u64 m_reinsertionsCount{};
+        u64 m_lastModificationId{};
+    };
+}
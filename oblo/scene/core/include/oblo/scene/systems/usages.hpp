@@ -7,4 +7,6 @@ namespace oblo::system_graph_usages
     constexpr ecs::system_graph_usage editor = "editor"_hsv;
     constexpr ecs::system_graph_usage no_scripts = "no_scripts"_hsv;
     constexpr ecs::system_graph_usage play_mode = "play_mode"_hsv;
+    /// @brief Opts in to mirroring the meshes in the CPU scene_raycaster, for synchronous raycasts and overlaps.
+    constexpr ecs::system_graph_usage scene_raycast = "scene_raycast"_hsv;
 }
\ No newline at end of file
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <oblo/core/buffered_array.hpp>
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/types.hpp>
+#include <oblo/math/aabb.hpp>
+#include <oblo/math/ray.hpp>
+#include <oblo/math/ray_intersection.hpp>
+
+namespace oblo
+{
+    enum class aabb_tree_visit : u8
+    {
+        /// @brief Skips the node and its subtree.
+        skip,
+        /// @brief Keeps testing the children of the node.
+        descend,
+        /// @brief Accepts all the leaves in the subtree of the node without further tests.
+        accept_all,
+    };
+
+    /// @brief A bounding volume hierarchy with incremental insertion and removal of leaves, meant for bounds that
+    /// change every frame.
+    /// @remarks Leaves are inserted next to the sibling that minimizes the increase in surface area, and the tree is
+    /// kept balanced with rotations on the way back up, similarly to an AVL tree. Leaves are identified by a proxy,
+    /// which stays valid until the leaf is removed.
+    class dynamic_aabb_tree
+    {
+    public:
+        static constexpr u32 Null{~u32{}};
+
+    public:
+        OBLO_SCENE_API dynamic_aabb_tree();
+        OBLO_SCENE_API dynamic_aabb_tree(const dynamic_aabb_tree&);
+        OBLO_SCENE_API dynamic_aabb_tree(dynamic_aabb_tree&&) noexcept;
+
+        OBLO_SCENE_API ~dynamic_aabb_tree();
+
+        OBLO_SCENE_API dynamic_aabb_tree& operator=(const dynamic_aabb_tree&);
+        OBLO_SCENE_API dynamic_aabb_tree& operator=(dynamic_aabb_tree&&) noexcept;
+
+        /// @brief Adds a leaf to the tree.
+        /// @return The proxy of the leaf.
+        OBLO_SCENE_API u32 insert(const aabb& bounds, u32 userData);
+
+        OBLO_SCENE_API void remove(u32 proxy);
+
+        /// @brief Changes the bounds of a leaf, reinserting it in the tree.
+        OBLO_SCENE_API void move(u32 proxy, const aabb& bounds);
+
+        OBLO_SCENE_API void clear();
+
+        OBLO_SCENE_API void reserve(u32 leavesCount);
+
+        const aabb& get_bounds(u32 proxy) const
+        {
+            return m_nodes[proxy].bounds;
+        }
+
+        u32 get_user_data(u32 proxy) const
+        {
+            return m_nodes[proxy].userData;
+        }
+
+        void set_user_data(u32 proxy, u32 userData)
+        {
+            m_nodes[proxy].userData = userData;
+        }
+
+        u32 get_leaves_count() const
+        {
+            return m_leavesCount;
+        }
+
+        /// @brief The height of the tree, where a tree with a single leaf has height 0.
+        OBLO_SCENE_API u32 get_height() const;
+
+        /// @brief Computes the ratio between the sum of the surfaces of the internal nodes and the surface of the
+        /// root, which measures the quality of the tree.
+        OBLO_SCENE_API f32 compute_surface_ratio() const;
+
+        /// @brief Checks that the links, heights and bounds of all nodes are consistent.
+        OBLO_SCENE_API bool validate() const;
+
+        /// @brief Visits the tree depth first, calling the test on the bounds of each node to decide whether to visit
+        /// its subtree.
+        /// @param test Returns an aabb_tree_visit for the bounds of a node.
+        /// @param f Is called with the user data of each accepted leaf.
+        template <typename Test, typename F>
+        void query(Test&& test, F&& f) const;
+
+        /// @brief Calls the function with the user data of each leaf whose bounds are hit by the ray, roughly in
+        /// front to back order.
+        /// @param f Is called with the user data of the leaf and the distance at which the ray enters its bounds, it
+        /// returns the new maximum distance of the ray, which can be used to clip the traversal to the closest hit.
+        template <typename F>
+        void raycast(const ray& ray, f32 maxDistance, F&& f) const;
+
+    private:
+        struct node
+        {
+            aabb bounds;
+
+            /// @brief The parent of the node, or the next free node when the node is in the free list.
+            u32 parent;
+            u32 children[2];
+            u32 userData;
+
+            /// @brief Leaves have height 0, free nodes have height -1.
+            i32 height;
+
+            bool is_leaf() const
+            {
+                return children[0] == Null;
+            }
+        };
+
+    private:
+        u32 allocate_node();
+        void free_node(u32 index);
+
+        void insert_leaf(u32 leaf);
+        void remove_leaf(u32 leaf);
+
+        /// @brief Rotates the subtree rooted at the node if it's unbalanced.
+        /// @return The new root of the subtree.
+        u32 balance(u32 index);
+
+        /// @brief Recomputes bounds and heights from the node up to the root, balancing the tree along the way.
+        void refit_ancestors(u32 index);
+
+        template <typename F>
+        void visit_leaves(u32 root, F& f) const;
+
+    private:
+        dynamic_array<node> m_nodes;
+        u32 m_root{Null};
+        u32 m_freeList{Null};
+        u32 m_leavesCount{};
+    };
+
+    template <typename Test, typename F>
+    void dynamic_aabb_tree::query(Test&& test, F&& f) const
+    {
+        if (m_root == Null)
+        {
+            return;
+        }
+
+        buffered_array<u32, 64> stack;
+        stack.push_back(m_root);
+
+        while (!stack.empty())
+        {
+            const u32 index = stack.back();
+            stack.pop_back();
+
+            const node& n = m_nodes[index];
+            const aabb_tree_visit visit = test(n.bounds);
+
+            if (visit == aabb_tree_visit::skip)
+            {
+                continue;
+            }
+
+            if (n.is_leaf())
+            {
+                f(n.userData);
+            }
+            else if (visit == aabb_tree_visit::accept_all)
+            {
+                visit_leaves(index, f);
+            }
+            else
+            {
+                stack.push_back(n.children[0]);
+                stack.push_back(n.children[1]);
+            }
+        }
+    }
+
+    template <typename F>
+    void dynamic_aabb_tree::raycast(const ray& ray, f32 maxDistance, F&& f) const
+    {
+        if (m_root == Null)
+        {
+            return;
+        }
+
+        buffered_array<u32, 64> stack;
+        stack.push_back(m_root);
+
+        while (!stack.empty())
+        {
+            const u32 index = stack.back();
+            stack.pop_back();
+
+            const node& n = m_nodes[index];
+
+            f32 t0, t1;
+
+            if (!intersect(ray, n.bounds, maxDistance, t0, t1))
+            {
+                continue;
+            }
+
+            if (n.is_leaf())
+            {
+                maxDistance = f(n.userData, t0);
+                continue;
+            }
+
+            // Push the farthest child first, so that the closest one is visited first and clips the ray sooner
+            const vec3 center0 = (m_nodes[n.children[0]].bounds.min + m_nodes[n.children[0]].bounds.max) * .5f;
+            const vec3 center1 = (m_nodes[n.children[1]].bounds.min + m_nodes[n.children[1]].bounds.max) * .5f;
+
+            const bool isFirstCloser = dot(center0 - center1, ray.direction) < 0.f;
+
+            stack.push_back(n.children[isFirstCloser ? 1 : 0]);
+            stack.push_back(n.children[isFirstCloser ? 0 : 1]);
+        }
+    }
+
+    template <typename F>
+    void dynamic_aabb_tree::visit_leaves(u32 root, F& f) const
+    {
+        buffered_array<u32, 64> stack;
+        stack.push_back(root);
+
+        while (!stack.empty())
+        {
+            const u32 index = stack.back();
+            stack.pop_back();
+
+            const node& n = m_nodes[index];
+
+            if (n.is_leaf())
+            {
+                f(n.userData);
+            }
+            else
+            {
+                stack.push_back(n.children[0]);
+                stack.push_back(n.children[1]);
+            }
+        }
+    }
+}
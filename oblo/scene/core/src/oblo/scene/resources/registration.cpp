@@ -1,5 +1,6 @@
 #include <oblo/scene/resources/registration.hpp>
 
+#include <oblo/core/allocation_tracking.hpp>
 #include <oblo/core/service_registry.hpp>
 #include <oblo/modules/module_manager.hpp>
 #include <oblo/resource/descriptors/resource_type_descriptor.hpp>
@@ -161,14 +162,30 @@ namespace oblo
         };
     }
 
+    template <typename T>
+    void* create_resource()
+    {
+        auto* const allocator = select_global_allocator<alignof(T)>(allocation_tag::resources);
+        return new (allocator->allocate(sizeof(T), alignof(T))) T{};
+    }
+
+    template <typename T>
+    void destroy_resource(void* ptr)
+    {
+        static_cast<T*>(ptr)->~T();
+
+        auto* const allocator = select_global_allocator<alignof(T)>(allocation_tag::resources);
+        allocator->deallocate(static_cast<byte*>(ptr), sizeof(T), alignof(T));
+    }
+
     template <typename T>
     resource_type_descriptor make_resource_type_desc()
     {
         return {
             .typeId = get_type_id<T>(),
             .typeUuid = resource_type<T>,
-            .create = []() -> void* { return new T{}; },
-            .destroy = [](void* ptr) { delete static_cast<T*>(ptr); },
+            .create = &create_resource<T>,
+            .destroy = &destroy_resource<T>,
             .load = [](void* ptr, cstring_view source, const any& ctx) -> expected<>
             { return resource_descriptor_helper<T>::load(*static_cast<T*>(ptr), source, ctx); },
             .userdata = resource_descriptor_helper<T>::make_load_userdata(),
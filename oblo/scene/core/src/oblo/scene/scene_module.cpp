@@ -2,6 +2,7 @@
 
 #include <oblo/core/debug.hpp>
 #include <oblo/core/service_registry.hpp>
+#include <oblo/core/service_registry_builder.hpp>
 #include <oblo/ecs/services/world_builder.hpp>
 #include <oblo/ecs/systems/system_graph_builder.hpp>
 #include <oblo/modules/module_initializer.hpp>
@@ -9,8 +10,10 @@
 #include <oblo/reflection/codegen/registration.hpp>
 #include <oblo/resource/providers/resource_types_provider.hpp>
 #include <oblo/scene/resources/registration.hpp>
+#include <oblo/scene/services/spatial_index.hpp>
 #include <oblo/scene/systems/barriers.hpp>
 #include <oblo/scene/systems/entity_hierarchy_system.hpp>
+#include <oblo/scene/systems/spatial_index_system.hpp>
 #include <oblo/scene/systems/transform_system.hpp>
 
 namespace oblo::ecs
@@ -39,6 +42,11 @@ namespace oblo
         initializer.services->add<scene_resources_provider>().as<resource_types_provider>().unique();
 
         initializer.services->add<ecs::world_builder>().unique({
+            .services =
+                [](service_registry_builder& builder)
+            {
+                builder.add<spatial_index>().build([](service_builder<spatial_index> builder) { builder.unique(); });
+            },
             .systems =
                 [](ecs::system_graph_builder& b)
             {
@@ -46,6 +54,9 @@ namespace oblo
                 b.add_barrier<barriers::renderer_extract>().after<barriers::transform_update>();
                 b.add_barrier<barriers::renderer_update>().after<barriers::renderer_extract>();
                 b.add_system<entity_hierarchy_system>().before<barriers::transform_update>();
+                b.add_system<spatial_index_system>()
+                    .after<barriers::transform_update>()
+                    .before<barriers::renderer_extract>();
             },
         });
 
@@ -87,8 +87,8 @@ namespace oblo::ecs_serializer
 
                     const auto componentsAndTags = reg.get_component_and_tag_sets(entityId);
 
-                    if (!componentsAndTags.components.intersection(cfg.skipEntities.components).is_empty() ||
-                        !componentsAndTags.tags.intersection(cfg.skipEntities.tags).is_empty())
+                    if (componentsAndTags.components.intersects(cfg.skipEntities.components) ||
+                        componentsAndTags.tags.intersects(cfg.skipEntities.tags))
                     {
                         continue;
                     }
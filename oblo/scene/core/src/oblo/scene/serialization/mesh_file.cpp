@@ -7,6 +7,7 @@
 #include <oblo/core/expected.hpp>
 #include <oblo/core/filesystem/file.hpp>
 #include <oblo/core/filesystem/filesystem.hpp>
+#include <oblo/core/filesystem/mapped_file.hpp>
 #include <oblo/core/string/cstring_view.hpp>
 #include <oblo/core/string/string_builder.hpp>
 #include <oblo/math/float.hpp>
@@ -729,24 +730,24 @@ namespace oblo
 
     expected<> load_mesh(mesh& mesh, cstring_view source)
     {
-        dynamic_array<byte> content;
+        // Parse in place from the mapping, to avoid copying the whole file in memory first
+        filesystem::mapped_file file;
 
-        const auto r = filesystem::load_binary_file_into_memory(content, source);
-
-        if (!r)
+        if (!file.open(source, filesystem::mapped_file_hint::sequential))
         {
             return "Failed to read mesh file"_err;
         }
 
+        const std::span content = file.get_bytes();
+
         constexpr string_view fourCC = "glTF";
 
-        if (fourCC.size() > r->size())
+        if (fourCC.size() > content.size())
         {
             return "Invalid glTF file"_err;
         }
 
-        const bool isBinary =
-            fourCC.size() <= r->size() && std::memcmp(fourCC.data(), content.data(), fourCC.size()) == 0;
+        const bool isBinary = std::memcmp(fourCC.data(), content.data(), fourCC.size()) == 0;
 
         tinygltf::TinyGLTF loader;
         loader.SetStoreOriginalJSONForExtrasAndExtensions(true);
@@ -766,7 +767,7 @@ namespace oblo
                 &err,
                 &warn,
                 reinterpret_cast<const unsigned char*>(content.data()),
-                content.size32(),
+                u32(content.size()),
                 parentPath);
         }
         else
@@ -775,7 +776,7 @@ namespace oblo
                 &err,
                 &warn,
                 reinterpret_cast<const char*>(content.data()),
-                content.size32(),
+                u32(content.size()),
                 parentPath);
         }
 
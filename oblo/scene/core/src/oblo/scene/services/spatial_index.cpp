@@ -0,0 +1,368 @@
+#include <oblo/scene/services/spatial_index.hpp>
+
+#include <oblo/core/debug.hpp>
+#include <oblo/ecs/entity_registry.hpp>
+#include <oblo/ecs/range.hpp>
+#include <oblo/ecs/type_registry.hpp>
+#include <oblo/math/frustum.hpp>
+#include <oblo/math/frustum_intersection.hpp>
+#include <oblo/math/mat4.hpp>
+#include <oblo/math/ray.hpp>
+#include <oblo/math/ray_intersection.hpp>
+#include <oblo/math/sphere.hpp>
+#include <oblo/scene/components/global_transform_component.hpp>
+#include <oblo/scene/components/local_bounds_component.hpp>
+
+namespace oblo
+{
+    namespace
+    {
+        aabb transform_aabb(const mat4& m, const aabb& box)
+        {
+            aabb r;
+
+            for (u32 i = 0; i < 3; ++i)
+            {
+                r.min[i] = m.at(i, 3);
+                r.max[i] = m.at(i, 3);
+
+                for (u32 j = 0; j < 3; ++j)
+                {
+                    const f32 a = m.at(i, j) * box.min[j];
+                    const f32 b = m.at(i, j) * box.max[j];
+
+                    r.min[i] += min(a, b);
+                    r.max[i] += max(a, b);
+                }
+            }
+
+            return r;
+        }
+
+        aabb enlarge(const aabb& box, f32 margin)
+        {
+            return {.min = box.min - margin, .max = box.max + margin};
+        }
+
+        bool contains(const aabb& outer, const aabb& inner)
+        {
+            return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+                inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+        }
+
+        aabb_tree_visit classify(const aabb& box, const aabb& bounds)
+        {
+            if (!overlap(box, bounds))
+            {
+                return aabb_tree_visit::skip;
+            }
+
+            return contains(box, bounds) ? aabb_tree_visit::accept_all : aabb_tree_visit::descend;
+        }
+
+        aabb_tree_visit classify(const sphere& s, const aabb& bounds)
+        {
+            if (!overlap(s, bounds))
+            {
+                return aabb_tree_visit::skip;
+            }
+
+            return contains(s, bounds) ? aabb_tree_visit::accept_all : aabb_tree_visit::descend;
+        }
+
+        aabb_tree_visit classify(const frustum& f, const aabb& bounds)
+        {
+            const vec3* minMax[] = {&bounds.min, &bounds.max};
+
+            bool isInside = true;
+
+            for (const plane& plane : f.planes)
+            {
+                const u32 nx = u32{plane.normal.x < 0.f};
+                const u32 ny = u32{plane.normal.y < 0.f};
+                const u32 nz = u32{plane.normal.z < 0.f};
+
+                // The corners that are the closest and the farthest along the normal, which points outside
+                const vec3 inner{minMax[nx]->x, minMax[ny]->y, minMax[nz]->z};
+                const vec3 outer{minMax[1 - nx]->x, minMax[1 - ny]->y, minMax[1 - nz]->z};
+
+                if (dot(plane.normal, inner) > -plane.offset)
+                {
+                    return aabb_tree_visit::skip;
+                }
+
+                if (dot(plane.normal, outer) > -plane.offset)
+                {
+                    isInside = false;
+                }
+            }
+
+            return isInside ? aabb_tree_visit::accept_all : aabb_tree_visit::descend;
+        }
+
+        bool overlaps(const aabb& box, const aabb& bounds)
+        {
+            return overlap(box, bounds);
+        }
+
+        bool overlaps(const sphere& s, const aabb& bounds)
+        {
+            return overlap(s, bounds);
+        }
+
+        bool overlaps(const frustum& f, const aabb& bounds)
+        {
+            return intersects_or_contains(f, bounds);
+        }
+    }
+
+    spatial_index::spatial_index() = default;
+
+    spatial_index::~spatial_index()
+    {
+        if (m_registry)
+        {
+            m_registry->untrack_removals(m_removals);
+        }
+    }
+
+    void spatial_index::set_margin(f32 margin)
+    {
+        m_margin = margin;
+    }
+
+    void spatial_index::update(ecs::entity_registry& entities)
+    {
+        if (!m_registry)
+        {
+            m_registry = &entities;
+            m_removals = entities.track_removals();
+        }
+
+        OBLO_ASSERT(m_registry == &entities, "The index can only track a single registry");
+
+        const u64 currentModificationId = entities.get_modification_id();
+        const u64 target = m_lastModificationId;
+
+        // Removals go first, so that entities reusing the slot of a destroyed one start from a clean entry
+        remove_dead_entities(entities);
+
+        auto transformsRange = entities.range<const global_transform_component>();
+
+        // Adding or removing the bounds moves the entity to another chunk, which is notified as well
+        for (auto&& chunk : transformsRange.notified(target))
+        {
+            const std::span chunkEntities = chunk.get<ecs::entity>();
+            const std::span globalTransforms = chunk.get<const global_transform_component>();
+            const std::span localBounds = chunk.try_get<const local_bounds_component>();
+
+            for (usize i = 0; i < chunkEntities.size(); ++i)
+            {
+                const aabb bounds = localBounds.empty() ? aabb{} : aabb{localBounds[i].min, localBounds[i].max};
+                add_or_update(chunkEntities[i], globalTransforms[i].localToWorld, bounds);
+            }
+        }
+
+        m_lastModificationId = currentModificationId;
+    }
+
+    void spatial_index::clear()
+    {
+        m_tree.clear();
+        m_entries.clear();
+        m_entityToEntry.clear();
+        m_lastModificationId = 0;
+    }
+
+    void spatial_index::query(const aabb& box, dynamic_array<ecs::entity>& out) const
+    {
+        query_shape(box, out);
+    }
+
+    void spatial_index::query(const sphere& sphere, dynamic_array<ecs::entity>& out) const
+    {
+        query_shape(sphere, out);
+    }
+
+    void spatial_index::query(const frustum& frustum, dynamic_array<ecs::entity>& out) const
+    {
+        query_shape(frustum, out);
+    }
+
+    void spatial_index::query(const ray& ray, f32 maxDistance, dynamic_array<ecs::entity>& out) const
+    {
+        m_tree.raycast(ray,
+            maxDistance,
+            [this, &ray, &out, maxDistance](u32 index, f32)
+            {
+                const entry& e = m_entries[index];
+
+                if (f32 t0, t1; intersect(ray, e.bounds, maxDistance, t0, t1))
+                {
+                    out.push_back(e.entity);
+                }
+
+                return maxDistance;
+            });
+    }
+
+    bool spatial_index::raycast(const ray& ray, f32 maxDistance, spatial_raycast_hit& out) const
+    {
+        bool found{false};
+
+        m_tree.raycast(ray,
+            maxDistance,
+            [this, &ray, &out, &found, &maxDistance](u32 index, f32)
+            {
+                const entry& e = m_entries[index];
+
+                if (f32 t0, t1; intersect(ray, e.bounds, maxDistance, t0, t1))
+                {
+                    out = {.entity = e.entity, .distance = t0};
+                    maxDistance = t0;
+                    found = true;
+                }
+
+                return maxDistance;
+            });
+
+        return found;
+    }
+
+    void spatial_index::query(std::span<const aabb> boxes, spatial_query_results& out) const
+    {
+        query_batch(boxes, out);
+    }
+
+    void spatial_index::query(std::span<const sphere> spheres, spatial_query_results& out) const
+    {
+        query_batch(spheres, out);
+    }
+
+    const aabb* spatial_index::get_bounds(ecs::entity e) const
+    {
+        auto* const index = m_entityToEntry.try_find(e);
+
+        if (!index || m_entries[*index].entity != e)
+        {
+            return nullptr;
+        }
+
+        return &m_entries[*index].bounds;
+    }
+
+    u32 spatial_index::get_entities_count() const
+    {
+        return m_entries.size32();
+    }
+
+    u64 spatial_index::get_reinsertions_count() const
+    {
+        return m_reinsertionsCount;
+    }
+
+    void spatial_index::add_or_update(ecs::entity e, const mat4& localToWorld, const aabb& localBounds)
+    {
+        auto* const index = m_entityToEntry.try_find(e);
+
+        if (!index)
+        {
+            const u32 newIndex = m_entries.size32();
+
+            entry& newEntry = m_entries.push_back_default();
+            newEntry.entity = e;
+            newEntry.bounds = transform_aabb(localToWorld, localBounds);
+            newEntry.proxy = m_tree.insert(enlarge(newEntry.bounds, m_margin), newIndex);
+
+            m_entityToEntry.emplace(e, newIndex);
+            return;
+        }
+
+        entry& current = m_entries[*index];
+
+        // The map only looks at the index of the entity, so we might find a destroyed entity whose slot was reused
+        const bool isReused = current.entity != e;
+
+        current.entity = e;
+        current.bounds = transform_aabb(localToWorld, localBounds);
+
+        if (isReused)
+        {
+            m_tree.move(current.proxy, enlarge(current.bounds, m_margin));
+        }
+        else if (!contains(m_tree.get_bounds(current.proxy), current.bounds))
+        {
+            m_tree.move(current.proxy, enlarge(current.bounds, m_margin));
+            ++m_reinsertionsCount;
+        }
+    }
+
+    void spatial_index::remove_entry(u32 index)
+    {
+        m_tree.remove(m_entries[index].proxy);
+        m_entityToEntry.erase(m_entries[index].entity);
+
+        // Move the last entry in place of the removed one
+        if (const u32 lastIndex = m_entries.size32() - 1; index != lastIndex)
+        {
+            m_entries[index] = m_entries[lastIndex];
+
+            m_tree.set_user_data(m_entries[index].proxy, index);
+            *m_entityToEntry.try_find(m_entries[index].entity) = index;
+        }
+
+        m_entries.pop_back();
+    }
+
+    void spatial_index::remove_dead_entities(ecs::entity_registry& entities)
+    {
+        // Entities that were destroyed, or lost their transform, can't be found in the notified chunks
+        entities.fetch_removals(m_removals, m_removedEntities);
+
+        for (const ecs::entity e : m_removedEntities)
+        {
+            auto* const index = m_entityToEntry.try_find(e);
+
+            // The map only looks at the index of the entity, the entry might belong to another one, and entities that
+            // only lost unrelated components are still indexed
+            if (index && m_entries[*index].entity == e &&
+                (!entities.contains(e) || !entities.has<global_transform_component>(e)))
+            {
+                remove_entry(*index);
+            }
+        }
+    }
+
+    template <typename Shape>
+    void spatial_index::query_shape(const Shape& shape, dynamic_array<ecs::entity>& out) const
+    {
+        m_tree.query([&shape](const aabb& bounds) { return classify(shape, bounds); },
+            [this, &shape, &out](u32 index)
+            {
+                // Leaves are enlarged, so the exact bounds still have to be tested
+                const entry& e = m_entries[index];
+
+                if (overlaps(shape, e.bounds))
+                {
+                    out.push_back(e.entity);
+                }
+            });
+    }
+
+    template <typename Shape>
+    void spatial_index::query_batch(std::span<const Shape> shapes, spatial_query_results& out) const
+    {
+        out.entities.clear();
+        out.offsets.clear();
+
+        out.offsets.reserve(shapes.size() + 1);
+        out.offsets.push_back(0);
+
+        // Results are appended to a single array, so running a batch doesn't allocate once the results are warm
+        for (const Shape& shape : shapes)
+        {
+            query_shape(shape, out.entities);
+            out.offsets.push_back(out.entities.size32());
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#include <oblo/scene/systems/spatial_index_system.hpp>
+
+#include <oblo/core/debug.hpp>
+#include <oblo/core/service_registry.hpp>
+#include <oblo/ecs/systems/system_update_context.hpp>
+#include <oblo/scene/services/spatial_index.hpp>
+
+namespace oblo
+{
+    void spatial_index_system::first_update(const ecs::system_update_context& ctx)
+    {
+        m_spatialIndex = ctx.services->find<spatial_index>();
+        OBLO_ASSERT(m_spatialIndex);
+
+        update(ctx);
+    }
+
+    void spatial_index_system::update(const ecs::system_update_context& ctx)
+    {
+        m_spatialIndex->update(*ctx.entities);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace oblo
+{
+    namespace ecs
+    {
+        struct system_update_context;
+    }
+
+    class spatial_index;
+
+    class spatial_index_system
+    {
+    public:
+        void first_update(const ecs::system_update_context& ctx);
+        void update(const ecs::system_update_context& ctx);
+
+    private:
+        spatial_index* m_spatialIndex{};
+    };
+}
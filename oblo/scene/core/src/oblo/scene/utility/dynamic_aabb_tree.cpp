@@ -0,0 +1,399 @@
+#include <oblo/scene/utility/dynamic_aabb_tree.hpp>
+
+#include <oblo/core/debug.hpp>
+
+namespace oblo
+{
+    namespace
+    {
+        f32 half_surface(const aabb& bounds)
+        {
+            const vec3 size = bounds.max - bounds.min;
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+    }
+
+    dynamic_aabb_tree::dynamic_aabb_tree() = default;
+
+    dynamic_aabb_tree::dynamic_aabb_tree(const dynamic_aabb_tree&) = default;
+
+    dynamic_aabb_tree::dynamic_aabb_tree(dynamic_aabb_tree&&) noexcept = default;
+
+    dynamic_aabb_tree::~dynamic_aabb_tree() = default;
+
+    dynamic_aabb_tree& dynamic_aabb_tree::operator=(const dynamic_aabb_tree&) = default;
+
+    dynamic_aabb_tree& dynamic_aabb_tree::operator=(dynamic_aabb_tree&&) noexcept = default;
+
+    u32 dynamic_aabb_tree::insert(const aabb& bounds, u32 userData)
+    {
+        const u32 leaf = allocate_node();
+
+        node& n = m_nodes[leaf];
+        n.bounds = bounds;
+        n.userData = userData;
+        n.height = 0;
+
+        insert_leaf(leaf);
+        ++m_leavesCount;
+
+        return leaf;
+    }
+
+    void dynamic_aabb_tree::remove(u32 proxy)
+    {
+        OBLO_ASSERT(proxy < m_nodes.size() && m_nodes[proxy].is_leaf() && m_nodes[proxy].height == 0);
+
+        remove_leaf(proxy);
+        free_node(proxy);
+        --m_leavesCount;
+    }
+
+    void dynamic_aabb_tree::move(u32 proxy, const aabb& bounds)
+    {
+        OBLO_ASSERT(proxy < m_nodes.size() && m_nodes[proxy].is_leaf() && m_nodes[proxy].height == 0);
+
+        remove_leaf(proxy);
+        m_nodes[proxy].bounds = bounds;
+        insert_leaf(proxy);
+    }
+
+    void dynamic_aabb_tree::clear()
+    {
+        m_nodes.clear();
+        m_root = Null;
+        m_freeList = Null;
+        m_leavesCount = 0;
+    }
+
+    void dynamic_aabb_tree::reserve(u32 leavesCount)
+    {
+        // A tree with N leaves has N - 1 internal nodes
+        m_nodes.reserve(2 * usize{leavesCount});
+    }
+
+    u32 dynamic_aabb_tree::get_height() const
+    {
+        return m_root == Null ? 0 : static_cast<u32>(m_nodes[m_root].height);
+    }
+
+    f32 dynamic_aabb_tree::compute_surface_ratio() const
+    {
+        if (m_root == Null)
+        {
+            return 0.f;
+        }
+
+        const f32 rootSurface = half_surface(m_nodes[m_root].bounds);
+
+        if (rootSurface <= 0.f)
+        {
+            return 0.f;
+        }
+
+        f32 totalSurface = 0.f;
+
+        for (const node& n : m_nodes)
+        {
+            if (n.height > 0)
+            {
+                totalSurface += half_surface(n.bounds);
+            }
+        }
+
+        return totalSurface / rootSurface;
+    }
+
+    bool dynamic_aabb_tree::validate() const
+    {
+        if (m_root == Null)
+        {
+            return m_leavesCount == 0;
+        }
+
+        if (m_nodes[m_root].parent != Null)
+        {
+            return false;
+        }
+
+        u32 leavesCount = 0;
+
+        buffered_array<u32, 64> stack;
+        stack.push_back(m_root);
+
+        while (!stack.empty())
+        {
+            const u32 index = stack.back();
+            stack.pop_back();
+
+            const node& n = m_nodes[index];
+
+            if (n.is_leaf())
+            {
+                if (n.height != 0)
+                {
+                    return false;
+                }
+
+                ++leavesCount;
+                continue;
+            }
+
+            const node& lhs = m_nodes[n.children[0]];
+            const node& rhs = m_nodes[n.children[1]];
+
+            if (lhs.parent != index || rhs.parent != index)
+            {
+                return false;
+            }
+
+            if (n.height != 1 + max(lhs.height, rhs.height))
+            {
+                return false;
+            }
+
+            const aabb expected = extend(lhs.bounds, rhs.bounds);
+
+            if (n.bounds.min != expected.min || n.bounds.max != expected.max)
+            {
+                return false;
+            }
+
+            stack.push_back(n.children[0]);
+            stack.push_back(n.children[1]);
+        }
+
+        return leavesCount == m_leavesCount;
+    }
+
+    u32 dynamic_aabb_tree::allocate_node()
+    {
+        u32 index;
+
+        if (m_freeList != Null)
+        {
+            index = m_freeList;
+            m_freeList = m_nodes[index].parent;
+        }
+        else
+        {
+            index = m_nodes.size32();
+            m_nodes.push_back_default();
+        }
+
+        node& n = m_nodes[index];
+        n.parent = Null;
+        n.children[0] = Null;
+        n.children[1] = Null;
+        n.userData = Null;
+        n.height = 0;
+
+        return index;
+    }
+
+    void dynamic_aabb_tree::free_node(u32 index)
+    {
+        node& n = m_nodes[index];
+        n.parent = m_freeList;
+        n.height = -1;
+
+        m_freeList = index;
+    }
+
+    void dynamic_aabb_tree::insert_leaf(u32 leaf)
+    {
+        if (m_root == Null)
+        {
+            m_root = leaf;
+            m_nodes[leaf].parent = Null;
+            return;
+        }
+
+        const aabb leafBounds = m_nodes[leaf].bounds;
+
+        // Descend towards the sibling that minimizes the surface added to the tree, where the cost of going down a
+        // subtree includes the surface added to all the ancestors it has to enlarge
+        u32 index = m_root;
+
+        while (!m_nodes[index].is_leaf())
+        {
+            const node& n = m_nodes[index];
+
+            const f32 surface = half_surface(n.bounds);
+            const f32 combinedSurface = half_surface(extend(n.bounds, leafBounds));
+
+            // Cost of making a new parent for this node and the leaf
+            const f32 cost = 2.f * combinedSurface;
+
+            // Minimum cost of pushing the leaf further down the tree
+            const f32 inheritanceCost = 2.f * (combinedSurface - surface);
+
+            f32 childCosts[2];
+
+            for (u32 i = 0; i < 2; ++i)
+            {
+                const node& child = m_nodes[n.children[i]];
+                const f32 enlargedSurface = half_surface(extend(child.bounds, leafBounds));
+
+                childCosts[i] = inheritanceCost +
+                    (child.is_leaf() ? enlargedSurface : enlargedSurface - half_surface(child.bounds));
+            }
+
+            if (cost < childCosts[0] && cost < childCosts[1])
+            {
+                break;
+            }
+
+            index = childCosts[0] < childCosts[1] ? n.children[0] : n.children[1];
+        }
+
+        const u32 sibling = index;
+
+        const u32 newParent = allocate_node();
+        const u32 oldParent = m_nodes[sibling].parent;
+
+        node& parent = m_nodes[newParent];
+        parent.parent = oldParent;
+        parent.bounds = extend(leafBounds, m_nodes[sibling].bounds);
+        parent.height = m_nodes[sibling].height + 1;
+        parent.children[0] = sibling;
+        parent.children[1] = leaf;
+
+        if (oldParent != Null)
+        {
+            node& grandParent = m_nodes[oldParent];
+            grandParent.children[grandParent.children[0] == sibling ? 0 : 1] = newParent;
+        }
+        else
+        {
+            m_root = newParent;
+        }
+
+        m_nodes[sibling].parent = newParent;
+        m_nodes[leaf].parent = newParent;
+
+        refit_ancestors(m_nodes[leaf].parent);
+    }
+
+    void dynamic_aabb_tree::remove_leaf(u32 leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = Null;
+            return;
+        }
+
+        const u32 parent = m_nodes[leaf].parent;
+        const u32 grandParent = m_nodes[parent].parent;
+
+        const node& parentNode = m_nodes[parent];
+        const u32 sibling = parentNode.children[0] == leaf ? parentNode.children[1] : parentNode.children[0];
+
+        m_nodes[sibling].parent = grandParent;
+
+        if (grandParent != Null)
+        {
+            node& grandParentNode = m_nodes[grandParent];
+            grandParentNode.children[grandParentNode.children[0] == parent ? 0 : 1] = sibling;
+
+            free_node(parent);
+            refit_ancestors(grandParent);
+        }
+        else
+        {
+            m_root = sibling;
+            free_node(parent);
+        }
+    }
+
+    void dynamic_aabb_tree::refit_ancestors(u32 index)
+    {
+        while (index != Null)
+        {
+            index = balance(index);
+
+            node& n = m_nodes[index];
+            const node& lhs = m_nodes[n.children[0]];
+            const node& rhs = m_nodes[n.children[1]];
+
+            n.height = 1 + max(lhs.height, rhs.height);
+            n.bounds = extend(lhs.bounds, rhs.bounds);
+
+            index = n.parent;
+        }
+    }
+
+    u32 dynamic_aabb_tree::balance(u32 iA)
+    {
+        node& a = m_nodes[iA];
+
+        if (a.is_leaf() || a.height < 2)
+        {
+            return iA;
+        }
+
+        const u32 iB = a.children[0];
+        const u32 iC = a.children[1];
+
+        node& b = m_nodes[iB];
+        node& c = m_nodes[iC];
+
+        const i32 balance = c.height - b.height;
+
+        // Whichever child is too tall is promoted in place of A, A takes the shortest of its children
+        const auto rotate = [this, iA, &a](u32 iUp, node& up, u32 upSlot, const node& other)
+        {
+            const u32 iF = up.children[0];
+            const u32 iG = up.children[1];
+
+            node& f = m_nodes[iF];
+            node& g = m_nodes[iG];
+
+            up.children[0] = iA;
+            up.parent = a.parent;
+            a.parent = iUp;
+
+            if (up.parent != Null)
+            {
+                node& upParent = m_nodes[up.parent];
+                upParent.children[upParent.children[0] == iA ? 0 : 1] = iUp;
+            }
+            else
+            {
+                m_root = iUp;
+            }
+
+            const bool keepF = f.height > g.height;
+
+            const u32 iKept = keepF ? iF : iG;
+            const u32 iMoved = keepF ? iG : iF;
+
+            node& kept = m_nodes[iKept];
+            node& moved = m_nodes[iMoved];
+
+            up.children[1] = iKept;
+            a.children[upSlot] = iMoved;
+            moved.parent = iA;
+
+            a.bounds = extend(other.bounds, moved.bounds);
+            up.bounds = extend(a.bounds, kept.bounds);
+
+            a.height = 1 + max(other.height, moved.height);
+            up.height = 1 + max(a.height, kept.height);
+        };
+
+        if (balance > 1)
+        {
+            rotate(iC, c, 1, b);
+            return iC;
+        }
+
+        if (balance < -1)
+        {
+            rotate(iB, b, 0, c);
+            return iB;
+        }
+
+        return iA;
+    }
+}
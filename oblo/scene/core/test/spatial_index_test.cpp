@@ -0,0 +1,404 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/ecs/entity_registry.hpp>
+#include <oblo/ecs/range.hpp>
+#include <oblo/ecs/type_registry.hpp>
+#include <oblo/ecs/utility/registration.hpp>
+#include <oblo/math/frustum.hpp>
+#include <oblo/math/mat4.hpp>
+#include <oblo/math/ray.hpp>
+#include <oblo/math/ray_intersection.hpp>
+#include <oblo/math/sphere.hpp>
+#include <oblo/scene/components/global_transform_component.hpp>
+#include <oblo/scene/components/local_bounds_component.hpp>
+#include <oblo/scene/services/spatial_index.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace oblo
+{
+    namespace
+    {
+        struct spatial_index_test_scene
+        {
+            spatial_index_test_scene()
+            {
+                ecs::register_type<global_transform_component>(types);
+                ecs::register_type<local_bounds_component>(types);
+            }
+
+            ecs::entity create(const vec3& position)
+            {
+                const auto e = entities.create<global_transform_component>();
+                move(e, position);
+                return e;
+            }
+
+            void move(ecs::entity e, const vec3& position)
+            {
+                mat4& localToWorld = entities.get<global_transform_component>(e).localToWorld;
+                localToWorld = mat4::identity();
+                localToWorld.columns[3] = {position.x, position.y, position.z, 1.f};
+
+                entities.notify(e);
+            }
+
+            void set_local_bounds(ecs::entity e, const aabb& bounds)
+            {
+                if (!entities.has<local_bounds_component>(e))
+                {
+                    entities.add<local_bounds_component>(e);
+                }
+
+                entities.get<local_bounds_component>(e) = {.min = bounds.min, .max = bounds.max};
+                entities.notify(e);
+            }
+
+            void next_frame()
+            {
+                entities.set_modification_id(++modificationId);
+                index.update(entities);
+            }
+
+            template <typename F>
+            dynamic_array<ecs::entity> brute_force(F&& overlaps)
+            {
+                dynamic_array<ecs::entity> result;
+
+                for (auto&& chunk : entities.range<const global_transform_component>())
+                {
+                    for (auto&& [e, transform] : chunk.zip<ecs::entity, const global_transform_component>())
+                    {
+                        const aabb* const bounds = index.get_bounds(e);
+
+                        if (bounds && overlaps(*bounds))
+                        {
+                            result.push_back(e);
+                        }
+                    }
+                }
+
+                std::sort(result.begin(), result.end());
+                return result;
+            }
+
+            ecs::type_registry types;
+            ecs::entity_registry entities{&types};
+            spatial_index index;
+            u64 modificationId{};
+        };
+
+        dynamic_array<ecs::entity> sorted(dynamic_array<ecs::entity> entities)
+        {
+            std::sort(entities.begin(), entities.end());
+            return entities;
+        }
+
+        frustum make_box_frustum(const aabb& box)
+        {
+            // Normals point outside
+            return {{
+                {.normal = {1.f, 0.f, 0.f}, .offset = -box.max.x},
+                {.normal = {-1.f, 0.f, 0.f}, .offset = box.min.x},
+                {.normal = {0.f, 1.f, 0.f}, .offset = -box.max.y},
+                {.normal = {0.f, -1.f, 0.f}, .offset = box.min.y},
+                {.normal = {0.f, 0.f, 1.f}, .offset = -box.max.z},
+                {.normal = {0.f, 0.f, -1.f}, .offset = box.min.z},
+            }};
+        }
+    }
+
+    TEST(dynamic_aabb_tree, insert_move_remove)
+    {
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<f32> position{-100.f, 100.f};
+
+        const auto randomBox = [&]
+        {
+            const vec3 p{position(rng), position(rng), position(rng)};
+            return aabb{.min = p - 1.f, .max = p + 1.f};
+        };
+
+        dynamic_aabb_tree tree;
+        dynamic_array<u32> proxies;
+
+        constexpr u32 count{4096};
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            proxies.push_back(tree.insert(randomBox(), i));
+        }
+
+        ASSERT_TRUE(tree.validate());
+        ASSERT_EQ(tree.get_leaves_count(), count);
+
+        // Balancing should keep the height logarithmic, a degenerate tree would be as tall as the number of leaves
+        ASSERT_LT(tree.get_height(), 32u);
+
+        for (u32 i = 0; i < count; i += 2)
+        {
+            tree.move(proxies[i], randomBox());
+        }
+
+        ASSERT_TRUE(tree.validate());
+
+        for (u32 i = 0; i < count; i += 3)
+        {
+            tree.remove(proxies[i]);
+        }
+
+        ASSERT_TRUE(tree.validate());
+        ASSERT_EQ(tree.get_leaves_count(), count - (count + 2) / 3);
+
+        u32 visited{};
+        tree.query([](const aabb&) { return aabb_tree_visit::descend; }, [&visited](u32) { ++visited; });
+
+        ASSERT_EQ(visited, tree.get_leaves_count());
+    }
+
+    TEST(spatial_index, queries)
+    {
+        spatial_index_test_scene scene;
+
+        std::mt19937 rng{7};
+        std::uniform_real_distribution<f32> position{-50.f, 50.f};
+        std::uniform_real_distribution<f32> extent{0.f, 2.f};
+
+        dynamic_array<ecs::entity> entities;
+
+        for (u32 i = 0; i < 2000; ++i)
+        {
+            entities.push_back(scene.create({position(rng), position(rng), position(rng)}));
+        }
+
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_entities_count(), 2000u);
+
+        // Give some of the entities a volume
+        for (u32 i = 0; i < entities.size32(); i += 2)
+        {
+            const vec3 halfSize{extent(rng), extent(rng), extent(rng)};
+            scene.set_local_bounds(entities[i], {-halfSize, halfSize});
+        }
+
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_entities_count(), 2000u);
+        ASSERT_TRUE(scene.index.get_tree().validate());
+
+        for (u32 i = 0; i < 16; ++i)
+        {
+            const vec3 center{position(rng), position(rng), position(rng)};
+            const aabb box{.min = center - 15.f, .max = center + 15.f};
+
+            dynamic_array<ecs::entity> result;
+            scene.index.query(box, result);
+
+            ASSERT_EQ(sorted(result), scene.brute_force([&box](const aabb& b) { return overlap(box, b); }));
+
+            result.clear();
+            scene.index.query(make_box_frustum(box), result);
+
+            ASSERT_EQ(sorted(result), scene.brute_force([&box](const aabb& b) { return overlap(box, b); }));
+
+            const sphere s{.center = center, .radius = 20.f};
+
+            result.clear();
+            scene.index.query(s, result);
+
+            ASSERT_EQ(sorted(result), scene.brute_force([&s](const aabb& b) { return overlap(s, b); }));
+
+            const ray r{.origin = center, .direction = normalize(vec3{position(rng), position(rng), position(rng)})};
+
+            result.clear();
+            scene.index.query(r, 100.f, result);
+
+            const auto hits = scene.brute_force(
+                [&r](const aabb& b)
+                {
+                    f32 t0, t1;
+                    return intersect(r, b, 100.f, t0, t1);
+                });
+
+            ASSERT_EQ(sorted(result), hits);
+
+            spatial_raycast_hit closest;
+            ASSERT_EQ(scene.index.raycast(r, 100.f, closest), !hits.empty());
+
+            for (const ecs::entity e : hits)
+            {
+                f32 t0, t1;
+                ASSERT_TRUE(intersect(r, *scene.index.get_bounds(e), 100.f, t0, t1));
+                ASSERT_LE(closest.distance, t0);
+            }
+        }
+
+        const sphere spheres[] = {
+            {.center = {}, .radius = 10.f},
+            {.center = {20.f, 0.f, 0.f}, .radius = 5.f},
+            {.center = {1000.f, 0.f, 0.f}, .radius = 5.f},
+        };
+
+        spatial_query_results batch;
+        scene.index.query(spheres, batch);
+
+        ASSERT_EQ(batch.get_queries_count(), 3u);
+        ASSERT_TRUE(batch.get(2).empty());
+
+        for (u32 i = 0; i < 3; ++i)
+        {
+            dynamic_array<ecs::entity> result;
+
+            for (const ecs::entity e : batch.get(i))
+            {
+                result.push_back(e);
+            }
+
+            ASSERT_EQ(sorted(result), scene.brute_force([&s = spheres[i]](const aabb& b) { return overlap(s, b); }));
+        }
+    }
+
+    TEST(spatial_index, incremental_updates)
+    {
+        spatial_index_test_scene scene;
+        scene.index.set_margin(1.f);
+
+        dynamic_array<ecs::entity> entities;
+
+        for (u32 i = 0; i < 100; ++i)
+        {
+            entities.push_back(scene.create({f32(i) * 10.f, 0.f, 0.f}));
+        }
+
+        scene.next_frame();
+
+        // Moving within the margin only updates the exact bounds
+        for (u32 i = 0; i < 100; ++i)
+        {
+            scene.move(entities[i], {f32(i) * 10.f + .5f, 0.f, 0.f});
+        }
+
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_reinsertions_count(), 0u);
+        ASSERT_EQ(scene.index.get_bounds(entities[3])->min, (vec3{30.5f, 0.f, 0.f}));
+
+        dynamic_array<ecs::entity> result;
+        scene.index.query(aabb{.min = {30.f, -1.f, -1.f}, .max = {31.f, 1.f, 1.f}}, result);
+
+        ASSERT_EQ(result.size(), 1u);
+        ASSERT_EQ(result[0], entities[3]);
+
+        // Moving out of the margin reinserts the leaf
+        scene.move(entities[3], {-500.f, 0.f, 0.f});
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_reinsertions_count(), 1u);
+
+        result.clear();
+        scene.index.query(aabb{.min = {30.f, -1.f, -1.f}, .max = {31.f, 1.f, 1.f}}, result);
+        ASSERT_TRUE(result.empty());
+
+        scene.index.query(sphere{.center = {-500.f, 0.f, 0.f}, .radius = 1.f}, result);
+        ASSERT_EQ(result.size(), 1u);
+        ASSERT_EQ(result[0], entities[3]);
+
+        // Destroyed entities, or entities losing their transform, are removed
+        scene.entities.destroy(entities[3]);
+        scene.entities.remove<global_transform_component>(entities[4]);
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_entities_count(), 98u);
+        ASSERT_FALSE(scene.index.get_bounds(entities[3]));
+        ASSERT_FALSE(scene.index.get_bounds(entities[4]));
+        ASSERT_TRUE(scene.index.get_bounds(entities[5]));
+        ASSERT_TRUE(scene.index.get_tree().validate());
+
+        // A new entity reusing the slot of a destroyed one is indexed as well
+        const auto reused = scene.create({-100.f, 0.f, 0.f});
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_entities_count(), 99u);
+        ASSERT_EQ(scene.index.get_bounds(reused)->min, (vec3{-100.f, 0.f, 0.f}));
+        ASSERT_TRUE(scene.index.get_tree().validate());
+
+        // Removals are found even when entities are created in the same frame and the count doesn't change
+        scene.entities.destroy(entities[10]);
+        scene.entities.remove<global_transform_component>(entities[11]);
+        const auto added = scene.create({-200.f, 0.f, 0.f});
+        const auto addedToo = scene.create({-300.f, 0.f, 0.f});
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_entities_count(), 99u);
+        ASSERT_FALSE(scene.index.get_bounds(entities[10]));
+        ASSERT_FALSE(scene.index.get_bounds(entities[11]));
+        ASSERT_TRUE(scene.index.get_bounds(added));
+        ASSERT_TRUE(scene.index.get_bounds(addedToo));
+
+        result.clear();
+        scene.index.query(sphere{.center = {100.f, 0.f, 0.f}, .radius = 1.f}, result);
+        ASSERT_TRUE(result.empty());
+        ASSERT_TRUE(scene.index.get_tree().validate());
+    }
+
+    TEST(spatial_index, local_bounds)
+    {
+        spatial_index_test_scene scene;
+
+        // The pivot is far from the query, but the geometry extends into it
+        const auto e = scene.create({10.f, 0.f, 0.f});
+        scene.next_frame();
+
+        const aabb box{.min = {-1.f, -1.f, -1.f}, .max = {1.f, 1.f, 1.f}};
+        const frustum f = make_box_frustum(box);
+        const sphere s{.center = {}, .radius = 1.f};
+
+        dynamic_array<ecs::entity> result;
+        scene.index.query(box, result);
+        ASSERT_TRUE(result.empty());
+
+        scene.set_local_bounds(e, {.min = {-10.5f, -.5f, -.5f}, .max = {-9.5f, .5f, .5f}});
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_bounds(e)->min, (vec3{-.5f, -.5f, -.5f}));
+        ASSERT_EQ(scene.index.get_bounds(e)->max, (vec3{.5f, .5f, .5f}));
+
+        result.clear();
+        scene.index.query(box, result);
+        ASSERT_EQ(result.size(), 1u);
+        ASSERT_EQ(result[0], e);
+
+        result.clear();
+        scene.index.query(f, result);
+        ASSERT_EQ(result.size(), 1u);
+        ASSERT_EQ(result[0], e);
+
+        result.clear();
+        scene.index.query(s, result);
+        ASSERT_EQ(result.size(), 1u);
+        ASSERT_EQ(result[0], e);
+
+        // Bounds follow the transform
+        scene.move(e, {20.f, 0.f, 0.f});
+        scene.next_frame();
+
+        result.clear();
+        scene.index.query(box, result);
+        ASSERT_TRUE(result.empty());
+
+        result.clear();
+        scene.index.query(aabb{.min = {9.f, -1.f, -1.f}, .max = {11.f, 1.f, 1.f}}, result);
+        ASSERT_EQ(result.size(), 1u);
+
+        // Without the component the entity is a point again
+        scene.entities.remove<local_bounds_component>(e);
+        scene.next_frame();
+
+        ASSERT_EQ(scene.index.get_bounds(e)->min, (vec3{20.f, 0.f, 0.f}));
+        ASSERT_EQ(scene.index.get_bounds(e)->max, (vec3{20.f, 0.f, 0.f}));
+        ASSERT_TRUE(scene.index.get_tree().validate());
+    }
+}
@@ -22,8 +22,8 @@ namespace oblo
         job_manager& jm = *job_manager::get();
 
         const job_range firstJobRange{
-            .begin = 0,
-            .end = min(granularity, range.end),
+            .begin = range.begin,
+            .end = min(range.begin + granularity, range.end),
         };
 
         // We are passing a reference to the function here because the function is blocking and stays alive
@@ -54,13 +54,13 @@ namespace oblo
         job_manager& jm = *job_manager::get();
 
         const job_range firstJobRows{
-            .begin = 0,
-            .end = min(rowGranularity, rows.end),
+            .begin = rows.begin,
+            .end = min(rows.begin + rowGranularity, rows.end),
         };
 
         const job_range firstJobColumns{
-            .begin = 0,
-            .end = min(colGranularity, columns.end),
+            .begin = columns.begin,
+            .end = min(columns.begin + colGranularity, columns.end),
         };
 
         // We are passing a reference to the function here because the function is blocking and stays alive
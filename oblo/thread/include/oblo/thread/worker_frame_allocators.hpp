@@ -0,0 +1,60 @@
+#pragma once
+
+#include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/frame_allocator.hpp>
+#include <oblo/core/types.hpp>
+
+namespace oblo
+{
+    class job_manager;
+
+    /// @brief A set of frame allocators, one per job manager thread.
+    /// Each worker can allocate from its own allocator without synchronization, the whole set is meant to be reset
+    /// once all jobs using it are completed.
+    class worker_frame_allocators
+    {
+    public:
+        OBLO_THREAD_API worker_frame_allocators();
+        worker_frame_allocators(const worker_frame_allocators&) = delete;
+        OBLO_THREAD_API worker_frame_allocators(worker_frame_allocators&&) noexcept;
+        worker_frame_allocators& operator=(const worker_frame_allocators&) = delete;
+        OBLO_THREAD_API worker_frame_allocators& operator=(worker_frame_allocators&&) noexcept;
+        OBLO_THREAD_API ~worker_frame_allocators();
+
+        /// @brief Initializes one allocator for each thread of the job manager.
+        /// @param jm The job manager, the number of allocators matches its number of threads.
+        /// @param maxSizePerThread The virtual memory to reserve for each allocator.
+        /// @param chunkSize The commit granularity of each allocator.
+        [[nodiscard]] OBLO_THREAD_API bool init(
+            const job_manager& jm, usize maxSizePerThread, usize chunkSize = 4u << 20);
+
+        /// @brief Initializes one allocator for each thread of the job manager, with the given configuration.
+        [[nodiscard]] OBLO_THREAD_API bool init(const job_manager& jm, const frame_allocator_initializer& initializer);
+        OBLO_THREAD_API void shutdown();
+
+        /// @brief Returns the allocator for the calling thread.
+        /// @remarks The calling thread has to be a job manager thread.
+        OBLO_THREAD_API frame_allocator& get_current();
+
+        OBLO_THREAD_API frame_allocator& get(u32 threadIndex);
+        OBLO_THREAD_API const frame_allocator& get(u32 threadIndex) const;
+
+        OBLO_THREAD_API u32 get_threads_count() const;
+
+        /// @brief Resets all allocators and notifies them of the end of the frame, for their shrink policy.
+        /// @remarks Must not be called while jobs might still be allocating.
+        OBLO_THREAD_API void restore_all();
+
+        /// @brief Returns the sum of the high-water marks of all allocators.
+        OBLO_THREAD_API usize get_high_water_mark() const;
+
+        /// @brief Returns the highest high-water mark of a single allocator.
+        OBLO_THREAD_API usize get_max_thread_high_water_mark() const;
+
+        OBLO_THREAD_API void reset_high_water_marks();
+
+    private:
+        const job_manager* m_jobManager{};
+        dynamic_array<frame_allocator> m_allocators;
+    };
+}
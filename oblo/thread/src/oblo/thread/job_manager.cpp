@@ -1,7 +1,9 @@
 #include <oblo/thread/job_manager.hpp>
 
+#include <oblo/core/allocation_tracking.hpp>
 #include <oblo/core/compressed_pointer_with_flags.hpp>
 #include <oblo/core/dynamic_array.hpp>
+#include <oblo/core/stl/memory_resource_adapter.hpp>
 #include <oblo/trace/profile.hpp>
 
 #include <moodycamel/concurrentqueue.h>
@@ -87,12 +89,14 @@ namespace oblo
 
         void* allocate_job()
         {
-            return ::operator new(sizeof(job_impl), std::align_val_t(alignof(job_impl)));
+            return select_global_allocator<alignof(job_impl)>(allocation_tag::jobs)
+                ->allocate(sizeof(job_impl), alignof(job_impl));
         }
 
         void deallocate_job(job_impl* j)
         {
-            ::operator delete(j, std::align_val_t(alignof(job_impl)));
+            select_global_allocator<alignof(job_impl)>(allocation_tag::jobs)
+                ->deallocate(reinterpret_cast<byte*>(j), sizeof(job_impl), alignof(job_impl));
         }
 
         struct worker_thread_context
@@ -194,10 +198,16 @@ namespace oblo
 
         void worker_thread_init(job_manager* manager, u32 id, job_queue* q, std::atomic<worker_state>* state)
         {
-#ifdef TRACY_ENABLE
+#if defined(TRACY_ENABLE) || defined(OBLO_TRACE_RECORDER)
+            // The buffer is zero-initialized, we leave space for the null terminator
             char threadName[64]{};
-            std::format_to_n(threadName, 64, "{}oblo worker #{}", id == 0 ? "main - " : "", id);
+            std::format_to_n(threadName, 63, "{}oblo worker #{}", id == 0 ? "main - " : "", id);
+#endif
+
+#ifdef TRACY_ENABLE
             tracy::SetThreadName(threadName);
+#elif defined(OBLO_TRACE_RECORDER)
+            trace::set_thread_name(threadName);
 #endif
 
             s_tlsWorkerCtx = {
@@ -255,9 +265,14 @@ namespace oblo
 
     struct job_manager::impl
     {
-        explicit impl(u32 numThreads) : threads{get_global_allocator(), numThreads} {}
+        explicit impl(u32 numThreads) :
+            threads{get_global_allocator(), numThreads},
+            userdataUpstream{get_global_aligned_allocator(allocation_tag::jobs)}, userdataPool{&userdataUpstream}
+        {
+        }
 
         dynamic_array<worker_thread> threads;
+        memory_resource_adapter userdataUpstream;
         std::pmr::synchronized_pool_resource userdataPool;
         semaphore workReady;
     };
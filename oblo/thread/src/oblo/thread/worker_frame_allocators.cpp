@@ -0,0 +1,117 @@
+#include <oblo/thread/worker_frame_allocators.hpp>
+
+#include <oblo/core/debug.hpp>
+#include <oblo/core/utility.hpp>
+#include <oblo/thread/job_manager.hpp>
+
+namespace oblo
+{
+    worker_frame_allocators::worker_frame_allocators() = default;
+
+    worker_frame_allocators::worker_frame_allocators(worker_frame_allocators&&) noexcept = default;
+
+    worker_frame_allocators& worker_frame_allocators::operator=(worker_frame_allocators&&) noexcept = default;
+
+    worker_frame_allocators::~worker_frame_allocators()
+    {
+        shutdown();
+    }
+
+    bool worker_frame_allocators::init(const job_manager& jm, usize maxSizePerThread, usize chunkSize)
+    {
+        return init(jm, {.maxSize = maxSizePerThread, .chunkSize = chunkSize});
+    }
+
+    bool worker_frame_allocators::init(const job_manager& jm, const frame_allocator_initializer& initializer)
+    {
+        if (m_jobManager)
+        {
+            return false;
+        }
+
+        const u32 numThreads = jm.get_num_threads();
+
+        m_allocators = dynamic_array<frame_allocator>{get_global_allocator(), numThreads};
+
+        for (auto& allocator : m_allocators)
+        {
+            if (!allocator.init(initializer))
+            {
+                m_allocators.clear();
+                return false;
+            }
+        }
+
+        m_jobManager = &jm;
+
+        return true;
+    }
+
+    void worker_frame_allocators::shutdown()
+    {
+        m_allocators.clear();
+        m_jobManager = nullptr;
+    }
+
+    frame_allocator& worker_frame_allocators::get_current()
+    {
+        OBLO_ASSERT(m_jobManager);
+        return m_allocators[m_jobManager->get_current_thread()];
+    }
+
+    frame_allocator& worker_frame_allocators::get(u32 threadIndex)
+    {
+        return m_allocators[threadIndex];
+    }
+
+    const frame_allocator& worker_frame_allocators::get(u32 threadIndex) const
+    {
+        return m_allocators[threadIndex];
+    }
+
+    u32 worker_frame_allocators::get_threads_count() const
+    {
+        return m_allocators.size32();
+    }
+
+    void worker_frame_allocators::restore_all()
+    {
+        for (auto& allocator : m_allocators)
+        {
+            allocator.restore_all();
+            allocator.end_frame();
+        }
+    }
+
+    usize worker_frame_allocators::get_high_water_mark() const
+    {
+        usize highWaterMark{0};
+
+        for (const auto& allocator : m_allocators)
+        {
+            highWaterMark += allocator.get_high_water_mark();
+        }
+
+        return highWaterMark;
+    }
+
+    usize worker_frame_allocators::get_max_thread_high_water_mark() const
+    {
+        usize highWaterMark{0};
+
+        for (const auto& allocator : m_allocators)
+        {
+            highWaterMark = max(highWaterMark, allocator.get_high_water_mark());
+        }
+
+        return highWaterMark;
+    }
+
+    void worker_frame_allocators::reset_high_water_marks()
+    {
+        for (auto& allocator : m_allocators)
+        {
+            allocator.reset_high_water_mark();
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <oblo/core/frame_allocator.hpp>
+#include <oblo/thread/job_manager.hpp>
+#include <oblo/thread/parallel_for.hpp>
+#include <oblo/thread/worker_frame_allocators.hpp>
+
+#include <atomic>
+
+namespace oblo
+{
+    TEST(worker_frame_allocators, parallel_allocations)
+    {
+        job_manager jm;
+        ASSERT_TRUE(jm.init());
+
+        {
+            worker_frame_allocators allocators;
+            ASSERT_TRUE(allocators.init(jm, 1u << 24));
+            ASSERT_EQ(allocators.get_threads_count(), jm.get_num_threads());
+
+            constexpr u32 N{1024};
+            constexpr usize AllocationSize{256};
+
+            std::atomic<u32> failures{};
+
+            parallel_for(
+                [&](const job_range& range)
+                {
+                    auto& allocator = allocators.get_current();
+
+                    for (u32 i = range.begin; i < range.end; ++i)
+                    {
+                        auto* const ptr = allocator.allocate(AllocationSize, 16);
+
+                        if (!ptr || !allocator.contains(ptr))
+                        {
+                            ++failures;
+                        }
+                    }
+                },
+                job_range{0, N},
+                16);
+
+            ASSERT_EQ(failures, 0);
+            ASSERT_EQ(allocators.get_high_water_mark(), N * AllocationSize);
+            ASSERT_GE(allocators.get_max_thread_high_water_mark(), AllocationSize);
+
+            allocators.restore_all();
+
+            for (u32 i = 0; i < allocators.get_threads_count(); ++i)
+            {
+                ASSERT_EQ(allocators.get(i).get_allocated_memory_size(), 0);
+            }
+
+            allocators.reset_high_water_marks();
+            ASSERT_EQ(allocators.get_high_water_mark(), 0);
+        }
+
+        jm.shutdown();
+    }
+}
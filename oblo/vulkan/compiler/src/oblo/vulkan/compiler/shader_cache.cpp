@@ -156,11 +156,14 @@ namespace oblo::vk
         }
 
         const auto sourceCode = result.get_source_code();
-        u64 id = hash_xxh64(sourceCode.data(), sourceCode.size());
 
-        id = hash_xxh64(&stage, sizeof(stage), id);
-        id = hash_xxh64(&compilerOptions.codeOptimization, sizeof(compilerOptions.codeOptimization), id);
-        id = hash_xxh64(&compilerOptions.generateDebugInfo, sizeof(compilerOptions.generateDebugInfo), id);
+        hasher idHasher;
+        idHasher.update(sourceCode.data(), sourceCode.size());
+        idHasher.update(stage);
+        idHasher.update(compilerOptions.codeOptimization);
+        idHasher.update(compilerOptions.generateDebugInfo);
+
+        const u64 id = idHasher.digest();
 
         string_builder spvPath;
         spvPath.append(m_path).append_path_separator().format("{}_{}.spirv", debugName, id);
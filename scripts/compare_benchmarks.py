@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON reports, e.g. the output of the oblo_benchmarks_json target.
+
+Usage: compare_benchmarks.py baseline.json current.json [--threshold 0.1] [--metric real_time|cpu_time]
+
+Exits with a non-zero code when any benchmark regressed by more than the threshold.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load_results(path, metric):
+    with open(path, "r", encoding="utf-8") as f:
+        report = json.load(f)
+
+    results = {}
+
+    for entry in report.get("benchmarks", []):
+        if entry.get("error_occurred"):
+            continue
+
+        run_type = entry.get("run_type", "iteration")
+        aggregate = entry.get("aggregate_name", "")
+
+        if run_type == "aggregate":
+            # Prefer the median, it's less sensitive to outliers than the mean
+            if aggregate != "median":
+                continue
+
+            name = entry.get("run_name", entry["name"])
+        else:
+            name = entry["name"]
+
+            # When repetitions are reported individually, keep the aggregate if we already have it
+            if name in results and results[name][1]:
+                continue
+
+        results[name] = (entry[metric], run_type == "aggregate", entry.get("time_unit", "ns"))
+
+    return {name: (value, unit) for name, (value, _, unit) in results.items()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares two benchmark JSON reports and flags regressions")
+    parser.add_argument("baseline", help="JSON report used as reference")
+    parser.add_argument("current", help="JSON report to compare against the baseline")
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=0.1,
+        help="Relative slowdown above which a benchmark is considered a regression (default: 0.1)",
+    )
+    parser.add_argument("--metric", choices=["real_time", "cpu_time"], default="real_time")
+    args = parser.parse_args()
+
+    baseline = load_results(args.baseline, args.metric)
+    current = load_results(args.current, args.metric)
+
+    names = [name for name in current if name in baseline]
+    width = max([len(name) for name in names] + [len("Benchmark")])
+
+    print(f"{'Benchmark':<{width}}  {'Baseline':>14}  {'Current':>14}  {'Change':>9}")
+
+    regressions = []
+
+    for name in names:
+        base_value, unit = baseline[name]
+        value, _ = current[name]
+
+        change = (value - base_value) / base_value if base_value > 0 else 0.0
+        marker = ""
+
+        if change > args.threshold:
+            marker = "  REGRESSION"
+            regressions.append(name)
+        elif change < -args.threshold:
+            marker = "  improved"
+
+        print(
+            f"{name:<{width}}  {base_value:>11.1f} {unit:<2}  {value:>11.1f} {unit:<2}  {change:>+8.1%}{marker}"
+        )
+
+    for name in sorted(set(baseline) - set(current)):
+        print(f"Missing from current: {name}")
+
+    for name in sorted(set(current) - set(baseline)):
+        print(f"New benchmark: {name}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) regressed by more than {args.threshold:.0%}")
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())